@@ -133,6 +133,16 @@ VOIDPTR buf;
     return ((mode == DTMLOCAL) ? (size / 16) : (size * 16));
 }
 
+/*
+	dtm_data_order()
+	Byte order of datasets as this host writes them.  No conversion
+	is done here, so that is the order of the machine itself.
+*/
+int dtm_data_order()
+{
+    return dtm_local_order();
+}
+
 /* conversion routine function table */
 int (*DTMconvertRtns[])() = {
     dtm_char,
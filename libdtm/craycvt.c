@@ -200,6 +200,16 @@ static int dtm_triplet(mode, buf, size)
 }
 
 
+/*
+	dtm_data_order()
+	Datasets are converted to the DTM standard, big endian, order
+	before they are written.
+*/
+int dtm_data_order()
+{
+  return DTM_BIG_ENDIAN;
+}
+
 /* conversion routine function table */
 int	(*DTMconvertRtns[])() = {
 		dtm_char,
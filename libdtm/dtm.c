@@ -317,6 +317,8 @@ typedef struct {
     int32 hdr_size;
     int32 data_size;
     int32 end_data;
+    int data;                   /* iovec index of the dataset, or -1 */
+    char hdr[DTM_MAX_HEADER];   /* header with the byte order tag added */
 } IOV_BUF;
 
 unsigned int uDTMdbg;
@@ -341,6 +343,8 @@ static int writev_buffer DTM_PROTO((DTMPORT * pp, IOV_BUF * iov_buf, int fStartS
 static int check_header_write_ack DTM_PROTO((DTMPORT * pp));
 static int verify_out_connections DTM_PROTO((DTMPORT * pp));
 static int clear_write_flags DTM_PROTO((DTMPORT * pp));
+static int get_credit DTM_PROTO((Outport * pcur, int fWait));
+static int take_credit DTM_PROTO((DTMPORT * pp));
 #endif
 
 /*
@@ -362,6 +366,7 @@ Outport **ppcur;
        Send to the server...?
        -john
      */
+    dtm_shm_close(pcur->connfd);
     (void)dtm_end_connect(pcur->connfd);
     pcur->seqstart = FALSE;
     pcur->availwrite = FALSE;
@@ -439,6 +444,8 @@ DTMPORT *pp;
                 DBGFLOW("make_out_connections: dtm_connect fails \n");
                 return DTMERROR;
             }
+            if (pp->fShm)
+                dtm_shm_create(pcur->connfd);
         }
     }
     return DTM_OK;
@@ -486,6 +493,68 @@ DTMPORT *pp;
     return DTM_OK;
 }
 
+/*
+	get_credit()
+	DTM_WINDOW only.  Ask for a window on a new connection, then
+	collect whatever credit the reader has returned.  With fWait,
+	block until there is at least one credit.
+	Returns: TRUE if a dataset may be sent, FALSE if not, DTMERROR.
+*/
+#ifdef DTM_PROTOTYPES
+static int get_credit(Outport *pcur, int fWait)
+#else
+static int get_credit(pcur, fWait)
+Outport *pcur;
+int fWait;
+#endif
+{
+    int32 tmp;
+    int ack;
+
+    if (!pcur->fWindowSent) {
+        DBGMSG1("get_credit: asking for window of %d\n", DTMWindowSize);
+        CHECK_ERR(dtm_send_ack(pcur->connfd, DTMWindowSize));
+        pcur->fWindowSent = TRUE;
+        pcur->credit = 0;
+    }
+
+    while ((fWait && pcur->credit < 1)
+           || (dtm_select(pcur->connfd, &tmp, 0) == TRUE && tmp >= 4)) {
+        CHECK_ERR(dtm_recv_ack(pcur->connfd, &ack));
+        /* the reader's first CTS counts as one credit */
+        pcur->credit += (ack == DTM_CTS) ? 1 : ack;
+        DBGMSG1("get_credit: credit now %d\n", pcur->credit);
+    }
+    return pcur->credit > 0;
+}
+
+/*
+	take_credit()
+	DTM_WINDOW only.  Wait for a credit on each out port and spend it
+	on the dataset about to be written.
+*/
+#ifdef DTM_PROTOTYPES
+static int take_credit(DTMPORT *pp)
+#else
+static int take_credit(pp)
+DTMPORT *pp;
+#endif
+{
+    Outport *pcur;
+
+    FOR_EACH_OUT_PORT(pcur, pp) {
+        if (pcur->connfd == DTM_NO_CONNECTION)
+            continue;
+        if (get_credit(pcur, DTM_WAIT) == DTMERROR) {
+            DBGFLOW("take_credit: lost connection\n");
+            CHECK_ERR(destroy_out_port(pp, &pcur));
+            continue;
+        }
+        pcur->credit--;
+    }
+    return DTM_OK;
+}
+
 /*
 	check_header_write_ack()
 	!!!! Check to see whether a header write acknowledge is required,
@@ -502,6 +571,10 @@ DTMPORT *pp;
 {
     Outport *pcur;
 
+    /* credit already taken care of this one */
+    if (pp->qservice == DTM_WINDOW)
+        return DTM_OK;
+
     FOR_EACH_OUT_PORT(pcur, pp) {
         if (pcur->connfd == DTM_NO_CONNECTION)
             continue;
@@ -559,6 +632,7 @@ int datasize;
 
     i = 0;
     iov->iovsize = 0;
+    iov->data = -1;
 
     if (fStartSeq) {
         DBGMSG("make_write_iov: making start seq\n");
@@ -575,6 +649,10 @@ int datasize;
 
     if (hdrsize != 0) {
         DBGMSG("make_write_iov: making header\n");
+        if ((status = dtm_tag_order(hdr, hdrsize, iov->hdr)) > 0) {
+            hdr = iov->hdr;
+            hdrsize = status;
+        }
         iov->hdr_size = hdrsize;
         STDINT(iov->hdr_size);
         iov->iovec[i].iov_base = (char *)&iov->hdr_size;
@@ -596,6 +674,7 @@ int datasize;
         iov->iovec[i].iov_base = (char *)&iov->data_size;
         iov->iovec[i].iov_len = 4;
         i += 1;
+        iov->data = i;
         iov->iovec[i].iov_base = (char *)data;
         iov->iovec[i].iov_len = datasize;
         i += 1;
@@ -628,6 +707,7 @@ int fStartSeq;
     struct iovec *iov;
     int32 iovlen;
     int32 iovsize;
+    DTMshm *shm;
 
     FOR_EACH_OUT_PORT(pcur, pp) {
         int status;
@@ -654,7 +734,12 @@ int fStartSeq;
         DBGMSG1("writev_buffer: ptr iov = %X\n", iov);
         DBGMSG1("writev_buffer: first ptr word = %X\n", iov[0].iov_base);
         DBGMSG1("writev_buffer: first word = %d\n", *(int *)((iov[0]).iov_base));
-        status = dtm_writev_buffer(pcur->connfd, iov, iovlen, iovsize, NULL, 0);
+        /* big datasets to a local reader go through shared memory */
+        if (iov_buf->data >= 0 && iov_buf->iovec[iov_buf->data].iov_len >= DTM_SHM_MIN
+            && (shm = dtm_shm_find(pcur->connfd)) != NULL)
+            status = dtm_shm_writev(shm, iov, iovlen, iov_buf->data - (iov - iov_buf->iovec));
+        else
+            status = dtm_writev_buffer(pcur->connfd, iov, iovlen, iovsize, NULL, 0);
 
         DBGINT("writev_buffer - status = %d\n", status);
 
@@ -763,6 +848,7 @@ int fd;
     inp->fd = fd;
     inp->blocklen = DTM_NEW_DATASET;
     inp->fCTSsent = FALSE;
+    inp->fGotRTS = FALSE;
 #define	PUT_NEW_IN_PORTS_AT_END
 #ifdef PUT_NEW_IN_PORTS_AT_END
     {
@@ -1104,6 +1190,7 @@ DTMPORT *pp;
     if (pp->Xcallback)
         pp->XremoveInput(inp->XinputId);
 
+    dtm_shm_close(inp->fd);
     close(inp->fd);
 
     if (pp->nextToRead == inp)
@@ -1185,7 +1272,8 @@ int fWait;
         DBGMSG1("send_cts: while loop port %X\n", inp);
         DBGMSG1("send_cts: while loop port fd %d\n", inp->fd);
         if (!inp->fCTSsent && ((fWait && (iSent == 1)) || (dtm_select(inp->fd, &tmp, 0) == TRUE && tmp >= 4))) {
-            if (dtm_send_ack(inp->fd, DTM_CTS) == DTMERROR) {
+            /* a DTM_WINDOW writer already has credit, no CTS */
+            if (!inp->window && dtm_send_ack(inp->fd, DTM_CTS) == DTMERROR) {
                 CHECK_ERR(dtm_destroy_in_port(inp, pp));
                 /*
                    Never hurts to start at the top.
@@ -1211,6 +1299,57 @@ int fWait;
     return DTM_OK;
 }
 
+/*
+	accept_rts()
+	Read the RTS that comes ahead of a header.  A DTM_WINDOW writer
+	asks for its window first: the CTS already sent was its first
+	credit, grant the rest and go on to the real RTS.  Without fWait,
+	stop short of blocking.
+	Returns: TRUE if the RTS has been read, FALSE if not yet, DTMERROR.
+*/
+#ifdef DTM_PROTOTYPES
+static int accept_rts(DTMPORT *pp, Inport *inp, int fWait)
+#else
+static int accept_rts(pp, inp, fWait)
+DTMPORT *pp;
+Inport *inp;
+int fWait;
+#endif
+{
+    int32 tmp;
+    int ack;
+
+    while (!inp->fGotRTS) {
+        if (!fWait && (dtm_select(inp->fd, &tmp, 0) != TRUE || tmp < 4))
+            return FALSE;
+        DBGMSG1("Accepting RTS on %d\n", inp->fd);
+        if (dtm_recv_ack(inp->fd, &ack) == DTMERROR) {
+            dtm_destroy_in_port(inp, pp);
+            return DTMERROR;
+        }
+        if (ack > 0 && !inp->window) {
+            inp->window = (ack < DTMWindowSize) ? ack : DTMWindowSize;
+            if (inp->window < 1)
+                inp->window = 1;
+            inp->consumed = 0;
+            DBGMSG1("Granting window of %d\n", inp->window);
+            if (inp->window > 1 && dtm_send_ack(inp->fd, inp->window - 1) == DTMERROR) {
+                dtm_destroy_in_port(inp, pp);
+                return DTMERROR;
+            }
+            continue;
+        }
+        if (ack != DTM_RTS) {
+            DTMerrno = DTMBADACK;
+            DBGMSG1("Something other than RTS received %d\n", ack);
+            dtm_destroy_in_port(inp, pp);
+            return DTMERROR;
+        }
+        inp->fGotRTS = TRUE;
+    }
+    return TRUE;
+}
+
 #ifdef DTM_PROTOTYPES
 static int accept_one_header(DTMPORT *pp, void *header, int size)
 #else
@@ -1221,25 +1360,17 @@ int size;
 #endif
 {
     Inport *inp = pp->nextToRead;
+    char hdr[DTM_MAX_HEADER];
+    char *buf;
     int count;
-    int ack;
+    int order;
 
     if (inp == NULL || !inp->fCTSsent || inp->fGotHeader) {
         DTMerrno = DTMCALL;
         return DTMERROR;
     }
 
-    DBGMSG1("Accepting RTS on %d\n", inp->fd);
-    if (dtm_recv_ack(inp->fd, &ack) == DTMERROR) {
-        dtm_destroy_in_port(inp, pp);
-        return DTMERROR;
-    }
-    if (ack != DTM_RTS) {
-        DTMerrno = DTMBADACK;
-        DBGMSG1("Something other than RTS received %d\n", ack);
-        dtm_destroy_in_port(inp, pp);
-        return DTMERROR;
-    }
+    CHECK_ERR(accept_rts(pp, inp, DTM_WAIT));
 #if 0
     /*      There are no header ack */
     if (dtm_send_ack(inp->fd, DTM_CTS) == DTMERROR) {
@@ -1248,13 +1379,30 @@ int size;
     }
 #endif
     DBGINT("Accepting header on %d\n", inp->fd);
-    if ((count = dtm_read_header(inp->fd, header, size)) < 0) {
+
+    /*
+       A tagged header may be a little longer than the one the writer
+       gave, and so longer than the caller expects: read short headers
+       here and hand back only what is left once the tag is removed.
+     */
+    buf = (size < DTM_MAX_HEADER) ? hdr : (char *)header;
+    if ((count = dtm_read_header(inp->fd, buf,
+                    (buf == hdr) ? DTM_MAX_HEADER : size)) < 0) {
         DBGINT("Recv header error = %d\n", errno);
         if (DTMerrno != DTMHEADER) {
             dtm_destroy_in_port(inp, pp);
         }
         return DTMERROR;
     }
+    order = dtm_untag_order(buf, &count);
+    inp->fSwap = (order != 0 && order != dtm_data_order());
+    if (buf == hdr) {
+        memcpy(header, hdr, (count < size) ? count : size);
+        if (count > size) {
+            DTMerrno = DTMHEADER;
+            return DTMERROR;
+        }
+    }
     inp->fGotHeader = TRUE;
     return count;
 }
@@ -1313,6 +1461,8 @@ int p;
     Sock_set sockset;
     int socknum;
     int fAnyReady;
+    Inport *inp;
+    int32 tmp;
 
     DBGFLOW("DTMavailRead called\n");
     DTMerrno = DTMNOERR;
@@ -1335,6 +1485,22 @@ int p;
                 return DTMERROR;
         }
     }
+
+    /*
+       A window request alone is not a header: take it now, so that
+       DTMbeginRead does not block on a dataset that was never sent.
+     */
+    inp = DTMpt[p]->nextToRead;
+    if (fAnyReady && inp != NULL && inp->fCTSsent && !inp->fGotHeader
+        && !inp->window && !inp->fGotRTS
+        && dtm_select(inp->fd, &tmp, 0) == TRUE && tmp >= 4) {
+        if ((fAnyReady = accept_rts(DTMpt[p], inp, DTM_DONT_WAIT)) == DTMERROR) {
+            if (DTMerrno == DTMEOF)
+                fAnyReady = FALSE;
+            else
+                return DTMERROR;
+        }
+    }
     DBGMSG("DTMavailRead done\n");
     return fAnyReady;
 }
@@ -1475,6 +1641,11 @@ DTMTYPE type;
      */
     CHECK_ERR(size = dtm_read_buffer(inp->fd, &inp->blocklen, ds, size));
 
+    /* put it in the byte order the conversion routines expect */
+
+    if (inp->fSwap)
+        dtm_swap_buffer(type, ds, size);
+
     /* convert dataset to local representation */
 
     return (*DTMconvertRtns[(int)type]) (DTMLOCAL, ds, size);
@@ -1515,7 +1686,18 @@ int p;
 
     while (dtm_read_buffer(inp->fd, &inp->blocklen, dtm_discard, DISCARDSIZE) > 0);
     inp->fCTSsent = FALSE;
+    inp->fGotRTS = FALSE;
     inp->fGotHeader = FALSE;
+
+    /* hand DTM_WINDOW credit back once half the window is used */
+    if (inp->window && ++inp->consumed >= (inp->window + 1) / 2) {
+        if (dtm_send_ack(inp->fd, inp->consumed) == DTMERROR) {
+            DBGMSG("DTMendRead: could not return credit\n");
+            CHECK_ERR(dtm_destroy_in_port(inp, pp));
+            return DTM_OK;
+        }
+        inp->consumed = 0;
+    }
     return DTM_OK;
 }
 
@@ -1618,6 +1800,21 @@ int port;
                 ++err_count;
                 continue;
             }
+            if (pp->fShm)
+                dtm_shm_create(pcur->connfd);
+        }
+
+        if (pp->qservice == DTM_WINDOW) {
+            int fCredit;
+
+            if ((fCredit = get_credit(pcur, DTM_DONT_WAIT)) == DTMERROR) {
+                CHECK_ERR(destroy_out_port(pp, &pcur));
+                ++err_count;
+                continue;
+            }
+            if (!fCredit)
+                rstatus = DTM_PORT_NOT_READY;
+            continue;
         }
 
         DBGINT("DTMavailWrite: availWrite = %d\n", pcur->availwrite);
@@ -1683,6 +1880,29 @@ int port;
     return (err_count != 0) ? DTM_PORT_NOT_READY : rstatus;
 }
 
+/*
+	DTMsetWindowSize()
+	Set how many datasets a DTM_WINDOW port may have in flight per
+	connection.  Affects connections made after the call.
+	Returns the previous setting.
+*/
+#ifdef DTM_PROTOTYPES
+int DTMsetWindowSize(int credits)
+#else
+int DTMsetWindowSize(credits)
+int credits;
+#endif
+{
+    int old = DTMWindowSize;
+
+    if (credits < 1) {
+        DTMerrno = DTMCALL;
+        return DTMERROR;
+    }
+    DTMWindowSize = credits;
+    return old;
+}
+
 /*
 	Function to write user's header.
 
@@ -1711,6 +1931,8 @@ int size;
     if (!pp->fLastWasSuccessfulAvailWrite)
         CHECK_ERR(dtm_check_server(pp, DTM_WAIT));
     CHECK_ERR(make_out_connections(pp));
+    if (pp->qservice == DTM_WINDOW)
+        CHECK_ERR(take_credit(pp));
     make_write_iov(&iov_buf, START_SEQ, NO_END_SEQ, header, size, NULL, 0);
     DBGMSG1("DTMbeginWrite: before writev_buffer with %d ports\n", outp_count(pp));
     CHECK_ERR(writev_buffer(pp, &iov_buf, START_SEQ));
@@ -1831,6 +2053,8 @@ DTMTYPE datatype;
         CHECK_ERR(dtm_check_server(pp, DTM_WAIT));
     CHECK_ERR(make_out_connections(pp));
     CHECK_ERR(verify_out_connections(pp));
+    if (pp->qservice == DTM_WINDOW)
+        CHECK_ERR(take_credit(pp));
     datasize = (*DTMconvertRtns[(int)datatype]) (DTMSTD, data, datasize);
     make_write_iov(&iov_buf, START_SEQ, END_SEQ, hdr, hdrsize, data, datasize);
     CHECK_ERR(writev_buffer(pp, &iov_buf, START_SEQ));
@@ -199,7 +199,8 @@ struct DTM_TRIPLET {
 #define	DTM_DEFAULT		DTM_SYNC
 typedef	enum	{
 	DTM_SYNC=0,
-	DTM_ASYNC
+	DTM_ASYNC,
+	DTM_WINDOW	/* credit based, both ends must support it */
 } DTMqserv ;
 
 /* Environmental variables used by DTM name server */
@@ -284,6 +285,8 @@ extern int	DTMendRead		DTM_PROTO(( int port ));
 extern int	DTMendWrite		DTM_PROTO(( int port ));
 extern int	DTMreadMsg		DTM_PROTO(( int p, char *hdr, int hdrsize, 
 								VOIDPTR data, int datasize, int datatype ));
+extern int	DTMwriteMsg		DTM_PROTO(( int p, char *hdr, int hdrsize, 
+								VOIDPTR data, int datasize, DTMTYPE datatype ));
 extern int	DTMdestroyPort	DTM_PROTO(( int port));
 extern char	*DTMerrmsg();
 extern int	DTMgetPortAddr	DTM_PROTO(( int port, char * addr, int length ));
@@ -304,6 +307,7 @@ extern int	DTMrecvServerMsg	DTM_PROTO(( int fd, int len, void * buffer ));
 extern int	DTMreadReady		DTM_PROTO(( int port, void  (*func)() ));
 
 extern int	DTMgetConnectionCount DTM_PROTO(( int port, int * n_connects ));
+extern int	DTMsetWindowSize	DTM_PROTO(( int credits ));
 
 /*	If you do not have X included you are not likely to use this function */
 typedef	(*DTMfuncPtr)();
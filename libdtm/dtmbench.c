@@ -0,0 +1,248 @@
+/*****************************************************************************
+*
+*                         NCSA DTM version 2.3
+*                               May 1, 1992
+*
+* NCSA DTM Version 2.3 source code and documentation are in the public
+* domain.  Specifically, we give to the public domain all rights for future
+* licensing of the source code, all resale rights, and all publishing rights.
+*
+* We ask, but do not require, that the following message be included in all
+* derived works:
+*
+* Portions developed at the National Center for Supercomputing Applications at
+* the University of Illinois at Urbana-Champaign.
+*
+* THE UNIVERSITY OF ILLINOIS GIVES NO WARRANTY, EXPRESSED OR IMPLIED, FOR THE
+* SOFTWARE AND/OR DOCUMENTATION PROVIDED, INCLUDING, WITHOUT LIMITATION,
+* WARRANTY OF MERCHANTABILITY AND WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE
+*
+*****************************************************************************/
+
+/*
+	dtmbench - DTM throughput benchmark.
+
+	Forks a reader, then writes a run of 1 KB, 64 KB and 16 MB
+	datasets to it over a local connection: with DTM_SYNC (an RTS/CTS
+	round trip per dataset), with DTM_WINDOW (credit based) and with
+	DTM_WINDOW through an "shm:" address (shared memory ring).  Prints
+	datasets and megabytes per second.
+
+	usage: dtmbench [-w window] [-s sync|window|shm] [-n scale]
+		-w	credits per connection for DTM_WINDOW (default 8)
+		-s	run only the given mode
+		-n	multiply the number of datasets sent by scale
+
+	Build with "make dtmbench" after building the library.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "dtm.h"
+
+static struct {
+    int	size;
+    int	count;
+} runs[] = {
+    { 1024,			4000 },
+    { 64 * 1024,	1000 },
+    { 16 * 1024 * 1024,	16 }
+};
+#define	NUM_RUNS	(sizeof(runs) / sizeof(runs[0]))
+
+static double now()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/*
+	reader()
+	Child side: read count datasets of size bytes, then exit.
+	The port address goes back to the parent through fd.
+*/
+static void reader(fd, size, count)
+int fd;
+int size;
+int count;
+{
+    char header[DTM_MAX_HEADER];
+    char addr[128];
+    char *buf;
+    int in, i;
+
+    if ((in = DTMmakeInPort(":0", DTM_DEFAULT)) == DTMERROR) {
+        fprintf(stderr, "dtmbench: can't make in port: %s\n", DTMerrmsg(1));
+        exit(1);
+    }
+    DTMgetPortAddr(in, addr, sizeof(addr));
+    write(fd, addr, sizeof(addr));
+    close(fd);
+
+    if ((buf = (char *)malloc(size)) == NULL) {
+        fprintf(stderr, "dtmbench: out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < count; i++) {
+        if (DTMreadMsg(in, header, sizeof(header), buf, size, DTM_CHAR)
+            == DTMERROR) {
+            fprintf(stderr, "dtmbench: read %d failed: %s\n", i,
+                DTMerrmsg(1));
+            exit(1);
+        }
+    }
+    exit(0);
+}
+
+/*
+	run()
+	Send count datasets of size bytes with the given quality of service.
+	Returns the elapsed time in seconds, or -1.0 on error.
+*/
+static double run(qservice, prefix, size, count)
+int qservice;
+char *prefix;
+int size;
+int count;
+{
+    char header[DTM_MAX_HEADER];
+    char addr[128], outaddr[140];
+    char *buf;
+    int fds[2], out, i, status;
+    pid_t pid;
+    double start, elapsed;
+
+    if (pipe(fds) < 0) {
+        perror("dtmbench: pipe");
+        return -1.0;
+    }
+    fflush(stdout);
+    if ((pid = fork()) == 0) {
+        close(fds[0]);
+        reader(fds[1], size, count);
+    }
+    close(fds[1]);
+    if (pid < 0 || read(fds[0], addr, sizeof(addr)) != sizeof(addr)) {
+        fprintf(stderr, "dtmbench: reader did not start\n");
+        close(fds[0]);
+        return -1.0;
+    }
+    close(fds[0]);
+
+    if ((buf = (char *)malloc(size)) == NULL) {
+        fprintf(stderr, "dtmbench: out of memory\n");
+        kill(pid, SIGTERM);
+        waitpid(pid, &status, 0);
+        return -1.0;
+    }
+    memset(buf, 'x', size);
+    DTMsetClass(header);
+
+    sprintf(outaddr, "%s%s", prefix, addr);
+    if ((out = DTMmakeOutPort(outaddr, qservice)) == DTMERROR) {
+        fprintf(stderr, "dtmbench: can't make out port %s: %s\n", outaddr,
+            DTMerrmsg(1));
+        kill(pid, SIGTERM);
+        waitpid(pid, &status, 0);
+        free(buf);
+        return -1.0;
+    }
+
+    start = now();
+    for (i = 0; i < count; i++) {
+        if (DTMwriteMsg(out, header, DTMHL(header), buf, size, DTM_CHAR)
+            == DTMERROR) {
+            /*
+               A DTM_SYNC writer may still be waiting for a CTS on the
+               last dataset when the reader, having read everything,
+               exits.  That shows up here as DTMEOF.
+             */
+            if (i == count - 1 && DTMerrno == DTMEOF) {
+                i++;
+                break;
+            }
+            fprintf(stderr, "dtmbench: write %d failed: %s\n", i,
+                DTMerrmsg(1));
+            kill(pid, SIGTERM);
+            break;
+        }
+    }
+    /* the last dataset is only done when the reader has it */
+    waitpid(pid, &status, 0);
+    elapsed = now() - start;
+
+    DTMdestroyPort(out);
+    free(buf);
+
+    if (i < count || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return -1.0;
+    return elapsed;
+}
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+    static char *names[] = { "sync", "window", "shm" };
+    static int modes[] = { DTM_SYNC, DTM_WINDOW, DTM_WINDOW };
+    static char *prefixes[] = { "", "", "shm:" };
+    int window = 0, scale = 1, only = -1;
+    int m, r, count;
+    double secs;
+
+    for (m = 1; m < argc; m++) {
+        if (!strcmp(argv[m], "-w") && m + 1 < argc)
+            window = atoi(argv[++m]);
+        else if (!strcmp(argv[m], "-n") && m + 1 < argc)
+            scale = atoi(argv[++m]);
+        else if (!strcmp(argv[m], "-s") && m + 1 < argc) {
+            ++m;
+            for (only = 2; only > 0; only--)
+                if (!strcmp(argv[m], names[only]))
+                    break;
+        } else {
+            fprintf(stderr,
+                "usage: %s [-w window] [-s sync|window|shm] [-n scale]\n",
+                argv[0]);
+            return 1;
+        }
+    }
+    if (window > 0 && DTMsetWindowSize(window) == DTMERROR) {
+        fprintf(stderr, "dtmbench: bad window size %d\n", window);
+        return 1;
+    }
+    if (scale < 1)
+        scale = 1;
+
+    signal(SIGPIPE, SIG_IGN);
+    printf("%-8s %10s %8s %10s %12s %10s\n",
+        "mode", "size", "count", "seconds", "datasets/s", "MB/s");
+
+    for (m = 0; m < 3; m++) {
+        if (only >= 0 && only != m)
+            continue;
+        for (r = 0; r < NUM_RUNS; r++) {
+            count = runs[r].count * scale;
+            if ((secs = run(modes[m], prefixes[m], runs[r].size, count)) < 0.0) {
+                printf("%-8s %10d %8d %10s\n", names[m], runs[r].size,
+                    count, "failed");
+                continue;
+            }
+            if (secs <= 0.0)
+                secs = 0.000001;
+            printf("%-8s %10d %8d %10.3f %12.1f %10.2f\n", names[m],
+                runs[r].size, count, secs, count / secs,
+                (double)runs[r].size * count / secs / (1024.0 * 1024.0));
+        }
+    }
+    return 0;
+}
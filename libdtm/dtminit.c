@@ -574,11 +574,19 @@ int qservice;
 {
     int port;
     int fLogicalName = TRUE;
+    int fShm = FALSE;
     S_ADDR addr;
 
     DBGFLOW("DTMmakeOutPort called.\n");
 
+    /* "shm:host:port" - use shared memory if the reader is local */
+    if (!strncmp(portname, DTM_SHM_PREFIX, strlen(DTM_SHM_PREFIX))) {
+        portname += strlen(DTM_SHM_PREFIX);
+        fShm = TRUE;
+    }
+
     CHECK_ERR((port = get_init_port(portname, OUTPORTTYPE, qservice)));
+    DTMpt[port]->fShm = fShm;
     CHECK_ERR((dtm_init_sockaddr(&addr, DTMpt[port]->portname, &fLogicalName)));
     DTMpt[port]->fLogical = fLogicalName;
 
@@ -633,6 +641,7 @@ int port;
             if (pcur->fd != DTM_NO_CONNECTION) {
                 if (pp->Xcallback)
                     pp->XremoveInput(pcur->XinputId);
+                dtm_shm_close(pcur->fd);
                 close(pcur->fd);
             }
         }
@@ -640,8 +649,10 @@ int port;
         register Outport *pcur;
 
         FOR_EACH_OUT_PORT(pcur, pp) {
-            if (pcur->connfd != DTM_NO_CONNECTION)
+            if (pcur->connfd != DTM_NO_CONNECTION) {
+                dtm_shm_close(pcur->connfd);
                 close(pcur->connfd);
+            }
         }
     }
 
@@ -295,6 +295,8 @@ typedef	struct	Outport
 	int32	connfd ; 			/* connection fd */ 
 	int		availwrite ;		/* port availability for write */	
 	int		seqstart ;			/* "Sequence start" message sent or not */ 
+	int		fWindowSent ;		/* DTM_WINDOW credit request sent */
+	int32	credit ;			/* datasets we may send before an ack */
 	struct Outport * next;	/* link to next outport */ 
 } Outport ;
 
@@ -307,7 +309,11 @@ typedef struct Inport {
 			would allow > < comparisions
 		*/
 	int			fCTSsent;		/* CTS already sent */
+	int			fGotRTS;		/* Already got the RTS */
 	int			fGotHeader;		/* Already got the header */
+	int32		window;			/* credits granted, 0 if not DTM_WINDOW */
+	int32		consumed;		/* datasets read since credit returned */
+	int			fSwap;			/* dataset byte order differs, see swap.c */
 #ifdef _XtIntrinsic_h
 #ifdef __STDC__
 #if sizeof( XtInputId ) != sizeof( int )
@@ -368,8 +374,44 @@ typedef	struct
 	int		fLastWasSuccessfulAvailWrite;
 	int		fGotList;	/* initially false, TRUE after any list is read */
 	int		fDiscard;	/* initially false, TRUE means /dev/null output */
+	int		fShm;		/* "shm:" address, use shared memory when local */
 } DTMPORT ;
 
+	/*
+		Byte order given in the "BO" header tag, see swap.c
+	*/
+#define	DTM_LITTLE_ENDIAN	1234
+#define	DTM_BIG_ENDIAN		4321
+#define	DTM_ORDER_TAGLEN	8		/* "BO 4321 " */
+
+	/*
+		Shared memory ring on one connection, see shm.c
+	*/
+#define	DTM_SHM_PREFIX		"shm:"
+#define	DTM_SHM_NAMELEN		32
+#define	DTM_SHM_IOV			10
+#define	DTM_SHM_MIN			16384	/* smaller datasets stay on the socket */
+
+	/*
+		Block length words below DTM_NEW_DATASET: a ring is being
+		attached, or a block of n bytes is waiting in the ring.
+	*/
+#define	DTM_SHM_ATTACH		-2
+#define	DTM_SHM_BLOCK(n)	(-(int32)(n) - 2)
+#define	DTM_IS_SHM_BLOCK(b)	((b) < DTM_SHM_ATTACH)
+#define	DTM_SHM_BLOCK_LEN(b)	(-(b) - 2)
+
+typedef struct DTMshm {
+	int		fd;			/* connection the ring belongs to */
+	int		fWriter;	/* TRUE on the out port end */
+	int		fAttachSent;
+	int		wakefd;		/* FIFO, reader pokes writer */
+	char	name[ DTM_SHM_NAMELEN ];
+	struct DTMring * ring;	/* mapped shared object */
+	uint32	size;		/* bytes of data in the ring */
+	struct DTMshm * next;
+} DTMshm;
+
 
 /*
 	GLOBAL VARIABLES
@@ -403,6 +445,20 @@ extern int		(*DTMconvertRtns[]) DTM_PROTO(( int, VOIDPTR, int ));
 	*/
 global	int		DTMSendCTSAhead			INIT( 0 );
 
+	/*
+		Number of datasets a DTM_WINDOW writer asks to have in flight
+		on each connection, and the most a reader will grant.  Credit
+		is returned in batches of half the window.
+	*/
+#define	DTM_WINDOW_DEFAULT	8
+global	int		DTMWindowSize			INIT( DTM_WINDOW_DEFAULT );
+
+	/*
+		Size of the shared memory ring made for each local connection
+		on an "shm:" out port.
+	*/
+global	int		DTMShmSize				INIT( 8 * 1024 * 1024 );
+
 
 /*
 	FUNCTION PROTOTYPES
@@ -461,6 +517,20 @@ extern void		dtm_version			DTM_PROTO(( void ));
 extern int		dtm_sigio			DTM_PROTO(( int ));
 extern char * 	dtm_find_tag		DTM_PROTO(( char *, char *));
 extern int		dtm_accept_read_connections DTM_PROTO(( DTMPORT *pp,int fWait ));
+extern int		dtm_data_order		DTM_PROTO(( void ));
+extern int		dtm_local_order		DTM_PROTO(( void ));
+extern int		dtm_tag_order		DTM_PROTO(( char * hdr, int hdrsize,
+												char * tagged ));
+extern int		dtm_untag_order		DTM_PROTO(( char * hdr, int * size ));
+extern void		dtm_swap_buffer		DTM_PROTO(( DTMTYPE type, VOIDPTR buf,
+												int size ));
+extern int		dtm_shm_create		DTM_PROTO(( int fd ));
+extern int		dtm_shm_attach		DTM_PROTO(( int fd, char * name ));
+extern DTMshm *	dtm_shm_find		DTM_PROTO(( int fd ));
+extern void		dtm_shm_close		DTM_PROTO(( int fd ));
+extern int		dtm_shm_read		DTM_PROTO(( int fd, char * buffer, int len ));
+extern int		dtm_shm_writev		DTM_PROTO(( DTMshm * shm, struct iovec * iov,
+										int32 iovlen, int data ));
 extern void		dtm_set_Xcallback	DTM_PROTO(( DTMPORT *pp, Inport * inp ));
 #ifdef _XtIntrinsic_h
 extern void		dtm_handle_in		DTM_PROTO(( caddr_t client_data,  
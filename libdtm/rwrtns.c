@@ -171,6 +171,8 @@
 static int dtm_recv_reliable DTM_PROTO((int, char *, int));
 static int dtm_writev_failed DTM_PROTO((int, struct msghdr *, int));
 static int dtm_send_some DTM_PROTO((int d, char *buf, int bufsize));
+static int recv_blocklen DTM_PROTO((int d, int32 * blocklen));
+static int recv_block DTM_PROTO((int d, int fShm, char *buffer, int length));
 #endif
 
 static int padding[] = { 0, 3, 2, 1 };
@@ -283,10 +285,66 @@ int length;
     return DTM_OK;
 }
 
+/*
+	recv_blocklen()
+	Read the next block length, mapping any shared memory ring that
+	is announced ahead of it.
+*/
+#ifdef DTM_PROTOTYPES
+static int recv_blocklen(int d, int32 *blocklen)
+#else
+static int recv_blocklen(d, blocklen)
+int d;
+int32 *blocklen;
+#endif
+{
+    char name[DTM_SHM_NAMELEN + 1];
+    int32 namelen;
+
+    CHECK_ERR(dtm_recv_reliable(d, (char *)blocklen, 4));
+    LOCALINT(*blocklen);
+    while (*blocklen == DTM_SHM_ATTACH) {
+        CHECK_ERR(dtm_recv_reliable(d, (char *)&namelen, 4));
+        LOCALINT(namelen);
+        if (namelen != DTM_SHM_NAMELEN) {
+            DTMerrno = DTMREAD;
+            return DTMERROR;
+        }
+        CHECK_ERR(dtm_recv_reliable(d, name, DTM_SHM_NAMELEN));
+        name[DTM_SHM_NAMELEN] = '\0';
+        CHECK_ERR(dtm_shm_attach(d, name));
+        CHECK_ERR(dtm_recv_reliable(d, (char *)blocklen, 4));
+        LOCALINT(*blocklen);
+    }
+    DBGINT("blocklen = %d\n", *blocklen);
+    return DTM_OK;
+}
+
+/*
+	recv_block()
+	Read part of a block from the socket or, for a DTM_SHM_BLOCK,
+	from the connection's ring.
+*/
+#ifdef DTM_PROTOTYPES
+static int recv_block(int d, int fShm, char *buffer, int length)
+#else
+static int recv_block(d, fShm, buffer, length)
+int d;
+int fShm;
+char *buffer;
+int length;
+#endif
+{
+    if (fShm)
+        return dtm_shm_read(d, buffer, length);
+    return dtm_recv_reliable(d, buffer, length);
+}
+
 /*
  * dtm_read_buffer() - attempts to fill the next dtm buffer.  The 
  *	blocklen variable must be set to DTM_NEW_DATASET after each dataset
- *	to force recv_buffer to move the next dataset.
+ *	to force recv_buffer to move the next dataset.  What is left of a
+ *	block in shared memory is kept as a DTM_SHM_BLOCK length.
  */
 #ifdef DTM_PROTOTYPES
 int dtm_read_buffer(int d, int32 *blocklen, VOIDPTR buffer, int length)
@@ -297,7 +355,9 @@ VOIDPTR buffer;
 int length;
 #endif
 {
-    reg int tmp, readcnt, count = 0;
+    reg int readcnt, count = 0;
+    int fShm;
+    int32 left;
 
     DBGFLOW("# dtm_read_buffer called.\n");
     DBGMSG1("dtm_recv_buffer: attempting to read %d bytes.\n", length);
@@ -307,8 +367,7 @@ int length;
      * get initial block count 
      */
     if (*blocklen == DTM_NEW_DATASET) {
-        CHECK_ERR(dtm_recv_reliable(d, (char *)blocklen, 4));
-        LOCALINT(*blocklen);
+        CHECK_ERR(recv_blocklen(d, blocklen));
         DBGINT("initial blocklen = %d\n", *blocklen);
     }
 
@@ -322,16 +381,21 @@ int length;
         if (*blocklen == 0)
             return 0;
 
+        fShm = DTM_IS_SHM_BLOCK(*blocklen);
+        left = fShm ? DTM_SHM_BLOCK_LEN(*blocklen) : *blocklen;
+
         /* if block length is greater than buffer size then... */
-        if (*blocklen >= length - count) {
+        if (left >= length - count) {
 
             readcnt = length - count;
-            CHECK_ERR(dtm_recv_reliable(d, ((char *)buffer) + length - readcnt, readcnt));
+            CHECK_ERR(recv_block(d, fShm, ((char *)buffer) + count, readcnt));
 
             /* decrement block length, if 0 get next block length */
-            *blocklen -= (length - count);
-            if (*blocklen == 0)
+            left -= readcnt;
+            if (left == 0)
                 *blocklen = DTM_NEW_DATASET;
+            else
+                *blocklen = fShm ? DTM_SHM_BLOCK(left) : left;
 
             /* if block length is 0 now, the EOS will be returned on */
             /* the next call to fill_buffer */
@@ -344,16 +408,13 @@ int length;
         /* else block length is less than buffer size */
         else {
 
-            readcnt = *blocklen;
-            CHECK_ERR(dtm_recv_reliable(d, (char *)buffer + count + *blocklen - readcnt, readcnt));
+            CHECK_ERR(recv_block(d, fShm, (char *)buffer + count, left));
 
             /* increment count */
-            count += *blocklen;
+            count += left;
 
             /* get next block length */
-            CHECK_ERR(dtm_recv_reliable(d, (char *)blocklen, 4));
-            LOCALINT(*blocklen);
-            DBGINT("blocklen = %d\n", *blocklen);
+            CHECK_ERR(recv_blocklen(d, blocklen));
 
             /* if block length is 0 now, the correct count will be */
             /* returned now, and EOS on the next call to fill_buffer */
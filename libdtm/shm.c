@@ -0,0 +1,582 @@
+/*****************************************************************************
+*
+*                         NCSA DTM version 2.3
+*                               May 1, 1992
+*
+* NCSA DTM Version 2.3 source code and documentation are in the public
+* domain.  Specifically, we give to the public domain all rights for future
+* licensing of the source code, all resale rights, and all publishing rights.
+*
+* We ask, but do not require, that the following message be included in all
+* derived works:
+*
+* Portions developed at the National Center for Supercomputing Applications at
+* the University of Illinois at Urbana-Champaign.
+*
+* THE UNIVERSITY OF ILLINOIS GIVES NO WARRANTY, EXPRESSED OR IMPLIED, FOR THE
+* SOFTWARE AND/OR DOCUMENTATION PROVIDED, INCLUDING, WITHOUT LIMITATION,
+* WARRANTY OF MERCHANTABILITY AND WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE
+*
+*****************************************************************************/
+
+/*
+	Shared memory transport for connections between two ports on
+	the same host.
+
+	An out port made with an "shm:" address checks each new
+	connection; if both ends of it have the same IP address it creates
+	a ring buffer in a POSIX shared memory object.  Dataset blocks of
+	DTM_SHM_MIN bytes or more are then copied into the ring and only
+	their length goes down the socket, as a negative block length
+	(see DTM_SHM_BLOCK).  The first such block is preceded by a
+	DTM_SHM_ATTACH record naming the ring so the reader can map it.
+	Headers, acks and small blocks still go through the socket, so
+	the stream keeps its order and the usual flow control applies.
+
+	The socket is the reader's wakeup.  When the ring is full the
+	writer sleeps on a FIFO which the reader pokes once it has made
+	room.  Both ends must run this version of DTM.
+
+	CONTENTS
+
+	dtm_shm_create()	- set up a ring on a new out connection
+	dtm_shm_attach()	- map the ring named by a DTM_SHM_ATTACH record
+	dtm_shm_find()		- ring for a connection, if any
+	dtm_shm_close()		- forget a connection's ring
+	dtm_shm_writev()	- write a dataset through the ring
+	dtm_shm_read()		- read a block out of the ring
+*/
+
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<sys/types.h>
+#include	<sys/socket.h>
+#include	<sys/stat.h>
+#include	<sys/time.h>
+#include	<sys/uio.h>
+#include	<fcntl.h>
+#include	<errno.h>
+#include	<unistd.h>
+
+#ifdef _POSIX_SHARED_MEMORY_OBJECTS
+#include	<sys/mman.h>
+#endif
+
+#include	"dtmint.h"
+#include	"debug.h"
+
+extern int	ftruncate();	/* Not in POSIX.2 <unistd.h> */
+
+#ifdef __GNUC__
+#define	DTM_SHM_BARRIER()	__sync_synchronize()
+#else
+#define	DTM_SHM_BARRIER()
+#endif
+
+	/*
+		Layout of the shared object: this control block followed
+		by the data area.  head and tail count bytes written and
+		read and are only ever compared modulo 2^32.
+	*/
+typedef struct DTMring {
+    volatile uint32 head;
+    volatile uint32 tail;
+    volatile int32 fWriterWaiting;
+    int32 size;
+} DTMring;
+
+#define	RING_DATA(r)	((char *)(r) + sizeof(DTMring))
+
+static DTMshm *shmList = NULL;
+static int shmSequence = 0;
+
+/*
+	dtm_shm_find()
+	Return the ring attached to a connection, NULL if it has none.
+*/
+#ifdef DTM_PROTOTYPES
+DTMshm *dtm_shm_find(int fd)
+#else
+DTMshm *dtm_shm_find(fd)
+int fd;
+#endif
+{
+    DTMshm *shm;
+
+    for (shm = shmList; shm != NULL; shm = shm->next)
+        if (shm->fd == fd)
+            return shm;
+    return NULL;
+}
+
+#ifdef _POSIX_SHARED_MEMORY_OBJECTS
+
+#ifdef DTM_PROTOTYPES
+static void shm_paths(char *name, char *object, char *fifo)
+#else
+static void shm_paths(name, object, fifo)
+char *name;
+char *object;
+char *fifo;
+#endif
+{
+    sprintf(object, "/%s", name);
+    sprintf(fifo, "/tmp/%s", name);
+}
+
+#ifdef DTM_PROTOTYPES
+static DTMshm *shm_new(int fd, int fWriter, char *name)
+#else
+static DTMshm *shm_new(fd, fWriter, name)
+int fd;
+int fWriter;
+char *name;
+#endif
+{
+    DTMshm *shm;
+
+    if ((shm = (DTMshm *) malloc(sizeof(DTMshm))) == NULL) {
+        DTMerrno = DTMMEM;
+        return NULL;
+    }
+    memset(shm, 0, sizeof(DTMshm));
+    shm->fd = fd;
+    shm->fWriter = fWriter;
+    shm->wakefd = -1;
+    strncpy(shm->name, name, DTM_SHM_NAMELEN - 1);
+    return shm;
+}
+
+/*
+	dtm_shm_create()
+	Called for each new connection on an "shm:" out port.  If the
+	peer is on this host, make a ring for it; otherwise, or if
+	anything goes wrong, the connection just stays plain TCP.
+*/
+#ifdef DTM_PROTOTYPES
+int dtm_shm_create(int fd)
+#else
+int dtm_shm_create(fd)
+int fd;
+#endif
+{
+    struct sockaddr_in self, peer;
+    socklen_t len;
+    int shmfd;
+    char name[DTM_SHM_NAMELEN], object[DTM_SHM_NAMELEN + 8];
+    char fifo[DTM_SHM_NAMELEN + 8];
+    DTMshm *shm;
+    DTMring *ring;
+    size_t size;
+
+    if (dtm_shm_find(fd) != NULL)
+        return DTM_OK;
+
+    len = sizeof(self);
+    if (getsockname(fd, (struct sockaddr *)&self, &len) < 0)
+        return DTM_OK;
+    len = sizeof(peer);
+    if (getpeername(fd, (struct sockaddr *)&peer, &len) < 0)
+        return DTM_OK;
+    if (self.sin_family != AF_INET || peer.sin_family != AF_INET
+        || self.sin_addr.s_addr != peer.sin_addr.s_addr) {
+        DBGMSG("dtm_shm_create: peer is not local, using TCP\n");
+        return DTM_OK;
+    }
+
+    sprintf(name, "dtm.%d.%d", (int)getpid(), ++shmSequence);
+    shm_paths(name, object, fifo);
+    size = sizeof(DTMring) + DTMShmSize;
+
+    if ((shmfd = shm_open(object, O_RDWR | O_CREAT | O_EXCL, 0600)) < 0) {
+        DBGMSG1("dtm_shm_create: shm_open failed, errno %d\n", errno);
+        return DTM_OK;
+    }
+    if (ftruncate(shmfd, size) < 0
+        || (ring = (DTMring *) mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED, shmfd, 0)) == (DTMring *) MAP_FAILED) {
+        DBGMSG1("dtm_shm_create: can't map ring, errno %d\n", errno);
+        close(shmfd);
+        shm_unlink(object);
+        return DTM_OK;
+    }
+    close(shmfd);
+
+    if (mkfifo(fifo, 0600) < 0 || (shm = shm_new(fd, TRUE, name)) == NULL) {
+        munmap((char *)ring, size);
+        shm_unlink(object);
+        unlink(fifo);
+        return DTM_OK;
+    }
+    /* nonblocking so the open does not wait for the reader */
+    shm->wakefd = open(fifo, O_RDONLY | O_NONBLOCK);
+
+    ring->head = ring->tail = 0;
+    ring->fWriterWaiting = FALSE;
+    ring->size = DTMShmSize;
+    shm->ring = ring;
+    shm->size = DTMShmSize;
+    shm->next = shmList;
+    shmList = shm;
+
+    DBGMSG1("dtm_shm_create: ring %s\n", name);
+    return DTM_OK;
+}
+
+/*
+	dtm_shm_attach()
+	Reader side of a DTM_SHM_ATTACH record: map the named ring and
+	open the writer's wakeup FIFO.  The names are removed as soon as
+	both ends hold them.
+*/
+#ifdef DTM_PROTOTYPES
+int dtm_shm_attach(int fd, char *name)
+#else
+int dtm_shm_attach(fd, name)
+int fd;
+char *name;
+#endif
+{
+    char object[DTM_SHM_NAMELEN + 8], fifo[DTM_SHM_NAMELEN + 8];
+    int shmfd;
+    struct stat st;
+    DTMshm *shm;
+    DTMring *ring;
+
+    DBGMSG1("dtm_shm_attach: ring %s\n", name);
+    dtm_shm_close(fd);
+
+    shm_paths(name, object, fifo);
+    if ((shmfd = shm_open(object, O_RDWR, 0)) < 0) {
+        DTMerrno = DTMREAD;
+        return DTMERROR;
+    }
+    if (fstat(shmfd, &st) < 0 || st.st_size < (off_t) sizeof(DTMring)
+        || (ring = (DTMring *) mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED, shmfd, 0)) == (DTMring *) MAP_FAILED) {
+        close(shmfd);
+        DTMerrno = DTMREAD;
+        return DTMERROR;
+    }
+    close(shmfd);
+
+    if (ring->size + sizeof(DTMring) > st.st_size
+        || (shm = shm_new(fd, FALSE, name)) == NULL) {
+        munmap((char *)ring, st.st_size);
+        DTMerrno = DTMREAD;
+        return DTMERROR;
+    }
+    shm->wakefd = open(fifo, O_WRONLY | O_NONBLOCK);
+    shm->ring = ring;
+    shm->size = ring->size;
+    shm->next = shmList;
+    shmList = shm;
+
+    shm_unlink(object);
+    unlink(fifo);
+    return DTM_OK;
+}
+
+/*
+	dtm_shm_close()
+	Unmap and forget the ring on a connection that is going away.
+*/
+#ifdef DTM_PROTOTYPES
+void dtm_shm_close(int fd)
+#else
+void dtm_shm_close(fd)
+int fd;
+#endif
+{
+    DTMshm *shm, **pshm;
+    char object[DTM_SHM_NAMELEN + 8], fifo[DTM_SHM_NAMELEN + 8];
+
+    for (pshm = &shmList; (shm = *pshm) != NULL; pshm = &shm->next)
+        if (shm->fd == fd)
+            break;
+    if (shm == NULL)
+        return;
+    *pshm = shm->next;
+
+    DBGMSG1("dtm_shm_close: ring %s\n", shm->name);
+    if (shm->fWriter) {
+        /* the reader may never have attached */
+        shm_paths(shm->name, object, fifo);
+        shm_unlink(object);
+        unlink(fifo);
+    }
+    if (shm->wakefd >= 0)
+        close(shm->wakefd);
+    munmap((char *)shm->ring, sizeof(DTMring) + shm->size);
+    free(shm);
+}
+
+/*
+	shm_wait_space()
+	Block until the ring has room for need bytes.  The FIFO wakes us
+	when the reader frees some; the timeout covers a lost wakeup and
+	the socket tells us if the reader has gone away.
+*/
+#ifdef DTM_PROTOTYPES
+static int shm_wait_space(DTMshm *shm, uint32 need)
+#else
+static int shm_wait_space(shm, need)
+DTMshm *shm;
+uint32 need;
+#endif
+{
+    DTMring *ring = shm->ring;
+    fd_set mask;
+    struct timeval timeout;
+    char junk[64];
+    int maxfd;
+
+    while ((uint32) (ring->size - (ring->head - ring->tail)) < need) {
+        ring->fWriterWaiting = TRUE;
+        DTM_SHM_BARRIER();
+        if ((uint32) (ring->size - (ring->head - ring->tail)) >= need)
+            break;
+
+        FD_ZERO(&mask);
+        FD_SET(shm->fd, &mask);
+        maxfd = shm->fd;
+        if (shm->wakefd >= 0) {
+            FD_SET(shm->wakefd, &mask);
+            if (shm->wakefd > maxfd)
+                maxfd = shm->wakefd;
+        }
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 10000;
+        if (select(maxfd + 1, &mask, (fd_set *) 0, (fd_set *) 0, &timeout) < 0) {
+            if (errno == EINTR)
+                continue;
+            DTMerrno = DTMSELECT;
+            return DTMERROR;
+        }
+        if (shm->wakefd >= 0 && FD_ISSET(shm->wakefd, &mask))
+            while (read(shm->wakefd, junk, sizeof(junk)) > 0);
+        if (FD_ISSET(shm->fd, &mask) && recv(shm->fd, junk, 1, MSG_PEEK) == 0) {
+            DTMerrno = DTMEOF;
+            return DTMERROR;
+        }
+    }
+    ring->fWriterWaiting = FALSE;
+    return DTM_OK;
+}
+
+/*
+	shm_put()
+	Copy len bytes into the ring, which must have room.
+*/
+#ifdef DTM_PROTOTYPES
+static void shm_put(DTMshm *shm, char *data, uint32 len)
+#else
+static void shm_put(shm, data, len)
+DTMshm *shm;
+char *data;
+uint32 len;
+#endif
+{
+    DTMring *ring = shm->ring;
+    uint32 at = ring->head % ring->size;
+    uint32 first = ring->size - at;
+
+    if (first > len)
+        first = len;
+    memcpy(RING_DATA(ring) + at, data, first);
+    memcpy(RING_DATA(ring), data + first, len - first);
+    DTM_SHM_BARRIER();
+    ring->head += len;
+}
+
+/*
+	dtm_shm_read()
+	Copy the next len bytes of a DTM_SHM_BLOCK out of the ring.  The
+	writer filled them in before it sent the block length.
+*/
+#ifdef DTM_PROTOTYPES
+int dtm_shm_read(int fd, char *buffer, int len)
+#else
+int dtm_shm_read(fd, buffer, len)
+int fd;
+char *buffer;
+int len;
+#endif
+{
+    DTMshm *shm;
+    DTMring *ring;
+    uint32 at, first;
+
+    if ((shm = dtm_shm_find(fd)) == NULL || shm->fWriter) {
+        DTMerrno = DTMREAD;
+        return DTMERROR;
+    }
+    ring = shm->ring;
+    DTM_SHM_BARRIER();
+    if ((uint32) (ring->head - ring->tail) < (uint32) len) {
+        DBGMSG("dtm_shm_read: ring holds less than the block\n");
+        DTMerrno = DTMREAD;
+        return DTMERROR;
+    }
+
+    at = ring->tail % ring->size;
+    first = ring->size - at;
+    if (first > (uint32) len)
+        first = len;
+    memcpy(buffer, RING_DATA(ring) + at, first);
+    memcpy(buffer + first, RING_DATA(ring), len - first);
+    DTM_SHM_BARRIER();
+    ring->tail += len;
+
+    DTM_SHM_BARRIER();
+    if (ring->fWriterWaiting && shm->wakefd >= 0) {
+        ring->fWriterWaiting = FALSE;
+        (void)write(shm->wakefd, "", 1);
+    }
+    return DTM_OK;
+}
+
+/*
+	dtm_shm_writev()
+	Write the iovec built by make_write_iov() for one out connection,
+	sending the dataset at iov[data] through the ring.  iov[data - 1]
+	is the dataset's block length word, which is replaced by one
+	DTM_SHM_BLOCK length per piece.
+*/
+#ifdef DTM_PROTOTYPES
+int dtm_shm_writev(DTMshm *shm, struct iovec *iov, int32 iovlen, int data)
+#else
+int dtm_shm_writev(shm, iov, iovlen, data)
+DTMshm *shm;
+struct iovec *iov;
+int32 iovlen;
+int data;
+#endif
+{
+    struct iovec out[DTM_SHM_IOV];
+    int32 attach[2];
+    int32 block;
+    int i, n, size;
+    char *p;
+    uint32 left, piece;
+
+    /* everything ahead of the block length goes out as is */
+    n = 0;
+    size = 0;
+    for (i = 0; i < data - 1; i++) {
+        out[n++] = iov[i];
+        size += iov[i].iov_len;
+    }
+
+    if (!shm->fAttachSent) {
+        attach[0] = DTM_SHM_ATTACH;
+        STDINT(attach[0]);
+        attach[1] = DTM_SHM_NAMELEN;
+        STDINT(attach[1]);
+        out[n].iov_base = (char *)attach;
+        out[n++].iov_len = sizeof(attach);
+        out[n].iov_base = shm->name;
+        out[n++].iov_len = DTM_SHM_NAMELEN;
+        size += sizeof(attach) + DTM_SHM_NAMELEN;
+        shm->fAttachSent = TRUE;
+    }
+
+    p = (char *)iov[data].iov_base;
+    left = iov[data].iov_len;
+    while (left > 0) {
+        /* wait for a worthwhile piece rather than dribbling */
+        piece = (left < shm->size / 4) ? left : shm->size / 4;
+        CHECK_ERR(shm_wait_space(shm, piece));
+        piece = shm->size - (shm->ring->head - shm->ring->tail);
+        if (piece > left)
+            piece = left;
+        shm_put(shm, p, piece);
+        p += piece;
+        left -= piece;
+
+        block = DTM_SHM_BLOCK(piece);
+        STDINT(block);
+        out[n].iov_base = (char *)&block;
+        out[n++].iov_len = 4;
+        size += 4;
+
+        /* the trailer rides along with the last piece */
+        if (left == 0)
+            for (i = data + 1; i < iovlen; i++) {
+                out[n++] = iov[i];
+                size += iov[i].iov_len;
+            }
+
+        if (dtm_writev_buffer(shm->fd, out, n, size, NULL, 0) < 0)
+            return DTMERROR;
+        n = 0;
+        size = 0;
+    }
+    return DTM_OK;
+}
+
+#else /* _POSIX_SHARED_MEMORY_OBJECTS */
+
+	/*
+		No shared memory here; "shm:" ports simply use TCP.
+	*/
+#ifdef DTM_PROTOTYPES
+int dtm_shm_create(int fd)
+#else
+int dtm_shm_create(fd)
+int fd;
+#endif
+{
+    return DTM_OK;
+}
+
+#ifdef DTM_PROTOTYPES
+int dtm_shm_attach(int fd, char *name)
+#else
+int dtm_shm_attach(fd, name)
+int fd;
+char *name;
+#endif
+{
+    DTMerrno = DTMREAD;
+    return DTMERROR;
+}
+
+#ifdef DTM_PROTOTYPES
+void dtm_shm_close(int fd)
+#else
+void dtm_shm_close(fd)
+int fd;
+#endif
+{
+}
+
+#ifdef DTM_PROTOTYPES
+int dtm_shm_read(int fd, char *buffer, int len)
+#else
+int dtm_shm_read(fd, buffer, len)
+int fd;
+char *buffer;
+int len;
+#endif
+{
+    DTMerrno = DTMREAD;
+    return DTMERROR;
+}
+
+#ifdef DTM_PROTOTYPES
+int dtm_shm_writev(DTMshm *shm, struct iovec *iov, int32 iovlen, int data)
+#else
+int dtm_shm_writev(shm, iov, iovlen, data)
+DTMshm *shm;
+struct iovec *iov;
+int32 iovlen;
+int data;
+#endif
+{
+    DTMerrno = DTMWRITE;
+    return DTMERROR;
+}
+
+#endif /* _POSIX_SHARED_MEMORY_OBJECTS */
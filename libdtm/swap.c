@@ -0,0 +1,268 @@
+/*****************************************************************************
+*
+*                         NCSA DTM version 2.3
+*                               May 1, 1992
+*
+* NCSA DTM Version 2.3 source code and documentation are in the public
+* domain.  Specifically, we give to the public domain all rights for future
+* licensing of the source code, all resale rights, and all publishing rights.
+*
+* We ask, but do not require, that the following message be included in all
+* derived works:
+*
+* Portions developed at the National Center for Supercomputing Applications at
+* the University of Illinois at Urbana-Champaign.
+*
+* THE UNIVERSITY OF ILLINOIS GIVES NO WARRANTY, EXPRESSED OR IMPLIED, FOR THE
+* SOFTWARE AND/OR DOCUMENTATION PROVIDED, INCLUDING, WITHOUT LIMITATION,
+* WARRANTY OF MERCHANTABILITY AND WARRANTY OF FITNESS FOR A PARTICULAR PURPOSE
+*
+*****************************************************************************/
+
+/*
+	Byte order of datasets.
+
+	Every header a writer sends carries a "BO" tag giving the byte
+	order its dataset is in on the wire (see dtm_data_order()).  The
+	reader takes the tag back out and, if that order is not the one
+	its own conversion routines expect, swaps each buffer in place as
+	it comes off the connection, before the usual conversion.
+
+	CONTENTS
+
+	dtm_local_order()	- byte order of this machine
+	dtm_tag_order()		- add the "BO" tag to an outgoing header
+	dtm_untag_order()	- remove it from an incoming one
+	dtm_swap_buffer()	- byteswap an array of DTM elements in place
+*/
+
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<sys/types.h>
+
+#if defined(__SSE2__)
+#include	<emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include	<arm_neon.h>
+#endif
+
+#include	"dtmint.h"
+#include	"debug.h"
+
+#define	ORDER_TAG	"BO"
+
+/*
+	dtm_local_order()
+	Returns DTM_LITTLE_ENDIAN or DTM_BIG_ENDIAN.
+*/
+#ifdef DTM_PROTOTYPES
+int dtm_local_order(void)
+#else
+int dtm_local_order()
+#endif
+{
+    int32 one = 1;
+
+    return (*(char *)&one) ? DTM_LITTLE_ENDIAN : DTM_BIG_ENDIAN;
+}
+
+/*
+	dtm_tag_order()
+	Copy a text header into tagged with the byte order of the data
+	that follows it.  Headers that are not plain strings, already
+	carry a tag, or would grow past DTM_MAX_HEADER are left alone.
+	Returns the size of the tagged header, or 0 if it was not tagged.
+*/
+#ifdef DTM_PROTOTYPES
+int dtm_tag_order(char *hdr, int hdrsize, char *tagged)
+#else
+int dtm_tag_order(hdr, hdrsize, tagged)
+char *hdr;
+int hdrsize;
+char *tagged;
+#endif
+{
+    int len;
+
+    if (hdr == NULL || hdrsize < 1 || hdr[hdrsize - 1] != '\0')
+        return 0;
+    if ((len = strlen(hdr)) != hdrsize - 1 || dtm_find_tag(hdr, ORDER_TAG))
+        return 0;
+    if (hdrsize + DTM_ORDER_TAGLEN > DTM_MAX_HEADER)
+        return 0;
+
+    /*
+       Keep the header's own trailing blank, or lack of one, so the
+       reader can restore it exactly.
+     */
+    if (len > 0 && hdr[len - 1] == ' ')
+        sprintf(tagged, "%s%s %d ", hdr, ORDER_TAG, dtm_data_order());
+    else
+        sprintf(tagged, "%s %s %d", hdr, ORDER_TAG, dtm_data_order());
+    return strlen(tagged) + 1;
+}
+
+/*
+	dtm_untag_order()
+	Take the "BO" tag out of a header just read and return the byte
+	order it gave, or 0 for a header from a writer that does not tag.
+	*size is adjusted to the header's new length.
+*/
+#ifdef DTM_PROTOTYPES
+int dtm_untag_order(char *hdr, int *size)
+#else
+int dtm_untag_order(hdr, size)
+char *hdr;
+int *size;
+#endif
+{
+    char *tag, *end;
+    int order;
+
+    if (*size < 1 || hdr[*size - 1] != '\0')
+        return 0;
+    if ((tag = dtm_find_tag(hdr, ORDER_TAG)) == NULL)
+        return 0;
+    if (dtm_get_int(tag - 1, ORDER_TAG, &order) == DTMERROR)
+        return 0;
+
+    /* drop "BO <order> ", or " BO <order>" at the very end */
+    end = tag + strlen(ORDER_TAG) + 1;
+    while (*end && *end != ' ')
+        end++;
+    if (*end == ' ')
+        end++;
+    else
+        tag--;
+    memmove(tag, end, strlen(end) + 1);
+    *size = strlen(hdr) + 1;
+
+    return order;
+}
+
+	/*
+		Swap n elements of 2, 4 or 8 bytes.  The vector loops take
+		16 bytes at a time; the scalar loop does the rest, or all of
+		it where neither SSE2 nor NEON is available.
+	*/
+#ifdef DTM_PROTOTYPES
+static void swap_2(unsigned char *p, int n)
+#else
+static void swap_2(p, n)
+unsigned char *p;
+int n;
+#endif
+{
+    unsigned char t;
+
+#if defined(__SSE2__)
+    for (; n >= 8; n -= 8, p += 16) {
+        __m128i v = _mm_loadu_si128((__m128i *) p);
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128((__m128i *) p, v);
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; n >= 8; n -= 8, p += 16)
+        vst1q_u8(p, vrev16q_u8(vld1q_u8(p)));
+#endif
+    for (; n > 0; n--, p += 2) {
+        t = p[0]; p[0] = p[1]; p[1] = t;
+    }
+}
+
+#ifdef DTM_PROTOTYPES
+static void swap_4(unsigned char *p, int n)
+#else
+static void swap_4(p, n)
+unsigned char *p;
+int n;
+#endif
+{
+    unsigned char t;
+
+#if defined(__SSE2__)
+    for (; n >= 4; n -= 4, p += 16) {
+        __m128i v = _mm_loadu_si128((__m128i *) p);
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128((__m128i *) p, v);
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; n >= 4; n -= 4, p += 16)
+        vst1q_u8(p, vrev32q_u8(vld1q_u8(p)));
+#endif
+    for (; n > 0; n--, p += 4) {
+        t = p[0]; p[0] = p[3]; p[3] = t;
+        t = p[1]; p[1] = p[2]; p[2] = t;
+    }
+}
+
+#ifdef DTM_PROTOTYPES
+static void swap_8(unsigned char *p, int n)
+#else
+static void swap_8(p, n)
+unsigned char *p;
+int n;
+#endif
+{
+    unsigned char t;
+
+#if defined(__SSE2__)
+    for (; n >= 2; n -= 2, p += 16) {
+        __m128i v = _mm_loadu_si128((__m128i *) p);
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128((__m128i *) p, v);
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; n >= 2; n -= 2, p += 16)
+        vst1q_u8(p, vrev64q_u8(vld1q_u8(p)));
+#endif
+    for (; n > 0; n--, p += 8) {
+        t = p[0]; p[0] = p[7]; p[7] = t;
+        t = p[1]; p[1] = p[6]; p[6] = t;
+        t = p[2]; p[2] = p[5]; p[5] = t;
+        t = p[3]; p[3] = p[4]; p[4] = t;
+    }
+}
+
+/*
+	dtm_swap_buffer()
+	Byteswap size bytes of type in place.  Complex numbers are pairs
+	of floats and triplets are an int tag and three floats, so both
+	swap as 4 byte words.
+*/
+#ifdef DTM_PROTOTYPES
+void dtm_swap_buffer(DTMTYPE type, VOIDPTR buf, int size)
+#else
+void dtm_swap_buffer(type, buf, size)
+DTMTYPE type;
+VOIDPTR buf;
+int size;
+#endif
+{
+    DBGMSG1("dtm_swap_buffer: swapping %d bytes\n", size);
+
+    if (buf == NULL || size <= 0)
+        return;
+
+    switch (type) {
+    case DTM_SHORT:
+        swap_2((unsigned char *)buf, size / 2);
+        break;
+    case DTM_INT:
+    case DTM_FLOAT:
+    case DTM_COMPLEX:
+    case DTM_TRIPLET:
+        swap_4((unsigned char *)buf, size / 4);
+        break;
+    case DTM_DOUBLE:
+        swap_8((unsigned char *)buf, size / 8);
+        break;
+    default:
+        break;
+    }
+}
@@ -205,6 +205,20 @@ char *buf;
     return ((mode == DTMLOCAL) ? size : (size * 16));
 }
 
+/*
+	dtm_data_order()
+	Datasets are converted to the DTM standard, big endian, order
+	before they are written.
+*/
+#ifdef DTM_PROTOTYPES
+int dtm_data_order(void)
+#else
+int dtm_data_order()
+#endif
+{
+    return DTM_BIG_ENDIAN;
+}
+
 /* conversion routine function table */
 int (*DTMconvertRtns[])() = {
     dtm_char,
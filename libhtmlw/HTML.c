@@ -168,6 +168,8 @@ static void CallLinkCallbacks(HTMLWidget hw);
 
 char CurrentURL[8096];          /*if url bigger than this...too bad */
 
+HTMLSetTextTimes HTMLLastSetText;
+
 #ifndef DISABLE_TRACE
 int htmlwTrace;
 #endif
@@ -4761,6 +4763,9 @@ _HTMLpwdInput(Widget w, XEvent *event, String *params,  /* unused */
             if ((tptr->value != NULL) && (tptr->type != W_OPTIONMENU)) {
                 free(tptr->value);
             }
+            if (tptr->text != NULL) {
+                free(tptr->text);
+            }
             free((char *)tptr);
         }
     }
@@ -4782,14 +4787,23 @@ _HTMLpwdInput(Widget w, XEvent *event, String *params,  /* unused */
     {
         HTMLWidget hw = (HTMLWidget) w;
         struct ele_rec *start;
+        char *last_href;
+        int visited;
+        unsigned long fg;
+        int underline_number;
+        Boolean dashed_underline;
 
         if (testFunc == NULL) {
             testFunc = (visitTestProc) hw->html.previously_visited_test;
         }
 
         /*
-         * Search all elements
+         * Search all elements.  The words of one anchor are separate
+         * elements with their own copy of the href, so only ask
+         * testFunc again when the href changes.
          */
+        last_href = NULL;
+        visited = 0;
         start = hw->html.formatted_elements;
         while (start != NULL) {
             if ((start->internal == True) || (start->anchorHRef == NULL)) {
@@ -4797,24 +4811,35 @@ _HTMLpwdInput(Widget w, XEvent *event, String *params,  /* unused */
                 continue;
             }
 
-            if (testFunc != NULL) {
-                if ((*testFunc) (hw, start->anchorHRef)) {
-                    start->fg = hw->html.visitedAnchor_fg;
-                    start->underline_number = hw->html.num_visitedAnchor_underlines;
-                    start->dashed_underline = hw->html.dashed_visitedAnchor_lines;
-                } else {
-                    start->fg = hw->html.anchor_fg;
-                    start->underline_number = hw->html.num_anchor_underlines;
-                    start->dashed_underline = hw->html.dashed_anchor_lines;
-                }
+            if ((last_href == NULL) || (strcmp(last_href, start->anchorHRef) != 0)) {
+                last_href = start->anchorHRef;
+                visited = (testFunc != NULL) && (*testFunc) (hw, start->anchorHRef);
+            }
+
+            if (visited) {
+                fg = hw->html.visitedAnchor_fg;
+                underline_number = hw->html.num_visitedAnchor_underlines;
+                dashed_underline = hw->html.dashed_visitedAnchor_lines;
             } else {
-                start->fg = hw->html.anchor_fg;
-                start->underline_number = hw->html.num_anchor_underlines;
-                start->dashed_underline = hw->html.dashed_anchor_lines;
+                fg = hw->html.anchor_fg;
+                underline_number = hw->html.num_anchor_underlines;
+                dashed_underline = hw->html.dashed_anchor_lines;
             }
 
             /*
-             * Since the element may have changed, redraw it
+             * Nothing to redraw if it already looks right
+             */
+            if ((start->fg == fg) && (start->underline_number == underline_number) &&
+                (start->dashed_underline == dashed_underline)) {
+                start = start->next;
+                continue;
+            }
+            start->fg = fg;
+            start->underline_number = underline_number;
+            start->dashed_underline = dashed_underline;
+
+            /*
+             * Since the element has changed, redraw it
              */
             switch (start->type) {
             case E_TEXT:
@@ -5226,11 +5251,16 @@ _HTMLpwdInput(Widget w, XEvent *event, String *params,  /* unused */
         hw->html.widget_list = wptr;
         hw->html.form_list = NULL;
 
+        gettimeofday(&HTMLLastSetText.parse_start, NULL);
+        HTMLLastSetText.parse_bytes = 0;
         if (text != NULL) {
             if (*text == '\0') {
                 text = NULL;
             }
             hw->html.raw_text = text;
+            if (text != NULL) {
+                HTMLLastSetText.parse_bytes = strlen(text);
+            }
 
             /*
              * Free any old colors and pixmaps
@@ -5267,11 +5297,15 @@ _HTMLpwdInput(Widget w, XEvent *event, String *params,  /* unused */
             hw->html.html_footer_objects = HTMLParse(hw->html.html_footer_objects, hw->html.footer_text, hw);
         }
 
+        gettimeofday(&HTMLLastSetText.parse_end, NULL);
+
         /*
          * Reformat the new text
          */
+        HTMLLastSetText.format_start = HTMLLastSetText.parse_end;
         hw->html.max_pre_width = DocumentWidth(hw, hw->html.html_objects);
         ReformatWindow(hw);
+        gettimeofday(&HTMLLastSetText.format_end, NULL);
 
         /*
          * If a target anchor is passed, override the element id
@@ -5347,6 +5381,61 @@ _HTMLpwdInput(Widget w, XEvent *event, String *params,  /* unused */
         hw->html.cached_tracked_ele = NULL;
     }
 
+/*
+ * Replace just the header and footer text, as HTMLSetText would,
+ * and lay the document out again around them.  The body is not
+ * parsed again, so its form widgets keep what was typed into them
+ * and the view stays where it was.  NULL leaves that part alone.
+ */
+    void
+#ifdef _NO_PROTO
+     HTMLSetHeaderFooter(w, header_text, footer_text) Widget w;
+    char *header_text;
+    char *footer_text;
+#else
+     HTMLSetHeaderFooter(Widget w, char *header_text, char *footer_text)
+#endif
+    {
+        HTMLWidget hw = (HTMLWidget) w;
+
+        if ((header_text == NULL) && (footer_text == NULL)) {
+            return;
+        }
+
+        if (header_text != NULL) {
+            if (*header_text == '\0') {
+                header_text = NULL;
+            }
+            hw->html.header_text = header_text;
+            hw->html.html_header_objects = HTMLParse(hw->html.html_header_objects, hw->html.header_text, hw);
+        }
+        if (footer_text != NULL) {
+            if (*footer_text == '\0') {
+                footer_text = NULL;
+            }
+            hw->html.footer_text = footer_text;
+            hw->html.html_footer_objects = HTMLParse(hw->html.html_footer_objects, hw->html.footer_text, hw);
+        }
+
+        /*
+         * The same steps as a resize that needs a reformat
+         */
+        ResetWidgetsOnResize(hw);
+        ReformatWindow(hw);
+        if (hw->html.scroll_y > (hw->html.doc_height - (int)hw->html.view_height)) {
+            hw->html.scroll_y = hw->html.doc_height - (int)hw->html.view_height;
+        }
+        if (hw->html.scroll_y < 0) {
+            hw->html.scroll_y = 0;
+        }
+        ConfigScrollBars(hw);
+        ScrollWidgets(hw);
+        ViewClearAndRefresh(hw);
+
+        hw->html.active_anchor = NULL;
+        hw->html.cached_tracked_ele = NULL;
+    }
+
 /*
  * To use faster TOLOWER as set up in HTMLparse.c
  */
@@ -66,6 +66,11 @@
 #include <X11/Constraint.h>
 #endif /* MOTIF */
 #include <X11/StringDefs.h>
+#ifndef VMS
+#include <sys/time.h>
+#else
+#include <time.h>
+#endif
 
 typedef int (*visitTestProc)();
 typedef void (*pointerTrackProc)();
@@ -100,6 +105,7 @@ extern void HTMLRetestAnchors ();
 extern void HTMLClearSelection ();
 extern void HTMLSetSelection ();
 extern void HTMLSetText ();
+extern void HTMLSetHeaderFooter ();
 extern void HTMLSetAppInsensitive();
 extern int HTMLSearchText ();
 extern int HTMLSearchNews();
@@ -128,6 +134,8 @@ extern void HTMLSetSelection (Widget w, ElementRef *start, ElementRef *end);
 extern void HTMLSetText (Widget w, char *text, char *header_text,
 			char *footer_text, int element_id,
 			char *target_anchor, void *ptr);
+extern void HTMLSetHeaderFooter (Widget w, char *header_text,
+			char *footer_text);
 extern int HTMLSearchNews(Widget w,ElementRef *m_start, ElementRef *m_end);
 extern int HTMLSearchText (Widget w, char *pattern,
 	ElementRef *m_start, ElementRef *m_end, int backward, int caseless);
@@ -239,6 +247,10 @@ typedef struct wid_rec {
 	char **mapping;
 	Boolean checked;
 	Boolean mapped;
+	char *text;		/* tag of a field not yet realized */
+	FormInfo *fptr;
+	XFontStruct *font;	/* measured font, for the unrealized */
+	Boolean state;		/* toggle state, for the unrealized */
 	struct wid_rec *next;
 	struct wid_rec *prev;
 } WidgetInfo;
@@ -258,12 +270,15 @@ typedef struct table_field {
         int minHeight;
         int colWidth;           /* uniform width for all element in this col*/
         int rowHeight;          /* uniform hieght for all element in the row*/
+        int spanRight;          /* fields to the right continuing this one */
+        int spanDown;           /* fields below continuing this one */
 	Boolean	header;		/* is this field created with <TH> or <TD> */
 	
 	/* contents */
 	FieldType	type;
 	char		*text;
 	XFontStruct	*font;
+	int		textWidth;	/* of text in font, measured once */
 	char		**formattedText;
 	int		numLines;	/* for formatted text */
 
@@ -299,6 +314,19 @@ typedef struct sel_rec {
 
 typedef ImageInfo *(*resolveImageProc)();
 
+
+/*
+ * When the last HTMLSetText parsed and formatted its text, for whoever
+ * is timing the load.  Formatting takes in resolving the images.
+ */
+typedef struct settext_times {
+	struct timeval parse_start, parse_end;
+	struct timeval format_start, format_end;
+	int parse_bytes;	/* of the document text */
+} HTMLSetTextTimes;
+
+extern HTMLSetTextTimes HTMLLastSetText;
+
 /*
  * defines for client-side ismap -- SWP
  */
@@ -1,5 +1,6 @@
 #include "../config.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <X11/Xlib.h>
 #include "HTMLP.h"
@@ -42,11 +43,14 @@ static TableField *NewTableField()
     tf->minWidth = DEFAULT_FIELD_WIDTH;
     tf->maxHeight = DEFAULT_FIELD_HEIGHT;
     tf->minHeight = DEFAULT_FIELD_HEIGHT;
+    tf->spanRight = 0;
+    tf->spanDown = 0;
     tf->header = False;
 
     tf->type = F_NONE;
     tf->text = (char *)0;
     tf->font = (XFontStruct *) 0;
+    tf->textWidth = 0;
     tf->formattedText = (char **)0;
     tf->numLines = 0;
 
@@ -91,10 +95,13 @@ char **retEnd;                  /* RETURNED: end of word in text */
    If a height is specified, then text will be truncated if necessary to fit.
    If height is 0, then all of the text is in the list. 
    The actual pixel height of the text is returned in variable height.
+   The width of the whole text may be passed in textWidth if already
+   known, or -1.
 */
-int PourText(text, font, width, height, percentVertSpace, formattedText, numberOfLines)
+int PourText(text, font, textWidth, width, height, percentVertSpace, formattedText, numberOfLines)
 char *text;                     /* assumed that text is already clean and without newlines */
 XFontStruct *font;
+int textWidth;                  /* XTextWidth of text, or -1 */
 int width;                      /* width of area to pour text */
 int *height;                    /* if passed height value is zero, then height is returned */
          /* if passed height is non zero, then truncate to this height */
@@ -111,7 +118,8 @@ int *numberOfLines;             /* RETURNED: number of lines */
     int wordWidth;              /* in pixels */
     int wordLength;             /* in chars */
     List textList;              /* returned list of text lines */
-    char tmpBuff[5120];         /*ACK!, can't have more than 5k chars on a line in a field */
+    char *tmpBuff;              /* line being built, never longer than text */
+    int tmpLength;              /* in chars */
     int spaceWidth;             /* width of a space in this font */
     char **cTextList;
     int numLines;
@@ -131,15 +139,20 @@ int *numberOfLines;             /* RETURNED: number of lines */
     }
 
     textList = ListCreate();
-    stringWidth = XTextWidth(font, text, strlen(text));
+    if (textWidth < 0) {
+        stringWidth = XTextWidth(font, text, strlen(text));
+    } else {
+        stringWidth = textWidth;
+    }
     if (stringWidth < width) {
         ListAddEntry(textList, strdup(text));
-    } else {
+    } else if ((tmpBuff = (char *)malloc(strlen(text) + 1)) != NULL) {
 
         builtWidth = 0;
         textPtr = text;
         spaceWidth = XTextWidth(font, " ", 1);
         *tmpBuff = '\0';
+        tmpLength = 0;
         while (*textPtr) {
 
 #ifndef DISABLE_TRACE
@@ -155,19 +168,22 @@ int *numberOfLines;             /* RETURNED: number of lines */
                 /* then add to line */
                 if (builtWidth) {
                     /* only add space if something on line already */
-                    strcat(tmpBuff, " ");
+                    tmpBuff[tmpLength++] = ' ';
                     builtWidth += spaceWidth;
                 }
-                strncat(tmpBuff, wordStart, wordLength);
+                memcpy(&tmpBuff[tmpLength], wordStart, wordLength);
+                tmpLength += wordLength;
+                tmpBuff[tmpLength] = '\0';
                 builtWidth += wordWidth;
             } else if (wordWidth < width) {
                 /* start new line */
                 ListAddEntry(textList, strdup(tmpBuff));
-                *tmpBuff = '\0';
                 builtWidth = 0;
 
                 /* and add it to the line */
-                strncat(tmpBuff, wordStart, wordLength);
+                memcpy(tmpBuff, wordStart, wordLength);
+                tmpLength = wordLength;
+                tmpBuff[tmpLength] = '\0';
                 builtWidth += wordWidth;
             } else {
                 /* word is too big to fit on a line */
@@ -175,20 +191,22 @@ int *numberOfLines;             /* RETURNED: number of lines */
 
                 /* start new line */
                 ListAddEntry(textList, strdup(tmpBuff));
-                *tmpBuff = '\0';
                 builtWidth = 0;
 
-                /* find the max that will fit on a line */
+                /* find the max that will fit on a line, a character
+                   at a time, as a string is as wide as its characters */
                 wordWidth = 0;
                 wordLength = 0;
                 wordEnd = wordStart;
                 while ((*wordEnd) && (width > wordWidth)) {
+                    wordWidth += XTextWidth(font, wordEnd, 1);
                     wordEnd++;
-                    wordLength = (int)(wordEnd - wordStart);
-                    wordWidth = XTextWidth(font, wordStart, wordLength);
+                    wordLength++;
                 }
 
-                strncat(tmpBuff, wordStart, wordLength);
+                memcpy(tmpBuff, wordStart, wordLength);
+                tmpLength = wordLength;
+                tmpBuff[tmpLength] = '\0';
                 builtWidth += wordWidth;
 
             }
@@ -198,6 +216,7 @@ int *numberOfLines;             /* RETURNED: number of lines */
         if (*tmpBuff) {
             ListAddEntry(textList, strdup(tmpBuff));
         }
+        free(tmpBuff);
     }
 
     /* ok, we haven't paid attention to height, so now we are going
@@ -337,61 +356,41 @@ List tableList;
         rowList = (List) ListNext(tableList);
     }
 
+    /* count the fields continuing each field to the right and below,
+       working back from the far corner so each count is one more
+       than its neighbour's */
+    for (y = t->numRows - 1; y >= 0; y--) {
+        for (x = t->numColumns - 1; x >= 0; x--) {
+            field = &(t->table[y * t->numColumns + x]);
+            field->spanRight = 0;
+            if ((x + 1 < t->numColumns) && field[1].contHoriz) {
+                field->spanRight = field[1].spanRight + 1;
+            }
+            field->spanDown = 0;
+            if ((y + 1 < t->numRows) && field[t->numColumns].contVert) {
+                field->spanDown = field[t->numColumns].spanDown + 1;
+            }
+        }
+    }
+
     return (1);
 
 }
 
-/* return the number of connected fields */
+/* return the number of connected fields, as counted by TableCleanUp() */
 static int TableHowManyConnectedHorizFields(t, xpos, ypos)
 TableInfo *t;
 int xpos, ypos;
 {
-    int count;
-    register int x;
-
-    count = 0;
-    for (x = xpos + 1; x < t->numColumns; x++) {
-        if (t->table[ypos * t->numColumns + x].contHoriz) {
-            count++;
-        } else {
-            return (count);
-        }
-    }
-    return (count);
+    return (t->table[ypos * t->numColumns + xpos].spanRight);
 }
 
-/* return the number of connected fields */
+/* return the number of connected fields, as counted by TableCleanUp() */
 static int TableHowManyConnectedVertFields(t, xpos, ypos)
 TableInfo *t;
 int xpos, ypos;
 {
-    int count;
-    register int y;
-
-    count = 0;
-    for (y = ypos + 1; y < t->numRows; y++) {
-        if (t->table[y * t->numColumns + xpos].contVert) {
-            count++;
-        } else {
-            return (count);
-        }
-    }
-    return (count);
-}
-
-static int CalculateMaxWidthOfColumn(t, x)
-TableInfo *t;
-int x;
-{
-    register int y;
-    register int maxWidth = 0;
-    register int width;
-
-    for (y = 0; y < t->numRows; y++) {
-        width = t->table[y * t->numColumns + x].maxWidth;
-        maxWidth = (maxWidth > width) ? maxWidth : width;
-    }
-    return (maxWidth);
+    return (t->table[ypos * t->numColumns + xpos].spanDown);
 }
 
 TableCalculateDimensions(hw, t, pageWidth)
@@ -410,8 +409,10 @@ int pageWidth;                  /* width in pixels of output page */
     int numAdjacent;
     float percentToShrink;
     int accumulateColWidth;
+    int *maxWidthOfColumns;     /* widest field in each column */
 
-    /* calculate max and min width for each field */
+    /* calculate max and min width for each field, measuring each
+       field's text only once */
     sumMaxWidth = 0;
     sumMinWidth = 0;
     for (y = 0; y < t->numRows; y++) {
@@ -421,7 +422,8 @@ int pageWidth;                  /* width in pixels of output page */
 
             field = &(t->table[y * t->numColumns + x]);
             if (field->type == F_TEXT) {
-                field->maxWidth = XTextWidth(field->font, field->text, strlen(field->text));
+                field->textWidth = XTextWidth(field->font, field->text, strlen(field->text));
+                field->maxWidth = field->textWidth;
                 field->minHeight = FONTHEIGHT(field->font);
             } else {
                 /* non text */
@@ -473,22 +475,31 @@ int pageWidth;                  /* width in pixels of output page */
         }
     }
 
+    /* find the widest field in each column, in one pass */
+    if (!(maxWidthOfColumns = (int *)malloc(sizeof(int) * (t->numColumns + 1)))) {
+        return (0);             /* out of memory */
+    }
+    for (x = 0; x < t->numColumns; x++) {
+        maxWidthOfColumns[x] = 0;
+    }
+    field = t->table;
+    for (y = 0; y < t->numRows; y++) {
+        for (x = 0; x < t->numColumns; x++) {
+            if (field->maxWidth > maxWidthOfColumns[x]) {
+                maxWidthOfColumns[x] = field->maxWidth;
+            }
+            field++;
+        }
+    }
+
     /* fit table to page */
     if (sumMaxWidth < pageWidth) {
         /* fits on the page, set all fields to use max width */
 
-        for (x = 0; x < t->numColumns; x++) {
-            /* find widest field in column */
-            maxWidthOfColumn = 0;
-            for (y = 0; y < t->numRows; y++) {
-                maxWidthOfColumn =
-                    (maxWidthOfColumn >
-                     t->table[y * t->numColumns + x].maxWidth) ?
-                    maxWidthOfColumn : t->table[y * t->numColumns + x].maxWidth;
-            }
+        for (y = 0; y < t->numRows; y++) {
             /* assign uniform width to column */
-            for (y = 0; y < t->numRows; y++) {
-                t->table[y * t->numColumns + x].colWidth = maxWidthOfColumn + 2 * FIELD_BORDER_SPACE;
+            for (x = 0; x < t->numColumns; x++) {
+                t->table[y * t->numColumns + x].colWidth = maxWidthOfColumns[x] + 2 * FIELD_BORDER_SPACE;
             }
         }
         for (y = 0; y < t->numRows; y++) {
@@ -540,14 +551,14 @@ int pageWidth;                  /* width in pixels of output page */
             for (y = 0; y < t->numRows; y++) {
                 field = &(t->table[y * t->numColumns + x]);
                 field->colWidth = (int)(percentToShrink * ((float)
-                                                           CalculateMaxWidthOfColumn(t, x)));
+                                                           maxWidthOfColumns[x]));
                 field->rowHeight = 0;
                 numAdjacent = TableHowManyConnectedHorizFields(t, x, y);
                 /* calculate the width including connected */
                 accumulateColWidth = field->colWidth;
                 for (xx = x + 1; xx < x + numAdjacent + 1; xx++) {
                     accumulateColWidth += ((percentToShrink * ((float)
-                                                               CalculateMaxWidthOfColumn(t, xx))));
+                                                               maxWidthOfColumns[xx])));
                 }
 
 #ifndef DISABLE_TRACE
@@ -556,7 +567,7 @@ int pageWidth;                  /* width in pixels of output page */
                 }
 #endif
 
-                PourText(field->text, field->font,
+                PourText(field->text, field->font, field->textWidth,
                          accumulateColWidth,
                          &(field->rowHeight), hw->html.percent_vert_space, &(field->formattedText), &(field->numLines));
 
@@ -631,6 +642,8 @@ int pageWidth;                  /* width in pixels of output page */
 
     }
 
+    free(maxWidthOfColumns);
+
     /* calculate table width */
     t->width = 0;
     for (x = 0; x < t->numColumns; x++) {
@@ -674,23 +687,20 @@ int pageWidth;                  /* width in pixels of output page */
 
 /* expand colspans and rowspans in table */
 /* return True if this routine did something */
-static Boolean TableExpandFields(tableList, rowList, rowCount, columnCount)
-List tableList;
+static Boolean TableExpandFields(previousRow, rowList, columnCount)
+List previousRow;               /* previous to current row, 0 for the first */
 List rowList;
-int rowCount;
 int *columnCount;
 {
     TableField *field;
-    List previousRow;           /* previous to current row */
     TableField *aboveField;     /* field above current field */
     TableField *fieldToTheLeft; /* field to the left of current field */
     Boolean expandedSomething;
 
     expandedSomething = False;
     /* check for and take care of previous rowspans */
-    if (rowCount > 1) {
+    if (previousRow) {
         /* get field above this one */
-        previousRow = (List) ListGetIndexedEntry(tableList, rowCount - 2);  /*zero indexed */
         aboveField = (TableField *) ListGetIndexedEntry(previousRow, *columnCount);
         if (aboveField) {
             /*check if the above expands into this row */
@@ -802,9 +812,9 @@ unsigned int x, y;
     TableInfo *t;
     TableField *field;
     int columnCount;
-    int rowCount;
     char *val;
     List rowList;               /* current row (List of TableFields) */
+    List previousRow;           /* the row before it, kept to save a search */
     List tableList;             /* list of Row Lists */
     char *tptr;
 
@@ -826,8 +836,8 @@ unsigned int x, y;
     tableList = ListCreate();
     rowList = ListCreate();
     ListAddEntry(tableList, rowList);
+    previousRow = (List) 0;
     columnCount = 0;
-    rowCount = 1;
     m = *mptr;
     field = (TableField *) 0;
     while (m && (!((m->type == M_TABLE) && (m->is_end)))) {
@@ -842,23 +852,23 @@ unsigned int x, y;
 
         else if ((m->type == M_TABLE_ROW) && (!m->is_end)) {
             /* expand at end of row */
-            while (TableExpandFields(tableList, rowList, rowCount, &columnCount));
+            while (TableExpandFields(previousRow, rowList, &columnCount));
 
             /* if: is this the first container <tr> or the 
                separator */
             if (ListHead(ListHead(tableList))) {
+                previousRow = rowList;
                 rowList = ListCreate();
                 ListAddEntry(tableList, rowList);
-                rowCount++;
             }
             columnCount = 0;
             /* expand cols at beginning of row */
-            TableExpandFields(tableList, rowList, rowCount, &columnCount);
+            TableExpandFields(previousRow, rowList, &columnCount);
         }
 
         else if ((m->type == M_TABLE_DATA) && (!m->is_end)) {
 
-            while (TableExpandFields(tableList, rowList, rowCount, &columnCount));
+            while (TableExpandFields(previousRow, rowList, &columnCount));
 
             if (!(field = NewTableField())) {
                 return (0);     /* out of memory */
@@ -900,7 +910,7 @@ unsigned int x, y;
 
         else if ((m->type == M_TABLE_HEADER) && (!m->is_end)) {
 
-            while (TableExpandFields(tableList, rowList, rowCount, &columnCount));
+            while (TableExpandFields(previousRow, rowList, &columnCount));
 
             if (!(field = NewTableField())) {
                 return (0);     /*out of memory */
@@ -947,7 +957,7 @@ unsigned int x, y;
 
     /* end of table has been hit, so wrap it up */
     /* clean up any at end of row */
-    while (TableExpandFields(tableList, rowList, rowCount, &columnCount));
+    while (TableExpandFields(previousRow, rowList, &columnCount));
 /*
 	rowCount++;
 	do {
@@ -54,6 +54,7 @@
 #include "../config.h"
 #include "../src/compat.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
 #ifdef MOTIF
@@ -113,9 +114,36 @@ extern char *ParseMarkTag();
 static Boolean ModifyIgnore = False;
 #endif                          /* MOTIF */
 
+/*
+ * Form fields that look alike come out the same size.  The first field
+ * of each kind is created and measured, and the rest are laid out from
+ * its geometry with no widget behind them until they scroll into view,
+ * are tabbed to, or a submit needs what only the widget knows.  Entries
+ * are never freed, as placeholders point at their fonts.
+ */
+#define GEOM_HASH	127
+#define GEOM_MAX	512
+
+typedef struct geom_rec {
+    char *key;
+    int type;
+    int width, height;
+    char *label;
+    Boolean has_font;
+    XFontStruct font;
+    struct geom_rec *next;
+} GeomInfo;
+
+static GeomInfo *GeomCache[GEOM_HASH];
+static int GeomCount = 0;
+static WidgetInfo *Realizing = NULL;
+
 char **ParseCommaList();
 void FreeCommaList();
 char *MapOptionReturn();
+void UnMuckTextAreaValue();
+WidgetInfo *MakeWidget();
+static Widget RealizeWidget();
 
 static char traversal_table[] = "\
 ~Shift ~Meta ~Ctrl <Key> Tab:  traversal_forward()\n\
@@ -283,29 +311,45 @@ char ***value_list;
 #else
             XawListReturnStruct *currentSelection;
 #endif                          /* MOTIF */
+            Boolean on;
+
+            /*
+             * What is selected in a list is easier had from the list.
+             */
+            if ((wptr->text != NULL) && ((wptr->type == W_LIST) || (wptr->type == W_OPTIONMENU))) {
+                RealizeWidget(hw, wptr);
+            }
 
             cbdata.attribute_names[cnt] = wptr->name;
             switch (wptr->type) {
             case W_TEXTFIELD:
+                if (wptr->text != NULL) {
+                    cbdata.attribute_values[cnt] = wptr->value;
+                } else {
 #ifdef MOTIF
-                cbdata.attribute_values[cnt] = XmTextFieldGetString(wptr->w);
+                    cbdata.attribute_values[cnt] = XmTextFieldGetString(wptr->w);
 #else
-                XtVaGetValues(wptr->w, XtNstring, &(cbdata.attribute_values[cnt]), NULL);
+                    XtVaGetValues(wptr->w, XtNstring, &(cbdata.attribute_values[cnt]), NULL);
 #endif                          /* MOTIF */
+                }
                 if ((cbdata.attribute_values[cnt] != NULL) && (cbdata.attribute_values[cnt][0] == '\0')) {
                     cbdata.attribute_values[cnt] = NULL;
                 }
                 break;
             case W_TEXTAREA:
+                if (wptr->text != NULL) {
+                    cbdata.attribute_values[cnt] = wptr->value;
+                } else {
 #ifdef MOTIF
-                argcnt = 0;
-                XtSetArg(arg[argcnt], XmNworkWindow, &child);
-                argcnt++;
-                XtGetValues(wptr->w, arg, argcnt);
-                cbdata.attribute_values[cnt] = XmTextGetString(child);
+                    argcnt = 0;
+                    XtSetArg(arg[argcnt], XmNworkWindow, &child);
+                    argcnt++;
+                    XtGetValues(wptr->w, arg, argcnt);
+                    cbdata.attribute_values[cnt] = XmTextGetString(child);
 #else
-                XtVaGetValues(wptr->w, XtNstring, &(cbdata.attribute_values[cnt]), NULL);
+                    XtVaGetValues(wptr->w, XtNstring, &(cbdata.attribute_values[cnt]), NULL);
 #endif                          /* MOTIF */
+                }
                 if ((cbdata.attribute_values[cnt] != NULL) && (cbdata.attribute_values[cnt][0] == '\0')) {
                     cbdata.attribute_values[cnt] = NULL;
                 }
@@ -421,13 +465,17 @@ char ***value_list;
                 break;
             case W_CHECKBOX:
             case W_RADIOBOX:
+                if (wptr->text != NULL) {
+                    on = wptr->state;
+                } else {
 #ifdef MOTIF
-                if (XmToggleButtonGetState(wptr->w) == True)
+                    on = XmToggleButtonGetState(wptr->w);
 #else
-                XtVaGetValues(wptr->w, XtNstate, &state, NULL);
-                if (state)
+                    XtVaGetValues(wptr->w, XtNstate, &state, NULL);
+                    on = state;
 #endif                          /* MOTIF */
-                {
+                }
+                if (on) {
                     cbdata.attribute_values[cnt] = wptr->value;
                 } else {
                     cnt--;
@@ -439,7 +487,7 @@ char ***value_list;
 		            Adding multiple submit buttons support ***/
                 /* mods 3/11/95  -- amb */
             case W_PUSHBUTTON:
-                if (fptr->button_pressed == wptr->w) {
+                if ((wptr->w != NULL) && (fptr->button_pressed == wptr->w)) {
                     cbdata.attribute_values[cnt] = wptr->value;
                 } else {
                     cnt--;
@@ -672,6 +720,10 @@ caddr_t call_data;
     while ((wptr != NULL) && (cnt < count)) {
 #ifdef MOTIF
         if ((wptr->type == W_RADIOBOX) &&
+            (wptr->text != NULL) &&
+            (wptr->name != NULL) && (name != NULL) && (strcmp(wptr->name, name) == 0)) {
+            wptr->state = False;
+        } else if ((wptr->type == W_RADIOBOX) &&
             (wptr->w != w) &&
             (XmToggleButtonGetState(wptr->w) == True) &&
             (wptr->name != NULL) && (name != NULL) && (strcmp(wptr->name, name) == 0)) {
@@ -975,6 +1027,16 @@ caddr_t call_data;
         Boolean stringInPlace;
 #endif                          /* MOTIF */
 
+        /*
+         * A field never realized can only have had its toggle moved.
+         */
+        if (wptr->text != NULL) {
+            wptr->state = wptr->checked;
+            cnt++;
+            wptr = wptr->next;
+            continue;
+        }
+
         switch (wptr->type) {
         case W_TEXTFIELD:
 #ifdef MOTIF
@@ -1311,6 +1373,28 @@ Boolean checked;
 {
     WidgetInfo *wptr, *lptr;
 
+    /*
+     * A placeholder being realized keeps its record, and the state
+     * kept in it, and only takes the widget.  A select's value and
+     * mapping are only known once it is made.
+     */
+    if (Realizing != NULL) {
+        wptr = Realizing;
+        wptr->w = w;
+        wptr->width = width;
+        wptr->height = height;
+        if (name != NULL) {
+            free(name);
+        }
+        if ((type == W_OPTIONMENU) || (type == W_LIST)) {
+            wptr->value = value;
+            wptr->mapping = mapping;
+        } else if (value != NULL) {
+            free(value);
+        }
+        return (wptr);
+    }
+
     wptr = hw->html.widget_list;
     if (wptr == NULL) {
         wptr = (WidgetInfo *) malloc(sizeof(WidgetInfo));
@@ -1328,6 +1412,10 @@ Boolean checked;
         wptr->mapping = mapping;
         wptr->checked = checked;
         wptr->mapped = False;
+        wptr->text = NULL;
+        wptr->fptr = fptr;
+        wptr->font = NULL;
+        wptr->state = checked;
         wptr->next = NULL;
         wptr->prev = NULL;
         hw->html.widget_list = wptr;
@@ -1353,6 +1441,10 @@ Boolean checked;
         wptr->mapping = mapping;
         wptr->checked = checked;
         wptr->mapped = False;
+        wptr->text = NULL;
+        wptr->fptr = fptr;
+        wptr->font = NULL;
+        wptr->state = checked;
         wptr->next = NULL;
     }
 
@@ -1383,6 +1475,10 @@ WidgetInfo *wptr;
     XmStringCharSet charset;
 #endif                          /* MOTIF */
 
+    if (wptr->text != NULL) {
+        return (wptr->font);
+    }
+
     /*
      * For option menus we have to first get the child that has the
      * font info.
@@ -1767,6 +1863,241 @@ int list_cnt;
     return (list);
 }
 
+#ifdef MOTIF
+/*
+ * The attributes a field's size depends on, run together into a key
+ * for the geometry cache.  A button's label is its size, so VALUE
+ * counts for those.  Hidden fields have no widget, jots are left as
+ * they were, and a textarea given no size sizes itself to its text,
+ * so those get no key.
+ */
+static char *GeometryKey(text)
+char *text;
+{
+    static char *attrs[] = { "TYPE", "SIZE", "ROWS", "COLS", "HINT", "MULTIPLE", "OPTIONS", NULL };
+    char *vals[8];
+    char *type_str;
+    char *key;
+    int i, n, len;
+
+    len = 0;
+    for (n = 0; attrs[n] != NULL; n++) {
+        vals[n] = ParseMarkTag(text, MT_INPUT, attrs[n]);
+        len += 2;
+        if (vals[n] != NULL) {
+            len += strlen(vals[n]);
+        }
+    }
+    type_str = vals[0];
+
+    if ((type_str != NULL) &&
+        ((my_strcasecmp(type_str, "submit") == 0) ||
+         (my_strcasecmp(type_str, "reset") == 0) || (my_strcasecmp(type_str, "button") == 0))) {
+        vals[n] = ParseMarkTag(text, MT_INPUT, "VALUE");
+        len += 2;
+        if (vals[n] != NULL) {
+            len += strlen(vals[n]);
+        }
+        n++;
+    }
+
+    key = NULL;
+    if ((type_str == NULL) ||
+        ((my_strcasecmp(type_str, "hidden") != 0) &&
+         (my_strcasecmp(type_str, "jot") != 0) &&
+         ((my_strcasecmp(type_str, "textarea") != 0) ||
+          (vals[1] != NULL) || (vals[2] != NULL) || (vals[3] != NULL)))) {
+        key = (char *)malloc(len + 1);
+        key[0] = '\0';
+        for (i = 0; i < n; i++) {
+            strcat(key, "\001");
+            strcat(key, (vals[i] != NULL) ? vals[i] : "\002");
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        if (vals[i] != NULL) {
+            free(vals[i]);
+        }
+    }
+    return (key);
+}
+
+static GeomInfo **GeometrySlot(key)
+char *key;
+{
+    unsigned int h;
+    unsigned char *p;
+
+    h = 0;
+    for (p = (unsigned char *)key; *p != '\0'; p++) {
+        h = (h * 31) + *p;
+    }
+    return (&GeomCache[h % GEOM_HASH]);
+}
+
+static GeomInfo *FindGeometry(key)
+char *key;
+{
+    GeomInfo *geom;
+
+    for (geom = *GeometrySlot(key); geom != NULL; geom = geom->next) {
+        if (strcmp(geom->key, key) == 0) {
+            break;
+        }
+    }
+    return (geom);
+}
+
+/*
+ * Remember the size of a field just made, taking over the key.
+ */
+static void KeepGeometry(hw, key, wptr)
+HTMLWidget hw;
+char *key;
+WidgetInfo *wptr;
+{
+    GeomInfo **slot;
+    GeomInfo *geom;
+    XFontStruct *font;
+
+    if ((GeomCount >= GEOM_MAX) || (wptr->w == NULL)) {
+        free(key);
+        return;
+    }
+
+    geom = (GeomInfo *) malloc(sizeof(GeomInfo));
+    if (geom == NULL) {
+        free(key);
+        return;
+    }
+    geom->key = key;
+    geom->type = wptr->type;
+    geom->width = wptr->width;
+    geom->height = wptr->height;
+    geom->label = NULL;
+    if ((wptr->type == W_PUSHBUTTON) && (wptr->value != NULL)) {
+        geom->label = (char *)malloc(strlen(wptr->value) + 1);
+        strcpy(geom->label, wptr->value);
+    }
+    geom->has_font = False;
+    font = GetWidgetFont(hw, wptr);
+    if (font != NULL) {
+        geom->font = *font;
+        geom->has_font = True;
+    }
+
+    slot = GeometrySlot(key);
+    geom->next = *slot;
+    *slot = geom;
+    GeomCount++;
+}
+
+/*
+ * Lay out a field from the geometry of one like it, keeping its
+ * name, value and checked state as MakeWidget would have, but
+ * creating no widget.
+ */
+static WidgetInfo *AddPlaceholder(hw, geom, text, x, y, id, fptr)
+HTMLWidget hw;
+GeomInfo *geom;
+char *text;
+int x, y;
+int id;
+FormInfo *fptr;
+{
+    WidgetInfo *wptr;
+    char *name;
+    char *value;
+    char *tptr;
+    Boolean checked;
+
+    name = ParseMarkTag(text, MT_INPUT, "NAME");
+    value = NULL;
+    checked = False;
+
+    switch (geom->type) {
+    case W_CHECKBOX:
+    case W_RADIOBOX:
+        value = ParseMarkTag(text, MT_INPUT, "VALUE");
+        if (value == NULL) {
+            value = (char *)malloc(strlen("on") + 1);
+            strcpy(value, "on");
+        }
+        tptr = ParseMarkTag(text, MT_INPUT, "CHECKED");
+        if (tptr != NULL) {
+            checked = True;
+            if ((geom->type == W_RADIOBOX) && (AlreadyChecked(hw, fptr, name) == True)) {
+                checked = False;
+            }
+            free(tptr);
+        }
+        break;
+    case W_PUSHBUTTON:
+        if (geom->label != NULL) {
+            value = (char *)malloc(strlen(geom->label) + 1);
+            strcpy(value, geom->label);
+        }
+        break;
+    case W_TEXTFIELD:
+    case W_PASSWORD:
+    case W_TEXTAREA:
+        value = ParseMarkTag(text, MT_INPUT, "VALUE");
+        tptr = ParseMarkTag(text, MT_INPUT, "TYPE");
+        if ((tptr != NULL) && (my_strcasecmp(tptr, "textarea") == 0)) {
+            UnMuckTextAreaValue(value);
+        }
+        if (tptr != NULL) {
+            free(tptr);
+        }
+        break;
+    default:
+        break;
+    }
+
+    wptr = AddNewWidget(hw, fptr, NULL, geom->type, id, x, y, geom->width, geom->height, name, value, NULL, checked);
+    wptr->text = (char *)malloc(strlen(text) + 1);
+    strcpy(wptr->text, text);
+    if (geom->has_font) {
+        wptr->font = &(geom->font);
+    }
+    return (wptr);
+}
+#endif                          /* MOTIF */
+
+/*
+ * Create the real widget for a placeholder where it was laid out,
+ * and give it the state kept for it meanwhile.
+ */
+static Widget RealizeWidget(hw, wptr)
+HTMLWidget hw;
+WidgetInfo *wptr;
+{
+    char *text;
+
+    if (wptr->text == NULL) {
+        return (wptr->w);
+    }
+
+    text = wptr->text;
+    Realizing = wptr;
+    (void)MakeWidget(hw, text, wptr->x, wptr->y, wptr->id, wptr->fptr);
+    Realizing = NULL;
+    wptr->text = NULL;
+    free(text);
+
+    if (wptr->w != NULL) {
+#ifdef MOTIF
+        if ((wptr->type == W_CHECKBOX) || (wptr->type == W_RADIOBOX)) {
+            XmToggleButtonSetState(wptr->w, wptr->state, False);
+        }
+#endif                          /* MOTIF */
+        XtMoveWidget(wptr->w, wptr->x - hw->html.scroll_x, wptr->y - hw->html.scroll_y);
+        wptr->seeable = 1;
+    }
+    return (wptr->w);
+}
+
 #ifdef MOTIF
 /********** MOTIF VERSION *************/
 /*
@@ -1786,18 +2117,27 @@ FormInfo *fptr;
     WidgetInfo *wlist;
     WidgetInfo *wptr;
     Dimension width, height;
+    GeomInfo *geom;
+    char *key;
 
-    wlist = hw->html.widget_list;
-    while (wlist != NULL) {
-        if (wlist->id == id) {
-            break;
+    /*
+     * When realizing a placeholder its record is already on the list.
+     */
+    wlist = NULL;
+    if (Realizing == NULL) {
+        wlist = hw->html.widget_list;
+        while (wlist != NULL) {
+            if (wlist->id == id) {
+                break;
+            }
+            wlist = wlist->next;
         }
-        wlist = wlist->next;
     }
 
     /*
      * If this widget is not on the list, we have never
-     * used it before.  Create it now.
+     * used it before.  Create it now, unless we know its size
+     * and can leave that until it is seen.
      */
     if (wlist == NULL) {
         char widget_name[100];
@@ -1811,6 +2151,15 @@ FormInfo *fptr;
         int maxlength;
         Boolean checked;
 
+        key = NULL;
+        if ((Realizing == NULL) && (fptr != NULL)) {
+            key = GeometryKey(text);
+            if ((key != NULL) && ((geom = FindGeometry(key)) != NULL)) {
+                free(key);
+                return (AddPlaceholder(hw, geom, text, x, y, id, fptr));
+            }
+        }
+
         mapping = NULL;
 
         checked = False;
@@ -2684,6 +3033,9 @@ FormInfo *fptr;
         }
 
         wptr = AddNewWidget(hw, fptr, w, type, id, x, y, width, height, name, value, mapping, checked);
+        if (key != NULL) {
+            KeepGeometry(hw, key, wptr);
+        }
     } else
         /*
          * We found this widget on the list of already created widgets.
@@ -2692,6 +3044,7 @@ FormInfo *fptr;
     {
         wlist->x = x;
         wlist->y = y;
+        wlist->fptr = fptr;
 
         /*
          * Don't want to SetValues if type HIDDEN which
@@ -3455,6 +3808,10 @@ unsigned long wp=WhitePixel(XtDisplay(hw),DefaultScreen(XtDisplay(hw)));
 unsigned long bp=BlackPixel(XtDisplay(hw),DefaultScreen(XtDisplay(hw)));
 */
 
+    if ((eptr->widget_data != NULL) && (eptr->widget_data->text != NULL)) {
+        RealizeWidget(hw, eptr->widget_data);
+    }
+
     if ((eptr->widget_data != NULL) && (eptr->widget_data->mapped == False) && (eptr->widget_data->w != NULL)) {
         XSetForeground(XtDisplay(hw), hw->html.drawGC, eptr->fg);
         XSetBackground(XtDisplay(hw), hw->html.drawGC, eptr->bg);
@@ -3542,11 +3899,11 @@ void HTMLTraverseTabGroups(Widget w, int how)
     case XmTRAVERSE_NEXT_TAB_GROUP:
         if (!lptr)
             lptr = hw->html.widget_list;
-        else if (lptr->next && lptr->next->w && XtIsManaged(lptr->next->w))
+        else if (lptr->next && RealizeWidget(hw, lptr->next) && XtIsManaged(lptr->next->w))
             lptr = lptr->next;
 
         /* Patch for hidden fields... SWP */
-        while (lptr && !lptr->w) {
+        while (lptr && !RealizeWidget(hw, lptr)) {
             if (lptr->next) {
                 lptr = lptr->next;
             } else {
@@ -3587,7 +3944,7 @@ void HTMLTraverseTabGroups(Widget w, int how)
             lptr = lptr->prev;
 
         /* Patch for hidden fields... SWP */
-        while (lptr && !lptr->w) {
+        while (lptr && !RealizeWidget(hw, lptr)) {
             if (lptr->prev) {
                 lptr = lptr->prev;
             } else {
@@ -41,6 +41,7 @@
 #include "HTList.h"
 #include "HText.h"              /* See bugs above */
 #include "HTAlert.h"
+#include "HTSegment.h"
 
 #include "../src/proxy.h"
 #include "../src/compat.h"
@@ -50,6 +51,10 @@ extern int www2Trace;
 #endif
 
 extern char *mo_check_for_proxy(char *);
+extern int binary_transfer;
+extern int force_dump_to_file;
+extern char *force_dump_filename;
+extern int do_post;             /* HTTP.c */
 int has_fallbacks(char *protocol);
 
 char *currentURL = NULL;
@@ -113,6 +118,60 @@ PRIVATE void HTAccessInit NOARGS    /* Call me once */
      HTRegisterProtocol(&HTMailto);
      HTRegisterProtocol(&HTNNTP);
 }
+
+/*	Gateway and proxy for a scheme from the environment
+**	---------------------------------------------------
+**
+**	WWW_<scheme>_GATEWAY and <scheme>_proxy are read once per scheme.
+**	The proxy is returned with a '/' on the end, or NULL if not set.
+*/
+#define ENV_SCHEMES 16
+PRIVATE void proxy_environment ARGS3(char *, access, char **, gateway, char **, proxy)
+{
+    static struct {
+        char *access;
+        char *gateway;
+        char *proxy;
+    } env[ENV_SCHEMES];
+    static int nenv = 0, next = 0;
+    char name[64], *value;
+    int i;
+
+    for (i = 0; i < nenv; i++)
+        if (!strcmp(env[i].access, access)) {
+            *gateway = env[i].gateway;
+            *proxy = env[i].proxy;
+            return;
+        }
+
+    sprintf(name, "WWW_%s_GATEWAY", access);
+    *gateway = (char *)getenv(name);    /* coerce for decstation */
+    sprintf(name, "%s_proxy", access);
+    value = (char *)getenv(name);
+    *proxy = NULL;
+    if (value && *value) {
+        *proxy = (char *)malloc(strlen(value) + 2);
+        if (*proxy == NULL)
+            outofmem(__FILE__, "proxy_environment");
+        strcpy(*proxy, value);
+        if (value[strlen(value) - 1] != '/')
+            strcat(*proxy, "/");
+    }
+
+    if (nenv < ENV_SCHEMES)
+        i = nenv++;
+    else {
+        i = next;
+        next = (next + 1) % ENV_SCHEMES;
+        free(env[i].access);
+        if (env[i].proxy)
+            free(env[i].proxy);
+    }
+    env[i].access = strdup(access);
+    env[i].gateway = *gateway;
+    env[i].proxy = *proxy;
+}
+
 /*		Find physical name and access protocol
 **		--------------------------------------
 **
@@ -156,74 +215,55 @@ PRIVATE void HTAccessInit NOARGS    /* Call me once */
 #ifdef USE_GATEWAYS
     /* make sure the using_proxy variable is false */
     using_proxy = NO;
-    if (proxy_host_fix) {
-        free(proxy_host_fix);
-        proxy_host_fix = NULL;
-    }
+    proxy_host_fix = NULL;
 
     {
-        char *tmp_access, *tmp_host, *ptr;
+        char tmp_access[32];
+        static char *tmp_host = NULL;   /* proxy_host_fix points here */
+        int i;
 
-        for (ptr = tmp_access = strdup(access); ptr && *ptr; ptr++)
-            *ptr = tolower(*ptr);
-        for (ptr = tmp_host = strdup(host); ptr && *ptr; ptr++)
-            *ptr = tolower(*ptr);
+        for (i = 0; access[i] && i < sizeof(tmp_access) - 1; i++)
+            tmp_access[i] = TOLOWER(access[i]);
+        tmp_access[i] = '\0';
+        StrAllocCopy(tmp_host, host);
+        for (i = 0; tmp_host[i]; i++)
+            tmp_host[i] = TOLOWER(tmp_host[i]);
 
         if (!GetNoProxy(tmp_access, tmp_host)) {
-            char *gateway_parameter, *gateway, *proxy;
-            struct Proxy *proxent = NULL, *GetProxy();
-            extern struct Proxy *proxy_list;
-            char *proxyentry = NULL;
-
-            proxy_host_fix = strdup(tmp_host);
-
-            /* search for gateways */
-            gateway_parameter = (char *)malloc(strlen(tmp_access) + 20);
-            if (gateway_parameter == NULL)
-                outofmem(__FILE__, "HTLoad");
-            strcpy(gateway_parameter, "WWW_");
-            strcat(gateway_parameter, tmp_access);
-            strcat(gateway_parameter, "_GATEWAY");
-            gateway = (char *)getenv(gateway_parameter);    /* coerce for decstation */
-
-            /* search for proxy servers */
-            strcpy(gateway_parameter, tmp_access);
-            strcat(gateway_parameter, "_proxy");
-            proxy = (char *)getenv(gateway_parameter);
-            free(gateway_parameter);
+            char *gateway, *proxy;
+            struct Proxy *proxent = NULL;
+
+            proxy_host_fix = tmp_host;
+
+            /* search for gateways and proxy servers */
+            proxy_environment(tmp_access, &gateway, &proxy);
 
             /*
              * Check the proxies list
              */
-            if ((proxy == NULL) || (proxy[0] == '\0')) {
+            if (proxy == NULL) {
                 int fMatchEnd;
                 char *scheme_info;
 
-                scheme_info = HTParse(HTAnchor_physical(anchor), "", PARSE_HOST);
+                scheme_info = host;
                 fMatchEnd = 1;  /* match hosts from the end */
 
-                if ((scheme_info != NULL) && (*scheme_info == '\0')) {
+                if (*scheme_info == '\0') {
                     scheme_info = HTParse(HTAnchor_physical(anchor), "", PARSE_PATH);
                     fMatchEnd = 0;  /* match other scheme_info at beginning */
                 }
 
                 if (bong) {     /* this one is bad - disable! */
-                    proxent = GetProxy(tmp_access, scheme_info, fMatchEnd);
+                    proxent = MatchProxy(tmp_access, scheme_info, fMatchEnd, NULL);
                     if (proxent != NULL)
                         proxent->alive = bong;
                 }
-                proxent = GetProxy(tmp_access, scheme_info, fMatchEnd);
-                if (proxent != NULL) {
+                proxent = MatchProxy(tmp_access, scheme_info, fMatchEnd, &proxy);
+                if (proxent != NULL)
                     useKeepAlive = 0;   /* proxies don't keepalive */
-                    StrAllocCopy(proxyentry, proxent->transport);
-                    StrAllocCat(proxyentry, "://");
-                    StrAllocCat(proxyentry, proxent->address);
-                    StrAllocCat(proxyentry, ":");
-                    StrAllocCat(proxyentry, proxent->port);
-                    StrAllocCat(proxyentry, "/");
-                    proxy = proxyentry;
-                }
 
+                if (scheme_info != host)
+                    free(scheme_info);
             }
 
 #ifndef DIRECT_WAIS
@@ -235,22 +275,16 @@ PRIVATE void HTAccessInit NOARGS    /* Call me once */
             /* proxy servers have precedence over gateway servers */
             if (proxy) {
                 char *gatewayed;
-                char *y;
-                char *z;
-                y = strrchr(proxy, '/');
-                z = strrchr(proxy, '\0');
-                if (++y != z)   /* ewww but efficient */
-                    strcat(proxy, "/");
 
-                gatewayed = NULL;
-                StrAllocCopy(gatewayed, proxy);
-                StrAllocCat(gatewayed, addr);
+                gatewayed = (char *)malloc(strlen(proxy) + strlen(addr) + 1);
+                if (gatewayed == NULL)
+                    outofmem(__FILE__, "get_physical");
+                strcpy(gatewayed, proxy);
+                strcat(gatewayed, addr);
                 using_proxy = YES;
                 HTAnchor_setPhysical(anchor, gatewayed);
                 free(gatewayed);
                 free(access);
-                if (proxyentry)
-                    free(proxyentry);
                 access = HTParse(HTAnchor_physical(anchor), "http:", PARSE_ACCESS);
             } else if (gateway) {
                 char *gatewayed;
@@ -264,19 +298,15 @@ PRIVATE void HTAccessInit NOARGS    /* Call me once */
                 free(access);
                 access = HTParse(HTAnchor_physical(anchor), "http:", PARSE_ACCESS);
             } else {
-                if (proxy_host_fix) {
-                    free(proxy_host_fix);
-                }
                 proxy_host_fix = NULL;
                 using_proxy = NO;
                 using_gateway = NO;
                 ClearTempBongedProxies();
             }
         }
-        free(tmp_access);
-        free(tmp_host);
     }
 #endif
+    free(host);
 
 /*	Search registered protocols to find suitable one
 */
@@ -337,6 +367,13 @@ PRIVATE int HTLoad ARGS4(WWW_CONST char *, addr, HTParentAnchor *, anchor, HTFor
     }
     fallbacks = has_fallbacks(p->name);
 
+    /* A big file going straight to disk may be fetched in pieces. */
+    if (status >= 0 && binary_transfer && force_dump_to_file && !using_proxy && !do_post) {
+        ret = HTSegmentLoad(HTAnchor_physical(anchor), force_dump_filename);
+        if (ret != 0)
+            return ret;
+    }
+
     while (1) {
         if (status < 0)
             return status;      /* Can't resolve or forbidden */
@@ -46,6 +46,24 @@ PUBLIC int HTCheckActiveIcon ARGS1(int, twirl)
     return (ret);
 }
 
+PUBLIC BOOL HTFeedbackDue ARGS1(struct timeval *, last)
+{
+    struct timeval now;
+    long ms;
+
+    gettimeofday(&now, NULL);
+
+    /* Anything more than a second ago, or in the future, is due. */
+    if (now.tv_sec == last->tv_sec || now.tv_sec == last->tv_sec + 1) {
+        ms = (now.tv_sec - last->tv_sec) * 1000 + (now.tv_usec - last->tv_usec) / 1000;
+        if (ms >= 0 && ms < HT_FEEDBACK_INTERVAL)
+            return NO;
+    }
+
+    *last = now;
+    return YES;
+}
+
 PUBLIC void HTClearActiveIcon NOARGS {
     mo_gui_clear_icon();
     return;
@@ -36,10 +36,25 @@ extern void HTAlert PARAMS((WWW_CONST char * Msg));
 **              The input is a list of parameters for printf.
 */
 extern void HTProgress PARAMS((WWW_CONST char * Msg));
+extern void HTMeter PARAMS((WWW_CONST int level, WWW_CONST char * text));
 extern int HTCheckActiveIcon PARAMS((int twirl));
 extern void HTClearActiveIcon NOPARAMS;
 
 
+/*      Rate-limit feedback to the user
+**
+**      On entry,
+**              last is when feedback was last given (all zero for never).
+**
+**      On exit,
+**              Returns YES, and sets last to now, if at least
+**              HT_FEEDBACK_INTERVAL milliseconds have passed since last;
+**              returns NO otherwise.
+*/
+#define HT_FEEDBACK_INTERVAL 50
+extern BOOL HTFeedbackDue PARAMS((struct timeval * last));
+
+
 /*      Display a message, then wait for 'yes' or 'no'.
 **
 **      On entry,
@@ -13,7 +13,8 @@
 **	(c) Copyright CERN 1991 - See Copyright.html
 */
 #include "../config.h"
-#define HASH_SIZE 101           /* Arbitrary prime. Memory/speed tradeoff */
+#define INITIAL_BUCKETS 128     /* Power of two; the table doubles from here */
+#define KEEP_RECENT 64          /* Most recently used parents never collected */
 
 #include <ctype.h>
 #include "tcp.h"
@@ -27,7 +28,15 @@ extern int www2Trace;
 
 typedef struct _HyperDoc Hyperdoc;
 
-PRIVATE HTList **adult_table = 0;   /* Point to table of lists of all parents */
+PRIVATE HTParentAnchor **adult_table = 0;  /* Hash table of all parents */
+PRIVATE int adult_buckets = 0;
+PRIVATE HTParentAnchor *lru_head = 0;   /* Most recently used parent */
+PRIVATE HTParentAnchor *lru_tail = 0;   /* Least recently used parent */
+PRIVATE int collect_at = 0;     /* Don't try collecting again below this */
+PRIVATE HTAnchorStats anchor_stats;
+
+PUBLIC int HTAnchor_maxParents = 2000;
+PUBLIC int (*HTAnchor_isReferenced) PARAMS((char * address)) = 0;
 
 /*				Creation Methods
 **				================
@@ -136,6 +145,164 @@ PUBLIC HTChildAnchor *HTAnchor_findChildAndLink ARGS4(HTParentAnchor *, parent,
     return child;
 }
 
+/*	Parent anchor registry
+**	----------------------
+**
+**	The hash ignores case, as equivalent() does, and is kept in each
+**	anchor so the table can be doubled without rehashing addresses.
+*/
+
+PRIVATE unsigned int hash_address ARGS1(WWW_CONST char *, address)
+{
+    unsigned int hash = 0;
+
+    for (; *address; address++)
+        hash = hash * 31 + (unsigned char)TOUPPER(*address);
+
+    /* URLs differ mostly in their last few characters; mix those
+       into the low bits, which are all that pick a bucket. */
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3b;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+PRIVATE void lru_unlink ARGS1(HTParentAnchor *, me)
+{
+    if (me->lru_prev)
+        me->lru_prev->lru_next = me->lru_next;
+    else
+        lru_head = me->lru_next;
+    if (me->lru_next)
+        me->lru_next->lru_prev = me->lru_prev;
+    else
+        lru_tail = me->lru_prev;
+    me->lru_prev = me->lru_next = NULL;
+}
+
+PRIVATE void lru_push ARGS1(HTParentAnchor *, me)
+{
+    me->lru_prev = NULL;
+    me->lru_next = lru_head;
+    if (lru_head)
+        lru_head->lru_prev = me;
+    else
+        lru_tail = me;
+    lru_head = me;
+}
+
+PRIVATE void grow_table NOARGS
+{
+    HTParentAnchor **table, *me, *next;
+    int buckets = adult_buckets * 2;
+    int i;
+
+    table = (HTParentAnchor **) calloc(buckets, sizeof(HTParentAnchor *));
+    if (table == NULL)
+        return;                 /* Keep the old one; longer chains but correct */
+
+    for (i = 0; i < adult_buckets; i++) {
+        for (me = adult_table[i]; me; me = next) {
+            next = me->hash_next;
+            me->hash_next = table[me->hash & (buckets - 1)];
+            table[me->hash & (buckets - 1)] = me;
+        }
+    }
+    free(adult_table);
+    adult_table = table;
+    adult_buckets = buckets;
+    anchor_stats.resizes++;
+#ifndef DISABLE_TRACE
+    if (www2Trace)
+        fprintf(stderr, "HTAnchor: table grown to %d buckets for %d parents\n", buckets, anchor_stats.parents);
+#endif
+}
+
+PRIVATE void unregister ARGS1(HTParentAnchor *, me)
+{
+    HTParentAnchor **pp;
+
+    if (!adult_table)
+        return;
+    for (pp = &adult_table[me->hash & (adult_buckets - 1)]; *pp; pp = &(*pp)->hash_next) {
+        if (*pp == me) {
+            *pp = me->hash_next;
+            lru_unlink(me);
+            anchor_stats.parents--;
+            return;
+        }
+    }
+}
+
+/*	Free a parent which nothing links to, with its children
+*/
+PRIVATE void free_parent ARGS1(HTParentAnchor *, me)
+{
+    HTChildAnchor *child;
+
+    unregister(me);
+    while ((child = HTList_removeLastObject(me->children))) {
+        HTList_delete(child->links);
+        free(child->tag);
+        free(child);
+    }
+    HTList_delete(me->children);
+    HTList_delete(me->sources);
+    HTList_delete(me->links);
+    HTList_delete(me->methods);
+    free(me->address);
+    free(me->title);
+    free(me->physical);
+    free(me);
+}
+
+PRIVATE BOOL in_use ARGS1(HTParentAnchor *, me)
+{
+    HTList *kids = me->children;
+    HTChildAnchor *child;
+
+    if (me->document || !HTList_isEmpty(me->sources) || me->mainLink.dest || !HTList_isEmpty(me->links))
+        return YES;
+    while ((child = HTList_nextObject(kids)))
+        if (child->mainLink.dest || !HTList_isEmpty(child->links))
+            return YES;
+    if (HTAnchor_isReferenced && (*HTAnchor_isReferenced) (me->address))
+        return YES;
+    return NO;
+}
+
+/*	Collect least recently used parents until a quarter of the room
+**	is free again, or we run into the most recently used ones.
+*/
+PRIVATE void collect NOARGS
+{
+    HTParentAnchor *me, *prev;
+    int scan = anchor_stats.parents - KEEP_RECENT;
+    int target = HTAnchor_maxParents - HTAnchor_maxParents / 4;
+    long before = anchor_stats.collected;
+
+    for (me = lru_tail; me && scan > 0 && anchor_stats.parents > target; me = prev, scan--) {
+        prev = me->lru_prev;
+        if (in_use(me))
+            continue;
+        free_parent(me);
+        anchor_stats.collected++;
+    }
+
+    /* If most are still wanted, let a quarter more arrive before trying again. */
+    collect_at = anchor_stats.parents + HTAnchor_maxParents / 4;
+#ifndef DISABLE_TRACE
+    if (www2Trace)
+        fprintf(stderr, "HTAnchor: collected %ld parents, %d left\n", anchor_stats.collected - before, anchor_stats.parents);
+#endif
+}
+
+PUBLIC void HTAnchor_getStats ARGS1(HTAnchorStats *, stats)
+{
+    *stats = anchor_stats;
+    stats->buckets = adult_buckets;
+}
+
 /*	Create new or find old named anchor
 **	-----------------------------------
 **
@@ -162,43 +329,53 @@ HTAnchor *HTAnchor_findAddress ARGS1(WWW_CONST char *, address)
 
     else {                      /* If the address has no anchor tag, 
                                    check whether we have this node */
-        int hash;
-        WWW_CONST char *p;
-        HTList *adults;
-        HTList *grownups;
+        unsigned int hash;
         HTParentAnchor *foundAnchor;
 
         free(tag);
+        anchor_stats.lookups++;
+
+        if (!adult_table) {
+            adult_table = (HTParentAnchor **) calloc(INITIAL_BUCKETS, sizeof(HTParentAnchor *));
+            if (adult_table == NULL)
+                outofmem(__FILE__, "HTAnchor_findAddress");
+            adult_buckets = INITIAL_BUCKETS;
+        }
 
-        /* Select list from hash table */
-        for (p = address, hash = 0; *p; p++)
-            hash = (hash * 3 + (*(unsigned char *)p)) % HASH_SIZE;
-        if (!adult_table)
-            adult_table = (HTList **) calloc(HASH_SIZE, sizeof(HTList *));
-        if (!adult_table[hash])
-            adult_table[hash] = HTList_new();
-        adults = adult_table[hash];
-
-        /* Search list for anchor */
-        grownups = adults;
-        while (foundAnchor = HTList_nextObject(grownups)) {
-            if (equivalent(foundAnchor->address, address)) {
+        /* Search the bucket for the anchor */
+        hash = hash_address(address);
+        for (foundAnchor = adult_table[hash & (adult_buckets - 1)]; foundAnchor; foundAnchor = foundAnchor->hash_next) {
+            anchor_stats.probes++;
+            if (foundAnchor->hash == hash && equivalent(foundAnchor->address, address)) {
 #ifndef DISABLE_TRACE
                 if (www2Trace)
                     fprintf(stderr, "Anchor %p with address `%s' already exists.\n", (void *)foundAnchor, address);
 #endif
+                anchor_stats.hits++;
+                lru_unlink(foundAnchor);
+                lru_push(foundAnchor);
                 return (HTAnchor *) foundAnchor;
             }
         }
 
-        /* Node not found : create new anchor */
+        /* Node not found : make room, then create new anchor */
+        if (HTAnchor_maxParents > 0 && anchor_stats.parents >= HTAnchor_maxParents && anchor_stats.parents >= collect_at)
+            collect();
+        if (anchor_stats.parents >= adult_buckets)
+            grow_table();
+
         foundAnchor = HTParentAnchor_new();
 #ifndef DISABLE_TRACE
         if (www2Trace)
-            fprintf(stderr, "New anchor %p has hash %d and address `%s'\n", (void *)foundAnchor, hash, address);
+            fprintf(stderr, "New anchor %p has hash %u and address `%s'\n", (void *)foundAnchor, hash, address);
 #endif
         StrAllocCopy(foundAnchor->address, address);
-        HTList_addObject(adults, foundAnchor);
+        foundAnchor->hash = hash;
+        foundAnchor->hash_next = adult_table[hash & (adult_buckets - 1)];
+        adult_table[hash & (adult_buckets - 1)] = foundAnchor;
+        lru_push(foundAnchor);
+        anchor_stats.parents++;
+        anchor_stats.created++;
         return (HTAnchor *) foundAnchor;
     }
 }
@@ -263,12 +440,9 @@ PUBLIC BOOL HTAnchor_delete ARGS1(HTParentAnchor *, me)
         free(child);
     }
 
-    /* Now kill myself */
-    HTList_delete(me->children);
-    HTList_delete(me->sources);
-    free(me->address);
+    /* Now kill myself, and take myself out of the table */
     /* Devise a way to clean out the HTFormat if no longer needed (ref count?) */
-    free(me);
+    free_parent(me);
     return YES;                 /* Parent deleted */
 }
 
@@ -41,6 +41,7 @@
 #define HTAnchor_physical                       HTAnPhys
 #define HTAnchor_setPhysical                    HTAnSePh
 #define HTAnchor_methods                        HtAnMeth
+#define HTAnchor_getStats                       HTAnGeSt
 #endif
 
 /*                      Main definition of anchor
@@ -87,6 +88,12 @@ struct _HTParentAnchor {
   HTList*       methods;        /* Methods available as HTAtoms */
   void *        protocol;       /* Protocol object */
   char *        physical;       /* Physical address */
+
+  /* Registry bookkeeping, private to HTAnchor.c */
+  unsigned int  hash;           /* Full hash of address */
+  HTParentAnchor * hash_next;   /* Next in the same bucket */
+  HTParentAnchor * lru_prev;    /* Next more recently used */
+  HTParentAnchor * lru_next;    /* Next less recently used */
 };
 
 typedef struct {
@@ -160,6 +167,37 @@ extern BOOL HTAnchor_delete
      );
 
 
+/*      Parent anchor registry
+**      ----------------------
+**
+**      Parent anchors are kept in a hash table on their address, which
+**      doubles in size as it fills.  Once it holds HTAnchor_maxParents
+**      anchors, the least recently used are collected unless their
+**      document is loaded, they take part in links, or the application's
+**      HTAnchor_isReferenced (if set) says it still wants the address.
+**      Setting HTAnchor_maxParents to 0 turns collection off.
+*/
+
+typedef struct _HTAnchorStats {
+  long          lookups;        /* Parent lookups by HTAnchor_findAddress */
+  long          hits;           /* ... that found an existing anchor */
+  long          probes;         /* Anchors looked at while searching */
+  long          created;        /* Parents created */
+  long          collected;      /* Parents collected */
+  int           parents;        /* Parents in the table now */
+  int           buckets;        /* Size of the table now */
+  int           resizes;        /* Times the table has doubled */
+} HTAnchorStats;
+
+extern int HTAnchor_maxParents;
+extern int (*HTAnchor_isReferenced) PARAMS((char * address));
+
+extern void HTAnchor_getStats
+  PARAMS(
+     (HTAnchorStats *stats)
+     );
+
+
 /*              Move an anchor to the head of the list of its siblings
 **              ------------------------------------------------------
 **
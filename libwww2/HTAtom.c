@@ -6,6 +6,7 @@
 **	for equality done more efficiently.
 **
 **	Atoms are kept in a hash table consisting of an array of linked lists.
+**	The array doubles when there are twice as many atoms as lists.
 **
 ** Authors:
 **	TBL	Tim Berners-Lee, WorldWideWeb project, CERN
@@ -13,7 +14,7 @@
 **
 */
 #include "../config.h"
-#define HASH_SIZE	101         /* Tunable */
+#define INITIAL_SIZE	128     /* Power of two; the table doubles from here */
 #include "HTAtom.h"
 
 #include <stdio.h>              /* joe@athena, TBL 921019 */
@@ -25,8 +26,47 @@
 extern int www2Trace;
 #endif
 
-PRIVATE HTAtom *hash_table[HASH_SIZE];
-PRIVATE BOOL initialised = NO;
+PRIVATE HTAtom **hash_table = 0;
+PRIVATE int hash_size = 0;
+PRIVATE int atom_count = 0;
+
+/*	Generate hash function
+*/
+PRIVATE unsigned int hash_string ARGS1(WWW_CONST char *, string)
+{
+    unsigned int hash = 0;
+
+    for (; *string; string++)
+        hash = hash * 31 + (unsigned char)*string;
+    hash ^= hash >> 16;         /* Mix the last characters into the low bits */
+    hash *= 0x45d9f3b;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/*	Double the table, moving every atom to its new list
+*/
+PRIVATE void grow_table NOARGS
+{
+    HTAtom **table, *a, *next;
+    int size = hash_size * 2;
+    int i;
+
+    table = (HTAtom **) calloc(size, sizeof(HTAtom *));
+    if (table == NULL)
+        return;                 /* Keep the old one; longer lists but correct */
+
+    for (i = 0; i < hash_size; i++) {
+        for (a = hash_table[i]; a; a = next) {
+            next = a->next;
+            a->next = table[hash_string(a->name) & (size - 1)];
+            table[hash_string(a->name) & (size - 1)] = a;
+        }
+    }
+    free(hash_table);
+    hash_table = table;
+    hash_size = size;
+}
 
 #ifdef __STDC__
 PUBLIC HTAtom *HTAtom_for(char *string)
@@ -35,32 +75,26 @@ PUBLIC HTAtom *HTAtom_for(string)
 char *string;
 #endif
 {
-    int hash;
-    WWW_CONST char *p;
+    unsigned int hash;
     HTAtom *a;
 
     /* Bug hack. */
     if (!string || !*string)
         string = strdup("blargh");
 
-    /*          First time around, clear hash table
+    /*          First time around, make the hash table
      */
-    if (!initialised) {
-        int i;
-        for (i = 0; i < HASH_SIZE; i++)
-            hash_table[i] = (HTAtom *) 0;
-        initialised = YES;
-    }
-
-    /*          Generate hash function
-     */
-    for (p = string, hash = 0; *p; p++) {
-        hash = (hash * 3 + *p) % HASH_SIZE;
+    if (!hash_table) {
+        hash_table = (HTAtom **) calloc(INITIAL_SIZE, sizeof(HTAtom *));
+        if (hash_table == NULL)
+            outofmem(__FILE__, "HTAtom_for");
+        hash_size = INITIAL_SIZE;
     }
 
     /*          Search for the string in the list
      */
-    for (a = hash_table[hash]; a; a = a->next) {
+    hash = hash_string(string);
+    for (a = hash_table[hash & (hash_size - 1)]; a; a = a->next) {
         if (0 == strcmp(a->name, string)) {
 #ifndef DISABLE_TRACE
             if (www2Trace)
@@ -79,8 +113,10 @@ char *string;
     if (a->name == NULL)
         outofmem(__FILE__, "HTAtom_for");
     strcpy(a->name, string);
-    a->next = hash_table[hash]; /* Put onto the head of list */
-    hash_table[hash] = a;
+    if (++atom_count > hash_size * 2)
+        grow_table();
+    a->next = hash_table[hash & (hash_size - 1)];   /* Put onto the head of list */
+    hash_table[hash & (hash_size - 1)] = a;
 #ifndef DISABLE_TRACE
     if (www2Trace)
         fprintf(stderr, "HTAtom: New atom %p for `%s'\n", a, string);
@@ -95,23 +131,15 @@ PUBLIC HTAtom *HTAtom_exists(string)
 char *string;
 #endif
 {
-    int hash;
-    WWW_CONST char *p;
     HTAtom *a;
 
-    if (!initialised) {
+    if (!hash_table) {
         return NULL;
     }
 
-    /*          Generate hash function
-     */
-    for (p = string, hash = 0; *p; p++) {
-        hash = (hash * 3 + *p) % HASH_SIZE;
-    }
-
     /*          Search for the string in the list
      */
-    for (a = hash_table[hash]; a; a = a->next) {
+    for (a = hash_table[hash_string(string) & (hash_size - 1)]; a; a = a->next) {
         if (0 == strcmp(a->name, string)) {
             return a;           /* Found: return it */
         }
@@ -6,6 +6,7 @@
 #include "HTUtils.h"
 #include "HTChunk.h"
 #include <stdio.h>
+#include <string.h>
 
 /*	Create a chunk with a certain allocation unit
 **	--------------
@@ -52,7 +53,10 @@ PUBLIC void HTChunkFree ARGS1(HTChunk *, ch)
 PUBLIC void HTChunkPutc ARGS2(HTChunk *, ch, char, c)
 {
     if (ch->size >= ch->allocated) {
-        ch->allocated = ch->allocated + ch->growby;
+        /* Grow by half again once past the first few units, so that
+           building a large chunk a byte at a time stays linear. */
+        ch->allocated = ch->allocated +
+            (ch->allocated > 4 * ch->growby ? ch->allocated / 2 : ch->growby);
         ch->data = ch->data ? (char *)realloc(ch->data, ch->allocated)
             : (char *)malloc(ch->allocated);
         if (!ch->data)
@@ -88,7 +92,16 @@ PUBLIC void HTChunkTerminate ARGS1(HTChunk *, ch)
 */
 PUBLIC void HTChunkPuts ARGS2(HTChunk *, ch, WWW_CONST char *, s)
 {
-    WWW_CONST char *p;
-    for (p = s; *p; p++)
-        HTChunkPutc(ch, *p);
+    int len = strlen(s);
+
+    if (!len)
+        return;
+    if (ch->size + len > ch->allocated) {
+        int grow = ch->allocated > 4 * ch->growby ? ch->allocated / 2 : ch->growby;
+
+        HTChunkEnsure(ch, ch->size + len > ch->allocated + grow ?
+                      ch->size + len : ch->allocated + grow);
+    }
+    memcpy(ch->data + ch->size, s, len);
+    ch->size += len;
 }
@@ -7,6 +7,9 @@
    automatically reallocating them as necessary.
    
  */
+#ifndef HTCHUNK_H
+#define HTCHUNK_H
+
 typedef struct {
         int     size;           /* In bytes                     */
         int     growby;         /* Allocation unit in bytes     */
@@ -155,6 +158,8 @@ Append a zero character to a  chunk
 
 extern void HTChunkTerminate PARAMS((HTChunk * ch));
 
+#endif /* HTCHUNK_H */
+
 /*
 
    end  */
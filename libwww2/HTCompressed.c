@@ -20,13 +20,68 @@
 
 #include "../libnut/system.h"
 
+#ifdef HAVE_PNG                 /* zlib comes with libpng */
+#include <zlib.h>
+#endif
+
 #ifndef DISABLE_TRACE
 extern int www2Trace;
 #endif
 
+/* LZW state for compress(1) data, see lzw_decode below. */
+#define LZW_MAGIC1      0x1f
+#define LZW_MAGIC2      0x9d
+#define LZW_INIT_BITS   9
+#define LZW_MAX_BITS    16
+#define LZW_CLEAR       256
+#define LZW_FIRST       257
+
+typedef struct {
+    int maxbits;
+    int block_mode;
+    int n_bits;
+    long maxcode;
+    long maxmaxcode;
+    long free_ent;
+    long oldcode;
+    int finchar;
+    unsigned long bitbuf;       /* bits not yet made into codes */
+    int bitcnt;
+    long groupbits;             /* code bits since the last width change */
+    long skip;                  /* padding bits still to throw away */
+    unsigned short *prefix;
+    unsigned char *suffix;
+    unsigned char *stack;
+} LZWState;
+
+#define GZIP_MAGIC1     0x1f
+#define GZIP_MAGIC2     0x8b
+#define INFLATE_BUFSIZE 16384
+
+/* What the stream found at the start of the data. */
+#define DECODE_SNIFF    0       /* still waiting for the magic number */
+#define DECODE_GZIP     1
+#define DECODE_LZW      2
+#define DECODE_RAW      3       /* not compressed after all; pass through */
+#define DECODE_FAILED   4       /* corrupt; drop the rest */
+
 struct _HTStream {
     WWW_CONST HTStreamClass *isa;
-    /* ... */
+
+    HTStream *target;
+    int compressed;
+    int state;
+    unsigned char magic[3];
+    int nmagic;
+    long total;                 /* bytes handed to the target */
+#ifdef HAVE_PNG
+    z_stream z;
+    int z_ready;
+    int z_members;              /* gzip members finished so far */
+#endif
+    LZWState *lzw;
+    char out[INFLATE_BUFSIZE];
+    int nout;
 };
 
 int is_uncompressed = 0;
@@ -256,3 +311,378 @@ void HTCompressedHText(HText *text, int compressed, int plain)
 
     return;
 }
+
+/*      Streaming decompression
+**      -----------------------
+**
+**      HTStreamStack puts this filter in front of the real converter when
+**      a document is gzipped or compressed, so the data is decoded as it
+**      arrives instead of being written out and run through gunzip(1) or
+**      uncompress(1) once the transfer is over.  gzip data goes through
+**      zlib; compress(1) data through the LZW decoder below.  Data that
+**      turns out not to carry either magic number is passed on unchanged.
+*/
+
+PRIVATE void HTCompressed_flush ARGS1(HTStream *, me)
+{
+    if (me->nout > 0) {
+        (*me->target->isa->put_block) (me->target, me->out, me->nout);
+        me->total += me->nout;
+        me->nout = 0;
+    }
+}
+
+PRIVATE void HTCompressed_fail ARGS2(HTStream *, me, char *, why)
+{
+#ifndef DISABLE_TRACE
+    if (www2Trace)
+        fprintf(stderr, "[HTCompressed] %s after %ld bytes; dropping the rest\n", why, me->total);
+#endif
+    HTCompressed_flush(me);
+    me->state = DECODE_FAILED;
+    HTProgress("Uncompress failed.");
+}
+
+/*      compress(1) data
+**
+**      Codes are packed LSB first, starting at 9 bits and growing to
+**      maxbits.  Whenever the width changes (or the table is cleared)
+**      compress skips to the end of the current group of eight codes,
+**      so those padding bits are thrown away here as well.
+*/
+PRIVATE int lzw_init ARGS2(LZWState *, lzw, int, flags)
+{
+    lzw->maxbits = flags & 0x1f;
+    lzw->block_mode = flags & 0x80;
+    if (lzw->maxbits < LZW_INIT_BITS || lzw->maxbits > LZW_MAX_BITS)
+        return 0;
+    lzw->maxmaxcode = 1L << lzw->maxbits;
+    lzw->n_bits = LZW_INIT_BITS;
+    lzw->maxcode = (1L << lzw->n_bits) - 1;
+    lzw->free_ent = lzw->block_mode ? LZW_FIRST : 256;
+    lzw->oldcode = -1;
+    lzw->finchar = 0;
+    lzw->bitbuf = 0;
+    lzw->bitcnt = 0;
+    lzw->groupbits = 0;
+    lzw->skip = 0;
+    return 1;
+}
+
+/* Bits from here to the end of the current group of codes. */
+PRIVATE long lzw_padding ARGS1(LZWState *, lzw)
+{
+    long group = (long)lzw->n_bits << 3;
+
+    return (group - lzw->groupbits % group) % group;
+}
+
+PRIVATE int lzw_decode ARGS3(HTStream *, me, unsigned char *, buf, int, len)
+{
+    LZWState *lzw = me->lzw;
+    unsigned char *sp;
+    long code, incode;
+    int n;
+
+    while (len-- > 0) {
+        lzw->bitbuf |= (unsigned long)*buf++ << lzw->bitcnt;
+        lzw->bitcnt += 8;
+
+        for (;;) {
+            if (lzw->skip > 0) {
+                n = (lzw->skip < lzw->bitcnt) ? (int)lzw->skip : lzw->bitcnt;
+                lzw->bitbuf >>= n;
+                lzw->bitcnt -= n;
+                lzw->skip -= n;
+                if (lzw->skip > 0)
+                    break;
+            }
+            if (lzw->free_ent > lzw->maxcode) {
+                lzw->skip = lzw_padding(lzw);
+                lzw->groupbits = 0;
+                lzw->n_bits++;
+                if (lzw->n_bits == lzw->maxbits)
+                    lzw->maxcode = lzw->maxmaxcode;
+                else
+                    lzw->maxcode = (1L << lzw->n_bits) - 1;
+                continue;
+            }
+            if (lzw->bitcnt < lzw->n_bits)
+                break;
+
+            code = lzw->bitbuf & ((1L << lzw->n_bits) - 1);
+            lzw->bitbuf >>= lzw->n_bits;
+            lzw->bitcnt -= lzw->n_bits;
+            lzw->groupbits += lzw->n_bits;
+
+            if (lzw->oldcode == -1) {
+                if (code >= 256)
+                    return 0;
+                lzw->oldcode = code;
+                lzw->finchar = (int)code;
+                if (me->nout == INFLATE_BUFSIZE)
+                    HTCompressed_flush(me);
+                me->out[me->nout++] = (char)code;
+                continue;
+            }
+            if (code == LZW_CLEAR && lzw->block_mode) {
+                memset(lzw->prefix, 0, 256 * sizeof(unsigned short));
+                lzw->free_ent = LZW_FIRST - 1;
+                lzw->skip = lzw_padding(lzw);
+                lzw->groupbits = 0;
+                lzw->n_bits = LZW_INIT_BITS;
+                lzw->maxcode = (1L << lzw->n_bits) - 1;
+                continue;
+            }
+
+            incode = code;
+            sp = lzw->stack + (1L << LZW_MAX_BITS);
+            if (code >= lzw->free_ent) {
+                if (code > lzw->free_ent)
+                    return 0;
+                *--sp = (unsigned char)lzw->finchar;
+                code = lzw->oldcode;
+            }
+            while (code >= 256) {
+                if (sp == lzw->stack)
+                    return 0;
+                *--sp = lzw->suffix[code];
+                code = lzw->prefix[code];
+            }
+            *--sp = (unsigned char)(lzw->finchar = (int)code);
+
+            n = (int)(lzw->stack + (1L << LZW_MAX_BITS) - sp);
+            while (n > 0) {
+                int chunk = INFLATE_BUFSIZE - me->nout;
+
+                if (chunk > n)
+                    chunk = n;
+                memcpy(me->out + me->nout, sp, chunk);
+                me->nout += chunk;
+                sp += chunk;
+                n -= chunk;
+                if (me->nout == INFLATE_BUFSIZE)
+                    HTCompressed_flush(me);
+            }
+
+            if ((code = lzw->free_ent) < lzw->maxmaxcode) {
+                lzw->prefix[code] = (unsigned short)lzw->oldcode;
+                lzw->suffix[code] = (unsigned char)lzw->finchar;
+                lzw->free_ent = code + 1;
+            }
+            lzw->oldcode = incode;
+        }
+    }
+    return 1;
+}
+
+#ifdef HAVE_PNG
+PRIVATE int gzip_decode ARGS3(HTStream *, me, unsigned char *, buf, int, len)
+{
+    int status;
+
+    me->z.next_in = buf;
+    me->z.avail_in = len;
+    while (me->z.avail_in > 0) {
+        me->z.next_out = (unsigned char *)me->out + me->nout;
+        me->z.avail_out = INFLATE_BUFSIZE - me->nout;
+        status = inflate(&me->z, Z_NO_FLUSH);
+        me->nout = INFLATE_BUFSIZE - me->z.avail_out;
+        if (me->nout == INFLATE_BUFSIZE)
+            HTCompressed_flush(me);
+        if (status == Z_STREAM_END) {
+            /* gzip allows several members back to back. */
+            me->z_members++;
+            if (inflateReset(&me->z) != Z_OK)
+                return 0;
+        } else if (status != Z_OK && status != Z_BUF_ERROR) {
+            /* Some servers pad the last member; ignore what follows. */
+            if (me->z_members > 0) {
+                me->z.avail_in = 0;
+                break;
+            }
+            return 0;
+        }
+    }
+    HTCompressed_flush(me);
+    return 1;
+}
+#endif
+
+/* Look at the magic number and set up the decoder it calls for. */
+PRIVATE void HTCompressed_start ARGS1(HTStream *, me)
+{
+    if (me->magic[0] == GZIP_MAGIC1 && me->magic[1] == GZIP_MAGIC2) {
+#ifdef HAVE_PNG
+        memset(&me->z, 0, sizeof(me->z));
+        if (inflateInit2(&me->z, 15 + 16) == Z_OK) {
+            me->z_ready = 1;
+            me->state = DECODE_GZIP;
+        } else {
+            HTCompressed_fail(me, "inflateInit2 failed");
+        }
+#else
+        HTCompressed_fail(me, "gzip data but no zlib");
+#endif
+    } else if (me->magic[0] == LZW_MAGIC1 && me->magic[1] == LZW_MAGIC2) {
+        me->lzw = (LZWState *) calloc(1, sizeof(LZWState));
+        if (me->lzw) {
+            me->lzw->prefix = (unsigned short *)calloc(1L << LZW_MAX_BITS, sizeof(unsigned short));
+            me->lzw->suffix = (unsigned char *)calloc(1L << LZW_MAX_BITS, 1);
+            me->lzw->stack = (unsigned char *)malloc(1L << LZW_MAX_BITS);
+        }
+        if (!me->lzw || !me->lzw->prefix || !me->lzw->suffix || !me->lzw->stack) {
+            HTCompressed_fail(me, "out of memory");
+            return;
+        }
+        for (me->lzw->finchar = 0; me->lzw->finchar < 256; me->lzw->finchar++)
+            me->lzw->suffix[me->lzw->finchar] = (unsigned char)me->lzw->finchar;
+        if (!lzw_init(me->lzw, me->magic[2]))
+            HTCompressed_fail(me, "bad compress header");
+        else
+            me->state = DECODE_LZW;
+    } else {
+        me->state = DECODE_RAW;
+    }
+
+#ifndef DISABLE_TRACE
+    if (www2Trace)
+        fprintf(stderr, "[HTCompressed] compressed %d, decoding as %d\n", me->compressed, me->state);
+#endif
+}
+
+PRIVATE void HTCompressed_write ARGS3(HTStream *, me, WWW_CONST char *, s, int, l)
+{
+    unsigned char *buf = (unsigned char *)s;
+    int ok = 1;
+
+    /* The magic number may come in a byte at a time. */
+    while (me->state == DECODE_SNIFF && l > 0) {
+        me->magic[me->nmagic++] = *buf++;
+        l--;
+        if (me->nmagic == 2 && me->magic[0] == LZW_MAGIC1 && me->magic[1] == LZW_MAGIC2)
+            continue;           /* wait for the flags byte */
+        if (me->nmagic >= 2) {
+            HTCompressed_start(me);
+            if (me->state == DECODE_GZIP) {
+#ifdef HAVE_PNG
+                ok = gzip_decode(me, me->magic, me->nmagic);
+#endif
+            } else if (me->state == DECODE_RAW) {
+                (*me->target->isa->put_block) (me->target, (char *)me->magic, me->nmagic);
+                me->total += me->nmagic;
+            }
+        }
+    }
+    if (!ok) {
+        HTCompressed_fail(me, "bad gzip data");
+        return;
+    }
+    if (l <= 0)
+        return;
+
+    switch (me->state) {
+#ifdef HAVE_PNG
+    case DECODE_GZIP:
+        ok = gzip_decode(me, buf, l);
+        break;
+#endif
+    case DECODE_LZW:
+        ok = lzw_decode(me, buf, l);
+        HTCompressed_flush(me);
+        break;
+    case DECODE_RAW:
+        (*me->target->isa->put_block) (me->target, (char *)buf, l);
+        me->total += l;
+        break;
+    default:
+        break;
+    }
+    if (!ok)
+        HTCompressed_fail(me, me->state == DECODE_LZW ? "bad compress data" : "bad gzip data");
+}
+
+PRIVATE void HTCompressed_put_character ARGS2(HTStream *, me, char, c)
+{
+    HTCompressed_write(me, &c, 1);
+}
+
+PRIVATE void HTCompressed_put_string ARGS2(HTStream *, me, WWW_CONST char *, s)
+{
+    HTCompressed_write(me, s, strlen(s));
+}
+
+PRIVATE void HTCompressed_end_document ARGS1(HTStream *, me)
+{
+    /* A document too short to hold a magic number goes through as is. */
+    if (me->state == DECODE_SNIFF && me->nmagic > 0) {
+        (*me->target->isa->put_block) (me->target, (char *)me->magic, me->nmagic);
+        me->total += me->nmagic;
+    }
+    HTCompressed_flush(me);
+    if (me->state == DECODE_GZIP || me->state == DECODE_LZW) {
+        is_uncompressed = 1;
+        HTProgress("Data uncompressed.");
+    }
+    (*me->target->isa->end_document) (me->target);
+}
+
+PRIVATE void HTCompressed_free ARGS1(HTStream *, me)
+{
+    (*me->target->isa->free) (me->target);
+#ifdef HAVE_PNG
+    if (me->z_ready)
+        inflateEnd(&me->z);
+#endif
+    if (me->lzw) {
+        if (me->lzw->prefix)
+            free(me->lzw->prefix);
+        if (me->lzw->suffix)
+            free(me->lzw->suffix);
+        if (me->lzw->stack)
+            free(me->lzw->stack);
+        free(me->lzw);
+    }
+    free(me);
+}
+
+PRIVATE void HTCompressed_handle_interrupt ARGS1(HTStream *, me)
+{
+    (*me->target->isa->handle_interrupt) (me->target);
+}
+
+PRIVATE WWW_CONST HTStreamClass HTCompressedClass = {
+    "Uncompress",
+    HTCompressed_free,
+    HTCompressed_end_document,
+    HTCompressed_put_character, HTCompressed_put_string, HTCompressed_write,
+    HTCompressed_handle_interrupt
+};
+
+/* Can HTCompressedStream handle this kind of compression? */
+PUBLIC int HTCompressedCanStream ARGS1(int, compressed)
+{
+    if (compressed == COMPRESSED_BIGZ)
+        return 1;
+#ifdef HAVE_PNG
+    if (compressed == COMPRESSED_GNUZIP)
+        return 1;
+#endif
+    return 0;
+}
+
+PUBLIC HTStream *HTCompressedStream ARGS2(int, compressed, HTStream *, target)
+{
+    HTStream *me = (HTStream *) malloc(sizeof(*me));
+
+    if (!me)
+        return target;
+    memset(me, 0, sizeof(*me));
+    me->isa = &HTCompressedClass;
+    me->target = target;
+    me->compressed = compressed;
+    me->state = DECODE_SNIFF;
+
+    HTProgress("Uncompressing data.");
+    return me;
+}
@@ -4,4 +4,8 @@
 extern void HTCompressedFileToFile (char *fnam, int compressed);
 extern void HTCompressedHText (HText *text, int compressed, int plain);
 
+/* Decompress on the fly in front of target, see HTStreamStack. */
+extern int HTCompressedCanStream (int compressed);
+extern HTStream *HTCompressedStream (int compressed, HTStream *target);
+
 #endif /* not HTCOMPRESSED_H */
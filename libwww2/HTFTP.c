@@ -43,6 +43,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
+#include <fcntl.h>
 #include "HTFTP.h"              /* Implemented here */
 #include "../libnut/str-tools.h"
 #define LINE_LENGTH 1024
@@ -125,6 +126,7 @@ extern int ftpRedialSleep;
 extern int ftpFilenameLength;
 extern int ftpEllipsisLength;
 extern int ftpEllipsisMode;
+extern BOOL reloading;          /* HTTP.c */
 
 /*SWP -- 9.27.95 -- Directory parsing*/
 #define NEW_PARSE
@@ -136,19 +138,28 @@ int ParseFileSizeAndName(char *szBuffer, char *szFileName, char *szSize);
 HText *HT;
 int fTimerStarted = 0;
 XtIntervalId timer;
+
+/*
+** Control connections are pooled: up to FTP_POOL_SIZE stay logged in,
+** one per host and user, so that moving between servers does not cost
+** a fresh login each time.  A new connection displaces the one used
+** least recently, and close_it_up() closes those left idle for
+** ftp_timeout_val seconds.
+*/
+#define FTP_POOL_SIZE 4
+
 static struct ftpcache {
-    int control;
-    char p1[256];
+    int control;                /* -1 if the slot is free */
     char host[256];
     char username[BUFSIZ];
     char password[BUFSIZ];
-} ftpcache = {
-    -1,
-    "",
-    "",
-    "",
-    ""
-};
+    time_t last_used;
+    BOOL binary;                /* TYPE I already sent */
+    BOOL no_epsv;               /* Server has refused EPSV */
+} ftpcache[FTP_POOL_SIZE];
+
+PRIVATE BOOL ftpcache_ready = NO;
+PRIVATE struct ftpcache *current = NULL;    /* Entry for control */
 
 #ifdef SOCKS
 extern struct in_addr SOCKS_ftpsrv; /* in HTFTP.c */
@@ -160,11 +171,65 @@ extern struct in_addr SOCKS_ftpsrv; /* in HTFTP.c */
 */
 void HTFTPClearCache(void)
 {
-    ftpcache.password[0] = '\0';
-    ftpcache.control = -1;
-    ftpcache.p1[0] = 0;
-    ftpcache.host[0] = 0;
-    ftpcache.username[0] = 0;
+    int i;
+
+    for (i = 0; i < FTP_POOL_SIZE; i++) {
+        if (ftpcache_ready && ftpcache[i].control != -1)
+            NETCLOSE(ftpcache[i].control);
+        ftpcache[i].control = -1;
+        ftpcache[i].host[0] = '\0';
+        ftpcache[i].username[0] = '\0';
+        ftpcache[i].password[0] = '\0';
+        ftpcache[i].binary = NO;
+        ftpcache[i].no_epsv = NO;
+    }
+    ftpcache_ready = YES;
+    current = NULL;
+}
+
+/* find_cached ()
+   Expects: host and user name (an empty one meaning anonymous)
+   Returns: the pool entry logged in to that host as that user, or NULL
+*/
+PRIVATE struct ftpcache *find_cached ARGS2(char *, host, char *, username)
+{
+    int i;
+
+    if (!ftpcache_ready)
+        HTFTPClearCache();
+    if (!*username)
+        username = "anonymous";
+    for (i = 0; i < FTP_POOL_SIZE; i++)
+        if (ftpcache[i].control != -1 && !strcmp(ftpcache[i].host, host)
+            && !strcmp(ftpcache[i].username, username))
+            return &ftpcache[i];
+    return NULL;
+}
+
+/* claim_cached ()
+   Expects: Nothing
+   Returns: a pool entry for a new connection: a free one if there is
+            one, else the least recently used, which is closed first
+*/
+PRIVATE struct ftpcache *claim_cached NOARGS
+{
+    struct ftpcache *entry = NULL;
+    int i;
+
+    if (!ftpcache_ready)
+        HTFTPClearCache();
+    for (i = 0; i < FTP_POOL_SIZE; i++) {
+        if (ftpcache[i].control == -1)
+            return &ftpcache[i];
+        if (!entry || ftpcache[i].last_used < entry->last_used)
+            entry = &ftpcache[i];
+    }
+#ifndef DISABLE_TRACE
+    if (www2Trace)
+        fprintf(stderr, "FTP: Pool full, closing connection to %s\n", entry->host);
+#endif
+    CLOSE_CONTROL(entry->control);
+    return entry;
 }
 
 /*	Module-Wide Variables
@@ -173,6 +238,7 @@ void HTFTPClearCache(void)
 PRIVATE char response_text[LINE_LENGTH + 1];    /* Last response from NewsHost */
 PRIVATE int control = -1;       /* Current connection */
 PRIVATE int data_soc = -1;      /* Socket for data transfer =invalid */
+PRIVATE BOOL passive = NO;      /* data_soc connected by us (PASV) */
 
 PRIVATE int master_socket = -1; /* Listening socket = invalid   */
 PRIVATE char port_command[255]; /* Command for setting the port */
@@ -527,8 +593,7 @@ PRIVATE int get_connection ARGS1(char *, arg)
                     *password = '\0';
                 }
             } else {            /*same username */
-                if (!*(ftpcache.host)
-                    || (*(ftpcache.host) && strcmp(host, ftpcache.host))) { /*new host */
+                if (!current || strcmp(host, current->host)) {  /*new host */
                     *password = '\0';
                 }
             }
@@ -550,54 +615,49 @@ PRIVATE int get_connection ARGS1(char *, arg)
             fprintf(stderr, "FTP: set dummy to %s\n", dummy);
 #endif
 
-        /*Is the cache connection still good? */
-        if (ftpcache.control != (-1) && *(ftpcache.host)
-            && !strcmp(ftpcache.host, host) && *username) {
-            /*Did we use a username before? */
-            if (!*username) {
-                return (ftpcache.control);
-            }
-
-            /*Is the username and password used the same? */
-            if (*username && !strcmp(ftpcache.username, username) && *password && !strcmp(ftpcache.password, password)) {
-                /* For security Icon */
-                if (*username && strcmp(username, "anonymous")
-                    && strcmp(username, "ftp")) {
-                    /*not anon login...assuming a real login */
-                    securityType = HTAA_LOGIN;
-                } else {
-                    securityType = HTAA_NONE;
+        /*Is there a pooled connection to this host for this user? */
+        {
+            struct ftpcache *entry = find_cached(host, username);
+
+            if (entry) {
+                /*Same password, or none given, means the same login */
+                if (!*password || !strcmp(entry->password, password)) {
+                    strcpy(username, entry->username);
+                    strcpy(password, entry->password);
+                    control = entry->control;
+                    entry->last_used = time(NULL);
+                    current = entry;
+                    HTInitInput(control);
+#ifndef DISABLE_TRACE
+                    if (www2Trace)
+                        fprintf(stderr, "FTP: Reusing control socket %d for %s\n", control, host);
+#endif
+                    /* For security Icon */
+                    if (strcmp(username, "anonymous")
+                        && strcmp(username, "ftp")) {
+                        /*not anon login...assuming a real login */
+                        securityType = HTAA_LOGIN;
+                    } else {
+                        securityType = HTAA_NONE;
+                    }
+                    if (!p2) {
+                        free(p1);
+                    }
+                    return control;
                 }
-                return (ftpcache.control);
+                /*Something has changed...reopen connection */
+                CLOSE_CONTROL(entry->control);
             }
-            /*Something has changed...reopen connection */
-            else {
-                close(ftpcache.control);
-            }
-        }
-
-        /*Connection is not good. Reopen */
-        strcpy(ftpcache.p1, p1);
-        strcpy(ftpcache.host, host);
-        if (*username) {
-            strcpy(ftpcache.username, username);
-        } else {
-            ftpcache.username[0] = '\0';
-        }
-        if (*password) {
-            strcpy(ftpcache.password, password);
-        } else {
-            ftpcache.password[0] = '\0';
         }
 
-/*
-    if ((ftpcache.p1[0] != NULL) && (strcmp(ftpcache.p1,p1) == 0) && (ftpcache.control != -1)) {
-    	return ftpcache.control;
-    } else {
-	close(ftpcache.control);
-	strcpy(ftpcache.p1,p1);
-    }
-*/
+        /*Connection is not good. Open a new one */
+        current = claim_cached();
+        strcpy(current->host, host);
+        strcpy(current->username, username);
+        strcpy(current->password, password);
+        current->binary = NO;
+        current->no_epsv = NO;
+        current->last_used = time(NULL);
 
         if (!*username) {
             free(p1);
@@ -652,7 +712,7 @@ PRIVATE int get_connection ARGS1(char *, arg)
 #endif
     control = con;              /* Current control connection */
 
-    ftpcache.control = control;
+    current->control = control;
 
     /* Initialise buffering for contron connection */
     HTInitInput(con);
@@ -686,11 +746,11 @@ PRIVATE int get_connection ARGS1(char *, arg)
                     pw = prompt_for_password("Please Enter Your FTP Password:");
                     if (pw && *pw) {
                         strcpy(password, pw);
-                        strcpy(ftpcache.password, password);
+                        strcpy(current->password, password);
                         free(pw);
                     } else {
                         *password = '\0';
-                        *(ftpcache.password) = '\0';
+                        *(current->password) = '\0';
                         HTProgress("Connection aborted.");
                         CLOSE_CONTROL(control);
                         control = -1;
@@ -701,7 +761,7 @@ PRIVATE int get_connection ARGS1(char *, arg)
                 command = (char *)malloc(25);
                 sprintf(command, "USER anonymous%c%c", CR, LF);
                 strcpy(username, "anonymous");
-                strcpy(ftpcache.username, username);
+                strcpy(current->username, username);
             }
             status = response(command);
             free(command);
@@ -738,7 +798,7 @@ PRIVATE int get_connection ARGS1(char *, arg)
                 command = (char *)malloc(20 + strlen(host) + 2 + 1);
                 sprintf(command, "PASS %s@%s%c%c", user ? user : "WWWuser", host, CR, LF);  /*@@ */
                 sprintf(password, "%s@%s", (user ? user : "WWWuser"), host);
-                strcpy(ftpcache.password, password);
+                strcpy(current->password, password);
             }
             status = response(command);
             free(command);
@@ -826,7 +886,6 @@ PRIVATE int get_connection ARGS1(char *, arg)
 
                 if (redial < ftpRedial) {
                     /*close down current connection */
-                    ftpcache.control = -1;
                     CLOSE_CONTROL(control);
                     control = -1;
 
@@ -887,8 +946,6 @@ PRIVATE int get_connection ARGS1(char *, arg)
             loading_length = (-1);
 #endif
 
-            ftpcache.control = -1;
-
             CLOSE_CONTROL(control);
             control = -1;
             return -1;          /* Bad return */
@@ -914,7 +971,7 @@ PRIVATE int get_connection ARGS1(char *, arg)
 /*	Close Master (listening) socket
 **	-------------------------------
 **
-**
+**	A passive data connection takes its place, so that goes too.
 */
 #ifdef __STDC__
 PRIVATE void close_master_socket(void)
@@ -928,6 +985,11 @@ PRIVATE void close_master_socket()
 #endif
     NETCLOSE(master_socket);
     master_socket = -1;
+    if (passive && data_soc >= 0) {
+        NETCLOSE(data_soc);
+        data_soc = -1;
+    }
+    passive = NO;
 
     return;
 }
@@ -1055,6 +1117,136 @@ PRIVATE int get_listen_socket()
     return master_socket;       /* Good */
 }                               /* get_listen_socket */
 
+/*	Set up the data connection
+**	--------------------------
+**
+**	Passive mode is tried first, EPSV and then PASV, since an active
+**	PORT connection back to us does not get through a NAT.  We always
+**	connect to the address the control connection goes to: a PASV
+**	reply from behind a NAT often names a private address.  Servers
+**	that refuse both get PORT and a listening socket, as before.
+**
+** On exit,
+**	returns		0 if good, HT_INTERRUPTED if interrupted, -1 on a
+**			network error (worth a retry), HT_NOT_LOADED if
+**			the server would not have it.
+**	passive		YES if data_soc is connected, NO if master_socket
+**			is listening and the transfer must be accepted.
+*/
+#ifdef __STDC__
+PRIVATE int open_data_connection(void)
+#else
+PRIVATE int open_data_connection()
+#endif
+{
+    int status;
+
+    passive = NO;
+    data_soc = -1;
+
+#ifndef SOCKS                   /* SOCKS has its own idea of PORT */
+    {
+        struct sockaddr_in peer;
+        socklen_t peer_len = sizeof(peer);
+        char command[LINE_LENGTH + 1];
+        char *p;
+        int port = 0;
+        int h[6];
+
+        if (getpeername(control, (struct sockaddr *)&peer, &peer_len) < 0
+            || peer.sin_family != AF_INET)
+            goto active;
+
+        if (!current || !current->no_epsv) {
+            sprintf(command, "EPSV%c%c", CR, LF);
+            status = response(command);
+            if (status == HT_INTERRUPTED)
+                return HT_INTERRUPTED;
+            if (status < 0)
+                return -1;
+            /* 229 Entering Extended Passive Mode (|||port|) */
+            if (status != 2 || !(p = strchr(response_text, '('))
+                || sscanf(p + 1, "%*c%*c%*c%d", &port) != 1) {
+                port = 0;
+                if (current)
+                    current->no_epsv = YES;
+            }
+        }
+        if (port <= 0) {
+            sprintf(command, "PASV%c%c", CR, LF);
+            status = response(command);
+            if (status == HT_INTERRUPTED)
+                return HT_INTERRUPTED;
+            if (status < 0)
+                return -1;
+            /* 227 Entering Passive Mode (h1,h2,h3,h4,p1,p2) */
+            if (status == 2) {
+                for (p = response_text + 3; *p; p++) {
+                    if (isdigit(*p) && sscanf(p, "%d,%d,%d,%d,%d,%d",
+                                              &h[0], &h[1], &h[2], &h[3], &h[4], &h[5]) == 6) {
+                        port = (h[4] << 8) + h[5];
+                        break;
+                    }
+                }
+            }
+        }
+        if (port <= 0 || port > 65535)
+            goto active;
+
+        sprintf(command, "ftp://%s:%d/", HTInetString(&peer), port);
+        status = HTDoConnect(command, "FTP data", port, &data_soc);
+        if (status >= 0) {
+#ifndef DISABLE_TRACE
+            if (www2Trace)
+                fprintf(stderr, "FTP: Passive data socket %d to port %d\n", data_soc, port);
+#endif
+            passive = YES;
+            return 0;
+        }
+        data_soc = -1;          /* HTDoConnect has closed it */
+        if (status == HT_INTERRUPTED)
+            return HT_INTERRUPTED;
+    }
+  active:
+#endif
+
+    if (get_listen_socket() < 0) {
+        close_master_socket();
+        return HT_NOT_LOADED;
+    }
+    status = response(port_command);
+    if (status == HT_INTERRUPTED)
+        return HT_INTERRUPTED;
+    if (status < 0)
+        return -1;              /* Could have timed out */
+    if (status != 2)
+        return HT_NOT_LOADED;
+#ifndef DISABLE_TRACE
+    if (www2Trace)
+        fprintf(stderr, "FTP: Port defined.\n");
+#endif
+    return 0;
+}
+
+/*	Set up a fresh data connection after a failed transfer command
+**	---------------------------------------------------------------
+**
+**	A listening socket can take the next transfer, but the server is
+**	free to drop a passive one once a command has used or refused it.
+*/
+#ifdef __STDC__
+PRIVATE int reopen_data_connection(void)
+#else
+PRIVATE int reopen_data_connection()
+#endif
+{
+    if (!passive)
+        return 0;
+    NETCLOSE(data_soc);
+    data_soc = -1;
+    return open_data_connection();
+}
+
 /*	Read a directory into an hypertext object from the data socket
 **	--------------------------------------------------------------
 **
@@ -1083,6 +1275,9 @@ ARGS4(HTParentAnchor *, parent, WWW_CONST char *, address, HTFormat, format_out,
     char itemsize[BUFSIZ];
     char *full_ftp_name, *ptr;
     int count, ret, cmpr, c, rv;
+    HTChunk *listing = HTChunkCreate(4096);
+    int shown = 0, entries = 0;
+    char progress[64];
     extern char *HTgeticonname(HTFormat, char *);
     char *ellipsis_string = (char *)calloc(1024, sizeof(char));
 #ifdef NEW_PARSE
@@ -1100,21 +1295,21 @@ ARGS4(HTParentAnchor *, parent, WWW_CONST char *, address, HTFormat, format_out,
 
     HTProgress("Reading FTP directory");
 
-    HText_appendText(HT, "<H1>FTP Directory ");
-    HText_appendText(HT, filename);
-    HText_appendText(HT, "</H1>\n");
+    HTChunkPuts(listing, "<H1>FTP Directory ");
+    HTChunkPuts(listing, filename);
+    HTChunkPuts(listing, "</H1>\n");
 #ifdef NEW_PARSE
-    HText_appendText(HT, "<PRE>");
+    HTChunkPuts(listing, "<PRE>");
 #endif
-    HText_appendText(HT, "<DL>\n");
+    HTChunkPuts(listing, "<DL>\n");
     data_read_pointer = data_write_pointer = data_buffer;
 
     /* If this isnt the root level, spit out a parent directory entry */
 
     if (strcmp(filename, "/") != 0) {
-        HText_appendText(HT, "<DD>");
+        HTChunkPuts(listing, "<DD>");
 
-        HText_appendText(HT, "<A HREF=\"");
+        HTChunkPuts(listing, "<A HREF=\"");
 
         strcpy(buffer, filename);
         ptr = strrchr(buffer, '/');
@@ -1123,13 +1318,13 @@ ARGS4(HTParentAnchor *, parent, WWW_CONST char *, address, HTFormat, format_out,
             *ptr = '\0';
 
         if (buffer[0] == '\0')
-            HText_appendText(HT, "/");
+            HTChunkPuts(listing, "/");
         else
-            HText_appendText(HT, buffer);
+            HTChunkPuts(listing, buffer);
 
-        HText_appendText(HT, "\"><IMG SRC=\"");
-        HText_appendText(HT, HTgeticonname(NULL, "directory"));
-        HText_appendText(HT, "\"> Parent Directory</a>");
+        HTChunkPuts(listing, "\"><IMG SRC=\"");
+        HTChunkPuts(listing, HTgeticonname(NULL, "directory"));
+        HTChunkPuts(listing, "\"> Parent Directory</a>");
     }
 
     /* Loop until we hit EOF */
@@ -1142,6 +1337,7 @@ ARGS4(HTParentAnchor *, parent, WWW_CONST char *, address, HTFormat, format_out,
                 if (www2Trace)
                     fprintf(stderr, "FTP: Picked up interrupted_in_next_data_char\n");
 #endif
+                HTChunkFree(listing);
                 return HT_INTERRUPTED;
             }
 
@@ -1152,6 +1348,7 @@ ARGS4(HTParentAnchor *, parent, WWW_CONST char *, address, HTFormat, format_out,
                     if (www2Trace)
                         fprintf(stderr, "FTP: Picked up interrupted_in_next_data_char\n");
 #endif
+                    HTChunkFree(listing);
                     return HT_INTERRUPTED;
                 }
 
@@ -1249,18 +1446,26 @@ ARGS4(HTParentAnchor *, parent, WWW_CONST char *, address, HTFormat, format_out,
 #endif
         }
 
-        HText_appendText(HT, "<DD>");
+        /* Pass on what we have so far now and then */
+        if (++entries % HT_DIR_BATCH == 0) {
+            HText_appendBlock(HT, listing->data + shown, listing->size - shown);
+            shown = listing->size;
+            sprintf(progress, "Read %d directory entries", entries);
+            HTProgress(progress);
+        }
+
+        HTChunkPuts(listing, "<DD>");
         /* Spit out the anchor refrence, and continue on... */
 
-        HText_appendText(HT, "<A HREF=\"");
+        HTChunkPuts(listing, "<A HREF=\"");
         /* Assuming it's a relative reference... */
         if (itemname && itemname[0] != '/') {
-            HText_appendText(HT, filename);
+            HTChunkPuts(listing, filename);
             if (filename[strlen(filename) - 1] != '/')
-                HText_appendText(HT, "/");
+                HTChunkPuts(listing, "/");
         }
-        HText_appendText(HT, itemname);
-        HText_appendText(HT, "\">");
+        HTChunkPuts(listing, itemname);
+        HTChunkPuts(listing, "\">");
 
         /* There are 3 "types", directory, link and file.  If its a directory we     */
         /* just spit out the name with a directory icon.  If its a link, we go       */
@@ -1275,9 +1480,9 @@ ARGS4(HTParentAnchor *, parent, WWW_CONST char *, address, HTFormat, format_out,
                     strcpy(itemname, ellipsis_string);
                 }
                 sprintf(buffer, "%s", itemname);
-                HText_appendText(HT, "<IMG SRC=\"");
-                HText_appendText(HT, HTgeticonname(NULL, "directory"));
-                HText_appendText(HT, "\"> ");
+                HTChunkPuts(listing, "<IMG SRC=\"");
+                HTChunkPuts(listing, HTgeticonname(NULL, "directory"));
+                HTChunkPuts(listing, "\"> ");
                 break;
             }
 
@@ -1334,7 +1539,7 @@ ARGS4(HTParentAnchor *, parent, WWW_CONST char *, address, HTFormat, format_out,
                 format = HTFileFormat(itemname, &pencoding, WWW_SOURCE, &cmpr);
 
                 if (1) {
-                    HText_appendText(HT, "<IMG SRC=\"");
+                    HTChunkPuts(listing, "<IMG SRC=\"");
 
                     /* If this is a link, and we can't figure out what
                        kind of file it is by extension, throw up the unknown
@@ -1346,16 +1551,16 @@ ARGS4(HTParentAnchor *, parent, WWW_CONST char *, address, HTFormat, format_out,
                         /* If it's unknown, let's call it a menu (since symlinks
                            are most commonly used on FTP servers to point to
                            directories, IMHO... -marc */
-                        HText_appendText(HT, HTgeticonname(format, "directory"));
+                        HTChunkPuts(listing, HTgeticonname(format, "directory"));
                     } else {
-                        HText_appendText(HT, HTgeticonname(format, "text"));
+                        HTChunkPuts(listing, HTgeticonname(format, "text"));
                     }
 
-                    HText_appendText(HT, "\"> ");
+                    HTChunkPuts(listing, "\"> ");
                 } else {
-                    HText_appendText(HT, "<IMG SRC=\"");
-                    HText_appendText(HT, HTgeticonname(format, "application"));
-                    HText_appendText(HT, "\"> ");
+                    HTChunkPuts(listing, "<IMG SRC=\"");
+                    HTChunkPuts(listing, HTgeticonname(format, "application"));
+                    HTChunkPuts(listing, "\"> ");
                 }
 
                 break;
@@ -1363,20 +1568,20 @@ ARGS4(HTParentAnchor *, parent, WWW_CONST char *, address, HTFormat, format_out,
 
         default:
             {
-                HText_appendText(HT, "<IMG SRC=\"");
-                HText_appendText(HT, HTgeticonname(NULL, "unknown"));
-                HText_appendText(HT, "\"> ");
+                HTChunkPuts(listing, "<IMG SRC=\"");
+                HTChunkPuts(listing, HTgeticonname(NULL, "unknown"));
+                HTChunkPuts(listing, "\"> ");
                 break;
             }
         }
 
-        HText_appendText(HT, buffer);
+        HTChunkPuts(listing, buffer);
 #ifndef NEW_PARSE
-        HText_appendText(HT, "</A>\n");
+        HTChunkPuts(listing, "</A>\n");
 #endif
 
 #ifdef NEW_PARSE
-        HText_appendText(HT, "</A>");
+        HTChunkPuts(listing, "</A>");
 
         nStringLen = strlen(buffer);
         nSpaces = ftpFilenameLength - nStringLen;
@@ -1418,21 +1623,29 @@ ARGS4(HTParentAnchor *, parent, WWW_CONST char *, address, HTFormat, format_out,
 */
 
         if (usingNLST != 2) {
-            HText_appendText(HT, szDate);
+            HTChunkPuts(listing, szDate);
         }
-        HText_appendText(HT, "\n");
+        HTChunkPuts(listing, "\n");
 #endif
 
         free(full_ftp_name);
     }
 
-    HText_appendText(HT, "</DL>\n");
+    HTChunkPuts(listing, "</DL>\n");
 #ifdef NEW_PARSE
-    HText_appendText(HT, "</PRE>\n");
+    HTChunkPuts(listing, "</PRE>\n");
 #endif
+    HText_appendBlock(HT, listing->data + shown, listing->size - shown);
     HText_endAppend(HT);
 
     rv = response(NIL);
+    if (rv == 2) {
+        char *host = HTParse(address, "", PARSE_HOST);
+
+        HTDirListingStore(host, *filename ? filename : "/", 0L, 0L, listing);
+        free(host);
+    } else
+        HTChunkFree(listing);
     if (rv == HT_INTERRUPTED)
         return rv;
     return rv == 2 ? HT_LOADED : -1;
@@ -1464,6 +1677,25 @@ PUBLIC int HTFTPLoad ARGS4(char *, name, HTParentAnchor *, anchor, HTFormat, for
     HT = HText_new();
     HText_beginAppend(HT);
 
+    /* A directory listed lately needs no connection at all */
+    if (!reloading) {
+        char *host = HTParse(name, "", PARSE_HOST);
+        char *path = HTParse(name, "", PARSE_PATH + PARSE_PUNCTUATION);
+        HTChunk *listing = HTDirListingFind(host, *path ? path : "/", 0L, NULL);
+
+        free(host);
+        free(path);
+        if (listing) {
+#ifndef DISABLE_TRACE
+            if (www2Trace)
+                fprintf(stderr, "FTP: Directory listing for %s from cache\n", name);
+#endif
+            HText_appendBlock(HT, listing->data, listing->size);
+            HText_endAppend(HT);
+            return HT_LOADED;
+        }
+    }
+
     for (retry = 0; retry < 2; retry++) {
 #ifndef DISABLE_TRACE
         if (www2Trace)
@@ -1480,58 +1712,31 @@ PUBLIC int HTFTPLoad ARGS4(char *, name, HTParentAnchor *, anchor, HTFormat, for
             return status;
         }
 
-        status = get_listen_socket();
+        status = open_data_connection();
+        if (status == HT_INTERRUPTED) {
+#ifndef DISABLE_TRACE
+            if (www2Trace)
+                fprintf(stderr, "FTP: Interrupted setting up data connection\n");
+#endif
+#ifdef SWP_HACK
+            loading_length = (-1);
+#endif
+            HTProgress("Connection interrupted.");
+            CLOSE_CONTROL(control);
+            control = -1;
+            close_master_socket();
+            return HT_INTERRUPTED;
+        }
         if (status < 0) {
-            HText_appendText(HT, "FTP terminated because login failed");
-            HTProgress("Login failed");
             CLOSE_CONTROL(control);
             control = -1;
             close_master_socket();
+            if (status == -1)
+                continue;       /* try again - net error */
 #ifdef SWP_HACK
             loading_length = (-1);
 #endif
-            /* HT_INTERRUPTED would fall through, if we could interrupt
-               somehow in the middle of it, which we currently can't. */
-            return status;
-        }
-
-        /* Inform the server of the port number we will listen on */
-        {
-            status = response(port_command);
-            if (status == HT_INTERRUPTED) {
-#ifndef DISABLE_TRACE
-                if (www2Trace)
-                    fprintf(stderr, "FTP: Interrupted in response (port_command)\n");
-#endif
-#ifdef SWP_HACK
-                loading_length = (-1);
-#endif
-                HTProgress("Connection interrupted.");
-                CLOSE_CONTROL(control);
-                control = -1;
-                close_master_socket();
-                return HT_INTERRUPTED;
-            }
-            if (status != 2) {  /* Could have timed out */
-                if (status < 0) {
-                    CLOSE_CONTROL(control);
-                    control = -1;
-                    close_master_socket();
-                    continue;   /* try again - net error */
-                }
-
-                CLOSE_CONTROL(control);
-                control = -1;
-                close_master_socket();
-#ifdef SWP_HACK
-                loading_length = (-1);
-#endif
-                return HT_NOT_LOADED;   /* bad reply */
-            }
-#ifndef DISABLE_TRACE
-            if (www2Trace)
-                fprintf(stderr, "FTP: Port defined.\n");
-#endif
+            return HT_NOT_LOADED;   /* bad reply */
         }
         status = 0;
         break;                  /* No more retries */
@@ -1558,24 +1763,77 @@ PUBLIC int HTFTPLoad ARGS4(char *, name, HTParentAnchor *, anchor, HTFormat, for
             StrAllocCopy(filename, "/");
         format = HTFileFormat(filename, &encoding, WWW_PLAINTEXT, &compressed);
 
-        sprintf(command, "TYPE %s%c%c", "I", CR, LF);
-        status = response(command);
-        if (status != 2) {
-            if (status == HT_INTERRUPTED)
-                HTProgress("Connection interrupted.");
-            close_master_socket();
-            CLOSE_CONTROL(control);
-            control = -1;
-            free(filename);
+        if (!current || !current->binary) {
+            sprintf(command, "TYPE %s%c%c", "I", CR, LF);
+            status = response(command);
+            if (status != 2) {
+                if (status == HT_INTERRUPTED)
+                    HTProgress("Connection interrupted.");
+                close_master_socket();
+                CLOSE_CONTROL(control);
+                control = -1;
+                free(filename);
 #ifdef SWP_HACK
-            loading_length = (-1);
+                loading_length = (-1);
 #endif
-            return (status == HT_INTERRUPTED) ? HT_INTERRUPTED : -1;
+                return (status == HT_INTERRUPTED) ? HT_INTERRUPTED : -1;
+            }
+            if (current)
+                current->binary = YES;
         }
 
         fname = strdup(filename);
         try = (-1);
 
+        /* A path ending in a slash names a directory, so rather than
+           wait for RETR to fail, send the CWD and the NLST together.
+           Only in passive mode: if the CWD fails the NLST may go ahead
+           in the wrong directory, and its listing has to be thrown away. */
+        if (passive && usingNLST != 2 && filename[strlen(filename) - 1] == '/') {
+            sprintf(command, "CWD %s%c%cNLST %s %c%c", fname, CR, LF, NLST_PARAMS, CR, LF);
+            status = response(command);
+            if (status >= 0) {
+                int cwd = status;
+
+                status = response(NIL);     /* NLST */
+                if (status == 1 && cwd != 2) {
+                    while (NETREAD(data_soc, data_buffer, DATA_BUFFER_SIZE) > 0)
+                        ;       /* Not the directory we asked for */
+                    status = response(NIL);
+                }
+                if (status >= 0 && cwd == 2) {
+                    isDirectory = YES;
+                    usingNLST = 1;
+                    if (status == 1)
+                        goto skipDir;
+                }
+                if (status >= 0)
+                    status = reopen_data_connection();
+                if (status >= 0 && cwd == 2) {
+                    status = 5;
+                    goto plainNLST;
+                }
+            }
+            if (status == HT_INTERRUPTED) {
+#ifndef DISABLE_TRACE
+                if (www2Trace)
+                    fprintf(stderr, "FTP: Interrupted while sending CWD and NLST\n");
+#endif
+                HTProgress("Connection interrupted.");
+            }
+            if (status < 0) {
+                CLOSE_CONTROL(control);
+                control = -1;
+                close_master_socket();
+                free(filename);
+                free(fname);
+#ifdef SWP_HACK
+                loading_length = (-1);
+#endif
+                return (status == HT_INTERRUPTED) ? HT_INTERRUPTED : HT_NOT_LOADED;
+            }
+        }
+
       tryAgain:
         try++;
         sprintf(command, "RETR %s%c%c", fname, CR, LF);
@@ -1597,6 +1855,8 @@ PUBLIC int HTFTPLoad ARGS4(char *, name, HTParentAnchor *, anchor, HTFormat, for
         }
 
         if (status != 1) {      /* Failed : try to CWD to it */
+            if ((status = reopen_data_connection()) < 0)
+                goto skipDir;
             sprintf(command, "CWD %s%c%c", fname, CR, LF);
             status = response(command);
             if (status == HT_INTERRUPTED) {
@@ -1687,7 +1947,10 @@ PUBLIC int HTFTPLoad ARGS4(char *, name, HTParentAnchor *, anchor, HTFormat, for
                     return HT_INTERRUPTED;
                 }
 
+              plainNLST:
                 if (status == 5) {  /*unrecognized command or failed */
+                    if ((status = reopen_data_connection()) < 0)
+                        goto skipDir;
                     isDirectory = YES;
                     usingNLST = 2;
                     sprintf(command, "NLST%c%c", CR, LF);
@@ -1710,6 +1973,8 @@ PUBLIC int HTFTPLoad ARGS4(char *, name, HTParentAnchor *, anchor, HTFormat, for
                 }
 
                 if (status == 5) {  /*unrecognized command or failed */
+                    if ((status = reopen_data_connection()) < 0)
+                        goto skipDir;
                     isDirectory = YES;
                     usingNLST = 0;
                     sprintf(command, "LIST%c%c", CR, LF);
@@ -1744,12 +2009,14 @@ PUBLIC int HTFTPLoad ARGS4(char *, name, HTParentAnchor *, anchor, HTFormat, for
 #ifdef SWP_HACK
             loading_length = (-1);
 #endif
+            if (status == HT_INTERRUPTED)
+                return HT_INTERRUPTED;
             return HT_NOT_LOADED;   /* Action not started */
         }
     }
 
-    /* Wait for the connection */
-    {
+    /* Wait for the connection, unless we made it ourselves */
+    if (!passive) {
         struct sockaddr_in soc_address;
 
         int soc_addrlen = sizeof(soc_address);
@@ -1787,14 +2054,24 @@ PUBLIC int HTFTPLoad ARGS4(char *, name, HTParentAnchor *, anchor, HTFormat, for
         loading_length = (-1);
 #endif
 
-        close_master_socket();
         NETCLOSE(data_soc);
         data_soc = -1;
+        close_master_socket();
 
 #ifndef DISABLE_TRACE
         if (www2Trace)
             fprintf(stderr, "FTP: Returning %d after doing read_directory\n", s);
 #endif
+        /* read_directory has picked up the final reply, so the control
+           connection can stay in the pool for the next click. */
+        if (s == HT_LOADED && control != -1) {
+            current->last_used = time(NULL);
+            timer = XtAppAddTimeOut(app_context, ftp_timeout_val * 1000, close_it_up, NULL);
+            fTimerStarted = 1;
+        } else {
+            CLOSE_CONTROL(control);
+            control = -1;
+        }
         /* HT_INTERRUPTED should fall right through. */
         return s;
     } else {
@@ -1817,6 +2094,11 @@ PUBLIC int HTFTPLoad ARGS4(char *, name, HTParentAnchor *, anchor, HTFormat, for
 #ifdef SWP_HACK
             loading_length = (-1);
 #endif
+            NETCLOSE(data_soc);
+            data_soc = -1;
+            close_master_socket();
+            CLOSE_CONTROL(control);
+            control = -1;
             return HT_NOT_LOADED;
         }
 
@@ -1888,6 +2170,10 @@ PUBLIC int HTFTPLoad ARGS4(char *, name, HTParentAnchor *, anchor, HTFormat, for
                 close_master_socket();
                 return HT_NOT_LOADED;
             }
+        } else {
+            /* The reply is still to come: no good for the pool. */
+            CLOSE_CONTROL(control);
+            control = -1;
         }
 
         close_master_socket();
@@ -1901,6 +2187,8 @@ PUBLIC int HTFTPLoad ARGS4(char *, name, HTParentAnchor *, anchor, HTFormat, for
             (*targetClass.free) (stream);
         }
 
+        if (current)
+            current->last_used = time(NULL);
         timer = XtAppAddTimeOut(app_context, ftp_timeout_val * 1000, close_it_up, NULL);
         fTimerStarted = 1;
 
@@ -2115,16 +2403,12 @@ PUBLIC int HTFTPRemove ARGS1(char *, name)
 **             would send /tmp/bubba.tgz to warez.mama.com:/pub
 ** Returns     0 if successful, nonzero on error
 */
-#define OUTBUFSIZE 4096         /* Size of the chunk of the file read */
 PUBLIC int HTFTPSend ARGS1(char *, name)
 {
-    int status;
-    FILE *f;
+    int status, fd;
     char *fname, *filename, *path;
-    char command[LINE_LENGTH + 1], outBuf[OUTBUFSIZE + 1];
-    long bLeft, bDone, bTotal, chunk;
-    extern int twirl_increment;
-    int next_twirl = twirl_increment, intr = 0;
+    char command[LINE_LENGTH + 1], size[HT_OFF_STRLEN];
+    off_t bDone, bTotal;
     struct sockaddr_in soc_address;
     int soc_addrlen = sizeof(soc_address);
     struct stat sbuf;
@@ -2171,7 +2455,7 @@ PUBLIC int HTFTPSend ARGS1(char *, name)
     bTotal = sbuf.st_size;
 #ifndef DISABLE_TRACE
     if (www2Trace)
-        fprintf(stderr, "HTFTPSend: Attempting to send %s (%s) (%lu)\n", fname, filename, bTotal);
+        fprintf(stderr, "HTFTPSend: Attempting to send %s (%s) (%s)\n", fname, filename, HTOffString(bTotal, size));
 #endif
 
     status = get_connection(name);
@@ -2182,34 +2466,7 @@ PUBLIC int HTFTPSend ARGS1(char *, name)
         return status;
     }
 
-    status = get_listen_socket();
-    if (status < 0) {
-        CLOSE_CONTROL(control);
-        control = -1;
-        close_master_socket();
-        return status;
-    }
-
-    status = response(port_command);
-    if (status == HT_INTERRUPTED) {
-        HTProgress("Connection interrupted.");
-        CLOSE_CONTROL(control);
-        control = -1;
-        close_master_socket();
-        return -2;
-    }
-
-    if (status != 2) {          /* If the port command was not successful */
-        CLOSE_CONTROL(control);
-        control = -1;
-        close_master_socket();
-        if (status < 0) {       /*If we were going to try again, we would do it here.... */
-            return -3;
-        }
-        return -3;
-    }
-
-    /* Logged in, set up the port, now let's send the sucka */
+    /* Logged in, now let's send the sucka */
 
     /* Set the type to image */
     sprintf(command, "TYPE %s%c%c", "I", CR, LF);
@@ -2240,6 +2497,23 @@ PUBLIC int HTFTPSend ARGS1(char *, name)
         return (status == HT_INTERRUPTED) ? -2 : -1;
     }
 
+    /* Set up the data connection */
+    status = open_data_connection();
+    if (status == HT_INTERRUPTED) {
+        HTProgress("Connection interrupted.");
+        CLOSE_CONTROL(control);
+        control = -1;
+        close_master_socket();
+        return -2;
+    }
+
+    if (status < 0) {           /* Neither passive mode nor PORT worked */
+        CLOSE_CONTROL(control);
+        control = -1;
+        close_master_socket();
+        return -3;
+    }
+
     /* Send it */
     sprintf(command, "STOR %s%c%c", filename, CR, LF);
     status = response(command);
@@ -2261,70 +2535,41 @@ PUBLIC int HTFTPSend ARGS1(char *, name)
 
     /* Ready to send the data now, server is primed and ready... here we go, go go */
 
+    if (!passive) {
 #ifdef SOCKS
-    status = Raccept(master_socket, (struct sockaddr *)&soc_address, &soc_addrlen);
+        status = Raccept(master_socket, (struct sockaddr *)&soc_address, &soc_addrlen);
 #else
-    status = accept(master_socket, (struct sockaddr *)&soc_address, &soc_addrlen);
+        status = accept(master_socket, (struct sockaddr *)&soc_address, &soc_addrlen);
 #endif
 
-    if (status < 0) {
-        CLOSE_CONTROL(control);
-        control = -1;
-        close_master_socket();
-        return -2;
-    }
+        if (status < 0) {
+            CLOSE_CONTROL(control);
+            control = -1;
+            close_master_socket();
+            return -2;
+        }
 
-    data_soc = status;
+        data_soc = status;
+    }
     /* Server has contacted us... send them data */
     /* Send the data! */
 
-    if ((f = fopen(fname, "r")) == NULL) {
+    if ((fd = open(fname, O_RDONLY)) < 0) {
         CLOSE_CONTROL(control);
         control = -1;
         close_master_socket();
         return -1;
     }
 
-    HTMeter(0, NULL);
-    bDone = 0;
-    bLeft = bTotal;
     mo_busy();
-    for (;;) {
-
-        if (bDone > next_twirl) {
-            intr = HTCheckActiveIcon(1);
-            next_twirl += twirl_increment;
-        } else {
-            intr = HTCheckActiveIcon(0);
-        }
-        if (intr) {
-            HTProgress("Data transfer interrupted");
-            HTMeter(100, NULL);
-            break;
-        }
-
-        if (bLeft < OUTBUFSIZE) {   /* Handle last block */
-            if ((chunk = fread(outBuf, 1, bLeft, f)) == 0)
-                break;
-            NETWRITE(data_soc, outBuf, chunk);
-            bLeft -= chunk;
-            bDone += chunk;
-        } else if (bLeft <= 0) {    /* Exit */
-            break;
-        } else {                /* Handle a block of the data */
-            if ((chunk = fread(outBuf, 1, OUTBUFSIZE, f)) == 0)
-                break;
-            NETWRITE(data_soc, outBuf, chunk);
-            bLeft -= chunk;
-            bDone += chunk;
-        }
-        HTMeter((bDone * 100) / bTotal, NULL);
+    status = HTDoSendFile(data_soc, fd, bTotal, &bDone);
+    if (status == HT_INTERRUPTED) {
+        HTProgress("Data transfer interrupted");
+        HTMeter(100, NULL);
     }
-
     mo_not_busy();
     /* Done, now clean up */
-    fclose(f);
-    HTMeter(100, NULL);
+    close(fd);
 
     CLOSE_CONTROL(control);
     control = -1;
@@ -2337,12 +2582,12 @@ PUBLIC int HTFTPSend ARGS1(char *, name)
     NETCLOSE(data_soc);
     data_soc = -1;
 
-    if (bLeft != 0) {
+    if (bDone != bTotal) {
 #ifndef DISABLE_TRACE
         if (www2Trace)
-            fprintf(stderr, "HTFTPSend: Error sending file %lu bytes left\n", bLeft);
+            fprintf(stderr, "HTFTPSend: Error sending file %s bytes left\n", HTOffString(bTotal - bDone, size));
 #endif
-        return intr ? -2 : -1;
+        return (status == HT_INTERRUPTED) ? -2 : -1;
     }
 
     timer = XtAppAddTimeOut(app_context, ftp_timeout_val * 1000, close_it_up, NULL);
@@ -2355,17 +2600,246 @@ PUBLIC int HTFTPSend ARGS1(char *, name)
     return 0;
 }                               /* End of HTFTPSend */
 
+/*	Segmented downloads
+**	-------------------
+**
+**	HTSegment.c fetches a big file over several connections at once.
+**	They log in and set up their transfers here, as HTFTPLoad does,
+**	so they share the pool, the password dialog and the EPSV and PASV
+**	handling.  A segment keeps its control connection to itself while
+**	the transfer runs, so that is taken out of the pool; the next
+**	segment logs in afresh with the same name and password.
+*/
+
+/* Log in and switch to binary.  Returns 0, HT_INTERRUPTED or -1. */
+PRIVATE int segment_login ARGS1(char *, name)
+{
+    char command[LINE_LENGTH + 1];
+    int status;
+
+    /* Somewhere for login messages to go */
+    HT = HText_new();
+    HText_beginAppend(HT);
+
+    status = get_connection(name);
+    if (status < 0) {
+        CLOSE_CONTROL(control);
+        control = -1;
+        return (status == HT_INTERRUPTED) ? HT_INTERRUPTED : -1;
+    }
+    if (!current || !current->binary) {
+        sprintf(command, "TYPE I%c%c", CR, LF);
+        status = response(command);
+        if (status != 2) {
+            CLOSE_CONTROL(control);
+            control = -1;
+            return (status == HT_INTERRUPTED) ? HT_INTERRUPTED : -1;
+        }
+        if (current)
+            current->binary = YES;
+    }
+    return 0;
+}
+
+/*	Ask for the modification time of a file
+**	----------------------------------------
+**
+** On exit,
+**	returns		the time as MDTM gives it, e.g. 19950412183000,
+**			malloc'd; NULL if the server does not say, or
+**			if interrupted.
+*/
+PRIVATE char *segment_mdtm ARGS2(char *, path, int *, status)
+{
+    char *command, *p, *q, *stamp = NULL;
+
+    command = (char *)malloc(strlen(path) + 8);
+    sprintf(command, "MDTM %s%c%c", path, CR, LF);
+    *status = response(command);
+    free(command);
+
+    /* 213 19950412183000 */
+    if (*status == 2 && !strncmp(response_text, "213", 3)) {
+        for (p = response_text + 3; *p == ' '; p++) ;
+        for (q = p; isdigit((unsigned char)*q) || *q == '.'; q++) ;
+        if (q > p) {
+            stamp = (char *)malloc(q - p + 1);
+            strncpy(stamp, p, q - p);
+            stamp[q - p] = '\0';
+        }
+    }
+    return stamp;
+}
+
+/*	Find the size of a file, and whether a transfer can start part way
+**	-------------------------------------------------------------------
+**
+** On exit,
+**	returns		0 if SIZE gave the size and REST is understood,
+**			HT_INTERRUPTED, or -1.
+**	*total		the size, or -1
+**	*stamp		what MDTM says, or NULL
+*/
+PUBLIC int HTFTPSize ARGS3(char *, name, off_t *, total, char **, stamp)
+{
+    char rest[16];
+    char *path, *command, *p;
+    int status;
+
+    *total = -1;
+    *stamp = NULL;
+    if ((status = segment_login(name)) < 0)
+        return status;
+
+    path = HTParse(name, "", PARSE_PATH + PARSE_PUNCTUATION);
+    command = (char *)malloc(strlen(path) + 8);
+    sprintf(command, "SIZE %s%c%c", path, CR, LF);
+    status = response(command);
+    free(command);
+
+    /* 213 1234 */
+    if (status == 2 && !strncmp(response_text, "213", 3)) {
+        p = response_text + 3;
+        *total = HTOffValue(&p);
+        *stamp = segment_mdtm(path, &status);
+        if (status != HT_INTERRUPTED) {
+            sprintf(rest, "REST 0%c%c", CR, LF);
+            status = response(rest);
+        }
+    }
+    free(path);
+    if (status == 3 && *total > 0)
+        return 0;
+    if (*stamp) {
+        free(*stamp);
+        *stamp = NULL;
+    }
+    return (status == HT_INTERRUPTED) ? HT_INTERRUPTED : -1;
+}
+
+/*	Start a transfer part way through a file
+**	----------------------------------------
+**
+**	Only over a passive data connection: there is no waiting on a
+**	listening socket for every segment.
+**
+** On entry,
+**	stamp		the MDTM time the file had when the transfer
+**			started, or NULL not to check
+** On exit,
+**	returns		the data socket, HT_INTERRUPTED, -1, or -2 if
+**			the file is not the one the stamp was for.
+**	*con		the control connection, which the caller closes
+**			when done with the data socket; -1 on failure.
+*/
+PUBLIC int HTFTPSegment ARGS4(char *, name, off_t, from, int *, con, char *, stamp)
+{
+    char offset[HT_OFF_STRLEN];
+    char *path, *command, *now;
+    int status, retry, soc;
+
+    *con = -1;
+    for (retry = 0; retry < 2; retry++) {
+        if ((status = segment_login(name)) < 0)
+            return status;
+        status = open_data_connection();
+        if (status == 0 && passive)
+            break;
+        CLOSE_CONTROL(control);
+        control = -1;
+        close_master_socket();
+        if (status == HT_INTERRUPTED)
+            return HT_INTERRUPTED;
+        if (status != -1)
+            return -1;          /* No passive mode, or a bad reply */
+    }
+    if (status < 0)
+        return -1;
+
+    path = HTParse(name, "", PARSE_PATH + PARSE_PUNCTUATION);
+    if (stamp) {
+        now = segment_mdtm(path, &status);
+        if (!now || strcmp(now, stamp)) {
+            free(path);
+            NETCLOSE(data_soc);
+            data_soc = -1;
+            CLOSE_CONTROL(control);
+            control = -1;
+            if (status == HT_INTERRUPTED)
+                return HT_INTERRUPTED;
+            if (!now)
+                return -1;
+            free(now);
+            return -2;
+        }
+        free(now);
+    }
+    command = (char *)malloc(strlen(path) + HT_OFF_STRLEN + 8);
+    sprintf(command, "REST %s%c%c", HTOffString(from, offset), CR, LF);
+    status = response(command);
+    if (status == 3) {
+        sprintf(command, "RETR %s%c%c", path, CR, LF);
+        status = response(command);
+    }
+    free(command);
+    free(path);
+
+    if (status != 1) {
+        NETCLOSE(data_soc);
+        data_soc = -1;
+        CLOSE_CONTROL(control);
+        control = -1;
+        return (status == HT_INTERRUPTED) ? HT_INTERRUPTED : -1;
+    }
+
+    /* Out of the pool; current stays, so the password is kept */
+    if (current)
+        current->control = -1;
+    *con = control;
+    soc = data_soc;
+    control = data_soc = -1;
+    return soc;
+}
+
 CLOSE_CONTROL(s)
 int s;
 {
-    NETCLOSE(s);
-    ftpcache.control = -1;
+    int i;
+
+    if (s != -1) {
+        NETCLOSE(s);
+        for (i = 0; i < FTP_POOL_SIZE; i++)
+            if (ftpcache[i].control == s)
+                ftpcache[i].control = -1;
+    }
 }
 
+/*
+** Idle timer: close the pooled connections nobody has used for
+** ftp_timeout_val seconds, and come back later for the rest.
+*/
 void close_it_up()
 {
-    NETCLOSE(ftpcache.control);
-    ftpcache.control = -1;
+    time_t now = time(NULL);
+    int i, left = 0;
+
+    fTimerStarted = 0;
+    for (i = 0; i < FTP_POOL_SIZE; i++) {
+        if (ftpcache[i].control == -1)
+            continue;
+        if (now - ftpcache[i].last_used >= ftp_timeout_val) {
+#ifndef DISABLE_TRACE
+            if (www2Trace)
+                fprintf(stderr, "FTP: Closing idle connection to %s\n", ftpcache[i].host);
+#endif
+            CLOSE_CONTROL(ftpcache[i].control);
+        } else
+            left++;
+    }
+    if (left) {
+        timer = XtAppAddTimeOut(app_context, ftp_timeout_val * 1000, close_it_up, NULL);
+        fTimerStarted = 1;
+    }
 }
 
 #ifdef NEW_PARSE
@@ -52,6 +52,21 @@ extern WWW_CONST char * HTHostName NOPARAMS;
 /* Send file to server */
 extern int HTFTPSend PARAMS (( char * name ));
 
+
+/*
+
+Segmented downloads
+
+   Used by HTSegment. HTFTPSize finds the size of a file and checks that REST works,
+   and gives its MDTM time in *stamp if the server has one (malloc'd, or NULL);
+   HTFTPSegment starts a passive transfer at byte "from" and returns the data socket,
+   with *con set to a control connection of its own for the caller to close. Given a
+   stamp, it first checks the file still has it, and returns -2 if not.
+   
+ */
+extern int HTFTPSize PARAMS (( char * name, off_t * total, char ** stamp ));
+extern int HTFTPSegment PARAMS (( char * name, off_t from, int * con, char * stamp ));
+
 #endif
 
 /*
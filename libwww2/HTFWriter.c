@@ -18,6 +18,7 @@
 #include "HText.h"
 #include "tcp.h"
 #include "HTCompressed.h"
+#include "HTSpool.h"
 #include "../src/compat.h"
 
 extern char *currentURL;
@@ -39,6 +40,7 @@ struct _HTStream {
     char *fnam;
     char *end_command;
     int compressed;
+    int spooled;
     int interrupted;
     int write_error;
     char *mime_type;
@@ -98,6 +100,10 @@ PRIVATE void HTFWriter_put_string ARGS2(HTStream *, me, WWW_CONST char *, s)
     if (rv == EOF) {
         HTProgress("Error writing to temporary file.");
         me->write_error = 1;
+    } else if (me->spooled) {
+        HTSpoolWrote(me->fnam, &me->fp, (long)strlen(s));
+        if (!me->fp)
+            me->write_error = 1;
     }
 }
 
@@ -115,6 +121,10 @@ PRIVATE void HTFWriter_write ARGS3(HTStream *, me, WWW_CONST char *, s, int, l)
     if (rv != l) {
         HTProgress("Error writing to temporary file.");
         me->write_error = 1;
+    } else if (me->spooled) {
+        HTSpoolWrote(me->fnam, &me->fp, (long)l);
+        if (!me->fp)
+            me->write_error = 1;
     }
 }
 
@@ -200,7 +210,18 @@ PRIVATE void HTFWriter_free ARGS1(HTStream *, me)
         if (www2Trace)
             fprintf(stderr, "[HTFWriter] Hi there; compressed is %d, fnam is '%s'\n", me->compressed, me->fnam);
 #endif
-        HTCompressedFileToFile(me->fnam, me->compressed);
+        if (me->spooled) {
+            /* Uncompressing works on a file by name; do it on disk. */
+            char *path = HTSpoolSpill(me->fnam);
+
+            if (path) {
+                HTCompressedFileToFile(path, me->compressed);
+                HTSpoolAdopt(me->fnam, path);
+                free(path);
+            }
+        } else {
+            HTCompressedFileToFile(me->fnam, me->compressed);
+        }
     }
 
     if (force_dump_to_file) {
@@ -408,6 +429,7 @@ PUBLIC HTStream *HTSaveAndExecute ARGS5(HTPresentation *, pres, HTParentAnchor *
     me->fnam = NULL;
     me->end_command = NULL;
     me->compressed = compressed;
+    me->spooled = 0;
     if (!format_in || !format_in->name || !*(format_in->name)) {
         me->mime_type = NULL;
     } else {
@@ -441,6 +463,7 @@ PUBLIC HTStream *HTSaveAndExecute ARGS5(HTPresentation *, pres, HTParentAnchor *
         }
     } else {
         me->fnam = strdup(force_dump_filename);
+        me->spooled = HTSpoolIsSpool(me->fnam);
     }
 
     me->fp = fopen(me->fnam, "w");
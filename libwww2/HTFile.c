@@ -22,6 +22,7 @@
 #define MULTI_SUFFIX ".multi"   /* Extension for scanning formats */
 
 #include <stdio.h>
+#include <time.h>
 #include <sys/param.h>
 #include "HText.h"
 #include "HTUtils.h"
@@ -36,9 +37,12 @@
 #include "HTFWriter.h"
 #include "HTInit.h"
 #include "HTSort.h"
+#include "HTAlert.h"
 #include "../libnut/system.h"
 #include "../src/compat.h"
 
+extern BOOL reloading;          /* HTTP.c */
+
 typedef struct _HTSuffix {
     char *suffix;
     HTAtom *rep;
@@ -723,6 +727,172 @@ PUBLIC BOOL HTEditable ARGS1(WWW_CONST char *, filename)
 #endif
 }
 
+/*	Directory listing cache
+**	-----------------------
+**
+**	A short list, most recently used first.  It is bounded both by
+**	count and by total size, since a listing of 100,000 entries runs
+**	to several megabytes of HTML.
+*/
+#define DIR_LISTING_MAX         16
+#define DIR_LISTING_BYTES       (8 * 1024 * 1024)
+
+typedef struct _HTDirListing {
+    char *host;
+    char *path;
+    long mtime;                 /* 0 if unknown */
+    unsigned long sig;          /* What was listed, for local ones */
+    time_t stored;
+    HTChunk *listing;
+    struct _HTDirListing *next;
+} HTDirListing;
+
+PRIVATE HTDirListing *dir_listings = NULL;
+
+PUBLIC int HTDirListingTTL = 300;   /* For listings without an mtime */
+
+PRIVATE void free_dir_listing ARGS1(HTDirListing *, dl)
+{
+    free(dl->host);
+    free(dl->path);
+    HTChunkFree(dl->listing);
+    free(dl);
+}
+
+/* Unlink the entry for host and path, if there is one */
+PRIVATE HTDirListing *take_dir_listing ARGS2(WWW_CONST char *, host, WWW_CONST char *, path)
+{
+    HTDirListing *dl, *prev = NULL;
+
+    for (dl = dir_listings; dl; prev = dl, dl = dl->next) {
+        if (!strcmp(dl->path, path) && !strcmp(dl->host, host)) {
+            if (prev)
+                prev->next = dl->next;
+            else
+                dir_listings = dl->next;
+            return dl;
+        }
+    }
+    return NULL;
+}
+
+PUBLIC HTChunk *HTDirListingFind ARGS4(WWW_CONST char *, host, WWW_CONST char *, path, long, mtime,
+                                       unsigned long *, sig)
+{
+    HTDirListing *dl = take_dir_listing(host, path);
+
+    if (!dl)
+        return NULL;
+    if (dl->mtime != mtime || (!mtime && time(NULL) - dl->stored > HTDirListingTTL)) {
+#ifndef DISABLE_TRACE
+        if (www2Trace)
+            fprintf(stderr, "HTDirListingFind: %s%s is out of date\n", host, path);
+#endif
+        free_dir_listing(dl);
+        return NULL;
+    }
+
+    dl->next = dir_listings;
+    dir_listings = dl;
+    if (sig)
+        *sig = dl->sig;
+    return dl->listing;
+}
+
+PUBLIC void HTDirListingStore ARGS5(WWW_CONST char *, host, WWW_CONST char *, path, long, mtime,
+                                    unsigned long, sig, HTChunk *, listing)
+{
+    HTDirListing *dl, *prev;
+    int n, bytes;
+
+    if ((dl = take_dir_listing(host, path)) != NULL)
+        free_dir_listing(dl);
+
+    if (listing->size > DIR_LISTING_BYTES) {
+        HTChunkFree(listing);
+        return;
+    }
+
+    dl = (HTDirListing *) malloc(sizeof(HTDirListing));
+    if (!dl)
+        outofmem(__FILE__, "HTDirListingStore");
+    dl->host = strdup(host);
+    dl->path = strdup(path);
+    dl->mtime = mtime;
+    dl->sig = sig;
+    dl->stored = time(NULL);
+    dl->listing = listing;
+    dl->next = dir_listings;
+    dir_listings = dl;
+
+    /* Trim from the least recently used end */
+    n = bytes = 0;
+    for (prev = NULL, dl = dir_listings; dl; prev = dl, dl = dl->next) {
+        n++;
+        bytes += dl->listing->size;
+        if (prev && (n > DIR_LISTING_MAX || bytes > DIR_LISTING_BYTES)) {
+            prev->next = NULL;
+            while (dl) {
+                HTDirListing *next = dl->next;
+
+                free_dir_listing(dl);
+                dl = next;
+            }
+            break;
+        }
+    }
+}
+
+#ifdef GOT_READ_DIR
+/* What a local listing shows of one entry: its name, and for a file its
+   size and mode, which pick the size and icon shown. */
+PRIVATE unsigned long dir_entry_sig ARGS2(WWW_CONST char *, name, struct stat *, st)
+{
+    unsigned long h = 0;
+
+    for (; *name; name++)
+        h = h * 31 + (unsigned char)*name;
+    if (!(st->st_mode & S_IFDIR)) {
+        h = h * 31 + (unsigned long)st->st_size;
+        h = h * 31 + (unsigned long)st->st_mode;
+    }
+    return h;
+}
+
+/* The signature of a local directory as it would be listed now: the
+   sum over its entries, so the order readdir() gives does not matter. */
+PRIVATE int dir_signature ARGS2(WWW_CONST char *, localname, unsigned long *, sig)
+{
+    char filepath[MAXPATHLEN];
+    STRUCT_DIRENT *dp;
+    struct stat st;
+    DIR *dfp;
+
+    if ((dfp = opendir(localname)) == NULL)
+        return -1;
+    *sig = 0;
+    while ((dp = readdir(dfp)) != NULL) {
+        if (!strcmp(dp->d_name, ".") || !strcmp(dp->d_name, ".."))
+            continue;
+#ifdef DT_DIR
+        if (dp->d_type == DT_DIR)
+            st.st_mode = S_IFDIR;
+        else
+#endif
+        {
+            if (strlen(localname) + strlen(dp->d_name) + 2 > sizeof(filepath))
+                continue;
+            sprintf(filepath, "%s/%s", localname, dp->d_name);
+            if (stat(filepath, &st) == -1)
+                continue;
+        }
+        *sig += dir_entry_sig(dp->d_name, &st);
+    }
+    closedir(dfp);
+    return 0;
+}
+#endif
+
 /*      Output one directory entry
 **
 */
@@ -1012,6 +1182,9 @@ PUBLIC int HTLoadFile ARGS4(WWW_CONST char *, addr, HTParentAnchor *, anchor, HT
                 STRUCT_DIRENT *dp;
                 DIR *dfp;
 
+                HTChunk *listing;
+                unsigned long sig, now;
+                int shown, len;
                 int cmpr;
                 int count;
 
@@ -1039,22 +1212,47 @@ PUBLIC int HTLoadFile ARGS4(WWW_CONST char *, addr, HTParentAnchor *, anchor, HT
                     }
                 }
 
+                /* Seen it before, and nothing has come, gone or changed
+                   since?  Checking costs a readdir() and a stat() of each
+                   file, but no sorting or building of HTML. */
+                if (!reloading && (listing = HTDirListingFind("", localname, (long)dir_info.st_mtime, &sig)) &&
+                    dir_signature(localname, &now) == 0 && now == sig) {
+                    HT = HText_new();
+                    HText_beginAppend(HT);
+                    HText_appendBlock(HT, listing->data, listing->size);
+                    HText_endAppend(HT);
+                    free(localname);
+                    return HT_LOADED;
+                }
+
                 dfp = opendir(localname);
                 if (!dfp) {
                     free(localname);
                     return HTLoadError(sink, 403, "This directory is not readable.");
                 }
 
-                /* Suck the directory up into a list to be sorted */
+                /* Suck the directory up into a list to be sorted.
+                   readdir() already fetches entries from the kernel a
+                   buffer at a time; where it tells us the type of each
+                   entry, that rides along after the name's NUL so that
+                   directories need not be stat()ed below. */
 
                 HTSortInit();
 
                 for (dp = readdir(dfp); dp != NULL; dp = readdir(dfp)) {
-                    ptr = malloc(strlen(dp->d_name) + 1);
+                    len = strlen(dp->d_name);
+                    ptr = malloc(len + 2);
                     if (ptr == NULL) {
+                        closedir(dfp);
+                        free(localname);
                         return HTLoadError(sink, 403, "Ran out of memory in directory read!");
                     }
                     strcpy(ptr, dp->d_name);
+#ifdef DT_DIR
+                    ptr[len + 1] = dp->d_type;
+#else
+                    ptr[len + 1] = 0;
+#endif
 
                     HTSortAdd(ptr);
                 }
@@ -1065,14 +1263,18 @@ PUBLIC int HTLoadFile ARGS4(WWW_CONST char *, addr, HTParentAnchor *, anchor, HT
 
                 HTSortSort();
 
-/* Start a new HTML page */
+/* Start a new HTML page.  The listing is built up in a chunk, for the  */
+/* cache, and appended to the HText HT_DIR_BATCH entries at a time.     */
 
                 HT = HText_new();
                 HText_beginAppend(HT);
-                HText_appendText(HT, "<H1>Local Directory ");
-                HText_appendText(HT, localname);
-                HText_appendText(HT, "</H1>\n");
-                HText_appendText(HT, "<DL>\n");
+                listing = HTChunkCreate(4096);
+                shown = 0;
+                sig = 0;
+                HTChunkPuts(listing, "<H1>Local Directory ");
+                HTChunkPuts(listing, localname);
+                HTChunkPuts(listing, "</H1>\n");
+                HTChunkPuts(listing, "<DL>\n");
 
 /* Sort the list and then spit it out in a nice form */
 
@@ -1081,6 +1283,21 @@ PUBLIC int HTLoadFile ARGS4(WWW_CONST char *, addr, HTParentAnchor *, anchor, HT
                 for (count = 0, dataptr = HTSortFetch(count);
                      dataptr != NULL; free(dataptr), count++, dataptr = HTSortFetch(count)) {
 
+                    if (count % HT_DIR_BATCH == 0 && count) {
+                        HText_appendBlock(HT, listing->data + shown, listing->size - shown);
+                        shown = listing->size;
+                        sprintf(buffer, "Listed %d of %d entries", count, HTSortCurrentCount());
+                        HTProgress(buffer);
+                        if (HTCheckActiveIcon(1)) {
+                            for (; dataptr != NULL; free(dataptr), count++, dataptr = HTSortFetch(count))
+                                ;
+                            HTChunkFree(listing);
+                            HText_doAbort(HT);
+                            free(localname);
+                            return HT_INTERRUPTED;
+                        }
+                    }
+
 /* We dont want to see . */
 
                     if (strcmp(dataptr, ".") == 0)
@@ -1102,13 +1319,13 @@ PUBLIC int HTLoadFile ARGS4(WWW_CONST char *, addr, HTParentAnchor *, anchor, HT
                             if (buffer[0] == '\0')
                                 strcpy(buffer, "/");
 
-                            HText_appendText(HT, "<DD><A HREF=\"");
-                            HText_appendText(HT, buffer);
+                            HTChunkPuts(listing, "<DD><A HREF=\"");
+                            HTChunkPuts(listing, buffer);
 
-                            HText_appendText(HT, "\"><IMG SRC=\"");
-                            HText_appendText(HT, HTgeticonname(NULL, "directory"));
+                            HTChunkPuts(listing, "\"><IMG SRC=\"");
+                            HTChunkPuts(listing, HTgeticonname(NULL, "directory"));
 
-                            HText_appendText(HT, "\"> Parent Directory</a>");
+                            HTChunkPuts(listing, "\"> Parent Directory</a>");
                             continue;
                         } else {
                             continue;
@@ -1120,18 +1337,24 @@ PUBLIC int HTLoadFile ARGS4(WWW_CONST char *, addr, HTParentAnchor *, anchor, HT
 
                     sprintf(filepath, "%s/%s", localname, dataptr);
 
+#ifdef DT_DIR
+                    if (dataptr[strlen(dataptr) + 1] == DT_DIR)
+                        statbuf.st_mode = S_IFDIR;
+                    else
+#endif
                     if (stat(filepath, &statbuf) == -1)
                         continue;
+                    sig += dir_entry_sig(dataptr, &statbuf);
 
-                    HText_appendText(HT, "<DD><A HREF=\"");
-                    HText_appendText(HT, localname);
+                    HTChunkPuts(listing, "<DD><A HREF=\"");
+                    HTChunkPuts(listing, localname);
 
                     if (localname[strlen(localname) - 1] != '/') {
-                        HText_appendText(HT, "/");
+                        HTChunkPuts(listing, "/");
                     }
 
-                    HText_appendText(HT, dataptr);
-                    HText_appendText(HT, "\">");
+                    HTChunkPuts(listing, dataptr);
+                    HTChunkPuts(listing, "\">");
 
 /* If its a directory, dump out a dir icon, dont bother with anything else */
 /* if it is a file try and figure out what type of file it is, and grab    */
@@ -1140,9 +1363,9 @@ PUBLIC int HTLoadFile ARGS4(WWW_CONST char *, addr, HTParentAnchor *, anchor, HT
 
                     if (statbuf.st_mode & S_IFDIR) {
                         sprintf(buffer, "%s", dataptr);
-                        HText_appendText(HT, "<IMG SRC=\"");
-                        HText_appendText(HT, HTgeticonname(NULL, "directory"));
-                        HText_appendText(HT, "\"> ");
+                        HTChunkPuts(listing, "<IMG SRC=\"");
+                        HTChunkPuts(listing, HTgeticonname(NULL, "directory"));
+                        HTChunkPuts(listing, "\"> ");
                     } else {
                         sprintf(buffer, "%s (%d bytes)", dataptr, statbuf.st_size);
 
@@ -1151,31 +1374,33 @@ PUBLIC int HTLoadFile ARGS4(WWW_CONST char *, addr, HTParentAnchor *, anchor, HT
 /* If its executable then call it application, else it might as well be text */
 
                         if (cmpr == 0) {
-                            HText_appendText(HT, "<IMG SRC=\"");
+                            HTChunkPuts(listing, "<IMG SRC=\"");
                             if ((statbuf.st_mode & S_IXUSR) ||
                                 (statbuf.st_mode & S_IXGRP) || (statbuf.st_mode & S_IXOTH)) {
-                                HText_appendText(HT, HTgeticonname(format, "application"));
+                                HTChunkPuts(listing, HTgeticonname(format, "application"));
                             } else {
-                                HText_appendText(HT, HTgeticonname(format, "text"));
+                                HTChunkPuts(listing, HTgeticonname(format, "text"));
                             }
-                            HText_appendText(HT, "\"> ");
+                            HTChunkPuts(listing, "\"> ");
                         } else {
-                            HText_appendText(HT, "<IMG SRC=\"");
-                            HText_appendText(HT, HTgeticonname(NULL, "application"));
-                            HText_appendText(HT, "\"> ");
+                            HTChunkPuts(listing, "<IMG SRC=\"");
+                            HTChunkPuts(listing, HTgeticonname(NULL, "application"));
+                            HTChunkPuts(listing, "\"> ");
                         }
                     }
 
 /* Spit out the anchor */
 
-                    HText_appendText(HT, buffer);
-                    HText_appendText(HT, "</A>\n");
+                    HTChunkPuts(listing, buffer);
+                    HTChunkPuts(listing, "</A>\n");
                 }
 
 /* End of list, clean up and we are done */
 
-                HText_appendText(HT, "</DL>\n");
+                HTChunkPuts(listing, "</DL>\n");
+                HText_appendBlock(HT, listing->data + shown, listing->size - shown);
                 HText_endAppend(HT);
+                HTDirListingStore("", localname, (long)dir_info.st_mtime, sig, listing);
                 free(localname);
                 return HT_LOADED;
             }                   /* end if localname is directory */
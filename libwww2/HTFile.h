@@ -14,6 +14,7 @@
 #include "HTFormat.h"
 #include "HTAccess.h"
 #include "HTML.h"               /* SCW */
+#include "HTChunk.h"
 
 
 
@@ -202,6 +203,53 @@ extern WWW_CONST char * HTFileSuffix PARAMS((
 
 
 
+/*
+
+Directory listing cache
+
+   The HTML generated for local and FTP directory listings is kept,
+   keyed by host ("" for local files), path and the directory's
+   modification time, so that going back to a large directory does
+   not mean building the listing again.  The directory's mtime does
+   not change when a file in it is rewritten, so a local listing also
+   keeps a signature of the names, sizes and modes it shows; the
+   caller works out the signature again and compares.  FTP gives us
+   no modification time: those listings are stored with an mtime of 0
+   and trusted for HTDirListingTTL seconds.
+
+  HTDirListingFind        returns the cached listing, or NULL if there is
+                         none or it is out of date.  The chunk belongs to
+                         the cache.  If sig is not NULL the signature it
+                         was stored with goes there.
+
+  HTDirListingStore       hands a finished listing over to the cache.
+                         
+ */
+extern int HTDirListingTTL;
+
+extern HTChunk * HTDirListingFind PARAMS((
+                WWW_CONST char *        host,
+                WWW_CONST char *        path,
+                long                    mtime,
+                unsigned long *         sig));
+
+extern void HTDirListingStore PARAMS((
+                WWW_CONST char *        host,
+                WWW_CONST char *        path,
+                long                    mtime,
+                unsigned long           sig,
+                HTChunk *               listing));
+
+/*
+
+   Listings are appended to the HText every HT_DIR_BATCH entries, with a
+   progress message and, for local ones, a chance to interrupt in
+   between.  Nothing is displayed until the load is over.
+
+ */
+#define HT_DIR_BATCH            256
+
+
 /*
 
 The Protocols
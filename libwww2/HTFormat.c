@@ -24,6 +24,9 @@ PUBLIC float HTMaxLength = 1e10;    /* No effective limit */
 #include "SGML.h"
 #include "HTML.h"
 #include "HTMLGen.h"
+#include "HTFile.h"
+#include "HTCompressed.h"
+#include "HTTimeline.h"
 #include "../src/compat.h"
 
 /* From gui-documents.c. */
@@ -45,6 +48,20 @@ struct _HTStream {
 int loading_length = -1;
 int noLength = 1;
 
+/*	Counters for the transfer in progress, so updates is normally
+**	much smaller than reads on a fast connection.
+*/
+struct _HTTransferStats {
+    long bytes;                     /* read so far, headers included */
+    long expected;                  /* total expected, or -1 if unknown */
+    int reads;                      /* reads that returned data */
+    int updates;                    /* progress updates shown */
+    struct timeval start;           /* when the transfer started */
+    struct timeval last_feedback;   /* when the user last heard of it */
+};
+
+PUBLIC HTTransferStats HTCopyStats;
+
 /*SWP -- Even Uglier*/
 extern int ftpKludge;
 
@@ -55,6 +72,8 @@ extern int ftpKludge;
 PUBLIC HTList *HTPresentations = 0;
 PUBLIC HTPresentation *default_presentation = 0;
 
+PRIVATE void flush_lookups NOPARAMS;
+
 /*	Define a presentation system command for a content-type
 **	-------------------------------------------------------
 */
@@ -84,6 +103,7 @@ PUBLIC void HTSetPresentation ARGS5(WWW_CONST char *, representation,
     } else {
         HTList_addObjectAtEnd(HTPresentations, pres);
     }
+    flush_lookups();
 }
 
 /*	Define a built-in function for a content-type
@@ -115,6 +135,7 @@ PUBLIC void HTSetConversion ARGS6(WWW_CONST char *, representation_in,
     } else {
         HTList_addObject(HTPresentations, pres);
     }
+    flush_lookups();
 }
 
 /********************ddt*/
@@ -145,6 +166,7 @@ PUBLIC void HTRemoveConversion ARGS3(WWW_CONST char *, representation_in,
         }
 
     }
+    flush_lookups();
 }
 
 /***************** end ddt*/
@@ -234,8 +256,7 @@ static int partial_wildcard_matches(HTFormat r1, HTFormat r2)
 {
     /* r1 is the presentation format we're currently looking at out
        of the list we understand.  r2 is the one we need to get to. */
-    char *s1, *s2, *subtype1 = NULL, *subtype2 = NULL;
-    int i;
+    char *s1, *s2, *subtype1, *subtype2;
 
     s1 = HTAtom_name(r1);
     s2 = HTAtom_name(r2);
@@ -243,54 +264,116 @@ static int partial_wildcard_matches(HTFormat r1, HTFormat r2)
     if (!s1 || !s2)
         return 0;
 
-    s1 = strdup(s1);
-    s2 = strdup(s2);
+    /* Bail if we don't have a wildcard possibility. */
+    if (!(subtype1 = strchr(s1, '/')) || subtype1[1] != '*')
+        return 0;
+
+    if (!(subtype2 = strchr(s2, '/')))
+        return 0;
+
+    /* Either the main types are the same or s1's is a wildcard. */
+    if (s1[0] == '*')
+        return 1;
+    return (subtype1 - s1 == subtype2 - s2 && !strncmp(s1, s2, subtype1 - s1));
+}
+
+/*	Conversion lookup
+**	-----------------
+**
+**	Which presentation HTStreamStack uses for a (format_in, rep_out)
+**	pair is worked out the first time the pair is seen, by scanning
+**	HTPresentations, and kept here until the list changes.  Formats
+**	are atoms, so the pair hashes and compares as two pointers.
+*/
+#define LOOKUP_SIZE	128     /* Power of two */
+#define LOOKUP_MAX	1024    /* Start over past this many pairs */
+
+#define LOOKUP_NONE	0       /* Nothing converts format_in to rep_out */
+#define LOOKUP_INTERNAL	1       /* mosaic-internal-present: HTPlainPresent */
+#define LOOKUP_EXACT	2       /* pres->rep_out is rep_out */
+#define LOOKUP_WILDCARD	3       /* pres->rep_out is "*" */
+
+typedef struct _HTLookup {
+    HTFormat format_in;
+    HTFormat rep_out;
+    HTPresentation *pres;
+    int how;
+    struct _HTLookup *next;
+} HTLookup;
+
+PRIVATE HTLookup *lookup_table[LOOKUP_SIZE];
+PRIVATE int lookup_count = 0;
 
-    for (i = 0; i < strlen(s1); i++)
-        if (s1[i] == '/') {
-            s1[i] = '\0';
-            subtype1 = &(s1[i + 1]);
-            /* Now s1 contains the main type and subtype1 contains
-               the subtype. */
-            goto done1;
+#define LOOKUP_HASH(in, out) \
+	((((unsigned long)(in) >> 4) ^ ((unsigned long)(out) >> 3)) & (LOOKUP_SIZE - 1))
+
+PRIVATE void flush_lookups NOARGS
+{
+    HTLookup *l, *next;
+    int i;
+
+    if (!lookup_count)
+        return;
+    for (i = 0; i < LOOKUP_SIZE; i++) {
+        for (l = lookup_table[i]; l; l = next) {
+            next = l->next;
+            free(l);
         }
+        lookup_table[i] = NULL;
+    }
+    lookup_count = 0;
+}
 
-  done1:
-    if (!subtype1)
-        goto nope;
+PRIVATE HTLookup *find_lookup ARGS2(HTFormat, format_in, HTFormat, rep_out)
+{
+    HTAtom *wildcard = HTAtom_for("*");
+    int hash = LOOKUP_HASH(format_in, rep_out);
+    HTList *cur = HTPresentations;
+    HTPresentation *pres;
+    HTLookup *l;
 
-    /* Bail if we don't have a wildcard possibility. */
-    if (subtype1[0] != '*')
-        goto nope;
-
-    for (i = 0; i < strlen(s2); i++)
-        if (s2[i] == '/') {
-            s2[i] = '\0';
-            subtype2 = &(s2[i + 1]);
-            /* Now s2 contains the main type and subtype2 contains
-               the subtype. */
-            goto done2;
+    for (l = lookup_table[hash]; l; l = l->next)
+        if (l->format_in == format_in && l->rep_out == rep_out)
+            return l;
+
+    if (lookup_count >= LOOKUP_MAX)
+        flush_lookups();
+
+    if ((l = (HTLookup *) malloc(sizeof(HTLookup))) == NULL)
+        outofmem(__FILE__, "find_lookup");
+    l->format_in = format_in;
+    l->rep_out = rep_out;
+    l->pres = NULL;
+    l->how = LOOKUP_NONE;
+
+    while ((pres = HTList_nextObject(cur))) {
+#ifndef DISABLE_TRACE
+        if (www2Trace) {
+            fprintf(stderr, "HTFormat: looking at pres '%s'\n", HTAtom_name(pres->rep));
+            if (pres->command)
+                fprintf(stderr, "HTFormat: pres->command is '%s'\n", pres->command);
+            else
+                fprintf(stderr, "HTFormat: pres->command doesn't exist\n");
+        }
+#endif
+        if (pres->rep == format_in || partial_wildcard_matches(pres->rep, format_in)) {
+            if (pres->command && strstr(pres->command, "mosaic-internal-present"))
+                l->how = LOOKUP_INTERNAL;
+            else if (pres->rep_out == rep_out)
+                l->how = LOOKUP_EXACT;
+            else if (pres->rep_out == wildcard)
+                l->how = LOOKUP_WILDCARD;
+            if (l->how != LOOKUP_NONE) {
+                l->pres = pres;
+                break;
+            }
         }
+    }
 
-  done2:
-    if (!subtype2)
-        goto nope;
-
-    /* Bail if s1 and s2 aren't the same and s1[0] isn't '*'. */
-    if (strcmp(s1, s2) && s1[0] != '*')
-        goto nope;
-
-    /* OK, so now either we have the same main types or we have a wildcard
-       type for s1.  We also know that we have a wildcard possibility in
-       s1.  Therefore, at this point, we have a match. */
-    free(s1);
-    free(s2);
-    return 1;
-
-  nope:
-    free(s1);
-    free(s2);
-    return 0;
+    l->next = lookup_table[hash];
+    lookup_table[hash] = l;
+    lookup_count++;
+    return l;
 }
 
 /*		Create a filter stack
@@ -305,11 +388,11 @@ static int partial_wildcard_matches(HTFormat r1, HTFormat r2)
 PUBLIC HTStream *HTStreamStack ARGS5(HTFormat, format_in,
                                      HTFormat, rep_out, int, compressed, HTStream *, sink, HTParentAnchor *, anchor)
 {
-    HTAtom *wildcard = HTAtom_for("*");
     HTPresentation temp;
 
-    /* Inherit force_dump_to_file from mo-www.c. */
+    /* Inherit force_dump_to_file from mo-www.c, binary_transfer from gui.c. */
     extern int force_dump_to_file;
+    extern int binary_transfer;
 
 #ifndef DISABLE_TRACE
     if (www2Trace)
@@ -330,6 +413,14 @@ PUBLIC HTStream *HTStreamStack ARGS5(HTFormat, format_in,
         return sink;
     }
 
+    /* Decompress on the fly in front of whatever would take the data,
+       unless the user asked for the bytes exactly as they come. */
+    if (compressed != COMPRESSED_NOT && !binary_transfer && HTCompressedCanStream(compressed)) {
+        HTStream *target = HTStreamStack(format_in, rep_out, COMPRESSED_NOT, sink, anchor);
+
+        return target ? HTCompressedStream(compressed, target) : NULL;
+    }
+
     if (!HTPresentations)
         HTFormatInit();         /* set up the list */
 
@@ -338,45 +429,31 @@ PUBLIC HTStream *HTStreamStack ARGS5(HTFormat, format_in,
     }
 
     {
-        int n = HTList_count(HTPresentations);
-        int i;
-        HTPresentation *pres;
-        for (i = 0; i < n; i++) {
-            pres = HTList_objectAt(HTPresentations, i);
-#ifndef DISABLE_TRACE
-            if (www2Trace) {
-                fprintf(stderr, "HTFormat: looking at pres '%s'\n", HTAtom_name(pres->rep));
-                if (pres->command)
-                    fprintf(stderr, "HTFormat: pres->command is '%s'\n", pres->command);
-                else
-                    fprintf(stderr, "HTFormat: pres->command doesn't exist\n");
-            }
-#endif
-            if (pres->rep == format_in || partial_wildcard_matches(pres->rep, format_in)) {
-                if (pres->command && strstr(pres->command, "mosaic-internal-present")) {
+        HTLookup *l = find_lookup(format_in, rep_out);
+        HTPresentation *pres = l->pres;
+
+        /* l may be gone once a converter has stacked more streams */
+        switch (l->how) {
+        case LOOKUP_INTERNAL:
 #ifndef DISABLE_TRACE
-                    if (www2Trace)
-                        fprintf(stderr, "[HTStreamStack] HEY HEY HEY caught internal-present\n");
+            if (www2Trace)
+                fprintf(stderr, "[HTStreamStack] HEY HEY HEY caught internal-present\n");
 #endif
-                    return HTPlainPresent(pres, anchor, sink, format_in, compressed);
-                }
-                if (pres->rep_out == rep_out) {
+            return HTPlainPresent(pres, anchor, sink, format_in, compressed);
+        case LOOKUP_EXACT:
 #ifndef DISABLE_TRACE
-                    if (www2Trace)
-                        fprintf(stderr, "[HTStreamStack] pres->rep_out == rep_out\n");
+            if (www2Trace)
+                fprintf(stderr, "[HTStreamStack] pres->rep_out == rep_out\n");
 #endif
-                    return (*pres->converter) (pres, anchor, sink, format_in, compressed);
-                }
-                if (pres->rep_out == wildcard) {
+            return (*pres->converter) (pres, anchor, sink, format_in, compressed);
+        case LOOKUP_WILDCARD:
 #ifndef DISABLE_TRACE
-                    if (www2Trace)
-                        fprintf(stderr, "[HTStreamStack] pres->rep_out == wildcard\n");
+            if (www2Trace)
+                fprintf(stderr, "[HTStreamStack] pres->rep_out == wildcard\n");
 #endif
-                    temp = *pres;   /* make temp conversion to needed fmt */
-                    temp.rep_out = rep_out; /* yuk */
-                    return (*pres->converter) (&temp, anchor, sink, format_in, compressed);
-                }
-            }
+            temp = *pres;       /* make temp conversion to needed fmt */
+            temp.rep_out = rep_out;     /* yuk */
+            return (*pres->converter) (&temp, anchor, sink, format_in, compressed);
         }
     }
 
@@ -415,11 +492,9 @@ PUBLIC float HTStackValue ARGS4(HTFormat, format_in, HTFormat, rep_out, float, i
         HTFormatInit();         /* set up the list */
 
     {
-        int n = HTList_count(HTPresentations);
-        int i;
+        HTList *cur = HTPresentations;
         HTPresentation *pres;
-        for (i = 0; i < n; i++) {
-            pres = HTList_objectAt(HTPresentations, i);
+        while ((pres = HTList_nextObject(cur))) {
             if (pres->rep == format_in && (pres->rep_out == rep_out || pres->rep_out == wildcard)) {
                 float value = initial_value * pres->quality;
                 if (HTMaxSecs != 0.0)
@@ -456,6 +531,7 @@ PUBLIC int HTCopy ARGS3(int, file_number, HTStream *, sink, int, bytes_already_r
     extern int twirl_increment;
     int next_twirl = twirl_increment;
     int rv = 0;
+    long copying = HTTimelineNow();
 
     int left = -1, total_read = bytes_already_read, hdr_len = 0;
 
@@ -470,6 +546,11 @@ PUBLIC int HTCopy ARGS3(int, file_number, HTStream *, sink, int, bytes_already_r
 
     hdr_len = HTMIME_get_header_length(sink);
 
+    memset(&HTCopyStats, 0, sizeof(HTCopyStats));
+    HTCopyStats.bytes = bytes;
+    HTCopyStats.expected = -1;
+    gettimeofday(&HTCopyStats.start, NULL);
+
     /*        Push binary from socket down sink */
     for (;;) {
         int status, intr;
@@ -553,6 +634,22 @@ PUBLIC int HTCopy ARGS3(int, file_number, HTStream *, sink, int, bytes_already_r
 
         bytes += status;
 
+        HTCopyStats.bytes = bytes;
+        HTCopyStats.expected = (loading_length == -1 ? -1 : loading_length + hdr_len);
+        HTCopyStats.reads++;
+
+        if ((loading_length != -1)
+            && (total_read >= (loading_length + hdr_len))) {
+/*	  fprintf(stderr,"done\n");*/
+            break;
+        }
+
+        /* Every read used to update the message and meter, and at LAN
+           speeds the X traffic cost more than the reads did. */
+        if (!HTFeedbackDue(&HTCopyStats.last_feedback))
+            continue;
+        HTCopyStats.updates++;
+
         /* moved msg stuff here as loading_length may change midstream -bjs */
         if (loading_length == -1) {
             msg = (loading_inlined_images ? "Read %d bytes of inlined image data." : "Read %d bytes of data.");
@@ -565,11 +662,6 @@ PUBLIC int HTCopy ARGS3(int, file_number, HTStream *, sink, int, bytes_already_r
             HTMeter((bytes * 100) / (loading_length + hdr_len), NULL);
         }
         HTProgress(line);
-        if ((loading_length != -1)
-            && (total_read >= (loading_length + hdr_len))) {
-/*	  fprintf(stderr,"done\n");*/
-            break;
-        }
     }                           /* next bufferload */
 
 /*
@@ -586,6 +678,8 @@ PUBLIC int HTCopy ARGS3(int, file_number, HTStream *, sink, int, bytes_already_r
   NETCLOSE (file_number);
 */
 
+    HTTimelineAdd(HT_TL_BODY, copying, bytes - HTMIME_get_header_length(sink));
+
     /* Success. */
     rv = 0;
 
@@ -607,6 +701,8 @@ PUBLIC int HTCopy ARGS3(int, file_number, HTStream *, sink, int, bytes_already_r
 PUBLIC void HTFileCopy ARGS2(FILE *, fp, HTStream *, sink)
 {
     HTStreamClass targetClass;
+    long copying = HTTimelineNow();
+    long bytes = 0;
 
     targetClass = *(sink->isa); /* Copy pointers to procedures */
 
@@ -622,9 +718,11 @@ PUBLIC void HTFileCopy ARGS2(FILE *, fp, HTStream *, sink)
             break;
         }
         (*targetClass.put_block) (sink, input_buffer, status);
+        bytes += status;
     }                           /* next bufferload */
 
     fclose(fp);
+    HTTimelineAdd(HT_TL_BODY, copying, bytes);
     return;
 }
 
@@ -715,8 +813,18 @@ PUBLIC int HTParseFile ARGS6(HTFormat, format_in,
 {
     HTStream *stream;
     HTStreamClass targetClass;
-
+    struct stat st;
+    int hinted = 0;
+
+    /* Let the presenter size its buffer from the file, as HTMIME
+       does from Content-Length. */
+    if (loading_length == -1 && fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode)) {
+        loading_length = st.st_size;
+        hinted = 1;
+    }
     stream = HTStreamStack(format_in, format_out, compressed, sink, anchor);
+    if (hinted)
+        loading_length = -1;
 
     if (!stream) {
         char buffer[1024];      /* @@@@@@@@ */
@@ -244,6 +244,17 @@ extern int HTCopy PARAMS((
         HTStream*               sink,
         int                     bytes_already_read));
 
+/*
+
+   HTCopy keeps its counters for the transfer in progress (or the last one) in
+   HTCopyStats, which is private to HTFormat.c.  The progress message and meter are only
+   updated every HT_FEEDBACK_INTERVAL milliseconds (see HTAlert.h).
+   
+ */
+typedef struct _HTTransferStats HTTransferStats;
+
+extern HTTransferStats HTCopyStats;
+
         
 /*
 
@@ -15,6 +15,7 @@
 #include "HTMIME.h"             /* Implemented here */
 #include "HTAlert.h"
 #include "HTFile.h"
+#include "HTTimeline.h"
 #include "tcp.h"
 #include "../libnut/str-tools.h"
 #include "../src/compat.h"
@@ -203,6 +204,8 @@ PRIVATE void HTMIME_put_character ARGS2(HTStream *, me, char, c)
         case '\n':             /* Blank line: End of Header! */
             {
                 int compressed = COMPRESSED_NOT;
+
+                HTTimelineAdd(HT_TL_HEADERS, HT_TL_LAST, me->header_length);
 #ifndef DISABLE_TRACE
                 if (www2Trace)
                     fprintf(stderr,
@@ -21,6 +21,8 @@
 extern int www2Trace;
 #endif
 
+extern int loading_length;
+
 /*		HTML Object
 **		-----------
 */
@@ -130,5 +132,9 @@ PUBLIC HTStream *HTMosaicHTMLPresent ARGS5(HTPresentation *, pres,
     me->compressed = compressed;
     HText_beginAppend(me->text);
 
+    /* Content-Length, or the size of a local file: grow once. */
+    if (loading_length > 0)
+        HText_expectLength(me->text, loading_length);
+
     return (HTStream *) me;
 }
@@ -9,13 +9,7 @@
 
 #define HEX_ESCAPE '%'
 
-struct struct_parts {
-    char *access;
-    char *host;
-    char *absolute;
-    char *relative;
-    char *anchor;
-};
+#define HT_PARSE_LOCAL 1024        /* Results shorter than this go on the stack */
 
 #ifndef DISABLE_TRACE
 extern int www2Trace;
@@ -50,87 +44,96 @@ char *s;
     return s;
 }
 
-/*	Scan a filename for its consituents
-**	-----------------------------------
+/*	Take a name apart
+**	-----------------
 **
-** On entry,
-**	name	points to a document name which may be incomplete.
-** On exit,
-**      absolute or relative may be nonzero (but not both).
-**	host, anchor and access may be nonzero if they were specified.
-**	Any which are nonzero point to zero terminated strings.
+**	This finds what scan() used to cut out of a working copy, with the
+**	same quirks: the access is everything up to the first colon and the
+**	rest starts after the last one before any '/' or '#'; the anchor
+**	runs from the first '#' to the next one, if any; and where an
+**	access is given with no host the '#' does not start an anchor
+**	(news:j462#36487@foo.bar -- JFG 10/7/92) and is kept in the path.
 */
-#ifdef __STDC__
-PRIVATE void scan(char *name, struct struct_parts *parts)
-#else
-PRIVATE void scan(name, parts)
-char *name;
-struct struct_parts *parts;
-#endif
+PRIVATE void set_span ARGS3(HTURLSpan *, span, WWW_CONST char *, start, WWW_CONST char *, end)
 {
-    char *after_access;
-    char *p;
-    int length;
-
-    if (name && *name)
-        length = strlen(name);
-    else
-        length = 0;
+    span->start = start;
+    span->length = end - start;
+}
 
-    parts->access = 0;
-    parts->host = 0;
-    parts->absolute = 0;
-    parts->relative = 0;
-    parts->anchor = 0;
+PUBLIC void HTParseParts ARGS2(WWW_CONST char *, name, HTURLParts *, parts)
+{
+    WWW_CONST char *after_access;
+    WWW_CONST char *end;        /* Of everything before the anchor */
+    WWW_CONST char *stop;       /* Of the anchor */
+    WWW_CONST char *p;
 
-    /* Argh. */
-    if (!length)
+    memset(parts, 0, sizeof(HTURLParts));
+    if (!name || !*name)
         return;
+    parts->length = strlen(name);
+    end = stop = name + parts->length;
 
     after_access = name;
-    for (p = name; *p; p++) {
+    for (p = name; *p && *p != '/' && *p != '#'; p++) {
         if (*p == ':') {
-            *p = 0;
-            parts->access = name;   /* Access name has been specified */
+            if (!parts->access.start)
+                set_span(&parts->access, name, p);
             after_access = p + 1;
         }
-        if (*p == '/')
-            break;
-        if (*p == '#')
-            break;
     }
 
-    for (p = name + length - 1; p >= name; p--) {
-        if (*p == '#') {
-            parts->anchor = p + 1;
-            *p = 0;             /* terminate the rest */
-        }
+    if ((p = strchr(name, '#')) != NULL) {
+        end = p;
+        if ((p = strchr(end + 1, '#')) != NULL)
+            stop = p;
+        set_span(&parts->anchor, end + 1, stop);
     }
+
     p = after_access;
-    if (*p == '/') {
-        if (p[1] == '/') {
-            parts->host = p + 2;    /* host has been specified      */
-            *p = 0;             /* Terminate access             */
-            p = strchr(parts->host, '/');   /* look for end of host name if any */
-            if (p) {
-                *p = 0;         /* Terminate host */
-                parts->absolute = p + 1;    /* Root has been found */
-            }
+    if (p < end && *p == '/') {
+        if (p + 1 < end && p[1] == '/') {
+            WWW_CONST char *slash;
+
+            for (slash = p + 2; slash < end && *slash != '/'; slash++) ;
+            set_span(&parts->host, p + 2, slash);
+            if (slash < end)
+                set_span(&parts->absolute, slash + 1, end);
         } else {
-            parts->absolute = p + 1;    /* Root found but no host */
+            set_span(&parts->absolute, p + 1, end);
         }
-    } else {
-        parts->relative = (*after_access) ? after_access : 0;   /* zero for "" */
+    } else if (p < end) {
+        set_span(&parts->relative, p, end);
     }
 
-    /* Access specified but no host: the anchor was not really one
-       e.g. news:j462#36487@foo.bar -- JFG 10/7/92, from bug report */
-    if (parts->access && !parts->host && parts->anchor) {
-        *(parts->anchor - 1) = '#'; /* Restore the '#' in the address */
-        parts->anchor = 0;
+    /* Access specified but no host: the anchor was not really one */
+    if (parts->access.start && !parts->host.start && parts->anchor.start) {
+        parts->anchor.start = NULL;
+        parts->anchor.length = 0;
+        if (parts->absolute.start)
+            set_span(&parts->absolute, parts->absolute.start, stop);
+        if (parts->relative.start)
+            set_span(&parts->relative, parts->relative.start, stop);
     }
+}
 
-}                               /*scan */
+/*	Append a span to a string
+*/
+PRIVATE void span_cat ARGS2(char *, s, HTURLSpan *, span)
+{
+    s += strlen(s);
+    memcpy(s, span->start, span->length);
+    s[span->length] = 0;
+}
+
+PRIVATE BOOL span_equal ARGS2(HTURLSpan *, a, HTURLSpan *, b)
+{
+    return a->length == b->length && !strncmp(a->start, b->start, a->length);
+}
+
+PRIVATE BOOL span_is ARGS2(HTURLSpan *, span, WWW_CONST char *, s)
+{
+    return span->length == (int)strlen(s) && !strncmp(span->start, s, span->length);
+}
 
 /*	Parse a Name relative to another name
 **	-------------------------------------
@@ -139,70 +142,47 @@ struct struct_parts *parts;
 **	substituting bits from the related name where necessary.
 **
 ** On entry,
-**	aName		A filename given
-**      relatedName     A name relative to which aName is to be parsed
+**	given		A filename given, taken apart by HTParseParts
+**      related         A name relative to which it is to be parsed
 **      wanted          A mask for the bits which are wanted.
+**	buf, size	Where to put the result
 **
 ** On exit,
-**	returns		A pointer to a malloc'd string which MUST BE FREED
+**	returns		The length of the result, or -1 if it might not fit
 */
-#ifdef __STDC__
-char *HTParse(char *aName, char *relatedName, int wanted)
-#else
-char *HTParse(aName, relatedName, wanted)
-char *aName;
-char *relatedName;
-int wanted;
-#endif
-
+PUBLIC int HTParseInto ARGS5(HTURLParts *, given, HTURLParts *, relatedParts, int, wanted, char *, result, int, size)
 {
-    char *result = 0;
-    char *return_value = 0;
-    int len;
-    char *name = 0;
-    char *rel = 0;
     char *p;
-    char *access;
-    struct struct_parts given, related;
-
-    if (!aName)
-        aName = strdup("\0");
-    if (!relatedName)
-        relatedName = strdup("\0");
+    HTURLParts related;
+    HTURLSpan *access;
 
-    /* Make working copies of input strings to cut up:
-     */
-    len = strlen(aName) + strlen(relatedName) + 10;
-    result = (char *)malloc(len);   /* Lots of space: more than enough */
+    if (size < HT_PARSE_SIZE(given, relatedParts))
+        return -1;
+    related = *relatedParts;    /* Parts of it get dropped below */
 
-    StrAllocCopy(name, aName);
-    StrAllocCopy(rel, relatedName);
-
-    scan(name, &given);
-    scan(rel, &related);
     result[0] = 0;              /* Clear string  */
-    access = given.access ? given.access : related.access;
+    access = given->access.start ? &given->access : &related.access;
     if (wanted & PARSE_ACCESS)
-        if (access) {
-            strcat(result, access);
+        if (access->start) {
+            span_cat(result, access);
             if (wanted & PARSE_PUNCTUATION)
                 strcat(result, ":");
         }
 
-    if (given.access && related.access) /* If different, inherit nothing. */
-        if (strcmp(given.access, related.access) != 0) {
-            related.host = 0;
-            related.absolute = 0;
-            related.relative = 0;
-            related.anchor = 0;
+    if (given->access.start && related.access.start)    /* If different, inherit nothing. */
+        if (!span_equal(&given->access, &related.access)) {
+            related.host.start = 0;
+            related.absolute.start = 0;
+            related.relative.start = 0;
+            related.anchor.start = 0;
         }
 
     if (wanted & PARSE_HOST)
-        if (given.host || related.host) {
+        if (given->host.start || related.host.start) {
             char *tail = result + strlen(result);
             if (wanted & PARSE_PUNCTUATION)
                 strcat(result, "//");
-            strcat(result, given.host ? given.host : related.host);
+            span_cat(result, given->host.start ? &given->host : &related.host);
 #define CLEAN_URLS
 #ifdef CLEAN_URLS
             /* Ignore default port numbers, and trailing dots on FQDNs
@@ -210,16 +190,17 @@ int wanted;
             {
                 char *p;
                 p = strchr(tail, ':');
-                if (p && access) {  /* Port specified */
-                    if ((strcmp(access, "http") == 0 && strcmp(p, ":80") == 0)
-                        || (strcmp(access, "gopher") == 0 && (strcmp(p, ":70") == 0 || strcmp(p, ":70+") == 0)))
+                if (p && access->start) {   /* Port specified */
+                    if ((span_is(access, "http") && strcmp(p, ":80") == 0)
+                        || (span_is(access, "gopher") && (strcmp(p, ":70") == 0 || strcmp(p, ":70+") == 0)))
                         *p = (char)0;   /* It is the default: ignore it */
                     else if (p && *p && p[strlen(p) - 1] == '+')
                         p[strlen(p) - 1] = 0;
                 }
                 if (!p)
                     p = tail + strlen(tail);    /* After hostname */
-                p--;            /* End of hostname */
+                if (p > result)
+                    p--;        /* End of hostname */
                 if (strlen(tail) > 3 && (*p == '.')) {
 #ifndef DISABLE_TRACE
                     if (www2Trace)
@@ -244,7 +225,7 @@ int wanted;
 /*
                     bcopy (p+1, p, strlen(p+1));
 */
-                        memcpy(p, p + 1, strlen(p + 1));
+                        memmove(p, p + 1, strlen(p + 1));
 #ifndef DISABLE_TRACE
                         if (www2Trace)
                             fprintf(stderr, "[Parse] Setting '%c' to 0...\n", *(p + strlen(p + 1)));
@@ -268,52 +249,85 @@ int wanted;
 #endif
         }
 
-    if (given.host && related.host) /* If different hosts, inherit no path. */
-        if (strcmp(given.host, related.host) != 0) {
-            related.absolute = 0;
-            related.relative = 0;
-            related.anchor = 0;
+    if (given->host.start && related.host.start)    /* If different hosts, inherit no path. */
+        if (!span_equal(&given->host, &related.host)) {
+            related.absolute.start = 0;
+            related.relative.start = 0;
+            related.anchor.start = 0;
         }
 
     if (wanted & PARSE_PATH) {
-        if (given.absolute) {   /* All is given */
+        if (given->absolute.start) {    /* All is given */
             if (wanted & PARSE_PUNCTUATION)
                 strcat(result, "/");
-            strcat(result, given.absolute);
-        } else if (related.absolute) {  /* Adopt path not name */
+            span_cat(result, &given->absolute);
+        } else if (related.absolute.start) {    /* Adopt path not name */
             strcat(result, "/");
-            strcat(result, related.absolute);
-            if (given.relative) {
+            span_cat(result, &related.absolute);
+            if (given->relative.start) {
                 p = strchr(result, '?');    /* Search part? */
                 if (!p)
                     p = result + strlen(result) - 1;
-                for (; *p != '/'; p--); /* last / */
+                for (; p > result && *p != '/'; p--);    /* last / */
                 p[1] = 0;       /* Remove filename */
-                strcat(result, given.relative); /* Add given one */
+                span_cat(result, &given->relative); /* Add given one */
                 HTSimplify(result);
             }
-        } else if (given.relative) {
-            strcat(result, given.relative); /* what we've got */
-        } else if (related.relative) {
-            strcat(result, related.relative);
+        } else if (given->relative.start) {
+            span_cat(result, &given->relative); /* what we've got */
+        } else if (related.relative.start) {
+            span_cat(result, &related.relative);
         } else {                /* No inheritance */
             strcat(result, "/");
         }
     }
 
     if (wanted & PARSE_ANCHOR)
-        if (given.anchor || related.anchor) {
+        if (given->anchor.start || related.anchor.start) {
             if (wanted & PARSE_PUNCTUATION)
                 strcat(result, "#");
-            strcat(result, given.anchor ? given.anchor : related.anchor);
+            span_cat(result, given->anchor.start ? &given->anchor : &related.anchor);
         }
-    if (rel)
-        free(rel);
-    if (name)
-        free(name);
+    return strlen(result);
+}
+
+/*	Parse a Name relative to another name, into new memory
+**	------------------------------------------------------
+**
+**	The names are taken apart where they lie and the result is put
+**	together on the stack unless it could be very long, so the only
+**	allocation is the one handed back.
+**
+** On exit,
+**	returns		A pointer to a malloc'd string which MUST BE FREED
+*/
+#ifdef __STDC__
+char *HTParse(char *aName, char *relatedName, int wanted)
+#else
+char *HTParse(aName, relatedName, wanted)
+char *aName;
+char *relatedName;
+int wanted;
+#endif
+
+{
+    char buf[HT_PARSE_LOCAL];
+    char *result = buf;
+    char *return_value = 0;
+    int size;
+    HTURLParts given, related;
+
+    HTParseParts(aName, &given);
+    HTParseParts(relatedName, &related);
+    size = HT_PARSE_SIZE(&given, &related);
+    if (size > HT_PARSE_LOCAL)
+        result = (char *)malloc(size);
+
+    HTParseInto(&given, &related, wanted, result, size);
 
     StrAllocCopy(return_value, result);
-    free(result);
+    if (result != buf)
+        free(result);
     return return_value;        /* exactly the right length */
 }
 
@@ -345,20 +359,20 @@ char *filename;
     if (filename[0] && filename[1]) {
         for (p = filename + 2; *p; p++) {
             if (*p == '/') {
-                if ((p[1] == '.') && (p[2] == '.')
+                if (p > filename && (p[1] == '.') && (p[2] == '.')
                     && (p[3] == '/' || !p[3])) {
                     /* Changed clause below to (q>filename) due to attempted
                        read to q = filename-1 below. */
                     for (q = p - 1; (q > filename) && (*q != '/'); q--);    /* prev slash */
                     if (q[0] == '/' && 0 != strncmp(q, "/../", 4)
                         && !(q - 1 > filename && q[-1] == '/')) {
-                        strcpy(q, p + 3);   /* Remove  /xxx/..      */
+                        memmove(q, p + 3, strlen(p + 3) + 1);   /* Remove  /xxx/..      */
                         if (!*filename)
                             strcpy(filename, "/");
                         p = q - 1;  /* Start again with prev slash  */
                     }
                 } else if ((p[1] == '.') && (p[2] == '/' || !p[2])) {
-                    strcpy(p, p + 2);   /* Remove a slash and a dot */
+                    memmove(p, p + 2, strlen(p + 2) + 1);   /* Remove a slash and a dot */
                 }
             }
         }
@@ -47,6 +47,52 @@ HTParse:  Parse a URL relative to another URL
 extern char * HTParse  PARAMS((char * aName, char * relatedName, int wanted));
 
 
+/*
+
+HTParseParts:  Take a URL apart in place
+
+   Finds the parts HTParse works with as spans of the string itself, which is neither
+   copied nor changed. A part that is not there has a NULL start. The same parts may be
+   used for any number of HTParseInto calls, so a document's base URL need only be taken
+   apart once however many references are resolved against it.
+
+ */
+typedef struct _HTURLSpan {
+        WWW_CONST char *start;
+        int             length;
+} HTURLSpan;
+
+typedef struct _HTURLParts {
+        HTURLSpan       access;         /* "http" */
+        HTURLSpan       host;           /* "host:port", without the "//" */
+        HTURLSpan       absolute;       /* path after its leading "/" */
+        HTURLSpan       relative;       /* path with no leading "/" */
+        HTURLSpan       anchor;         /* after the "#" */
+        int             length;         /* of the whole string */
+} HTURLParts;
+
+extern void HTParseParts PARAMS((WWW_CONST char * name, HTURLParts * parts));
+
+
+/*
+
+HTParseInto:  Parse a URL relative to another into a buffer
+
+   As HTParse, but given both names already taken apart, and writing the result into buf
+   rather than allocating it. HT_PARSE_SIZE is enough room for any result.
+
+  ON EXIT,
+
+  returns                 The length of the result, or -1 if size is less than
+                         HT_PARSE_SIZE, in which case buf is untouched.
+
+ */
+#define HT_PARSE_SIZE(given, related) ((given)->length + (related)->length + 10)
+
+extern int HTParseInto PARAMS((HTURLParts * given, HTURLParts * related, int wanted,
+                               char * buf, int size));
+
+
 /*
 
 HTStrip: Strip white space off a string
@@ -18,6 +18,8 @@
 extern int www2Trace;
 #endif
 
+extern int loading_length;
+
 /*		HTML Object
 **		-----------
 */
@@ -122,5 +124,9 @@ PUBLIC HTStream *HTPlainPresent ARGS5(HTPresentation *, pres,
     if (me->compressed == COMPRESSED_NOT)
         HText_appendText(me->text, "<PLAINTEXT>\n");
 
+    /* Content-Length, or the size of a local file: grow once. */
+    if (loading_length > 0)
+        HText_expectLength(me->text, loading_length);
+
     return (HTStream *) me;
 }
@@ -0,0 +1,633 @@
+/*		Segmented downloads				HTSegment.c
+**		===================
+**
+**	When a file is loaded to disk and the server can start a transfer
+**	part way through (HTTP Range:, FTP REST), the file is split into
+**	segments fetched over several connections at once.  Each piece is
+**	written into place with pwrite() in a part file the size of the
+**	whole, and a connection that finishes early takes over half of
+**	the biggest piece still going, so every connection stays busy to
+**	the end.  The transfers are multiplexed with select(), the way
+**	HTDoRead waits on one socket, checking the icon for interrupts.
+**	FTP logins and data connections are set up by HTFTP.c, so they
+**	go through its connection pool and its EPSV and PASV handling.
+**
+**	Beside the part file a manifest lists what is left of each
+**	segment.  It is rewritten every second or so and when the user
+**	interrupts; loading the same URL to disk again picks it up and
+**	carries on from there.  Bytes not listed there are on disk.
+**
+**	The manifest also keeps a validator for the document: its HTTP
+**	ETag, or Last-Modified if it has no strong ETag, or the FTP MDTM
+**	time.  A download is only resumed if the server still gives the
+**	same one, and every later HTTP range is asked for with If-Range
+**	and every FTP segment checks MDTM, so a document that changes
+**	part way is started again rather than spliced.
+**
+**	The part file and manifest live in the directory of the file the
+**	download is bound for, named after the URL:
+**
+**		mosaic-<hash>.part
+**		mosaic-<hash>.part.resume
+**
+**		Mosaic segments 2
+**		<url>
+**		<length>
+**		<validator>		empty if the server gave none
+**		<next> <end>		one line per segment
+*/
+#include "../config.h"
+#include "HTSegment.h"
+
+#include <sys/types.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "tcp.h"
+#include "HTTCP.h"
+#include "HTFTP.h"
+#include "HTParse.h"
+#include "HTAlert.h"
+#include "HText.h"
+#include "HTAABrow.h"
+#include "../libnut/str-tools.h"
+
+#ifndef DISABLE_TRACE
+extern int www2Trace;
+#endif
+
+extern int noLength;
+extern int sendAgent;                   /* HTTP.c */
+extern int selectedAgent;
+extern char **agent;
+extern void rename_binary_file PARAMS((char *fnam));
+extern ssize_t pwrite();        /* Not in POSIX.2 <unistd.h> */
+extern int ftruncate();
+
+#define LINE_LENGTH 1024
+#define SEGMENT_RETRIES 3               /* Reconnects before giving up */
+#define SEGMENT_SPLIT 262144L           /* Smallest piece worth handing over */
+#define MANIFEST_MAGIC "Mosaic segments 2"
+
+PUBLIC int HTSegmentCount = 4;
+PUBLIC long HTSegmentMinimum = 1048576L;
+
+typedef struct _segment {
+    off_t next;                 /* Next byte to arrive */
+    off_t end;                  /* One past the last byte */
+    int soc;                    /* Data connection, or -1 */
+    int control;                /* FTP control connection, or -1 */
+    int failures;
+} segment;
+
+PRIVATE segment seg[HT_SEGMENT_MAX];
+PRIVATE int nseg;
+PRIVATE int part_fd = -1;
+PRIVATE off_t part_length;
+PRIVATE char *part_validator;           /* NULL if the server gave none */
+PRIVATE char data_buf[65536];
+
+/*	Reading lines off a connection
+**	------------------------------
+**
+**	Only used while a connection is set up, one at a time, so one
+**	buffer does.  What is left in it after the HTTP headers is the
+**	start of the body.
+*/
+PRIVATE int in_soc;
+PRIVATE char in_buf[BUFSIZ];
+PRIVATE int in_pos, in_len;
+
+PRIVATE void reader_init ARGS1(int, soc)
+{
+    in_soc = soc;
+    in_pos = in_len = 0;
+}
+
+/* Returns the length of the line, CRLF dropped, -1 at end of file or
+   error, or HT_INTERRUPTED. */
+PRIVATE int read_line ARGS2(char *, line, int, size)
+{
+    int n = 0, status;
+    char c;
+
+    for (;;) {
+        if (in_pos >= in_len) {
+            status = NETREAD(in_soc, in_buf, BUFSIZ);
+            if (status == HT_INTERRUPTED)
+                return HT_INTERRUPTED;
+            if (status <= 0)
+                return -1;
+            in_len = status;
+            in_pos = 0;
+        }
+        c = in_buf[in_pos++];
+        if (c == LF)
+            break;
+        if (c != CR && n < size - 1)
+            line[n++] = c;
+    }
+    line[n] = '\0';
+    return n;
+}
+
+/*	Ask an HTTP server for a range of bytes
+**	---------------------------------------
+**
+** On entry,
+**	from, to	the first byte wanted and one past the last
+**	if_range	validator to send with If-Range, or NULL
+**	validator	where to put the document's validator, or NULL
+** On exit,
+**	returns		the socket, with the reader holding whatever of the
+**			body came in with the headers; HT_INTERRUPTED;
+**			-2 if if_range no longer matched; or -1 if the
+**			answer was not a 206 starting at from.
+**	*total		the full length of the document
+**	*validator	its strong ETag or Last-Modified, malloc'd, or NULL
+*/
+PRIVATE int http_range ARGS6(WWW_CONST char *, addr, off_t, from, off_t, to, off_t *, total,
+                             char *, if_range, char **, validator)
+{
+    char line[LINE_LENGTH + 1], first[HT_OFF_STRLEN], last[HT_OFF_STRLEN];
+    char *command = NULL, *p, *hostname, *docname, *colon, *auth;
+    char *etag = NULL, *modified = NULL;
+    int s, status, code = 0, portnumber;
+
+    if (validator)
+        *validator = NULL;
+
+    status = HTDoConnect((char *)addr, "HTTP", TCP_PORT, &s);
+    if (status < 0)
+        return (status == HT_INTERRUPTED) ? HT_INTERRUPTED : -1;
+
+    p = HTParse(addr, "", PARSE_PATH | PARSE_PUNCTUATION);
+    StrAllocCopy(command, "GET ");
+    StrAllocCat(command, p);
+    free(p);
+    sprintf(line, " HTTP/1.0%c%c", CR, LF);
+    StrAllocCat(command, line);
+
+    hostname = HTParse(addr, "", PARSE_HOST);
+    StrAllocCat(command, "Host: ");
+    StrAllocCat(command, hostname);
+    sprintf(line, "%c%cRange: bytes=%s-%s%c%c", CR, LF, HTOffString(from, first), HTOffString(to - 1, last), CR, LF);
+    StrAllocCat(command, line);
+    if (if_range) {
+        StrAllocCat(command, "If-Range: ");
+        StrAllocCat(command, if_range);
+        sprintf(line, "%c%c", CR, LF);
+        StrAllocCat(command, line);
+    }
+    if (sendAgent) {
+        sprintf(line, "User-Agent: %s%c%c", agent[selectedAgent], CR, LF);
+        StrAllocCat(command, line);
+    }
+
+    docname = HTParse(addr, "", PARSE_PATH);
+    if ((colon = strchr(hostname, ':')) != NULL) {
+        *(colon++) = '\0';      /* Chop off port number */
+        portnumber = atoi(colon);
+    } else
+        portnumber = 80;
+    if ((auth = HTAA_composeAuth(hostname, portnumber, docname)) != NULL) {
+        sprintf(line, "%s%c%c", auth, CR, LF);
+        StrAllocCat(command, line);
+    }
+    free(hostname);
+    free(docname);
+
+    sprintf(line, "%c%c", CR, LF);
+    StrAllocCat(command, line);
+    status = NETWRITE(s, command, strlen(command));
+    free(command);
+    if (status < 0)
+        goto refused;
+
+    /* HTTP/1.1 206 Partial Content ... Content-Range: bytes 0-0/1234 */
+    reader_init(s);
+    if ((status = read_line(line, sizeof(line))) < 0)
+        goto refused;
+    if (sscanf(line, "HTTP/%*s %d", &code) != 1 || code != 206) {
+        /* The whole document instead: it is not the one asked about */
+        status = (if_range && code == 200) ? -2 : -1;
+        goto refused;
+    }
+    *total = -1;
+    while ((status = read_line(line, sizeof(line))) > 0) {
+        if (validator && !my_strncasecmp(line, "ETag:", 5)) {
+            for (p = line + 5; *p == ' '; p++) ;
+            if (*p && strncmp(p, "W/", 2))      /* Weak ones can't go in If-Range */
+                StrAllocCopy(etag, p);
+            continue;
+        }
+        if (validator && !my_strncasecmp(line, "Last-Modified:", 14)) {
+            for (p = line + 14; *p == ' '; p++) ;
+            if (*p)
+                StrAllocCopy(modified, p);
+            continue;
+        }
+        if (my_strncasecmp(line, "Content-Range:", 14))
+            continue;
+        p = line + 14;
+        while (*p == ' ')
+            p++;
+        if (my_strncasecmp(p, "bytes", 5))
+            continue;
+        p += 5;
+        if (HTOffValue(&p) != from || *p++ != '-' || HTOffValue(&p) < 0 || *p++ != '/')
+            continue;
+        *total = HTOffValue(&p);
+    }
+    if (status < 0 || *total <= to - 1) {
+        status = -1;
+        goto refused;
+    }
+    if (validator) {
+        *validator = etag ? etag : modified;
+        if (etag && modified)
+            free(modified);
+    }
+    return s;
+
+  refused:
+#ifndef DISABLE_TRACE
+    if (www2Trace)
+        fprintf(stderr, "HTSegment: No range from %s (code %d)\n", addr, code);
+#endif
+    if (etag)
+        free(etag);
+    if (modified)
+        free(modified);
+    NETCLOSE(s);
+    if (status == HT_INTERRUPTED || status == -2)
+        return status;
+    return -1;
+}
+
+/*	Segments
+**	--------
+*/
+PRIVATE void close_segment ARGS1(segment *, s)
+{
+    if (s->soc >= 0)
+        NETCLOSE(s->soc);
+    if (s->control >= 0)
+        NETCLOSE(s->control);
+    s->soc = s->control = -1;
+}
+
+/* Connect a segment at its next byte.  Returns 0, HT_INTERRUPTED,
+   -1 worth a retry, or -2 if the document is no longer the same. */
+PRIVATE int open_segment ARGS3(WWW_CONST char *, addr, BOOL, ftp, segment *, s)
+{
+    off_t total = part_length;
+    off_t n;
+
+    if (ftp) {
+        s->soc = HTFTPSegment((char *)addr, s->next, &s->control, part_validator);
+        noLength = 0;           /* The FTP replies turn the meter off */
+    } else {
+        s->soc = http_range(addr, s->next, s->end, &total, part_validator, NULL);
+        if (s->soc >= 0 && total != part_length) {
+            close_segment(s);
+            return -2;
+        }
+        /* Body that came in with the headers */
+        if (s->soc >= 0 && (n = in_len - in_pos) > 0) {
+            if (n > s->end - s->next)
+                n = s->end - s->next;
+            if (pwrite(part_fd, in_buf + in_pos, (size_t)n, s->next) != n) {
+                close_segment(s);
+                return -1;
+            }
+            s->next += n;
+        }
+    }
+    if (s->soc < 0) {
+        int status = s->soc;
+
+        s->soc = -1;
+        return status;
+    }
+#ifndef DISABLE_TRACE
+    if (www2Trace)
+        fprintf(stderr, "HTSegment: Segment %d on socket %d\n", (int)(s - seg), s->soc);
+#endif
+    return 0;
+}
+
+/* A connection whose segment is done takes the back half of the
+   largest piece another connection still has to fetch. */
+PRIVATE void split_segment ARGS1(segment *, idle)
+{
+    segment *big = NULL;
+    off_t most = 2 * SEGMENT_SPLIT;
+    int i;
+
+    for (i = 0; i < nseg; i++) {
+        if (&seg[i] != idle && seg[i].soc >= 0 && seg[i].end - seg[i].next > most) {
+            big = &seg[i];
+            most = big->end - big->next;
+        }
+    }
+    if (!big)
+        return;
+    idle->end = big->end;
+    idle->next = big->end - most / 2;
+    idle->failures = 0;
+    big->end = idle->next;
+}
+
+/*	The manifest
+**	------------
+*/
+PRIVATE void save_manifest ARGS3(char *, manifest, WWW_CONST char *, addr, off_t, length)
+{
+    char *tmp = (char *)malloc(strlen(manifest) + 8);
+    char a[HT_OFF_STRLEN], b[HT_OFF_STRLEN];
+    FILE *fp;
+    int i;
+
+    sprintf(tmp, "%s.new", manifest);
+    if ((fp = fopen(tmp, "w")) != NULL) {
+        fprintf(fp, "%s\n%s\n%s\n%s\n", MANIFEST_MAGIC, addr, HTOffString(length, a),
+                part_validator ? part_validator : "");
+        for (i = 0; i < nseg; i++)
+            fprintf(fp, "%s %s\n", HTOffString(seg[i].next, a), HTOffString(seg[i].end, b));
+        if (fclose(fp) == 0)
+            rename(tmp, manifest);
+        else
+            unlink(tmp);
+    }
+    free(tmp);
+}
+
+/* Returns YES if the manifest is for this document, with seg[] and
+   nseg filled in from it.  Without a validator there is no telling a
+   changed document of the same length, so that is never resumed. */
+PRIVATE BOOL load_manifest ARGS3(char *, manifest, WWW_CONST char *, addr, off_t, length)
+{
+    char line[LINE_LENGTH + 1];
+    char *p;
+    FILE *fp;
+    BOOL ok;
+
+    if ((fp = fopen(manifest, "r")) == NULL)
+        return NO;
+    nseg = 0;
+    ok = (fgets(line, sizeof(line), fp) && !strncmp(line, MANIFEST_MAGIC, strlen(MANIFEST_MAGIC)));
+    ok = ok && fgets(line, sizeof(line), fp) && (p = strchr(line, '\n')) && (*p = '\0', !strcmp(line, addr));
+    ok = ok && fgets(line, sizeof(line), fp) && (p = line, HTOffValue(&p) == length);
+    ok = ok && part_validator && fgets(line, sizeof(line), fp) && (p = strchr(line, '\n')) &&
+        (*p = '\0', !strcmp(line, part_validator));
+    while (ok && nseg < HT_SEGMENT_MAX && fgets(line, sizeof(line), fp)) {
+        p = line;
+        seg[nseg].next = HTOffValue(&p);
+        seg[nseg].end = HTOffValue(&p);
+        ok = (seg[nseg].next >= 0 && seg[nseg].next <= seg[nseg].end && seg[nseg].end <= length);
+        nseg++;
+    }
+    fclose(fp);
+    return ok && nseg > 0;
+}
+
+/*	Fetch the segments
+**	------------------
+**
+** On exit,
+**	returns		HT_LOADED when every segment is complete,
+**			HT_INTERRUPTED, -1 with what is left in seg[], or
+**			-2 if the document changed and the part file is
+**			no good.
+*/
+PRIVATE int fetch_segments ARGS3(WWW_CONST char *, addr, BOOL, ftp, char *, manifest)
+{
+    struct timeval timeout, feedback;
+    time_t saved = time(NULL);
+    char line[256], a[HT_OFF_STRLEN], b[HT_OFF_STRLEN];
+    fd_set readers;
+    off_t left, want;
+    int i, n, connected, maxfd, status;
+
+    feedback.tv_sec = feedback.tv_usec = 0;
+    noLength = 0;
+
+    for (;;) {
+        /* (Re)connect segments with something left to fetch */
+        left = 0;
+        for (i = 0; i < nseg; i++) {
+            left += seg[i].end - seg[i].next;
+            if (seg[i].soc < 0 && seg[i].next < seg[i].end && seg[i].failures < SEGMENT_RETRIES) {
+                status = open_segment(addr, ftp, &seg[i]);
+                if (status == HT_INTERRUPTED)
+                    return HT_INTERRUPTED;
+                if (status == -2) {
+                    HTProgress("The document changed while it was being fetched.");
+                    return -2;
+                }
+                if (status < 0)
+                    seg[i].failures++;
+            }
+        }
+        if (left == 0)
+            return HT_LOADED;
+
+        FD_ZERO(&readers);
+        maxfd = -1;
+        connected = 0;
+        for (i = 0; i < nseg; i++) {
+            if (seg[i].soc >= 0) {
+                FD_SET(seg[i].soc, &readers);
+                if (seg[i].soc > maxfd)
+                    maxfd = seg[i].soc;
+                connected++;
+            }
+        }
+        if (connected == 0)
+            return -1;          /* Out of retries */
+
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 100000;
+        status = select(maxfd + 1, &readers, NULL, NULL, &timeout);
+        if (HTCheckActiveIcon(1))
+            return HT_INTERRUPTED;
+        if (status < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+
+        for (i = 0; status > 0 && i < nseg; i++) {
+            if (seg[i].soc < 0 || !FD_ISSET(seg[i].soc, &readers))
+                continue;
+            want = seg[i].end - seg[i].next;
+            if (want > (off_t)sizeof(data_buf))
+                want = sizeof(data_buf);
+            n = read(seg[i].soc, data_buf, (size_t)want);
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR)
+                    continue;
+                close_segment(&seg[i]);
+                seg[i].failures++;
+                continue;
+            }
+            if (pwrite(part_fd, data_buf, n, seg[i].next) != n) {
+                HTProgress("Insufficient disk space; could not transfer data.");
+                return -1;
+            }
+            seg[i].next += n;
+            seg[i].failures = 0;
+            if (seg[i].next >= seg[i].end) {
+                close_segment(&seg[i]);
+                split_segment(&seg[i]);
+            }
+        }
+
+        if (HTFeedbackDue(&feedback)) {
+            left = 0;
+            for (i = 0; i < nseg; i++)
+                left += seg[i].end - seg[i].next;
+            sprintf(line, "Read %s of %s bytes of data over %d connections.",
+                    HTOffString(part_length - left, a), HTOffString(part_length, b), connected);
+            HTProgress(line);
+            HTMeter((int)(((part_length - left) / 1024) * 100 / (part_length / 1024 + 1)), NULL);
+        }
+        if (time(NULL) != saved) {
+            save_manifest(manifest, addr, part_length);
+            saved = time(NULL);
+        }
+    }
+}
+
+/*	Load a document to a file in segments
+**	-------------------------------------
+*/
+PUBLIC int HTSegmentLoad ARGS2(WWW_CONST char *, addr, WWW_CONST char *, filename)
+{
+    char *access, *part, *manifest, *slash;
+    unsigned long hash = 0;
+    WWW_CONST char *p;
+    off_t length = -1, piece;
+    struct stat st;
+    HText *text;
+    BOOL ftp;
+    int i, status;
+
+    if (HTSegmentCount < 2 || !addr || !filename)
+        return 0;
+    access = HTParse(addr, "", PARSE_ACCESS);
+    ftp = !strcmp(access, "ftp");
+    status = (ftp || !strcmp(access, "http"));
+    free(access);
+    if (!status || addr[strlen(addr) - 1] == '/')
+        return 0;
+
+    HTProgress("Asking the server for the size of the document...");
+    part_validator = NULL;
+    status = ftp ? HTFTPSize((char *)addr, &length, &part_validator) :
+        http_range(addr, 0, 1, &length, NULL, &part_validator);
+    if (status == HT_INTERRUPTED)
+        return HT_INTERRUPTED;
+    if (status < 0)
+        return 0;
+    if (!ftp)
+        NETCLOSE(status);
+    if (length < HTSegmentMinimum || (part_validator && strlen(part_validator) > LINE_LENGTH - 2)) {
+        if (part_validator)
+            free(part_validator);
+        part_validator = NULL;
+        return 0;
+    }
+
+    for (p = addr; *p; p++)
+        hash = hash * 31 + (unsigned char)*p;
+    part = (char *)malloc(strlen(filename) + 48);
+    strcpy(part, filename);
+    if ((slash = strrchr(part, '/')) != NULL)
+        slash[1] = '\0';
+    else
+        *part = '\0';
+    sprintf(part + strlen(part), "mosaic-%08lx.part", hash & 0xffffffffUL);
+    manifest = (char *)malloc(strlen(part) + 8);
+    sprintf(manifest, "%s.resume", part);
+
+    part_length = length;
+    if (load_manifest(manifest, addr, length) && stat(part, &st) == 0 && st.st_size == length) {
+        HTProgress("Resuming an earlier download...");
+        part_fd = open(part, O_RDWR);
+    } else {
+        nseg = (HTSegmentCount > HT_SEGMENT_MAX) ? HT_SEGMENT_MAX : HTSegmentCount;
+        piece = length / nseg;
+        for (i = 0; i < nseg; i++) {
+            seg[i].next = i * piece;
+            seg[i].end = (i == nseg - 1) ? length : (i + 1) * piece;
+        }
+        part_fd = open(part, O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (part_fd >= 0 && ftruncate(part_fd, length) < 0) {
+            close(part_fd);
+            unlink(part);
+            part_fd = -1;
+        }
+    }
+    if (part_fd < 0) {
+        HTProgress("Insufficient disk space; could not transfer data.");
+        free(part);
+        free(manifest);
+        if (part_validator)
+            free(part_validator);
+        part_validator = NULL;
+        return 0;
+    }
+    for (i = 0; i < nseg; i++) {
+        seg[i].soc = seg[i].control = -1;
+        seg[i].failures = 0;
+    }
+#ifndef DISABLE_TRACE
+    if (www2Trace)
+        fprintf(stderr, "HTSegment: %s in %d segments to %s\n", addr, nseg, part);
+#endif
+
+    status = fetch_segments(addr, ftp, manifest);
+
+    for (i = 0; i < nseg; i++)
+        close_segment(&seg[i]);
+    if (close(part_fd) < 0 && status == HT_LOADED)
+        status = -1;
+    part_fd = -1;
+    HTMeter(100, NULL);
+    noLength = 1;
+
+    if (status == HT_LOADED && rename(part, filename) == 0) {
+        unlink(manifest);
+        HTProgress("Data transfer complete.");
+
+        /* Construct dummy HText thingie so Mosaic knows
+           not to try to access this "document", as HTFWriter does. */
+        text = HText_new();
+        HText_beginAppend(text);
+        HText_appendText(text, "<mosaic-access-override>\n");
+        HText_endAppend(text);
+        rename_binary_file((char *)filename);
+    } else if (status == -2) {
+        unlink(part);
+        unlink(manifest);
+        status = -1;
+    } else {
+        save_manifest(manifest, addr, length);
+        if (status == HT_INTERRUPTED)
+            HTProgress("Download interrupted; load it to disk again to resume.");
+        else
+            HTProgress("Download stopped; load it to disk again to resume.");
+        if (status == HT_LOADED)
+            status = -1;
+    }
+    free(part);
+    free(manifest);
+    if (part_validator)
+        free(part_validator);
+    part_validator = NULL;
+    return status;
+}
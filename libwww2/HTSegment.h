@@ -0,0 +1,34 @@
+/*		Segmented downloads				HTSegment.h
+**		===================
+**
+**	A large file loaded to disk is fetched in pieces over several
+**	connections at once, HTTP with Range: and FTP with REST, and the
+**	pieces written into place in a file of the full size.  A manifest
+**	beside the part file keeps track of each piece, so an interrupted
+**	download resumes the next time the same URL is loaded to disk.
+*/
+#ifndef HTSEGMENT_H
+#define HTSEGMENT_H
+
+#include "HTUtils.h"
+
+#define HT_SEGMENT_MAX 8                /* Most connections per file */
+
+extern int HTSegmentCount;              /* Connections to use, default 4 */
+extern long HTSegmentMinimum;           /* Smaller files load as usual */
+
+/*	Load a document to a file in segments
+**
+** On entry,
+**	addr		http: or ftp: address of the document
+**	filename	where it should end up
+** On exit,
+**	returns		0 if the server or the file is not suited, in
+**			which case the caller loads it the usual way;
+**			HT_LOADED when the file is complete and the save
+**			dialog has been posted; HT_INTERRUPTED, or <0 on
+**			error, with what was fetched kept for a resume.
+*/
+extern int HTSegmentLoad PARAMS((WWW_CONST char *addr, WWW_CONST char *filename));
+
+#endif /* not HTSEGMENT_H */
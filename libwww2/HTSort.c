@@ -23,8 +23,8 @@ void HTSortInit(void)
 
 static void expand_hunk(void)
 {
-    /* Make hunk bigger by SIZE_OF_HUNK elements. */
-    size_of_hunk += SIZE_OF_HUNK;
+    /* Double the hunk: directories can run to 100,000 entries. */
+    size_of_hunk *= 2;
     hunk = (char **)realloc(hunk, sizeof(char *) * size_of_hunk);
 
     return;
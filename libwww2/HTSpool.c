@@ -0,0 +1,208 @@
+/*		Spooling transient documents			HTSpool.c
+**		============================
+**
+**	Each spool is a file descriptor we hold, on a memory file from
+**	memfd_create() to begin with.  The name handed out goes through
+**	/proc so that code which only knows about paths, ReadBitmap() and
+**	the like, needs no change; the table below maps names back to
+**	descriptors.  Moving a spool to disk copies it into a temporary
+**	file and dup2()s that over the same descriptor, so the name stays
+**	good and anyone opening it afterwards gets the disk copy.
+**
+**	Without memfd_create() HTSpoolNew always fails and callers use
+**	temporary files the way they always have.
+*/
+#include "../config.h"
+#include "HTSpool.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/memfd.h>
+#endif
+
+#include "tcp.h"
+
+#ifndef DISABLE_TRACE
+extern int www2Trace;
+#endif
+
+extern char *mo_tmpnam PARAMS((char *url));
+#ifdef __linux__
+extern int memfd_create();      /* Not in POSIX.2 <sys/mman.h> */
+#endif
+
+#define SPOOL_COPY 8192
+
+PUBLIC long HTSpoolLimit = 524288L;
+
+typedef struct _spool {
+    int fd;                     /* -1 if the slot is free */
+    long size;                  /* Bytes written so far */
+    BOOL disk;                  /* Moved to a temporary file */
+} spool;
+
+PRIVATE spool spools[HT_SPOOL_MAX];
+PRIVATE BOOL initialized = NO;
+
+PRIVATE void init_spools NOARGS
+{
+    int i;
+
+    for (i = 0; i < HT_SPOOL_MAX; i++)
+        spools[i].fd = -1;
+    initialized = YES;
+}
+
+/*	Find the slot a name refers to, or NULL
+*/
+PRIVATE spool *find_spool ARGS1(WWW_CONST char *, name)
+{
+    long pid;
+    int fd, i;
+    char c;
+
+    if (!initialized || !name || strncmp(name, "/proc/", 6))
+        return NULL;
+    if (sscanf(name, "/proc/%ld/fd/%d%c", &pid, &fd, &c) != 2 || pid != (long)getpid())
+        return NULL;
+    for (i = 0; i < HT_SPOOL_MAX; i++)
+        if (spools[i].fd == fd)
+            return &spools[i];
+    return NULL;
+}
+
+/*	Point a spool's descriptor at another open file
+*/
+PRIVATE BOOL replace_fd ARGS2(spool *, s, int, fd)
+{
+    if (dup2(fd, s->fd) < 0) {
+        close(fd);
+        return NO;
+    }
+    close(fd);
+    fcntl(s->fd, F_SETFD, FD_CLOEXEC);
+    s->disk = YES;
+    return YES;
+}
+
+PUBLIC char *HTSpoolNew NOARGS
+{
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+    char *name;
+    int fd, i;
+
+    if (!initialized)
+        init_spools();
+    for (i = 0; i < HT_SPOOL_MAX && spools[i].fd >= 0; i++) ;
+    if (i == HT_SPOOL_MAX)
+        return NULL;
+
+    if ((fd = memfd_create("mosaic-spool", MFD_CLOEXEC)) < 0) {
+#ifndef DISABLE_TRACE
+        if (www2Trace)
+            fprintf(stderr, "HTSpool: memfd_create failed, errno %d\n", errno);
+#endif
+        return NULL;
+    }
+    spools[i].fd = fd;
+    spools[i].size = 0;
+    spools[i].disk = NO;
+
+    name = (char *)malloc(48);
+    sprintf(name, "/proc/%ld/fd/%d", (long)getpid(), fd);
+#ifndef DISABLE_TRACE
+    if (www2Trace)
+        fprintf(stderr, "HTSpool: New spool %s\n", name);
+#endif
+    return name;
+#else
+    return NULL;
+#endif
+}
+
+PUBLIC BOOL HTSpoolIsSpool ARGS1(WWW_CONST char *, name)
+{
+    return find_spool(name) != NULL;
+}
+
+PUBLIC void HTSpoolWrote ARGS3(WWW_CONST char *, name, FILE **, fp, long, bytes)
+{
+    spool *s = find_spool(name);
+    char *path;
+
+    if (!s)
+        return;
+    s->size += bytes;
+    if (s->disk || s->size <= HTSpoolLimit)
+        return;
+
+#ifndef DISABLE_TRACE
+    if (www2Trace)
+        fprintf(stderr, "HTSpool: %s passed %ld bytes, moving to disk\n", name, HTSpoolLimit);
+#endif
+    fclose(*fp);
+    if ((path = HTSpoolSpill(name)) != NULL) {
+        unlink(path);
+        free(path);
+    }
+    *fp = fopen(name, "a");
+}
+
+PUBLIC char *HTSpoolSpill ARGS1(WWW_CONST char *, name)
+{
+    spool *s = find_spool(name);
+    char buf[SPOOL_COPY];
+    char *path;
+    int fd, n;
+
+    if (!s)
+        return NULL;
+    path = mo_tmpnam(NULL);
+    if ((fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600)) < 0) {
+        free(path);
+        return NULL;
+    }
+
+    lseek(s->fd, 0, SEEK_SET);
+    while ((n = read(s->fd, buf, SPOOL_COPY)) > 0) {
+        if (write(fd, buf, n) != n) {
+            n = -1;
+            break;
+        }
+    }
+    if (n < 0 || !replace_fd(s, fd)) {
+        if (n < 0)
+            close(fd);
+        unlink(path);
+        free(path);
+        return NULL;
+    }
+    return path;
+}
+
+PUBLIC BOOL HTSpoolAdopt ARGS2(WWW_CONST char *, name, WWW_CONST char *, path)
+{
+    spool *s = find_spool(name);
+    int fd;
+
+    if (!s || (fd = open(path, O_RDWR)) < 0)
+        return NO;
+    if (!replace_fd(s, fd))
+        return NO;
+    unlink(path);
+    return YES;
+}
+
+PUBLIC BOOL HTSpoolRelease ARGS1(WWW_CONST char *, name)
+{
+    spool *s = find_spool(name);
+
+    if (!s)
+        return NO;
+    close(s->fd);
+    s->fd = -1;
+    return YES;
+}
@@ -0,0 +1,66 @@
+/*		Spooling transient documents			HTSpool.h
+**		============================
+**
+**	An inline image or a prefetched page is written out only to be
+**	read straight back and thrown away.  Where the system has
+**	memfd_create() such a document is kept in an anonymous memory file
+**	instead of a temporary file, under a name of the form
+**
+**		/proc/<pid>/fd/<fd>
+**
+**	which fopen(), stat() and any program we start can use like any
+**	other path for as long as the spool is held.  A spool that grows
+**	past HTSpoolLimit is moved to an unlinked file in the temporary
+**	directory under the same name.
+*/
+#ifndef HTSPOOL_H
+#define HTSPOOL_H
+
+#include "HTUtils.h"
+
+#define HT_SPOOL_MAX 16                 /* Spools held at once */
+
+extern long HTSpoolLimit;               /* Bytes kept in memory, default 512K */
+
+/*	Make a new spool
+**
+**	Returns a malloc'd name for an empty spool, or NULL when memory
+**	files are not available or too many spools are held; the caller
+**	then uses a temporary file as before.
+*/
+extern char *HTSpoolNew NOPARAMS;
+
+/*	Is this the name of a spool we hold?
+*/
+extern BOOL HTSpoolIsSpool PARAMS((WWW_CONST char *name));
+
+/*	Account for data written to a spool
+**
+**	Called with the stream open on it after each write; *fp is closed
+**	and opened again for appending if the spool has to move to disk.
+*/
+extern void HTSpoolWrote PARAMS((WWW_CONST char *name, FILE **fp, long bytes));
+
+/*	Move a spool to disk
+**
+**	Copies the spool into a new temporary file, which the name then
+**	refers to.  Returns the malloc'd path of that file, still linked
+**	so it can be worked on by name, or NULL on failure.
+*/
+extern char *HTSpoolSpill PARAMS((WWW_CONST char *name));
+
+/*	Replace what a spool holds
+**
+**	The file at path, typically one made from HTSpoolSpill's, becomes
+**	the spool's contents and is unlinked.
+*/
+extern BOOL HTSpoolAdopt PARAMS((WWW_CONST char *name, WWW_CONST char *path));
+
+/*	Let go of a spool
+**
+**	Returns NO if the name is not a spool, in which case it is a file
+**	the caller should unlink.
+*/
+extern BOOL HTSpoolRelease PARAMS((WWW_CONST char *name));
+
+#endif /* not HTSPOOL_H */
@@ -140,3 +140,60 @@ PUBLIC char *HTNextField ARGS1(char **, pstr)
     *pstr = p;
     return start;
 }
+
+/*	Write a file size or offset in decimal
+**	--------------------------------------
+**
+**	There is no portable printf conversion for off_t, which may be
+**	wider than a long.
+**
+** On entry,
+**	buf	has room for HT_OFF_STRLEN characters
+**
+** On exit,
+**	returns	buf
+*/
+PUBLIC char *HTOffString ARGS2(off_t, n, char *, buf)
+{
+    char digits[HT_OFF_STRLEN];
+    char *p = buf;
+    int i = 0;
+
+    if (n < 0) {
+        *p++ = '-';
+        n = -n;
+    }
+    do {
+        digits[i++] = '0' + (int)(n % 10);
+        n /= 10;
+    } while (n > 0);
+    while (i > 0)
+        *p++ = digits[--i];
+    *p = '\0';
+    return buf;
+}
+
+/*	Read a file size or offset in decimal
+**	-------------------------------------
+**
+**	scanf has no portable conversion for off_t either.
+**
+** On exit,
+**	returns	the number at *p, leading spaces skipped, or -1 if there
+**		is none
+**	*p	just past the number
+*/
+PUBLIC off_t HTOffValue ARGS1(char **, p)
+{
+    off_t n = 0;
+    BOOL any = NO;
+
+    while (**p == ' ')
+        (*p)++;
+    while (isdigit(**p)) {
+        n = n * 10 + (**p - '0');
+        (*p)++;
+        any = YES;
+    }
+    return any ? n : -1;
+}
@@ -7,6 +7,7 @@
 #ifndef HTSTRING_H
 #define HTSTRING_H
 
+#include <sys/types.h>
 #include "HTUtils.h"
 
 extern int WWW_TraceFlag;       /* Global flag for all W3 trace */
@@ -40,6 +41,15 @@ Next word or quoted string
  */
 extern char * HTNextField PARAMS ((char** pstr));
 
+/*
+
+Sizes and offsets of files as text
+
+ */
+#define HT_OFF_STRLEN 24
+extern char * HTOffString PARAMS ((off_t n, char *buf));
+extern off_t  HTOffValue PARAMS ((char **p));
+
 
 #endif
 /*
@@ -18,6 +18,7 @@
 #include "HTAlert.h"
 #include "HTAccess.h"
 #include "HTTCP.h"
+#include "HTTimeline.h"
 #include "tcp.h"                /* Defines SHORT_NAMES if necessary */
 #ifdef SHORT_NAMES
 #define HTInetStatus		HTInStat
@@ -37,6 +38,13 @@
 #include <sys/file.h>
 #endif
 
+#include <unistd.h>              /* read() and write() for HTDoSendFile */
+
+#if defined(linux) || defined(__linux__)
+#include <sys/sendfile.h>
+#define HAVE_SENDFILE
+#endif
+
 /* Apparently needed for AIX 3.2. */
 #ifndef FD_SETSIZE
 #define FD_SETSIZE 256
@@ -217,10 +225,12 @@ PUBLIC int HTParseInet ARGS2(SockA *, sin, WWW_CONST char *, str)
             memcpy(&sin->sin_addr, cached_phost_h_addr, cached_phost_h_length);
         } else {
             extern int h_errno;
+            long lookup = HTTimelineNow();
 #if 0
             fprintf(stderr, "=+= Fetching on '%s'\n", host);
 #endif
             phost = gethostbyname(host);
+            HTTimelineAdd(HT_TL_DNS, lookup, -1);
             if (!phost) {
 #ifndef DISABLE_TRACE
                 if (www2Trace)
@@ -333,6 +343,7 @@ PUBLIC int HTDoConnect(char *url, char *protocol, int default_port, int *s)
     struct sockaddr_in soc_address;
     struct sockaddr_in *sin = &soc_address;
     int status;
+    long connecting;
 
     /* Set up defaults: */
     sin->sin_family = AF_INET;
@@ -361,6 +372,7 @@ PUBLIC int HTDoConnect(char *url, char *protocol, int default_port, int *s)
     }
 
     /* Now, let's get a socket set up from the server for the data: */
+    connecting = HTTimelineNow();
     *s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
 
 #ifdef SOCKS
@@ -381,6 +393,8 @@ PUBLIC int HTDoConnect(char *url, char *protocol, int default_port, int *s)
             errno = EINTR;
         }
     }
+    if (status >= 0)
+        HTTimelineAdd(HT_TL_CONNECT, connecting, -1);
     return status;
 #else                           /* SOCKS not defined */
 
@@ -520,6 +534,7 @@ PUBLIC int HTDoConnect(char *url, char *protocol, int default_port, int *s)
         int val = 0;
         char line[256];
 
+        HTTimelineAdd(HT_TL_CONNECT, connecting, -1);
         ret = ioctl(*s, FIONBIO, &val);
         if (ret == -1) {
             sprintf(line, "Could not restore socket to blocking.");
@@ -584,3 +599,73 @@ int HTDoRead(int fildes, void *buf, unsigned nbyte)
 
     return ret;
 }
+
+/* Send length bytes of the file fd, from where it is positioned, down
+   the socket soc.  sendfile() takes them from the page cache straight
+   to the socket where there is one; otherwise, or if it refuses this
+   pair of descriptors, they are copied through a buffer.  Sizes are
+   off_t so there is no 2GB limit.  The meter follows along and the
+   icon is checked for interrupts between chunks.
+   Returns 0, HT_INTERRUPTED or -1; *sent is how much was sent. */
+#define SEND_CHUNK 131072
+
+int HTDoSendFile(int soc, int fd, off_t length, off_t *sent)
+{
+    char buf[BUFSIZ * 8];
+    char line[128], done[HT_OFF_STRLEN], total[HT_OFF_STRLEN];
+    struct timeval feedback;
+    BOOL copy = NO;
+    off_t left;
+    size_t chunk;
+    int n, w, i;
+
+    *sent = 0;
+    feedback.tv_sec = feedback.tv_usec = 0;
+    HTMeter(0, NULL);
+
+    while ((left = length - *sent) > 0) {
+        chunk = (left > SEND_CHUNK) ? SEND_CHUNK : (size_t)left;
+#ifdef HAVE_SENDFILE
+        if (!copy) {
+            n = sendfile(soc, fd, NULL, chunk);
+            if (n < 0 && (errno == EINVAL || errno == ENOSYS) && *sent == 0) {
+                copy = YES;
+                continue;
+            }
+        } else
+#else
+        copy = YES;
+#endif
+        {
+            if (chunk > sizeof(buf))
+                chunk = sizeof(buf);
+            n = read(fd, buf, chunk);
+            for (i = 0; n > 0 && i < n; i += w) {
+                if ((w = NETWRITE(soc, buf + i, n - i)) <= 0) {
+                    n = -1;
+                    break;
+                }
+            }
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+#ifndef DISABLE_TRACE
+            if (www2Trace)
+                fprintf(stderr, "HTDoSendFile: Stopped after %s bytes (errno = %d)\n", HTOffString(*sent, done), errno);
+#endif
+            return -1;
+        }
+        *sent += n;
+
+        if (HTCheckActiveIcon(1))
+            return HT_INTERRUPTED;
+        if (HTFeedbackDue(&feedback)) {
+            sprintf(line, "Sent %s of %s bytes.", HTOffString(*sent, done), HTOffString(length, total));
+            HTProgress(line);
+            HTMeter((int)((*sent / 1024) * 100 / (length / 1024 + 1)), NULL);
+        }
+    }
+    HTMeter(100, NULL);
+    return 0;
+}
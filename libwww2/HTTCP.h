@@ -109,4 +109,6 @@ extern int HTDoConnect (char *, char *, int, int *);
 
 extern int HTDoRead (int, void *, unsigned);
 
+extern int HTDoSendFile (int, int, off_t, off_t *);
+
 #endif   /* HTTCP_H */
@@ -22,6 +22,7 @@
 #include "HTML.h"
 #include "HTInit.h"
 #include "HTAABrow.h"
+#include "HTTimeline.h"
 #include "../src/compat.h"
 
 int useKeepAlive = 1;
@@ -65,7 +66,7 @@ char *headData = NULL;
 int do_post = 0;
 int do_put = 0;
 int do_meta = 0;
-int put_file_size = 0;
+off_t put_file_size = 0;
 FILE *put_fp;
 char *post_content_type = NULL;
 char *post_data = NULL;
@@ -104,6 +105,7 @@ PUBLIC int HTLoadHTTP ARGS4(char *, arg, HTParentAnchor *, anAnchor, HTFormat, f
     char *start_of_data;        /* Start of body of reply */
     int status;                 /* tcp return */
     int bytes_already_read;
+    long waiting;               /* Since the request went, on the timeline */
     char crlf[3];               /* A CR LF equivalent string */
     HTStream *target;           /* Unconverted data */
     HTFormat format_in;         /* Format arriving in the message */
@@ -268,11 +270,12 @@ PUBLIC int HTLoadHTTP ARGS4(char *, arg, HTParentAnchor *, anAnchor, HTFormat, f
     strcat(command, crlf);      /* CR LF, as in rfc 977 */
 
     if (extensions) {
-        int n, i;
+        HTList *cur;
+        HTPresentation *pres;
 
         if (!HTPresentations)
             HTFormatInit();
-        n = HTList_count(HTPresentations);
+        cur = HTPresentations;
 
         begin_ptr = command + strlen(command);
         env_length = 0;
@@ -296,8 +299,7 @@ PUBLIC int HTLoadHTTP ARGS4(char *, arg, HTParentAnchor *, anAnchor, HTFormat, f
             env_length += strlen(line);
         }
 
-        for (i = 0; i < n; i++) {
-            HTPresentation *pres = HTList_objectAt(HTPresentations, i);
+        while ((pres = HTList_nextObject(cur))) {
             if (pres->rep_out == WWW_PRESENT) {
                 sprintf(line, " %s,", HTAtom_name(pres->rep));
                 env_length += strlen(line);
@@ -459,7 +461,9 @@ PUBLIC int HTLoadHTTP ARGS4(char *, arg, HTParentAnchor *, anAnchor, HTFormat, f
         else
             StrAllocCat(command, "lose");
     } else if (do_post && do_put) {
-        sprintf(line, "Content-length: %d%c%c", put_file_size, CR, LF);
+        char size[HT_OFF_STRLEN];
+
+        sprintf(line, "Content-length: %s%c%c", HTOffString(put_file_size, size), CR, LF);
         StrAllocCat(command, line);
         StrAllocCat(command, crlf); /* Blank line means "end" */
     } else {
@@ -476,32 +480,24 @@ PUBLIC int HTLoadHTTP ARGS4(char *, arg, HTParentAnchor *, anAnchor, HTFormat, f
 */
 
     status = NETWRITE(s, command, (int)strlen(command));
-    if (do_post && do_put) {
-        char buf[BUFSIZ];
-        int upcnt = 0, n;
-
-        while (status > 0) {
-            n = fread(buf, 1, BUFSIZ - 1, put_fp);
+    if (do_post && do_put && status > 0) {
+        char tmpbuf[BUFSIZ], sent_text[HT_OFF_STRLEN], size_text[HT_OFF_STRLEN];
+        off_t sent;
 
-            upcnt += status = NETWRITE(s, buf, n);
-#ifndef DISABLE_TRACE
-            if (www2Trace) {
-                fprintf(stderr, "[%d](%d) %s", status, n, buf);
-            }
-#endif
-            if (feof(put_fp)) {
-                break;
-            }
+        status = HTDoSendFile(s, fileno(put_fp), put_file_size, &sent);
+        if (status == HT_INTERRUPTED) {
+            HTProgress("Upload interrupted.");
+            NETCLOSE(s);
+            free(command);
+            goto done;
         }
-
-        if (status < 0 || !feof(put_fp) || upcnt != put_file_size) {
-            char tmpbuf[BUFSIZ];
-
+        if (status < 0 || sent != put_file_size) {
             sprintf(tmpbuf,
-                    "Status: %d  --  EOF: %d  --  UpCnt/FileSize: %d/%d\n\nThe server you connected to either does not support\nthe PUT method, or an error occurred.\n\nYour upload was corrupted! Please try again!",
-                    status, (feof(put_fp) ? 1 : 0), upcnt, put_file_size);
+                    "Status: %d  --  Sent/FileSize: %s/%s\n\nThe server you connected to either does not support\nthe PUT method, or an error occurred.\n\nYour upload was corrupted! Please try again!",
+                    status, HTOffString(sent, sent_text), HTOffString(put_file_size, size_text));
             application_error(tmpbuf, "Upload Error!");
-        }
+        } else
+            status = 1;
     }
 
     /* Twirl on each request to make things look nicer -- SWP */
@@ -560,6 +556,7 @@ PUBLIC int HTLoadHTTP ARGS4(char *, arg, HTParentAnchor *, anAnchor, HTFormat, f
         fprintf(stderr, "HTTP: WRITE delivered OK\n");
 #endif
     HTProgress("Done sending HTTP request; waiting for response.");
+    waiting = HTTimelineNow();
 
     /*    Read the first line of the response
      **   -----------------------------------
@@ -652,6 +649,8 @@ PUBLIC int HTLoadHTTP ARGS4(char *, arg, HTParentAnchor *, anAnchor, HTFormat, f
                 end_of_file = YES;
                 break;
             }
+            if (bytes_already_read == status)
+                HTTimelineAdd(HT_TL_FIRST_BYTE, waiting, status);
             line_buffer[length + status] = 0;
 
             if (line_buffer) {
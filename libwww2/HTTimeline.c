@@ -0,0 +1,229 @@
+/*		Load timelines					HTTimeline.c
+**		==============
+**
+**	The timeline being recorded is kept here, with the subject URL
+**	that new events are put down to.  Events go in a table that grows
+**	by doubling up to HT_TIMELINE_EVENTS; any past that are counted in
+**	dropped, so a page with a great many images costs a bounded amount
+**	of memory per load.
+*/
+#include "../config.h"
+#include "HTTimeline.h"
+
+#ifndef DISABLE_TRACE
+extern int www2Trace;
+#endif
+
+#define TIMELINE_INITIAL 32
+
+PRIVATE HTTimeline *recording = NULL;
+PRIVATE char *subject = NULL;
+
+PRIVATE WWW_CONST char *stage_names[] = {
+    "dns",
+    "connect",
+    "first_byte",
+    "headers",
+    "body",
+    "parse",
+    "layout",
+    "image_fetch",
+    "image_decode"
+};
+
+PUBLIC void HTTimelineFree ARGS1(HTTimeline *, tl)
+{
+    int i;
+
+    if (!tl)
+        return;
+    for (i = 0; i < tl->count; i++)
+        if (tl->events[i].url)
+            free(tl->events[i].url);
+    if (tl->events)
+        free(tl->events);
+    if (tl->url)
+        free(tl->url);
+    free(tl);
+}
+
+PUBLIC void HTTimelineBegin ARGS1(WWW_CONST char *, url)
+{
+    if (recording)
+        HTTimelineFree(recording);
+    HTTimelineSubject(NULL);
+
+    recording = (HTTimeline *)calloc(1, sizeof(HTTimeline));
+    if (!recording)
+        return;
+    StrAllocCopy(recording->url, url ? url : "");
+    gettimeofday(&recording->begun, NULL);
+#ifndef DISABLE_TRACE
+    if (www2Trace)
+        fprintf(stderr, "HTTimeline: Begin %s\n", recording->url);
+#endif
+}
+
+/*	Put the events in order of starting time
+**
+**	Stages are noted as they finish, so an image fetched during layout
+**	comes before the layout that started first.  The table is nearly
+**	in order already, and equal starts keep the order they were noted
+**	in, so this is an insertion sort.
+*/
+PRIVATE void sort_events ARGS1(HTTimeline *, tl)
+{
+    HTTimelineEvent ev;
+    int i, j;
+
+    for (i = 1; i < tl->count; i++) {
+        ev = tl->events[i];
+        for (j = i; j > 0 && tl->events[j - 1].start > ev.start; j--)
+            tl->events[j] = tl->events[j - 1];
+        tl->events[j] = ev;
+    }
+}
+
+PUBLIC HTTimeline *HTTimelineEnd NOARGS
+{
+    HTTimeline *tl = recording;
+
+    if (!tl)
+        return NULL;
+    tl->total = HTTimelineNow();
+    sort_events(tl);
+    recording = NULL;
+    HTTimelineSubject(NULL);
+#ifndef DISABLE_TRACE
+    if (www2Trace)
+        fprintf(stderr, "HTTimeline: End %s, %d events in %ld ms\n", tl->url, tl->count, tl->total);
+#endif
+    return tl;
+}
+
+PUBLIC long HTTimelineAt ARGS1(struct timeval *, tv)
+{
+    if (!recording)
+        return -1;
+    return (tv->tv_sec - recording->begun.tv_sec) * 1000L + (tv->tv_usec - recording->begun.tv_usec) / 1000L;
+}
+
+PUBLIC long HTTimelineNow NOARGS
+{
+    struct timeval now;
+
+    if (!recording)
+        return -1;
+    gettimeofday(&now, NULL);
+    return HTTimelineAt(&now);
+}
+
+PUBLIC void HTTimelineSubject ARGS1(WWW_CONST char *, url)
+{
+    if (subject)
+        free(subject);
+    subject = NULL;
+    if (url)
+        StrAllocCopy(subject, url);
+}
+
+PUBLIC void HTTimelineSpan ARGS4(HTTimelineStage, stage, long, start, long, end, long, bytes)
+{
+    HTTimelineEvent *ev;
+
+    if (!recording || start == -1)
+        return;
+    if (start == HT_TL_LAST)
+        start = (recording->count ? recording->events[recording->count - 1].end : 0);
+
+    if (recording->count == recording->size) {
+        HTTimelineEvent *events;
+        int size = (recording->size ? recording->size * 2 : TIMELINE_INITIAL);
+
+        if (size > HT_TIMELINE_EVENTS ||
+            !(events = (HTTimelineEvent *)realloc(recording->events, size * sizeof(HTTimelineEvent)))) {
+            recording->dropped++;
+            return;
+        }
+        recording->events = events;
+        recording->size = size;
+    }
+
+    ev = &recording->events[recording->count++];
+    ev->stage = stage;
+    ev->start = start;
+    ev->end = (end < start ? start : end);
+    ev->bytes = bytes;
+    ev->url = NULL;
+    if (subject)
+        StrAllocCopy(ev->url, subject);
+}
+
+PUBLIC void HTTimelineAdd ARGS3(HTTimelineStage, stage, long, start, long, bytes)
+{
+    if (!recording)
+        return;
+    HTTimelineSpan(stage, start, HTTimelineNow(), bytes);
+}
+
+PUBLIC WWW_CONST char *HTTimelineStageName ARGS1(HTTimelineStage, stage)
+{
+    if ((int)stage < 0 || (int)stage >= (int)(sizeof(stage_names) / sizeof(stage_names[0])))
+        return "unknown";
+    return stage_names[stage];
+}
+
+/*	Append a JSON string, or null
+*/
+PRIVATE void json_string ARGS2(HTChunk *, ch, WWW_CONST char *, s)
+{
+    char hex[8];
+
+    if (!s) {
+        HTChunkPuts(ch, "null");
+        return;
+    }
+    HTChunkPutc(ch, '"');
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            HTChunkPutc(ch, '\\');
+            HTChunkPutc(ch, *s);
+        } else if ((unsigned char)*s < 0x20) {
+            sprintf(hex, "\\u%04x", (unsigned char)*s);
+            HTChunkPuts(ch, hex);
+        } else {
+            HTChunkPutc(ch, *s);
+        }
+    }
+    HTChunkPutc(ch, '"');
+}
+
+PUBLIC void HTTimelineJSON ARGS2(HTChunk *, ch, HTTimeline *, tl)
+{
+    char line[128];
+    int i;
+
+    HTChunkPuts(ch, "{\"url\": ");
+    json_string(ch, tl->url);
+    sprintf(line, ", \"started\": %ld, \"total_ms\": %ld, \"dropped\": %d, \"events\": [",
+            (long)tl->begun.tv_sec, tl->total, tl->dropped);
+    HTChunkPuts(ch, line);
+
+    for (i = 0; i < tl->count; i++) {
+        HTTimelineEvent *ev = &tl->events[i];
+
+        sprintf(line, "%s\n  {\"stage\": \"%s\", \"start_ms\": %ld, \"end_ms\": %ld, \"bytes\": ",
+                (i ? "," : ""), HTTimelineStageName(ev->stage), ev->start, ev->end);
+        HTChunkPuts(ch, line);
+        if (ev->bytes < 0) {
+            HTChunkPuts(ch, "null");
+        } else {
+            sprintf(line, "%ld", ev->bytes);
+            HTChunkPuts(ch, line);
+        }
+        HTChunkPuts(ch, ", \"url\": ");
+        json_string(ch, ev->url);
+        HTChunkPutc(ch, '}');
+    }
+    HTChunkPuts(ch, "]}");
+}
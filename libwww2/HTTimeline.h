@@ -0,0 +1,107 @@
+/*		Load timelines					HTTimeline.h
+**		==============
+**
+**	While a document is being loaded the library notes when each stage
+**	of the load happened: looking up the host, connecting, the first
+**	byte of the reply, the end of its headers, the end of the body.
+**	The display adds parsing, layout and the fetching and decoding of
+**	each inline image.  Times are in milliseconds from the start of the
+**	load.  Only one load is recorded at a time; outside of one, every
+**	call here but HTTimelineBegin does nothing.
+*/
+#ifndef HTTIMELINE_H
+#define HTTIMELINE_H
+
+#include "HTUtils.h"
+#include "HTChunk.h"
+#include "tcp.h"
+
+#define HT_TIMELINE_EVENTS 1024         /* Most events kept per load */
+
+#define HT_TL_LAST (-2L)                /* Start: where the last event ended */
+
+typedef enum _HTTimelineStage {
+        HT_TL_DNS,
+        HT_TL_CONNECT,
+        HT_TL_FIRST_BYTE,
+        HT_TL_HEADERS,
+        HT_TL_BODY,
+        HT_TL_PARSE,
+        HT_TL_LAYOUT,
+        HT_TL_IMAGE_FETCH,
+        HT_TL_IMAGE_DECODE
+} HTTimelineStage;
+
+typedef struct _HTTimelineEvent {
+        HTTimelineStage stage;
+        long            start;          /* ms from the start of the load */
+        long            end;
+        long            bytes;          /* or -1 if there is no count */
+        char *          url;            /* an inline image, or NULL */
+} HTTimelineEvent;
+
+typedef struct _HTTimeline {
+        char *          url;            /* of the document */
+        struct timeval  begun;
+        long            total;          /* ms, from begin to end */
+        int             count;          /* events */
+        int             size;           /* events allocated */
+        int             dropped;        /* past HT_TIMELINE_EVENTS */
+        HTTimelineEvent * events;
+} HTTimeline;
+
+/*	Start recording the load of a document
+**
+**	A load still being recorded is thrown away.
+*/
+extern void HTTimelineBegin PARAMS((WWW_CONST char *url));
+
+/*	Stop recording
+**
+**	Returns the finished timeline, which the caller frees with
+**	HTTimelineFree, or NULL if nothing was being recorded.
+*/
+extern HTTimeline *HTTimelineEnd NOPARAMS;
+
+extern void HTTimelineFree PARAMS((HTTimeline *tl));
+
+/*	The time now, or then, on the load's clock
+**
+**	Both return -1 when no load is being recorded, which callers
+**	pass back as the start of an event without checking.
+*/
+extern long HTTimelineNow NOPARAMS;
+extern long HTTimelineAt PARAMS((struct timeval *tv));
+
+/*	Whose events these are
+**
+**	Events added after this belong to url, an inline image say, until
+**	it is called again with NULL for the document itself.
+*/
+extern void HTTimelineSubject PARAMS((WWW_CONST char *url));
+
+/*	Note a stage
+**
+**	HTTimelineAdd notes one that started at start, or at HT_TL_LAST,
+**	and ends now; HTTimelineSpan one that is already over.  bytes is
+**	-1 where the stage moved no data, and the size of the pixels for
+**	a decoded image.
+*/
+extern void HTTimelineAdd PARAMS((HTTimelineStage stage, long start, long bytes));
+extern void HTTimelineSpan PARAMS((HTTimelineStage stage, long start, long end, long bytes));
+
+/*	Lowercase names for the stages, "dns", "first_byte" etc.
+*/
+extern WWW_CONST char *HTTimelineStageName PARAMS((HTTimelineStage stage));
+
+/*	Append a timeline to ch as a JSON object
+**
+**	{"url": ..., "started": <time_t>, "total_ms": ..., "dropped": ...,
+**	 "events": [{"stage": ..., "start_ms": ..., "end_ms": ...,
+**	             "bytes": ..., "url": ...}, ...]}
+**
+**	with null for a missing url or byte count.  ch is not terminated.
+*/
+extern void HTTimelineJSON PARAMS((HTChunk *ch, HTTimeline *tl));
+
+#endif /* not HTTIMELINE_H */
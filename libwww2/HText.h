@@ -82,6 +82,10 @@ extern void HText_appendText PARAMS((HText * text, WWW_CONST char * str));
 */
 extern void HText_appendBlock PARAMS((HText * text, WWW_CONST char * str, int len));
 
+/*      Size hint: about len more bytes are on their way.
+*/
+extern void HText_expectLength PARAMS((HText * text, int len));
+
 /*      New Paragraph
 */
 extern void HText_appendParagraph PARAMS((HText * text));
@@ -106,6 +106,9 @@
 #define MCCI_S_FORM	 	"FORM"
 #define MCCI_S_EVENT		"EVENT"
 #define MCCI_S_DOCOMMAND	"DOCOMMAND"
+#define MCCI_S_ID		"ID"	/* "ID <tag> <request>" pipelines */
+#define MCCI_S_PREFETCH		"PREFETCH"
+#define MCCI_S_TIMELINE		"TIMELINE"	/* load timelines as JSON */
 
 #define MCCI_S_TO		"TO"
 #define MCCI_S_STOP		"STOP"
@@ -114,6 +117,7 @@
 #define MCCI_S_NEW		"NEW"
 #define MCCI_S_NONE		"NONE"
 #define MCCI_S_HEADER		"HEADER"
+#define MCCI_S_INLINE		"INLINE"	/* PREFETCH the images of pages too */
 #define MCCI_S_POST		"POST"
 #define MCCI_POST             	"cciPOST"
 
@@ -200,6 +204,7 @@
 #define MCCIR_SEND_EVENT_OK		225
 #define MCCIR_SEND_EVENT_STOP_OK	226
 #define MCCIR_DOCOMMAND_OK 		227
+#define MCCIR_PREFETCH_OK		228  /* whole PREFETCH list done */
 
 /* Send Anchor Before return codes */
 #define MCCIR_SEND_ANCH_BEF_LINK_OK	280  /* clicked link  */
@@ -239,6 +244,9 @@
 #define MCCIR_FORM_RESPONSE	308 /* form submission reply */
 #define MCCIR_SEND_EVENT	309 /* output form send event protocol */
 #define MCCIR_SEND_MOUSE_ANCHOR 310 /* output from Send Mouse Anchor */
+#define MCCIR_PREFETCH_URL	311 /* one PREFETCH url is now cached */
+#define MCCIR_TIMELINE		312 /* load timelines of current window */
+#define MCCIR_PREFETCH_NOCACHE	313 /* PREFETCH url fetched, nothing cached */
 
 /* problem response codes... client problems*/
 #define MCCIR_UNRECOGNIZED	401  /* what's this? */
@@ -250,6 +258,7 @@
 #define MCCIR_MAX_CONNECTIONS   502  /* Max number of connections exceeded */
 #define MCCIR_NO_URL_FOR_FILE	503  /* couldn't translate filename to url */
 #define MCCIR_DOCOMMAND_FAILED	504  /* command not implemented yet */
+#define MCCIR_TOO_MANY_REQUESTS	505  /* per-client queue is full */
 
 /* all possible events on the Web browser */
 typedef enum{
@@ -55,6 +55,7 @@
 #include "../config.h"
 #include <stdio.h>
 #include <ctype.h>
+#include <sys/stat.h>
 #include "cci.h"
 
 #include "mosaic.h"
@@ -64,7 +65,9 @@
 #include "cciBindings2.h"
 #include "pan.h"
 #include "mo-www.h"
+#include "globalhist.h"
 #include "annotate.h"
+#include "gui-extras.h"
 /* for setting some selections buttons*/
 #include "libhtmlw/HTML.h"
 #include "compat.h"
@@ -797,8 +800,9 @@ int output;
            output back through the cci to the client */
         response = mo_post_pull_er_over(url, contentType, postData, &textHead);
 
-        /* send response back through cci */
-        if (response && (length = strlen(response))) {
+        /* send response back through cci, if the client is still there */
+        client = MCCIReplyPort(client);
+        if (client && response && (length = strlen(response))) {
             MCCISendResponseLine(client, MCCIR_POST_OUTPUT, "POST output");
             sprintf(buff, "Content-Length: %d\r\n", length);
             if (length != NetServerWrite(client, buff, strlen(buff))) {
@@ -959,3 +963,127 @@ char *fileName;
         *retCode = MCCIR_NO_URL_FOR_FILE;
     }
 }
+
+void MCCIRequestTimeline(retCode, retText, retData, retDataLength)
+/* hand back the load timelines the current window keeps, as JSON;
+ * retData is malloc'd, caller frees */
+int *retCode;
+char *retText;
+char **retData;
+int *retDataLength;
+{
+    *retDataLength = 0;
+
+    if (!current_win) {
+        *retCode = MCCIR_REQ_FAILED;
+        strcpy(retText, "No current window");
+        return;
+    }
+
+    *retData = mo_timeline_json(current_win);
+    *retDataLength = strlen(*retData);
+    *retCode = MCCIR_TIMELINE;
+    strcpy(retText, "Load timelines follow");
+}
+
+void MCCIRequestPrefetch(retCode, retText, url, scan, found, numFound)
+/* fetch url without displaying it; images land in the image cache.
+ * if scan is set and url turns out to be HTML, the canonical SRC of each
+ * inline image is handed back in found (malloc'd, caller frees) so it
+ * can be prefetched as well. */
+int *retCode;
+char *retText;                  /* must be less MCCI_MAX_RETURN_TEXT */
+char *url;
+int scan;
+char ***found;
+int *numFound;
+{
+    extern int interrupted;
+    extern ImageInfo *ImageResolve();
+    extern char *ParseMarkTag();
+    char *curl, *fnam, *hack, *buf, *s, *gt, *src;
+    struct stat st;
+    FILE *fp;
+    int len, size;
+
+    *found = NULL;
+    *numFound = 0;
+
+#ifndef DISABLE_TRACE
+    if (cciTrace) {
+        fprintf(stderr, "MCCIRequestPrefetch(url=\"%s\",scan=%d)\n", url, scan);
+    }
+#endif
+
+    if (!get_pref_int(eLOAD_LOCAL_FILE))
+        if (!my_strncasecmp(url, "file:", 5)) {
+            *retCode = MCCIR_GET_FAILED;
+            strcpy(retText, " Can't get local file (for CCI security reasons)");
+            return;
+        }
+
+    curl = mo_url_canonicalize(url, "");
+    if (mo_fetch_cached_image_data(curl)) {
+        *retCode = MCCIR_PREFETCH_URL;
+        sprintf(retText, "<%.900s> CACHED", url);
+        free(curl);
+        return;
+    }
+
+    fnam = mo_spoolnam(curl);
+    interrupted = 0;
+    if (!mo_pull_er_over_virgin(curl, fnam)) {
+        *retCode = MCCIR_GET_FAILED;
+        sprintf(retText, "Couldn't get URL %.900s", url);
+        mo_spool_release(fnam);
+        free(fnam);
+        free(curl);
+        return;
+    }
+
+    /* pick the inline images out of an HTML page before the file goes */
+    if (scan && !stat(fnam, &st) && (st.st_size > 0) && (fp = fopen(fnam, "r"))) {
+        len = (st.st_size > (1 << 20) ? (1 << 20) : st.st_size);
+        buf = (char *)malloc(len + 1);
+        len = fread(buf, 1, len, fp);
+        buf[len] = '\0';
+        fclose(fp);
+
+        size = 0;
+        for (s = buf; (s = strchr(s, '<')); s++) {
+            if (my_strncasecmp(s + 1, "img", 3) || !isspace(s[4]))
+                continue;
+            if (!(gt = strchr(s, '>')))
+                break;
+            *gt = '\0';
+            if ((src = ParseMarkTag(s + 1, "img", "src"))) {
+                if (*numFound == size) {
+                    size = (size ? size * 2 : 16);
+                    *found = (char **)realloc(*found, size * sizeof(char *));
+                }
+                (*found)[(*numFound)++] = mo_url_canonicalize(src, curl);
+                free(src);
+            }
+            *gt = '>';
+        }
+        free(buf);
+    }
+
+    /* Cache Load Hack: ImageResolve decodes and caches it, then
+       removes the file whether or not it was an image.  There is no
+       cache for documents, so one was fetched only to be thrown away
+       (and to find its images). */
+    hack = (char *)malloc(strlen(fnam) + strlen(curl) + 2);
+    sprintf(hack, "%s\n%s", fnam, curl);
+    if (ImageResolve(NULL, hack, 0, NULL, NULL)) {
+        *retCode = MCCIR_PREFETCH_URL;
+        sprintf(retText, "<%.900s> IMAGE", url);
+    } else {
+        *retCode = MCCIR_PREFETCH_NOCACHE;
+        sprintf(retText, "<%.900s> DOCUMENT", url);
+    }
+
+    free(hack);
+    free(fnam);
+    free(curl);
+}
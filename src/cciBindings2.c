@@ -70,12 +70,12 @@
 static Boolean cciAccepting = 0;
 static int listenPortNumber = 0;
 static XtInputId connectInputID;
+static XtWorkProcId queuedRequestsID = 0;
 static List listOfConnections;
 static List listOfSendOutput;
 static List listOfSendAnchorTo; /* client in list if should receive     */
 static List listOfSendBrowserView;
 static List listOfSendEvent;
-static List listOfFileToURLs;
 static List listOfForm;         /* list of form submitted by application */
 
 /* ADC ugly hack below  ZZZZZ */
@@ -105,8 +105,20 @@ struct SendWhatToWhom {
 struct FileURL {
     char *fileName;
     char *url;
+    struct FileURL *next;       /* in its hash chain */
+    int slot;                   /* in fileURLAge */
 };
 
+/* Every temporary file and spool is recorded here, so the table is
+   bounded: once FILEURL_MAX names are held the oldest goes to make
+   room, by which time its file is long gone. */
+#define FILEURL_HASH 127
+#define FILEURL_MAX 512
+static struct FileURL *fileURLTable[FILEURL_HASH];
+static struct FileURL *fileURLAge[FILEURL_MAX];
+static int fileURLNext = 0;
+static struct FileURL *lastFileURL = NULL;
+
 struct FormSubmit {
     MCCIPort client;
     char *actionID;
@@ -418,7 +430,6 @@ int MoCCIPreInitialize()
     listOfSendAnchorTo = ListCreate();
     listOfSendBrowserView = ListCreate();
     listOfSendEvent = ListCreate();
-    listOfFileToURLs = ListCreate();
     listOfForm = ListCreate();
 
 }
@@ -462,6 +473,7 @@ int MoCCITerminateAllConnections()
     con = (struct Connection *)ListHead(listOfConnections);
     while (con) {
         XtRemoveInput(con->inputId);
+        MCCIDropJobs(con->client);
         NetCloseConnection(con->client);
         MoCCISendAnchor(con->client, 0);
         MoCCISendBrowserView(con->client, 0);
@@ -520,12 +532,32 @@ MCCIPort client;
     }
 }
 
+static Boolean MoCCIRunQueuedRequests(client_data)
+XtPointer client_data;
+/* work procedure: run one queued CCI request each time the event loop
+   goes idle, so that input from every client is read in between */
+/* a queued load runs an event loop of its own, in which there is
+   nothing more to run until it is done; so this always takes itself
+   off, and the call that ran the job puts it back afterwards */
+{
+    queuedRequestsID = 0;
+    if (MCCIRunNextJob() && !queuedRequestsID && MCCIJobsPending()) {
+        queuedRequestsID = XtAppAddWorkProc(app_context, (XtWorkProc) MoCCIRunQueuedRequests, NULL);
+    }
+    return (True);
+}
+
 void MoCCIHandleInput(client, source)
 MCCIPort client;
 int source;
 {
     if (MCCIIsThereInput(client)) {
-        MCCIHandleInput(client);
+        /* a pipelining client may have sent several lines in one packet */
+        while (MCCIHandleInput(client) && MCCIHasBufferedLine(client));
+
+        if (!queuedRequestsID && MCCIJobsPending()) {
+            queuedRequestsID = XtAppAddWorkProc(app_context, (XtWorkProc) MoCCIRunQueuedRequests, NULL);
+        }
     }
 }
 
@@ -965,20 +997,76 @@ int MoCCIMaxNumberOfConnectionsAllowed()
     return (get_pref_int(eMAX_NUM_OF_CCI_CONNECTIONS));
 }
 
+int MoCCIMaxRequestsInFlight()
+/* return number of tagged requests a client may have queued or running.
+ * if it's zero, then treat it as unlimited.
+ */
+{
+    return (get_pref_int(eMAX_CCI_REQUESTS_IN_FLIGHT));
+}
+
 int MoCCICurrentNumberOfConnections()
 {
     return (ListCount(listOfConnections));
 }
 
+static int HashFileName(fileName, len)
+char *fileName;
+int len;
+{
+    unsigned int h = 0;
+
+    while (len-- > 0)
+        h = h * 31 + (unsigned char)*fileName++;
+    return (h % FILEURL_HASH);
+}
+
+static struct FileURL *FindFileURL(fileName, len)
+/* the entry for exactly the first len characters of fileName */
+char *fileName;
+int len;
+{
+    struct FileURL *fileURL;
+
+    fileURL = fileURLTable[HashFileName(fileName, len)];
+    while (fileURL) {
+        if (!strncmp(fileURL->fileName, fileName, len) &&
+            !fileURL->fileName[len]) {
+            return (fileURL);
+        }
+        fileURL = fileURL->next;
+    }
+    return (NULL);
+}
+
+static void DropFileURL(fileURL)
+struct FileURL *fileURL;
+{
+    struct FileURL **prev;
+
+    prev = &fileURLTable[HashFileName(fileURL->fileName,
+                                      strlen(fileURL->fileName))];
+    while (*prev != fileURL)
+        prev = &(*prev)->next;
+    *prev = fileURL->next;
+    fileURLAge[fileURL->slot] = NULL;
+    if (lastFileURL == fileURL)
+        lastFileURL = NULL;
+    free(fileURL->fileName);
+    free(fileURL->url);
+    free(fileURL);
+}
+
 void MoCCIAddFileURLToList(fileName, url)
 /* this routine should be called each time a url has been down loaded
    and stored as file.  This routine adds the fileName,url pair to the
-   list for later query over cci by an external viewer (cci app).
+   table for later query over cci by an external viewer (cci app).
 */
 char *fileName;
 char *url;
 {
     struct FileURL *fileURL;
+    int h;
 
 #ifndef DISABLE_TRACE
     if (cciTrace) {
@@ -992,29 +1080,66 @@ char *url;
         return;
     }
 
+    /* a name we have seen before has been reused */
+    if ((fileURL = FindFileURL(fileName, strlen(fileName)))) {
+        DropFileURL(fileURL);
+    }
+    if (fileURLAge[fileURLNext]) {
+        DropFileURL(fileURLAge[fileURLNext]);
+    }
+
     if (!(fileURL = (struct FileURL *)MALLOC(sizeof(struct FileURL)))) {
         /* out of memory, just return */
         return;
     }
     fileURL->fileName = strdup(fileName);
     fileURL->url = strdup(url);
-    ListAddEntry(listOfFileToURLs, fileURL);
+    h = HashFileName(fileName, strlen(fileName));
+    fileURL->next = fileURLTable[h];
+    fileURLTable[h] = fileURL;
+    fileURL->slot = fileURLNext;
+    fileURLAge[fileURLNext] = fileURL;
+    fileURLNext = (fileURLNext + 1) % FILEURL_MAX;
+    lastFileURL = fileURL;
     return;
 }
 
+void MoCCIRemoveFileURLFromList(fileName)
+/* the file has been removed; forget it */
+char *fileName;
+{
+    struct FileURL *fileURL;
+
+    if (fileName && (fileURL = FindFileURL(fileName, strlen(fileName)))) {
+        DropFileURL(fileURL);
+    }
+}
+
 char *MoReturnURLFromFileName(fileName)
-/* given filename, return associated URL in the list */
+/* given filename, return associated URL in the table */
 /* if not found, return NULL */
+/* a viewer may be handed the name with a suffix added (see HTFWriter.c),
+   so failing an exact match the name is tried without each one in turn */
 char *fileName;
 {
     struct FileURL *fileURL;
+    char *base;
+    int len;
 
-    fileURL = (struct FileURL *)ListHead(listOfFileToURLs);
-    while (fileURL) {
-        if (!strncmp(fileURL->fileName, fileName, strlen(fileURL->fileName))) {
+    if (!fileName) {
+        return (NULL);
+    }
+    base = strrchr(fileName, '/');
+    base = (base ? base + 1 : fileName);
+    len = strlen(fileName);
+    while (len > 0) {
+        if ((fileURL = FindFileURL(fileName, len))) {
             return (fileURL->url);
         }
-        fileURL = (struct FileURL *)ListNext(listOfFileToURLs);
+        while (--len > base - fileName && fileName[len] != '.') ;
+        if (len <= base - fileName) {
+            break;
+        }
     }
     return (NULL);
 }
@@ -1027,10 +1152,8 @@ void MoCCIAddAnchorToURL(url, urlAndAnchor)
 char *url;
 char *urlAndAnchor;
 {
-    struct FileURL *fileURL;
-    fileURL = (struct FileURL *)ListTail(listOfFileToURLs);
-    if (fileURL && !strcmp(fileURL->url, url)) {
-        free(fileURL->url);
-        fileURL->url = strdup(urlAndAnchor);
+    if (lastFileURL && !strcmp(lastFileURL->url, url)) {
+        free(lastFileURL->url);
+        lastFileURL->url = strdup(urlAndAnchor);
     }
 }
@@ -99,8 +99,10 @@ void MoCCISendBrowserViewOutput(char *url, char *contentType,
 char *data, int dataLength);
 int MoCCISendBrowserViewFile(char *url, char *contentType, char *filename);
 int MoCCIMaxNumberOfConnectionsAllowed();
+int MoCCIMaxRequestsInFlight();
 int MoCCICurrentNumberOfConnections();
 void MoCCIAddFileURLToList(char *fileName,char *url);
+void MoCCIRemoveFileURLFromList(char *fileName);
 char *MoReturnURLFromFileName(char *fileName);
 void MoCCIAddAnchorToURL(char *url, char *urlAndAnchor);
 
@@ -55,6 +55,7 @@
 #include "mosaic.h"
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <ctype.h>
 
 #include "memStuffForPipSqueeks.h"
 #include "cci.h"
@@ -72,6 +73,49 @@ extern int cciTrace;
 #endif
 
 extern char *GetLine();
+extern int MoCCIMaxRequestsInFlight();
+extern void MCCIRequestPrefetch();
+extern void MCCIRequestTimeline();
+
+/* Pipelined requests.  A request prefixed with "ID <tag>" is answered with
+ * the tag echoed back, so a client may have several outstanding at once.
+ * GET, DISPLAY and POST are the ones that load documents; tagged ones are
+ * queued per client and run one at a time from the event loop, taking
+ * turns between clients.  Untagged requests are answered synchronously,
+ * exactly as before.  PREFETCH, tagged or not, always goes through the
+ * queue and fetches one of its URLs per turn, so a long list never holds
+ * up the other clients. */
+struct MCCIJob {
+    MCCIPort client;
+    char *tag;
+    char *line;                 /* request line, tag stripped */
+    int hasContent;             /* request body was read when queued */
+    char *content;
+    int contentLength;
+    int prefetch;               /* PREFETCH job, see MCCIPrefetchStep() */
+    int inline_images;          /* also fetch the images of each page */
+    char **urls;
+    int numUrls;
+    int sizeUrls;
+    int nextUrl;
+    int numFetched;
+    struct MCCIJob *next;
+};
+
+struct MCCIClientQueue {
+    MCCIPort client;
+    int inFlight;               /* queued + running */
+    struct MCCIJob *head;
+    struct MCCIJob *tail;
+    struct MCCIClientQueue *next;
+};
+
+static struct MCCIClientQueue *jobQueues = NULL;
+static struct MCCIClientQueue *nextQueue = NULL;    /* whose turn it is */
+static struct MCCIJob *runningJob = NULL;
+static struct MCCIJob *replyJob = NULL;     /* queued request being answered */
+
+void MCCIDropJobs();
 
 int MCCIReturnListenPortSocketDescriptor()
 {
@@ -88,6 +132,7 @@ MCCIPort clientPort;
     }
 #endif
 
+    MCCIDropJobs(clientPort);
     MoCCITerminateAConnection(clientPort);
     NetCloseConnection(clientPort);
 
@@ -140,12 +185,56 @@ char *text;                     /* text response (no newline) */
     sprintf(buff, "%d %s\r\n", code, text);
     length = strlen(buff);
     if (length != NetServerWrite(client, buff, length)) {
+        FREE(buff);
         return (MCCI_FAIL);
     }
 
+    FREE(buff);
     return (MCCI_OK);
 }
 
+int MCCISendTaggedResponseLine(client, tag, code, text)
+/* same as MCCISendResponseLine(), but echo the request's ID tag if it had one */
+MCCIPort client;
+char *tag;                      /* NULL for untagged requests */
+int code;
+char *text;
+{
+    int retVal;
+    char *buff;
+
+    if (!tag) {
+        return (MCCISendResponseLine(client, code, text));
+    }
+
+    if (!(buff = (char *)MALLOC(strlen(MCCI_S_ID) + strlen(tag) + strlen(text) + 3))) {
+        return (MCCI_OUTOFMEMORY);
+    }
+    sprintf(buff, "%s %s %s", MCCI_S_ID, tag, text);
+    retVal = MCCISendResponseLine(client, code, buff);
+    FREE(buff);
+
+    return (retVal);
+}
+
+int MCCIHasBufferedLine(client)
+/* return 1 if a complete request line is already sitting in the port
+   buffer, i.e. the client pipelined it behind the one just handled */
+MCCIPort client;
+{
+    int i;
+
+    if (!client) {
+        return (0);
+    }
+    for (i = 0; i < client->numInBuffer - 1; i++) {
+        if ((client->buffer[i] == '\r') && (client->buffer[i + 1] == '\n')) {
+            return (1);
+        }
+    }
+    return (0);
+}
+
 MCCIPort MCCICheckAndAcceptConnection()
 /* return NULL if no connection */
 /* return a MCCIPort if connected */
@@ -200,6 +289,15 @@ char **content;
     char *line;
     int x;
 
+    if (replyJob && replyJob->hasContent && (replyJob->client == client)) {
+        /* the queued request being carried out; its body was read off
+           the socket back then.  A request off the wire in the middle
+           of its load has replyJob NULL and reads its own. */
+        *content = replyJob->content;
+        replyJob->content = (char *)0;
+        replyJob->hasContent = 0;
+        return (replyJob->contentLength);
+    }
 #ifndef DISABLE_TRACE
     if (cciTrace) {
         fprintf(stderr, "MCCIReadContent(): Just entered...about to GetLine()\n");
@@ -985,40 +1083,352 @@ char *retText;
 
 }
 
-int MCCIHandleInput(client)
-/* read input from the client and do something with it */
-/* return 1 on success, 0 on failure or disconnect */
+static int MCCIIsQueuedRequest(line)
+/* return 1 if this request loads a document and so goes through the queue */
+char *line;
+{
+    if (!my_strncasecmp(line, MCCI_S_PREFETCH, strlen(MCCI_S_PREFETCH))) {
+        return (1);
+    }
+    if (!my_strncasecmp(line, MCCI_S_GETANNOTATION, strlen(MCCI_S_GETANNOTATION))) {
+        return (0);
+    }
+    return (!my_strncasecmp(line, MCCI_S_GET, strlen(MCCI_S_GET)) ||
+            !my_strncasecmp(line, MCCI_S_DISPLAY, strlen(MCCI_S_DISPLAY)) ||
+            !my_strncasecmp(line, MCCI_S_POST, strlen(MCCI_S_POST)));
+}
+
+static int MCCIRequestHasContent(line)
+/* return 1 if a Content-Length body follows this request line */
+char *line;
+{
+    char *s, *start, *end;
+
+    if (!my_strncasecmp(line, MCCI_S_DISPLAY, strlen(MCCI_S_DISPLAY)) ||
+        !my_strncasecmp(line, MCCI_S_POST, strlen(MCCI_S_POST)) ||
+        !my_strncasecmp(line, MCCI_S_PREFETCH, strlen(MCCI_S_PREFETCH))) {
+        return (1);
+    }
+
+    /* GET URL <url> [OUTPUT where] [HEADER] */
+    if (!(s = strrchr(line, '>'))) {
+        return (0);
+    }
+    for (GetWordFromString(s + 1, &start, &end); start != end; GetWordFromString(end, &start, &end)) {
+        if (!my_strncasecmp(start, MCCI_S_HEADER, strlen(MCCI_S_HEADER))) {
+            return (1);
+        }
+    }
+    return (0);
+}
+
+static struct MCCIClientQueue *MCCIFindQueue(client, create)
 MCCIPort client;
+int create;
 {
-    int retCode;
+    struct MCCIClientQueue *q;
+
+    for (q = jobQueues; q; q = q->next) {
+        if (q->client == client) {
+            return (q);
+        }
+    }
+    if (!create || !(q = (struct MCCIClientQueue *)MALLOC(sizeof(struct MCCIClientQueue)))) {
+        return (NULL);
+    }
+    q->client = client;
+    q->inFlight = 0;
+    q->head = q->tail = NULL;
+    q->next = jobQueues;
+    jobQueues = q;
+
+    return (q);
+}
+
+static void MCCIFreeJob(job)
+struct MCCIJob *job;
+{
+    int i;
+
+    if (job->content) {
+        FREE(job->content);
+    }
+    for (i = 0; i < job->numUrls; i++) {
+        free(job->urls[i]);
+    }
+    if (job->urls) {
+        free(job->urls);
+    }
+    free(job->tag);
+    free(job->line);
+    FREE(job);
+}
+
+static void MCCIAddPrefetchURL(job, url, len)
+/* append url to a PREFETCH job's list unless it is already on it */
+struct MCCIJob *job;
+char *url;
+int len;
+{
+    int i;
+
+    if (len <= 0) {
+        return;
+    }
+    for (i = 0; i < job->numUrls; i++) {
+        if (!strncmp(job->urls[i], url, len) && !job->urls[i][len]) {
+            return;
+        }
+    }
+    if (job->numUrls == job->sizeUrls) {
+        job->sizeUrls = (job->sizeUrls ? job->sizeUrls * 2 : 16);
+        job->urls = (char **)realloc(job->urls, job->sizeUrls * sizeof(char *));
+    }
+    job->urls[job->numUrls] = (char *)malloc(len + 1);
+    strncpy(job->urls[job->numUrls], url, len);
+    job->urls[job->numUrls][len] = '\0';
+    job->numUrls++;
+}
+
+static void MCCIParsePrefetch(job)
+/* PREFETCH [INLINE]
+ * Content-Length: n
+ *
+ * url or <url>, one per line
+ */
+struct MCCIJob *job;
+{
+    char *s, *end, *start, *stop;
+
+    job->prefetch = 1;
+    GetWordFromString(job->line + strlen(MCCI_S_PREFETCH), &start, &stop);
+    job->inline_images = ((start != stop) && !my_strncasecmp(start, MCCI_S_INLINE, strlen(MCCI_S_INLINE)));
+
+    if (!job->content) {
+        return;
+    }
+    for (s = job->content; s < job->content + job->contentLength; s = end + 1) {
+        if (!(end = memchr(s, '\n', job->content + job->contentLength - s))) {
+            end = job->content + job->contentLength;
+        }
+        for (start = s; (start < end) && (isspace(*start) || (*start == '<')); start++);
+        for (stop = end; (stop > start) && (isspace(stop[-1]) || (stop[-1] == '>')); stop--);
+        MCCIAddPrefetchURL(job, start, stop - start);
+    }
+}
+
+static int MCCIPrefetchStep(job)
+/* fetch the next URL of a PREFETCH job and report on it */
+/* return 1 once the whole list has been answered */
+struct MCCIJob *job;
+{
+    int retCode, i, numFound;
     char retText[MCCI_MAX_RETURN_TEXT];
-    char *blah;
-    char **retData = &blah;
-    int retDataLength = 0;
-    char *line;
+    char **found;
 
-    line = GetLine(client);
+    if (job->nextUrl < job->numUrls) {
+        MCCIRequestPrefetch(&retCode, retText, job->urls[job->nextUrl], job->inline_images, &found, &numFound);
+        job->nextUrl++;
+        if ((retCode == MCCIR_PREFETCH_URL) || (retCode == MCCIR_PREFETCH_NOCACHE)) {
+            job->numFetched++;
+        }
+        if (job->client) {
+            MCCISendTaggedResponseLine(job->client, job->tag, retCode, retText);
+        }
+        for (i = 0; i < numFound; i++) {
+            MCCIAddPrefetchURL(job, found[i], strlen(found[i]));
+            free(found[i]);
+        }
+        if (found) {
+            free(found);
+        }
+    }
+
+    if (job->nextUrl < job->numUrls) {
+        return (0);
+    }
+
+    if (job->client) {
+        sprintf(retText, "PREFETCH done, %d of %d fetched", job->numFetched, job->numUrls);
+        MCCISendTaggedResponseLine(job->client, job->tag, MCCIR_PREFETCH_OK, retText);
+    }
+    return (1);
+}
+
+static int MCCIQueueJob(client, tag, line)
+/* queue a tagged request or a PREFETCH; the tag now belongs to the queue */
+/* return 1, the connection stays up either way */
+MCCIPort client;
+char *tag;
+char *line;
+{
+    struct MCCIClientQueue *q;
+    struct MCCIJob *job;
+    struct MCCIJob *outer = replyJob;
+    char *garbage;
+    int max;
+
+    /* any body is this request's, off the wire, not that of a queued
+       request whose load we may be in the middle of */
+    replyJob = NULL;
+
+    max = MoCCIMaxRequestsInFlight();
+    q = MCCIFindQueue(client, 1);
+    if (!q || ((max > 0) && (q->inFlight >= max)) ||
+        !(job = (struct MCCIJob *)MALLOC(sizeof(struct MCCIJob)))) {
+        /* still have to swallow the body to stay in step with the client */
+        if (MCCIRequestHasContent(line) && (MCCIReadContent(client, &garbage) > 0)) {
+            FREE(garbage);
+        }
+        MCCISendTaggedResponseLine(client, tag, MCCIR_TOO_MANY_REQUESTS, "Too many requests in flight");
+        free(tag);
+        replyJob = outer;
+        return (1);
+    }
+
+    job->client = client;
+    job->tag = tag;
+    job->line = strdup(line);
+    job->hasContent = 0;
+    job->content = (char *)0;
+    job->contentLength = 0;
+    job->prefetch = 0;
+    job->inline_images = 0;
+    job->urls = NULL;
+    job->numUrls = job->sizeUrls = 0;
+    job->nextUrl = job->numFetched = 0;
+    job->next = NULL;
+
+    /* the body has to come off the socket now, ahead of the next request */
+    if (MCCIRequestHasContent(job->line)) {
+        job->contentLength = MCCIReadContent(client, &job->content);
+        job->hasContent = 1;
+    }
+    replyJob = outer;
+    if (!my_strncasecmp(job->line, MCCI_S_PREFETCH, strlen(MCCI_S_PREFETCH))) {
+        MCCIParsePrefetch(job);
+    }
+
+    if (q->tail) {
+        q->tail->next = job;
+    } else {
+        q->head = job;
+    }
+    q->tail = job;
+    q->inFlight++;
 
 #ifndef DISABLE_TRACE
     if (cciTrace) {
-        if (line)
-            fprintf(stderr, "Server Read: %s\n", line);
-        else
-            fprintf(stderr, "Server Read: NULL line\n");
+        fprintf(stderr, "MCCIQueueJob(): queued [%s] %s, %d in flight\n", tag ? tag : "", job->line, q->inFlight);
     }
 #endif
 
-    if (!line) {
-        /* error or disconnect */
-        MCCICloseConnection(client);
-        return (0);
+    return (1);
+}
+
+int MCCIJobsPending()
+/* return 1 if any queued request is waiting to run */
+{
+    struct MCCIClientQueue *q;
+
+    for (q = jobQueues; q; q = q->next) {
+        if (q->head) {
+            return (1);
+        }
+    }
+    return (0);
+}
+
+void MCCIDropJobs(client)
+/* forget everything queued for a client that has gone away */
+MCCIPort client;
+{
+    struct MCCIClientQueue *q, *prev;
+    struct MCCIJob *job;
+
+    if (runningJob && (runningJob->client == client)) {
+        runningJob->client = NULL;
+    }
+
+    prev = NULL;
+    for (q = jobQueues; q && (q->client != client); q = q->next) {
+        prev = q;
+    }
+    if (!q) {
+        return;
+    }
+
+    while ((job = q->head)) {
+        q->head = job->next;
+        MCCIFreeJob(job);
     }
 
+    if (prev) {
+        prev->next = q->next;
+    } else {
+        jobQueues = q->next;
+    }
+    if (nextQueue == q) {
+        nextQueue = q->next;
+    }
+    FREE(q);
+}
+
+static int MCCISendContent(client, contentType, data, dataLength)
+/* send data with the Content-Type and Content-Length lines before it */
+MCCIPort client;
+char *contentType;
+char *data;
+int dataLength;
+{
+    char buff[1024];
+    int length;
+
+    sprintf(buff, "Content-Type: %s\r\n", contentType);
+    length = strlen(buff);
+    if (length != NetServerWrite(client, buff, length)) {
+        return (MCCI_FAIL);
+    }
+
+    sprintf(buff, "Content-Length: %d \r\n", dataLength);
+    length = strlen(buff);
+    if (length != NetServerWrite(client, buff, length)) {
+        return (MCCI_FAIL);
+    }
+
+    if (dataLength != NetServerWrite(client, data, dataLength)) {
+        return (MCCI_FAIL);
+    }
+
+    return (MCCI_OK);
+}
+
+MCCIPort MCCIReplyPort(client)
+/* the port to answer a request from client on, once its load is done */
+/* return NULL if it was a queued request and the client has gone away */
+MCCIPort client;
+{
+    return (replyJob ? replyJob->client : client);
+}
+
+static int MCCIDispatchLine(client, tag, line)
+/* parse and carry out one request line, answering with tag if given */
+/* return 1 on success, 0 on failure or disconnect */
+MCCIPort client;
+char *tag;
+char *line;
+{
+    int retCode;
+    char retText[MCCI_MAX_RETURN_TEXT];
+    char *blah;
+    char **retData = &blah;
+    int retDataLength = 0;
+
     /* parse the request */
     /* to save speed & memory this parse is destructive to the text in 'line' */
 
     if (!my_strncasecmp(line, MCCI_S_DISCONNECT, strlen(MCCI_S_DISCONNECT))) {
-        MCCISendResponseLine(client, MCCIR_DISCONNECT_OK, "DISCONNECT request received");
+        MCCISendTaggedResponseLine(client, tag, MCCIR_DISCONNECT_OK, "DISCONNECT request received");
         return (0);
     }
 /* This has to go ahead of the simple get or else it gets snagged */
@@ -1036,7 +1446,7 @@ MCCIPort client;
 		retCode = MCCIHandleGetAnnotation(client,line,retText,&retData,
 				&retDataLength);
 */
-        MCCISendResponseLine(client, retCode, retText);
+        MCCISendTaggedResponseLine(client, tag, retCode, retText);
         if (retDataLength != NetServerWrite(client, *retData, retDataLength)) {
             return (MCCI_FAIL);
         }
@@ -1051,45 +1461,198 @@ MCCIPort client;
 
     } else if (!my_strncasecmp(line, MCCI_S_GET, strlen(MCCI_S_GET))) {
         retCode = MCCIHandleGet(client, line, retText);
-        MCCISendResponseLine(client, retCode, retText);
+        if (!(client = MCCIReplyPort(client))) {
+            return (0);
+        }
+        MCCISendTaggedResponseLine(client, tag, retCode, retText);
     }
 
     else if (!my_strncasecmp(line, MCCI_S_DOCOMMAND, strlen(MCCI_S_DOCOMMAND))) {
         retCode = MCCIHandleDoCommand(client, line, retText);
-        MCCISendResponseLine(client, retCode, retText);
+        MCCISendTaggedResponseLine(client, tag, retCode, retText);
     }
 
     else if (!my_strncasecmp(line, MCCI_S_DISPLAY, strlen(MCCI_S_DISPLAY))) {
         retCode = MCCIHandleDisplay(client, line, retText);
-        MCCISendResponseLine(client, retCode, "DISPLAY request received by Mosaic");
+        if (!(client = MCCIReplyPort(client))) {
+            return (0);
+        }
+        MCCISendTaggedResponseLine(client, tag, retCode, "DISPLAY request received by Mosaic");
     } else if (!my_strncasecmp(line, MCCI_S_FORM, strlen(MCCI_S_FORM))) {
         retCode = MCCIHandleForm(client, line, retText);
-        MCCISendResponseLine(client, MCCIR_FORM_OK, "FORM request received by Mosaic");
+        MCCISendTaggedResponseLine(client, tag, MCCIR_FORM_OK, "FORM request received by Mosaic");
     } else if (!my_strncasecmp(line, MCCI_S_QUIT, strlen(MCCI_S_QUIT))) {
-        MCCISendResponseLine(client, MCCIR_QUIT_OK, "QUIT request received exiting...");
+        MCCISendTaggedResponseLine(client, tag, MCCIR_QUIT_OK, "QUIT request received exiting...");
         MCCIRequestQuit();
     } else if (!my_strncasecmp(line, MCCI_S_SEND, strlen(MCCI_S_SEND))) {
         retCode = MCCIHandleSend(client, line, retText);
-        MCCISendResponseLine(client, retCode, retText);
+        MCCISendTaggedResponseLine(client, tag, retCode, retText);
     } else if (!my_strncasecmp(line, MCCI_S_POST, strlen(MCCI_S_POST))) {
         retCode = MCCIHandlePost(client, line, retText);
-        MCCISendResponseLine(client, retCode, retText);
+        if (!(client = MCCIReplyPort(client))) {
+            return (0);
+        }
+        MCCISendTaggedResponseLine(client, tag, retCode, retText);
     } else if (!my_strncasecmp(line, MCCI_S_PUTANNOTATION, strlen(MCCI_S_PUTANNOTATION))) {
         retCode = MCCIHandlePutAnnotation(client, line, retText);
-        MCCISendResponseLine(client, retCode, retText);
+        MCCISendTaggedResponseLine(client, tag, retCode, retText);
     } else if (!my_strncasecmp(line, MCCI_S_FILE_TO_URL, strlen(MCCI_S_FILE_TO_URL))) {
         retCode = MCCIHandleFileToURL(client, line, retText);
-        MCCISendResponseLine(client, retCode, retText);
+        MCCISendTaggedResponseLine(client, tag, retCode, retText);
+    } else if (!my_strncasecmp(line, MCCI_S_TIMELINE, strlen(MCCI_S_TIMELINE))) {
+        MCCIRequestTimeline(&retCode, retText, retData, &retDataLength);
+        MCCISendTaggedResponseLine(client, tag, retCode, retText);
+        if (retDataLength > 0) {
+            retCode = MCCISendContent(client, "application/json", *retData, retDataLength);
+            free(*retData);
+            if (retCode != MCCI_OK) {
+                return (0);
+            }
+        }
     } else {
         /* 
            MCCIRRequestUnrecognized();
          */
-        MCCISendResponseLine(client, MCCIR_UNRECOGNIZED, "Command not recognized");
+        MCCISendTaggedResponseLine(client, tag, MCCIR_UNRECOGNIZED, "Command not recognized");
     }
 
     return (1);
 }
 
+static int MCCIDispatchRequest(job, client, tag, line)
+/* carry out a request, queued as job or, if job is NULL, straight off the wire */
+/* return 1 on success, 0 on failure or disconnect */
+struct MCCIJob *job;
+MCCIPort client;
+char *tag;
+char *line;
+{
+    struct MCCIJob *outer = replyJob;
+    int retVal;
+
+    /* a request off the wire can be answered in the middle of a queued load */
+    replyJob = job;
+    retVal = MCCIDispatchLine(client, tag, line);
+    replyJob = outer;
+
+    return (retVal);
+}
+
+int MCCIRunNextJob()
+/* run one queued request, taking clients in turn */
+/* return 1 if a request was run, 0 if there was nothing to do */
+{
+    struct MCCIClientQueue *q, *start;
+    struct MCCIJob *job;
+
+    if (runningJob || !jobQueues) {
+        return (0);
+    }
+
+    if (!nextQueue) {
+        nextQueue = jobQueues;
+    }
+    q = start = nextQueue;
+    while (!q->head) {
+        q = (q->next ? q->next : jobQueues);
+        if (q == start) {
+            return (0);
+        }
+    }
+
+    job = q->head;
+    if (!(q->head = job->next)) {
+        q->tail = NULL;
+    }
+    nextQueue = (q->next ? q->next : jobQueues);
+
+#ifndef DISABLE_TRACE
+    if (cciTrace) {
+        fprintf(stderr, "MCCIRunNextJob(): running [%s] %s\n", job->tag ? job->tag : "", job->line);
+    }
+#endif
+
+    runningJob = job;
+    if (job->prefetch) {
+        if (!MCCIPrefetchStep(job) && job->client && (q = MCCIFindQueue(job->client, 0))) {
+            /* more to fetch; back to the front of the line for its next turn */
+            if (!(job->next = q->head)) {
+                q->tail = job;
+            }
+            q->head = job;
+            runningJob = NULL;
+            return (1);
+        }
+    } else {
+        MCCIDispatchRequest(job, job->client, job->tag, job->line);
+    }
+    runningJob = NULL;
+
+    /* the client may have been dropped while we were loading */
+    if (job->client && (q = MCCIFindQueue(job->client, 0))) {
+        q->inFlight--;
+    }
+    MCCIFreeJob(job);
+
+    return (1);
+}
+
+int MCCIHandleInput(client)
+/* read input from the client and do something with it */
+/* return 1 on success, 0 on failure or disconnect */
+MCCIPort client;
+{
+    int retVal;
+    char *line;
+    char *tag, *end;
+
+    line = GetLine(client);
+
+#ifndef DISABLE_TRACE
+    if (cciTrace) {
+        if (line)
+            fprintf(stderr, "Server Read: %s\n", line);
+        else
+            fprintf(stderr, "Server Read: NULL line\n");
+    }
+#endif
+
+    if (!line) {
+        /* error or disconnect */
+        MCCICloseConnection(client);
+        return (0);
+    }
+
+    /* ID <tag> <request> */
+    if (!my_strncasecmp(line, MCCI_S_ID, strlen(MCCI_S_ID)) && isspace(line[strlen(MCCI_S_ID)])) {
+        GetWordFromString(line + strlen(MCCI_S_ID), &tag, &end);
+        if (tag == end) {
+            MCCISendResponseLine(client, MCCIR_ERROR, "ID needs a tag");
+            return (1);
+        }
+        line = end;
+        if (*line) {
+            *line++ = '\0';
+        }
+        while (*line && isspace(*line)) {
+            line++;
+        }
+        tag = strdup(tag);
+
+        if (MCCIIsQueuedRequest(line)) {
+            return (MCCIQueueJob(client, tag, line));
+        }
+        retVal = MCCIDispatchRequest(NULL, client, tag, line);
+        free(tag);
+        return (retVal);
+    }
+
+    if (!my_strncasecmp(line, MCCI_S_PREFETCH, strlen(MCCI_S_PREFETCH))) {
+        return (MCCIQueueJob(client, (char *)0, line));
+    }
+    return (MCCIDispatchRequest(NULL, client, (char *)0, line));
+}
+
 MCCISendAnchorHistory(client, url)
 MCCIPort client;
 char *url;
@@ -1208,30 +1771,11 @@ char *contentType;
 char *data;
 int dataLength;
 {
-    char buff[1024];
-    int length;
-
     if (MCCI_OK != MCCISendResponseLine(client, MCCIR_SEND_BROWSERVIEW, url)) {
         return (MCCI_FAIL);
     }
 
-    sprintf(buff, "Content-Type: %s\r\n", contentType);
-    length = strlen(buff);
-    if (length != NetServerWrite(client, buff, length)) {
-        return (MCCI_FAIL);
-    }
-
-    sprintf(buff, "Content-Length: %d \r\n", dataLength);
-    length = strlen(buff);
-    if (length != NetServerWrite(client, buff, length)) {
-        return (MCCI_FAIL);
-    }
-
-    if (dataLength != NetServerWrite(client, data, dataLength)) {
-        return (MCCI_FAIL);
-    }
-
-    return (MCCI_OK);
+    return (MCCISendContent(client, contentType, data, dataLength));
 
 }
 
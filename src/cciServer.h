@@ -8,6 +8,12 @@ extern MCCIPort MCCICheckAndAcceptConnection();
 extern int MCCISendResponseLine();
 extern int MCCIIsThereInput();
 extern int MCCIReadInputMessage();
+extern int MCCISendTaggedResponseLine();
+extern int MCCIHasBufferedLine();
+extern int MCCIJobsPending();
+extern int MCCIRunNextJob();
+extern void MCCIDropJobs();
+extern MCCIPort MCCIReplyPort();
 
 typedef struct {
 	MCCIPort client;
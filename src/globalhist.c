@@ -59,11 +59,18 @@
 #include <time.h>
 #include "../libnut/system.h"
 #include "compat.h"
+#include "child.h"
+#include "../libwww2/HTParse.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 /*for memset*/
 #include <memory.h>
 
 extern char *cached_url;
+extern int ftruncate();         /* Not in POSIX.2 <unistd.h> */
 
 #ifndef DISABLE_TRACE
 extern int srcTrace;
@@ -103,6 +110,12 @@ extern int cacheTrace;
 					    at last access]
    [1-line sequence for single document repeated as necessary]
    ...
+
+--Sorted--
+   Format 2, with "Global sorted" for the title and the lines in
+   strcmp order of url.  Older versions read it as plain format 2.
+   Visits since it was written are in a journal beside it, in the
+   same one-line form; see HISTORY ON DISK below.
 */
 
 #define NCSA_HISTORY_FORMAT_COOKIE_ONE "ncsa-mosaic-history-format-1"
@@ -148,7 +161,14 @@ static int hash_url(char *url);
 static void dump_bucket_counts(void);
 static void add_url_to_bucket(int buck, char *url, char *lastdate);
 static int been_here_before(char *url);
+static void mo_flush_visited_anchors(void);
+static void mo_mark_visited_anchors(char *url);
 static void mo_read_global_history(char *filename);
+static void mo_read_history_journal(char *filename);
+static entry *lookup_entry(char *url);
+static void touch_entry(entry *l);
+static int history_visited(char *url);
+static void journal_visit(char *url, char *ts);
 static mo_status mo_dump_cached_cd_array(void);
 static mo_status mo_init_cached_cd_array(void);
 static mo_status mo_grow_cached_cd_array(void);
@@ -162,11 +182,14 @@ static int access_counter = 0;
 static int dont_nuke_after_me = 0;
 static int kbytes_cached = 0;
 
+/* Rdata.urlExpired in seconds, looked up once at setup. */
+static long history_expiry = 0;
+
 /*given a character string of time, is this older than Rdata.urlExpired?*/
 static int notExpired(char *lastdate)
 {
 
-    long expired = get_pref_int(eURLEXPIRED) * 86400;
+    long expired = history_expiry;
     time_t curtime = time(NULL);
 
     if (expired <= 0) {
@@ -250,34 +273,53 @@ static void add_url_to_bucket(int buck, char *url, char *lastdate)
     }
 
     bkt->count += 1;
+
+    mo_mark_visited_anchors(url);
 }
 
-/* This is the internal predicate that takes a URL, hashes it,
-   does a search through the appropriate bucket, and either returns
-   1 or 0 depending on whether we've been there. */
-static int been_here_before(char *url)
+/* The hash table entry for url, if there is one. */
+static entry *lookup_entry(char *url)
 {
     int hash = hash_url(url);
     entry *l;
+
+    if (hash_table[hash].count)
+        for (l = hash_table[hash].head; l != NULL; l = l->next)
+            if (!strcmp(l->url, url))
+                return l;
+
+    return NULL;
+}
+
+/* Asking about an entry counts as seeing it: update its date. */
+static void touch_entry(entry *l)
+{
     time_t foo = time(NULL);
     char ts[30];
 
-    if (hash_table[hash].count)
-        for (l = hash_table[hash].head; l != NULL; l = l->next) {
-            if (!strcmp(l->url, url)) {
-                /*we need to update the date -- SWP */
-                sprintf(ts, "%ld", foo);
+    /*we need to update the date -- SWP */
+    sprintf(ts, "%ld", foo);
 
-                if (l->lastdate) {
-                    free(l->lastdate);
-                }
-                l->lastdate = strdup(ts);
+    if (l->lastdate) {
+        free(l->lastdate);
+    }
+    l->lastdate = strdup(ts);
+}
 
-                return 1;
-            }
-        }
+/* This is the internal predicate that takes a URL, hashes it,
+   does a search through the appropriate bucket, and either returns
+   1 or 0 depending on whether we've been there.  URLs not in the
+   hash table are looked up in the history file. */
+static int been_here_before(char *url)
+{
+    entry *l;
 
-    return 0;
+    if ((l = lookup_entry(url)) != NULL) {
+        touch_entry(l);
+        return 1;
+    }
+
+    return history_visited(url);
 }
 
 /* ------------------------------------------------------------------------ */
@@ -297,7 +339,8 @@ static int been_here_before(char *url)
  ****************************************************************************/
 mo_status mo_been_here_before_huh_dad(char *url)
 {
-    char *curl = mo_url_canonicalize(url, "");
+    char buf[MO_URL_BUF];
+    char *curl = mo_url_canonicalize_into(url, "", buf, MO_URL_BUF);
     mo_status status;
 
     if (been_here_before(curl))
@@ -305,7 +348,8 @@ mo_status mo_been_here_before_huh_dad(char *url)
     else
         status = mo_fail;
 
-    free(curl);
+    if (curl != buf)
+        free(curl);
     return status;
 }
 
@@ -334,14 +378,160 @@ mo_status mo_here_we_are_son(char *url)
   ts[strlen(ts)-1] = '\0';
 */
 
-    if (!been_here_before(curl))
+    /* A URL only in the history file goes into the hash table as
+       well, or the next compaction would keep the file's old date. */
+    if (!been_here_before(curl) || !lookup_entry(curl))
         add_url_to_bucket(hash_url(curl), curl, ts);
+    journal_visit(curl, ts);
 
     free(curl);
 
     return mo_succeed;
 }
 
+/* ------------------------------------------------------------------------ */
+/* ---------------------------- VISITED ANCHORS --------------------------- */
+/* ------------------------------------------------------------------------ */
+
+/* The HTML widget asks about every anchor each time a document is
+   formatted or its anchors are recoloured, and each question costs
+   two mo_url_canonicalize calls.  Here we remember, for the document
+   base in use, what each href resolved to and whether it was visited.
+   The table is dropped when the base changes or it gets too big;
+   add_url_to_bucket marks the entries that match a URL as it goes
+   into the history, and wiping the history drops the table. */
+
+#define VISITED_TABLE_SIZE 509
+#define VISITED_MAX_ENTRIES 8192
+
+typedef struct visited_anchor {
+    /* href as it appears in the document */
+    char *href;
+    /* the same, canonicalized as history entries are */
+    char *curl;
+    int visited;
+    struct visited_anchor *next;
+} visited_anchor;
+
+static visited_anchor *visited_table[VISITED_TABLE_SIZE];
+static char *visited_base = NULL;
+/* visited_base, taken apart once for all the hrefs resolved against it */
+static HTURLParts visited_base_parts;
+static int visited_count = 0;
+
+static int hash_href(char *href)
+{
+    unsigned int val = 0;
+
+    while (*href)
+        val = val * 31 + (unsigned char)*href++;
+
+    return val % VISITED_TABLE_SIZE;
+}
+
+static void mo_flush_visited_anchors(void)
+{
+    visited_anchor *v, *next;
+    int i;
+
+    for (i = 0; i < VISITED_TABLE_SIZE; i++) {
+        for (v = visited_table[i]; v != NULL; v = next) {
+            next = v->next;
+            free(v->href);
+            free(v->curl);
+            free(v);
+        }
+        visited_table[i] = NULL;
+    }
+    visited_count = 0;
+}
+
+/* url has just gone into the history; anchors that resolve to it
+   are now visited. */
+static void mo_mark_visited_anchors(char *url)
+{
+    visited_anchor *v;
+    int i;
+
+    if (!visited_count)
+        return;
+
+    for (i = 0; i < VISITED_TABLE_SIZE; i++)
+        for (v = visited_table[i]; v != NULL; v = v->next)
+            if (!v->visited && !strcmp(v->curl, url))
+                v->visited = 1;
+}
+
+/****************************************************************************
+ * name:    mo_anchor_visited_huh
+ * purpose: Predicate to determine if an anchor in a document points
+ *          somewhere we've visited before.
+ * inputs:  
+ *   - char *href: The anchor's href, as it appears in the document.
+ *   - char *base: URL of the document it appears in.
+ * returns: 
+ *   mo_succeed if we've been there before; mo_fail otherwise
+ * remarks: 
+ *   Same answer as canonicalizing href against base and passing it
+ *   to mo_been_here_before_huh_dad, but each distinct href is only
+ *   canonicalized once per document, against a base that is taken
+ *   apart only when it changes.
+ ****************************************************************************/
+mo_status mo_anchor_visited_huh(char *href, char *base)
+{
+    visited_anchor *v;
+    HTURLParts parts;
+    char buf[MO_URL_BUF];
+    char *url;
+    entry *l;
+    int hash;
+
+    if (!base)
+        base = "";
+    if (!visited_base || strcmp(visited_base, base)) {
+        mo_flush_visited_anchors();
+        if (visited_base)
+            free(visited_base);
+        visited_base = strdup(base);
+        HTParseParts(visited_base, &visited_base_parts);
+    }
+
+    hash = hash_href(href);
+    for (v = visited_table[hash]; v != NULL; v = v->next)
+        if (!strcmp(v->href, href)) {
+            /* As been_here_before would have */
+            if (v->visited && (l = lookup_entry(v->curl)) != NULL)
+                touch_entry(l);
+            return v->visited ? mo_succeed : mo_fail;
+        }
+
+    if (visited_count >= VISITED_MAX_ENTRIES)
+        mo_flush_visited_anchors();
+
+    v = (visited_anchor *) malloc(sizeof(visited_anchor));
+    HTParseParts(href, &parts);
+    url = buf;
+    if (HTParseInto(&parts, &visited_base_parts, PARSE_ACCESS | PARSE_HOST | PARSE_PATH | PARSE_PUNCTUATION,
+                    buf, MO_URL_BUF) < 0)
+        url = mo_url_canonicalize(href, base);
+    v->curl = mo_url_canonicalize(url, "");
+    if (url != buf)
+        free(url);
+    v->href = strdup(href);
+    v->visited = been_here_before(v->curl);
+    v->next = visited_table[hash];
+    visited_table[hash] = v;
+    visited_count++;
+
+#ifndef DISABLE_TRACE
+    if (srcTrace)
+        fprintf(stderr, "[mo_anchor_visited_huh] '%s' -> '%s' (%s)\n",
+                href, v->curl, v->visited ? "visited" : "not visited");
+#endif
+
+    return v->visited ? mo_succeed : mo_fail;
+}
+
 /****************************************************************************
  * name:    mo_read_global_history (PRIVATE)
  * purpose: Given a filename, read the file's contents into the
@@ -427,6 +617,413 @@ static void mo_read_global_history(char *filename)
     return;
 }
 
+/* ------------------------------------------------------------------------ */
+/* ---------------------------- HISTORY ON DISK --------------------------- */
+/* ------------------------------------------------------------------------ */
+
+/* The history file is kept sorted and read into memory, and a URL
+   that is not in the hash table is looked for there by binary search,
+   so startup no longer reads every line into the table.  Each visit
+   is appended to the journal (history_fname.journal) as it happens
+   and goes into the hash table, which so holds only what was visited
+   since the file was last written, and exit has nothing to write.
+
+   Every HISTORY_JOURNAL_MAX visits a child process merges the file
+   and the hash table into a new sorted file, dropping expired URLs
+   on the way, and renames it into place.  Just before the fork the
+   journal is moved to history_fname.journal.old, which the child
+   removes when it is done; if it never gets that far, the next
+   startup reads both journals. */
+
+#define HISTORY_SORTED_TITLE "Global sorted"
+#define HISTORY_JOURNAL_MAX 2000
+
+static char *history_fname = NULL;
+static char *journal_fname = NULL;
+static char *journal_old_fname = NULL;
+
+static char *history_data = NULL;       /* The history file, read in */
+static size_t history_size = 0;
+static char *history_urls = NULL;       /* Its first url line */
+static char *history_end = NULL;
+
+static int journal_fd = -1;
+static int journal_entries = 0;
+
+static pid_t compact_pid = 0;
+static volatile int compact_done = 0;
+
+static void history_free(void)
+{
+    if (history_data)
+        free(history_data);
+    history_data = history_urls = history_end = NULL;
+    history_size = 0;
+}
+
+/* Read the history file in, if it is there and sorted.  Returns 1 if
+   it was.  It is read rather than mapped: an older Mosaic rewrites
+   the file in place, and a shared mapping of a file truncated under
+   it faults on the next look. */
+static int history_read_file(void)
+{
+    struct stat st;
+    char *p;
+    size_t got;
+    int fd, n;
+
+    history_free();
+    if (!history_fname || (fd = open(history_fname, O_RDONLY)) < 0)
+        return 0;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    p = (char *)malloc(st.st_size + 1);
+    for (got = 0; got < (size_t)st.st_size; got += n) {
+        if ((n = read(fd, p + got, st.st_size - got)) < 0 && errno == EINTR)
+            n = 0;
+        else if (n <= 0)
+            break;
+    }
+    close(fd);
+    if (got == 0) {
+        free(p);
+        return 0;
+    }
+    p[got] = '\0';
+    history_data = p;
+    history_size = got;
+    history_end = p + got;
+
+    /* Cookie, title, and whole lines only: a number at the very end
+       of the file must not be read past it. */
+    if (history_end[-1] != '\n' ||
+        strncmp(p, NCSA_HISTORY_FORMAT_COOKIE_TWO, strlen(NCSA_HISTORY_FORMAT_COOKIE_TWO)) ||
+        !(p = memchr(p, '\n', history_end - p)) ||
+        history_end - ++p <= strlen(HISTORY_SORTED_TITLE) ||
+        strncmp(p, HISTORY_SORTED_TITLE, strlen(HISTORY_SORTED_TITLE)) ||
+        p[strlen(HISTORY_SORTED_TITLE)] != '\n') {
+        history_free();
+        return 0;
+    }
+    history_urls = p + strlen(HISTORY_SORTED_TITLE) + 1;
+
+#ifndef DISABLE_TRACE
+    if (srcTrace)
+        fprintf(stderr, "[history_read_file] Read %ld bytes of '%s'\n", (long)history_size, history_fname);
+#endif
+
+    return 1;
+}
+
+/* Compare the url at the start of a line of the history file with
+   url, in strcmp order. */
+static int history_line_compare(char *line, char *url)
+{
+    for (; line < history_end && *line != ' ' && *line != '\n'; line++, url++)
+        if (*line != *url)
+            return (*url ? (unsigned char)*line - (unsigned char)*url : 1);
+
+    return (*url ? -1 : 0);
+}
+
+/* The line of the history file for url, or NULL. */
+static char *history_find(char *url)
+{
+    char *lo = history_urls, *hi = history_end;
+    char *line, *next;
+    int cmp;
+
+    while (lo < hi) {
+        line = lo + (hi - lo) / 2;
+        while (line > lo && line[-1] != '\n')
+            line--;
+        if ((cmp = history_line_compare(line, url)) == 0)
+            return line;
+        if (cmp > 0) {
+            hi = line;
+        } else {
+            next = memchr(line, '\n', history_end - line);
+            lo = next ? next + 1 : history_end;
+        }
+    }
+
+    return NULL;
+}
+
+/* Is url in the history file, and not expired? */
+static int history_visited(char *url)
+{
+    char *line;
+
+    if (!history_urls || !(line = history_find(url)))
+        return 0;
+    while (*line != ' ' && *line != '\n')
+        line++;
+
+    return (*line == ' ' && notExpired(line + 1));
+}
+
+static void journal_open(void)
+{
+    if (journal_fd < 0 && journal_fname)
+        journal_fd = open(journal_fname, O_WRONLY | O_APPEND | O_CREAT, 0644);
+}
+
+/* Sort the hash table by url. */
+static int mo_sort_entries_for_qsort(MO_CONST void *a1, MO_CONST void *a2)
+{
+    return strcmp((*(entry **) a1)->url, (*(entry **) a2)->url);
+}
+
+/* Merge the history file and the hash table into a new sorted file
+   and rename it over the old one.  Returns 1 if it worked. */
+static int history_write_sorted(void)
+{
+    entry **list, *l;
+    char *tmp, *p, *nl, *date;
+    char ts[30];
+    FILE *fp;
+    int n = 0, i = 0, cmp, ok;
+
+    sprintf(ts, "%ld", (long)time(NULL));
+
+    for (cmp = 0; cmp < HASH_TABLE_SIZE; cmp++)
+        n += hash_table[cmp].count;
+    list = (entry **) malloc((n + 1) * sizeof(entry *));
+    for (n = 0, cmp = 0; cmp < HASH_TABLE_SIZE; cmp++)
+        for (l = hash_table[cmp].head; l != NULL; l = l->next)
+            if (!strpbrk(l->url, " \n"))
+                list[n++] = l;
+    qsort(list, n, sizeof(entry *), mo_sort_entries_for_qsort);
+
+    tmp = (char *)malloc(strlen(history_fname) + 8);
+    sprintf(tmp, "%s.new", history_fname);
+    if (!(fp = fopen(tmp, "w"))) {
+        free(list);
+        free(tmp);
+        return 0;
+    }
+    fprintf(fp, "%s\n%s\n", NCSA_HISTORY_FORMAT_COOKIE_TWO, HISTORY_SORTED_TITLE);
+
+    p = history_urls ? history_urls : history_end;
+    while (p < history_end || i < n) {
+        if (p >= history_end)
+            cmp = 1;
+        else if (i >= n)
+            cmp = -1;
+        else
+            cmp = history_line_compare(p, list[i]->url);
+
+        if (cmp < 0) {
+            nl = memchr(p, '\n', history_end - p);
+            for (date = p; *date != ' ' && *date != '\n'; date++);
+            if (*date == ' ' && notExpired(date + 1))
+                fwrite(p, 1, nl + 1 - p, fp);
+            p = nl + 1;
+        } else {
+            /* The hash table's date is the later one */
+            date = isdigit(*(list[i]->lastdate)) ? list[i]->lastdate : ts;
+            if (notExpired(date))
+                fprintf(fp, "%s %s\n", list[i]->url, date);
+            if (cmp == 0)
+                p = (char *)memchr(p, '\n', history_end - p) + 1;
+            i++;
+        }
+    }
+    free(list);
+
+    ok = (fclose(fp) == 0);
+    if (ok && get_pref_boolean(eBACKUP_FILES)) {
+        char *bak = (char *)malloc(strlen(history_fname) + 8);
+
+        sprintf(bak, "%s.backup", history_fname);
+        unlink(bak);
+        link(history_fname, bak);
+        free(bak);
+    }
+    if (!ok || rename(tmp, history_fname) < 0) {
+        unlink(tmp);
+        ok = 0;
+    }
+    free(tmp);
+
+    return ok;
+}
+
+/* Called from the SIGCHLD handler; see child.c. */
+static void history_compact_done(void *data, pid_t pid)
+{
+    compact_done = 1;
+}
+
+/* If a compaction has finished, read in the file it wrote. */
+static void history_check_compaction(void)
+{
+    if (compact_pid && compact_done) {
+        compact_pid = 0;
+        compact_done = 0;
+        history_read_file();
+    }
+}
+
+/* Move the journal aside and start a child rewriting the history
+   file from the old one and the hash table. */
+static void history_compact(void)
+{
+    sigset_t chld, saved;
+    pid_t pid;
+    char buf[BUFSIZ];
+    int in, out, n;
+
+    history_check_compaction();
+    if (compact_pid || journal_fd < 0)
+        return;
+
+    close(journal_fd);
+    journal_fd = -1;
+    if (access(journal_old_fname, F_OK) == 0) {
+        /* An earlier compaction never finished: keep both */
+        if ((in = open(journal_fname, O_RDONLY)) >= 0) {
+            if ((out = open(journal_old_fname, O_WRONLY | O_APPEND)) >= 0) {
+                while ((n = read(in, buf, sizeof(buf))) > 0)
+                    write(out, buf, n);
+                close(out);
+            }
+            close(in);
+        }
+        unlink(journal_fname);
+    } else {
+        rename(journal_fname, journal_old_fname);
+    }
+    journal_open();
+    journal_entries = 0;
+
+    /* So the child cannot be reaped before we know about it */
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, &saved);
+
+    pid = fork();
+    if (pid == 0) {
+        sigprocmask(SIG_SETMASK, &saved, NULL);
+        if (history_write_sorted())
+            unlink(journal_old_fname);
+        _exit(0);
+    }
+    if (pid > 0) {
+        compact_pid = pid;
+        compact_done = 0;
+        AddChildProcessHandler(pid, history_compact_done, NULL);
+    } else if (history_write_sorted()) {
+        unlink(journal_old_fname);
+        history_read_file();
+    }
+
+    sigprocmask(SIG_SETMASK, &saved, NULL);
+
+#ifndef DISABLE_TRACE
+    if (srcTrace)
+        fprintf(stderr, "[history_compact] Rewriting '%s' in process %d\n", history_fname, (int)pid);
+#endif
+}
+
+/* Record a visit in the journal. */
+static void journal_visit(char *url, char *ts)
+{
+    char *line;
+
+    if (journal_fd < 0)
+        return;
+
+    line = (char *)malloc(strlen(url) + strlen(ts) + 3);
+    sprintf(line, "%s %s\n", url, ts);
+    write(journal_fd, line, strlen(line));
+    free(line);
+
+    history_check_compaction();
+    if (++journal_entries >= HISTORY_JOURNAL_MAX)
+        history_compact();
+}
+
+/* Empty the history file and the journals, for a wipe. */
+static void history_reset(void)
+{
+    if (!history_fname)
+        return;
+
+    if (compact_pid) {
+        kill(compact_pid, SIGKILL);
+        compact_pid = 0;
+    }
+    history_free();
+    history_write_sorted();
+    history_read_file();
+    if (journal_fd >= 0)
+        ftruncate(journal_fd, 0);
+    unlink(journal_old_fname);
+    journal_entries = 0;
+}
+
+/* Free the hash table's entries.  Only for when none of them has
+   cached data. */
+static void free_history_entries(void)
+{
+    entry *l, *next;
+    int i;
+
+    for (i = 0; i < HASH_TABLE_SIZE; i++) {
+        for (l = hash_table[i].head; l != NULL; l = next) {
+            next = l->next;
+            free(l->url);
+            free(l->lastdate);
+            free(l);
+        }
+        hash_table[i].head = NULL;
+        hash_table[i].count = 0;
+    }
+}
+
+/****************************************************************************
+ * name:    mo_read_history_journal (PRIVATE)
+ * purpose: Read the visits in a history journal into the global history
+ *          hash table.
+ * inputs:  
+ *   - char *filename: The journal to read.
+ * returns: 
+ *   nothing
+ * remarks: 
+ *   A URL visited more than once is in the journal more than once;
+ *   the last date wins.
+ ****************************************************************************/
+static void mo_read_history_journal(char *filename)
+{
+    FILE *fp;
+    char line[MO_LINE_LENGTH];
+    char *url, *lastdate;
+    entry *l;
+
+    if (!(fp = fopen(filename, "r")))
+        return;
+
+    while (fgets(line, MO_LINE_LENGTH, fp)) {
+        url = strtok(line, " ");
+        lastdate = strtok(NULL, "\n");
+        if (!url || !lastdate)
+            continue;
+        journal_entries++;
+        if ((l = lookup_entry(url)) != NULL) {
+            free(l->lastdate);
+            l->lastdate = strdup(lastdate);
+        } else if (notExpired(lastdate)) {
+            add_url_to_bucket(hash_url(url), url, lastdate);
+        }
+    }
+
+    fclose(fp);
+}
+
 /****************************************************************************
  * name:    mo_init_global_history
  * purpose: Initialize the global history hash table.
@@ -447,6 +1044,9 @@ mo_status mo_init_global_history(void)
         hash_table[i].head = 0;
     }
 
+    /* Anything remembered as visited no longer is. */
+    mo_flush_visited_anchors();
+
     return mo_succeed;
 }
 
@@ -467,6 +1067,7 @@ mo_status mo_wipe_global_history(mo_window *win)
 
     /* Memory leak! @@@ */
     mo_init_global_history();
+    history_reset();
 
     return mo_succeed;
 }
@@ -483,7 +1084,6 @@ mo_status mo_wipe_global_history(mo_window *win)
  * remarks: 
  *   
  ****************************************************************************/
-static char *cached_global_hist_fname = NULL;
 mo_status mo_setup_global_history(void)
 {
     char *home = getenv("HOME");
@@ -497,34 +1097,44 @@ mo_status mo_setup_global_history(void)
     if (!home)
         home = "/tmp";
 
-    filename = (char *)malloc((strlen(home) + strlen(get_pref_string(eHISTORY_FILE)) + 8) * sizeof(char));
-    sprintf(filename, "%s/%s", home, get_pref_string(eHISTORY_FILE));
-
-    if (!(fp = fopen(filename, "r"))) {
-        printf("\n\n---------------New History Format---------------\n\n");
-        printf("Mosaic needs to update your history file to a new format\n");
-        printf("  which will enable links to expire after %d days (see\n", get_pref_int(eURLEXPIRED));
-        printf("  the resource 'Mosaic*urlExpired').\n\n");
-        printf("Your current history file will still exist and will not\n");
-        printf("  be modified. However, it will no longer be updated.\n");
-        printf("  Instead, the file '.mosaic-x-history' will be used.\n\n");
-
-        free(filename);
-        filename = (char *)malloc((strlen(home) + strlen(default_filename) + 8) * sizeof(char));
-        sprintf(filename, "%s/%s", home, default_filename);
-    } else {
-        fclose(fp);
+    history_expiry = get_pref_int(eURLEXPIRED) * 86400;
+
+    history_fname = (char *)malloc((strlen(home) + strlen(get_pref_string(eHISTORY_FILE)) + 8) * sizeof(char));
+    sprintf(history_fname, "%s/%s", home, get_pref_string(eHISTORY_FILE));
+    journal_fname = (char *)malloc(strlen(history_fname) + 16);
+    sprintf(journal_fname, "%s.journal", history_fname);
+    journal_old_fname = (char *)malloc(strlen(history_fname) + 16);
+    sprintf(journal_old_fname, "%s.journal.old", history_fname);
+
+    /* Not yet in sorted form: read it the old way, once, and write
+       it out sorted. */
+    if (!history_read_file()) {
+        if (!(fp = fopen(history_fname, "r"))) {
+            printf("\n\n---------------New History Format---------------\n\n");
+            printf("Mosaic needs to update your history file to a new format\n");
+            printf("  which will enable links to expire after %d days (see\n", get_pref_int(eURLEXPIRED));
+            printf("  the resource 'Mosaic*urlExpired').\n\n");
+            printf("Your current history file will still exist and will not\n");
+            printf("  be modified. However, it will no longer be updated.\n");
+            printf("  Instead, the file '.mosaic-x-history' will be used.\n\n");
+
+            filename = (char *)malloc((strlen(home) + strlen(default_filename) + 8) * sizeof(char));
+            sprintf(filename, "%s/%s", home, default_filename);
+            mo_read_global_history(filename);
+            free(filename);
+        } else {
+            fclose(fp);
+            mo_read_global_history(history_fname);
+        }
+        if (history_write_sorted() && history_read_file())
+            free_history_entries();
     }
 
-    cached_global_hist_fname = filename;
-
-    mo_read_global_history(filename);
-
-    free(filename);
-    filename = (char *)malloc((strlen(home) + strlen(get_pref_string(eHISTORY_FILE)) + 8) * sizeof(char));
-    sprintf(filename, "%s/%s", home, get_pref_string(eHISTORY_FILE));
-
-    cached_global_hist_fname = filename;
+    mo_read_history_journal(journal_old_fname);
+    mo_read_history_journal(journal_fname);
+    journal_open();
+    if (journal_entries >= HISTORY_JOURNAL_MAX)
+        history_compact();
 
     return mo_succeed;
 }
@@ -540,30 +1150,17 @@ mo_status mo_setup_global_history(void)
  *   This assigns last-read times to all the entries in the history,
  *   which is a bad thing.
  *   ---Not anymore --- SWP
+ *   Visits are in the journal as they happen, and the history file
+ *   is rewritten in the background, so there is nothing left to do
+ *   here but close the journal.
  ****************************************************************************/
 mo_status mo_write_global_history(void)
 {
-    FILE *fp;
-    int i;
-    entry *l;
-    time_t foo = time(NULL);
-    char ts[30];
-
-    sprintf(ts, "%ld", foo);
-
-    fp = fopen(cached_global_hist_fname, "w");
-    if (!fp)
+    if (journal_fd < 0)
         return mo_fail;
 
-    fprintf(fp, "%s\n%s\n", NCSA_HISTORY_FORMAT_COOKIE_TWO, "Global");
-
-    for (i = 0; i < HASH_TABLE_SIZE; i++) {
-        for (l = hash_table[i].head; l != NULL; l = l->next) {
-            fprintf(fp, "%s %s\n", l->url, (isdigit(*(l->lastdate)) ? l->lastdate : ts));
-        }
-    }
-
-    fclose(fp);
+    close(journal_fd);
+    journal_fd = -1;
 
     return mo_succeed;
 }
@@ -672,6 +1269,8 @@ mo_status mo_cache_data(char *url, void *info, int type)
        Now, the same URL can be registered multiple times with different
        (or, in one instance, no) internal anchor. */
     if (!been_here_before(url))
+        journal_visit(url, ts);
+    if (!lookup_entry(url))
         add_url_to_bucket(hash_url(url), url, ts);
 
     /* Then, find the right entry. */
@@ -715,11 +1314,14 @@ mo_status mo_zap_cached_images_here(mo_window *win)
     if (num) {
         int i;
         for (i = 0; i < num; i++) {
-            char *url = mo_url_canonicalize(hrefs[i], cached_url);
+            char buf[MO_URL_BUF];
+            char *url = mo_url_canonicalize_into(hrefs[i], cached_url, buf, MO_URL_BUF);
             ptr = mo_fetch_cached_image_data(url);
             if (ptr) {
                 mo_cache_data(url, NULL, 0);
             }
+            if (url != buf)
+                free(url);
         }
 
         /* All done; clean up. */
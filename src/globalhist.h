@@ -68,6 +68,7 @@
 
 mo_status mo_been_here_before_huh_dad (char *);
 mo_status mo_here_we_are_son (char *);
+mo_status mo_anchor_visited_huh (char *, char *);
 mo_status mo_init_global_history (void);
 mo_status mo_wipe_global_history (mo_window *);
 mo_status mo_setup_global_history (void);
@@ -58,10 +58,26 @@
 #include "pan.h"
 #include "mo-www.h"
 #include "compat.h"
+#include "gui.h"
+#include "gui-documents.h"
+#include "child.h"
+#include "proxy.h"
+#include "HTParse.h"
 #include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
 
 static char *EscapeStuff(char *title);
 
+#ifndef DISABLE_TRACE
+extern int srcTrace;
+#endif
+
 /* -------------------------- Group Annotations --------------------------- */
 #define NCSA_GROUP_ANNOTATION_FORMAT_ONE \
   "<ncsa-group-annotation-format-1>"
@@ -136,6 +152,636 @@ static char *EscapeStuff(char *title)
     return (ret);
 }
 
+/* ------------------------- Asynchronous lookups -------------------------- */
+
+/* Asking the annotation server about every document used to hold up
+   the document itself for a full round trip.  Now the answers are
+   kept in a small cache, and a document whose answer is not there yet
+   is shown without group annotations while a child process puts the
+   question to the server.  When the answer comes back through a pipe
+   it goes into the cache and any window still showing the document is
+   redrawn with it.
+
+   Documents either side of a window's current one in its history are
+   asked about in the same request, so going back or forward usually
+   finds its answer waiting.  Several documents go to the server as
+
+     cmd=an_get_batch&format=html&url=<escaped url>&url=...
+
+   and a server that understands this answers
+
+     <ncsa-group-annotation-batch>
+     status=200 length=<n> url=<url>
+     <n bytes of HTML>
+     status=404 length=0 url=<url>
+     ...
+
+   where a line end after the HTML, or CRLF for LF, does no harm.
+
+   A server that does not is asked about one document at a time with
+   the old cmd=an_get request, and not sent batches again.  The child
+   writes the answers down the pipe in the batch form either way. */
+
+#define GRPAN_CACHE_SIZE 64
+#define GRPAN_CACHE_TTL 300             /* seconds an answer is good for */
+#define GRPAN_BATCH_MAX 8               /* documents asked about at once */
+#define GRPAN_TIMEOUT 60                /* seconds before a child gives up */
+#define GRPAN_BATCH_MARKER "<ncsa-group-annotation-batch>"
+
+typedef struct {
+    char *url;                  /* NULL if the slot is free */
+    char *text;                 /* NULL if there are no annotations */
+    time_t fetched;
+    int pending;                /* a child is asking about it */
+    unsigned long used;
+} grpan_entry;
+
+typedef struct {
+    int fd;
+    XtInputId id;
+    int generation;
+    char **urls;                /* what this child was asked about */
+    int n;
+    char *buf;
+    int len, size;
+} grpan_request;
+
+static grpan_entry grpan_cache[GRPAN_CACHE_SIZE];
+static unsigned long grpan_clock = 0;
+static int grpan_generation = 0;        /* bumped when the cache is flushed */
+static int grpan_no_batch = 0;          /* server does not do batches */
+static int grpan_direct = 0;            /* server redirects or wants a password */
+
+extern XtAppContext app_context;
+extern char *HTAppVersion;
+extern int makeBusy;
+
+static grpan_entry *grpan_lookup(char *url)
+{
+    int i;
+
+    for (i = 0; i < GRPAN_CACHE_SIZE; i++)
+        if (grpan_cache[i].url && !strcmp(grpan_cache[i].url, url)) {
+            grpan_cache[i].used = ++grpan_clock;
+            return &grpan_cache[i];
+        }
+    return NULL;
+}
+
+/* Find url's slot, taking over the least recently used one that is
+   not waiting on a child if it has none. */
+static grpan_entry *grpan_slot(char *url)
+{
+    grpan_entry *e, *victim = NULL;
+    int i;
+
+    if ((e = grpan_lookup(url)))
+        return e;
+
+    for (i = 0; i < GRPAN_CACHE_SIZE; i++) {
+        e = &grpan_cache[i];
+        if (!e->url) {
+            victim = e;
+            break;
+        }
+        if (!e->pending && (!victim || e->used < victim->used))
+            victim = e;
+    }
+    if (!victim)
+        return NULL;
+
+    if (victim->url)
+        free(victim->url);
+    if (victim->text)
+        free(victim->text);
+    victim->url = strdup(url);
+    victim->text = NULL;
+    victim->fetched = 0;
+    victim->pending = 0;
+    victim->used = ++grpan_clock;
+    return victim;
+}
+
+static int grpan_fresh(grpan_entry *e)
+{
+    return e->fetched && time(NULL) - e->fetched < GRPAN_CACHE_TTL;
+}
+
+/* Forget every answer; the server's list has changed under us.
+   Children already asking will have their answers dropped. */
+static void grpan_flush(void)
+{
+    int i;
+
+    for (i = 0; i < GRPAN_CACHE_SIZE; i++) {
+        if (grpan_cache[i].url)
+            free(grpan_cache[i].url);
+        if (grpan_cache[i].text)
+            free(grpan_cache[i].text);
+        grpan_cache[i].url = NULL;
+        grpan_cache[i].text = NULL;
+        grpan_cache[i].pending = 0;
+    }
+    grpan_generation++;
+}
+
+/* The cache key for a document: its URL less any anchor that is not
+   an hdfref. */
+static char *grpan_key(char *url)
+{
+    char *anch = mo_url_extract_anchor(url);
+    char *key;
+
+    if (anch && strncmp(anch, "hdfref", 6))
+        key = mo_url_canonicalize(url, "");
+    else
+        key = strdup(url);
+    if (anch)
+        free(anch);
+    return key;
+}
+
+/* --------------------------- in the child --------------------------- */
+
+static int grpan_write(int fd, char *buf, int len)
+{
+    int n;
+
+    while (len > 0) {
+        if ((n = write(fd, buf, len)) < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* POST data to the server and return the body of the reply, or NULL
+   if it did not answer 2xx.  The status it gave, or 0, goes in code. */
+static char *grpan_post(struct sockaddr_in *sin, char *uri, char *host, char *data, int *len, int *code)
+{
+    char *req, *buf, *body;
+    int soc, n, size, got;
+
+    *code = 0;
+    if ((soc = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+        return NULL;
+    if (connect(soc, (struct sockaddr *)sin, sizeof(*sin)) < 0) {
+        close(soc);
+        return NULL;
+    }
+
+    req = (char *)malloc(strlen(uri) + strlen(host) + strlen(data) +
+                         (HTAppVersion ? strlen(HTAppVersion) : 0) + 256);
+    sprintf(req, "POST %s HTTP/1.0\r\nHost: %s\r\nUser-Agent: %s\r\n"
+            "Content-Type: application/x-www-form-urlencoded\r\n"
+            "Content-Length: %d\r\n\r\n%s",
+            uri, host, HTAppVersion ? HTAppVersion : "NCSA Mosaic", (int)strlen(data), data);
+    n = grpan_write(soc, req, strlen(req));
+    free(req);
+    if (n < 0) {
+        close(soc);
+        return NULL;
+    }
+
+    size = 8192;
+    got = 0;
+    buf = (char *)malloc(size + 1);
+    while ((n = read(soc, buf + got, size - got)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        got += n;
+        if (got == size) {
+            size *= 2;
+            buf = (char *)realloc(buf, size + 1);
+        }
+    }
+    close(soc);
+    buf[got] = '\0';
+
+    if (sscanf(buf, "HTTP/%*d.%*d %d", code) != 1 || *code / 100 != 2) {
+        free(buf);
+        return NULL;
+    }
+    if ((body = strstr(buf, "\r\n\r\n")))
+        body += 4;
+    else if ((body = strstr(buf, "\n\n")))
+        body += 2;
+    else {
+        free(buf);
+        return NULL;
+    }
+    *len = got - (body - buf);
+    memmove(buf, body, *len + 1);
+    return buf;
+}
+
+/* Work out where to send requests for the annotation server: the
+   server itself, or the http proxy if there is one for it.  The
+   proxy lists and the name server are only asked in the child, so
+   a slow lookup does not hold up the parent. */
+static int grpan_address(struct sockaddr_in *sin, char **uri, char **host)
+{
+    char *server = get_pref_string(eANNOTATION_SERVER);
+    char *where, *proxy = NULL, *port;
+    struct hostent *hp;
+    struct Proxy *proxent, *GetProxy(), *GetNoProxy();
+
+    *host = HTParse(server, "", PARSE_HOST);
+    *uri = HTParse(server, "", PARSE_PATH | PARSE_PUNCTUATION);
+
+    if (!GetNoProxy("http", *host)) {
+        if ((proxy = getenv("http_proxy")) && *proxy)
+            proxy = HTParse(proxy, "", PARSE_HOST);
+        else if ((proxent = GetProxy("http", *host, 1)) && !strcmp(proxent->transport, "http")) {
+            proxy = (char *)malloc(strlen(proxent->address) + strlen(proxent->port) + 2);
+            sprintf(proxy, "%s:%s", proxent->address, proxent->port);
+        } else
+            proxy = NULL;
+    }
+    if (proxy) {
+        free(*uri);
+        *uri = strdup(server);
+    }
+
+    where = strdup(proxy ? proxy : *host);
+    if (proxy)
+        free(proxy);
+    memset(sin, 0, sizeof(*sin));
+    sin->sin_family = AF_INET;
+    sin->sin_port = htons(80);
+    if ((port = strchr(where, ':'))) {
+        *port++ = '\0';
+        sin->sin_port = htons(atoi(port));
+    }
+    if ((hp = gethostbyname(where)) == NULL) {
+        free(where);
+        free(*uri);
+        free(*host);
+        return -1;
+    }
+    memcpy(&sin->sin_addr, hp->h_addr_list[0], hp->h_length);
+    free(where);
+    return 0;
+}
+
+/* Redirects and authentication are left to libwww: the parent is
+   told to ask the old way instead. */
+static int grpan_handover(int code)
+{
+    return code / 100 == 3 || code == 401 || code == 407;
+}
+
+static void grpan_child(int fd, char *batch, char **urls, char **singles, int n)
+{
+    struct sockaddr_in sin;
+    char line[64], *reply, *uri, *host;
+    int i, len, ok, code;
+
+    alarm(GRPAN_TIMEOUT);
+
+    /* No answers: the parent takes that as no annotations for now */
+    if (grpan_address(&sin, &uri, &host) < 0) {
+        grpan_write(fd, "batch=1\n", 8);
+        return;
+    }
+
+    if (batch && (reply = grpan_post(&sin, uri, host, batch, &len, &code))) {
+        if (!strncmp(reply, GRPAN_BATCH_MARKER, strlen(GRPAN_BATCH_MARKER))) {
+            char *p = reply + strlen(GRPAN_BATCH_MARKER);
+
+            while (*p == '\r' || *p == '\n')
+                p++;
+            grpan_write(fd, "batch=1\n", 8);
+            grpan_write(fd, p, len - (p - reply));
+            return;
+        }
+        free(reply);
+    }
+
+    grpan_write(fd, batch ? "batch=0\n" : "batch=1\n", 8);
+    if (batch && grpan_handover(code)) {
+        grpan_write(fd, "direct=1\n", 9);
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        reply = grpan_post(&sin, uri, host, singles[i], &len, &code);
+        if (!reply && grpan_handover(code)) {
+            grpan_write(fd, "direct=1\n", 9);
+            return;
+        }
+        ok = reply && strstr(reply, "status=200") != NULL;
+        sprintf(line, "status=%d length=%d url=", ok ? 200 : 404, ok ? len : 0);
+        grpan_write(fd, line, strlen(line));
+        grpan_write(fd, urls[i], strlen(urls[i]));
+        grpan_write(fd, "\n", 1);
+        if (ok)
+            grpan_write(fd, reply, len);
+        if (reply)
+            free(reply);
+    }
+}
+
+/* --------------------------- in the parent --------------------------- */
+
+static void grpan_refresh(XtPointer client_data, XtIntervalId *id);
+static char *grpan_fetch_now(char *url);
+
+/* Redraw the annotations of the windows showing url.  Not in the
+   middle of a load though; try again shortly. */
+static void grpan_show(char *url)
+{
+    mo_window *win = NULL;
+    char *key;
+
+    if (makeBusy) {
+        XtAppAddTimeOut(app_context, 500, (XtTimerCallbackProc) grpan_refresh, (XtPointer) strdup(url));
+        return;
+    }
+
+    while ((win = mo_next_window(win))) {
+        if (!win->current_node || !win->current_node->url)
+            continue;
+        key = grpan_key(win->current_node->url);
+        if (!strcmp(key, url))
+            mo_refresh_window_annotations(win);
+        free(key);
+    }
+}
+
+static void grpan_refresh(XtPointer client_data, XtIntervalId *id)
+{
+    char *url = (char *)client_data;
+    grpan_entry *e = grpan_lookup(url);
+
+    if (e && !e->fetched && !e->pending && grpan_direct) {
+        if (makeBusy) {
+            XtAppAddTimeOut(app_context, 500, (XtTimerCallbackProc) grpan_refresh, client_data);
+            return;
+        }
+        e->text = grpan_fetch_now(url);
+        e->fetched = time(NULL);
+    }
+    if (e && e->text)
+        grpan_show(url);
+    free(url);
+}
+
+static void grpan_answer(grpan_request *req)
+{
+    char *p = req->buf, *end = req->buf + req->len, *nl, *url;
+    int i, status, len;
+    time_t now = time(NULL);
+    grpan_entry *e;
+
+    if (req->generation != grpan_generation)
+        return;
+
+    if (req->len > 8 && !strncmp(p, "batch=0\n", 8))
+        grpan_no_batch = 1;
+    if ((nl = memchr(p, '\n', end - p)))
+        p = nl + 1;
+    else
+        p = end;
+
+    for (;;) {
+        /* Servers may end each entry's HTML with a line end */
+        while (p < end && (*p == '\r' || *p == '\n'))
+            p++;
+        if (p >= end || !(nl = memchr(p, '\n', end - p)))
+            break;
+        *nl = '\0';
+        if (nl > p && nl[-1] == '\r')
+            nl[-1] = '\0';
+        if (!strcmp(p, "direct=1")) {
+            grpan_direct = 1;
+            break;
+        }
+        if (sscanf(p, "status=%d length=%d", &status, &len) != 2 ||
+            !(url = strstr(p, " url=")) || len < 0 || len > end - (nl + 1))
+            break;
+        url += 5;
+        if ((e = grpan_slot(url))) {
+            if (e->text)
+                free(e->text);
+            e->text = NULL;
+            if (status == 200 && len > 0) {
+                e->text = (char *)malloc(len + 1);
+                memcpy(e->text, nl + 1, len);
+                e->text[len] = '\0';
+            }
+            e->fetched = now;
+            e->pending = 0;
+            if (e->text)
+                XtAppAddTimeOut(app_context, 0, (XtTimerCallbackProc) grpan_refresh,
+                                (XtPointer) strdup(e->url));
+        }
+        p = nl + 1 + len;
+    }
+
+    /* Whatever the server did not answer has no annotations, or at
+       least none we can get at for a while.  Unless it has to be asked
+       through libwww: then the document asked about first is fetched
+       that way, and the rest when they are next shown. */
+    for (i = 0; i < req->n; i++)
+        if ((e = grpan_lookup(req->urls[i])) && e->pending) {
+            e->fetched = grpan_direct ? 0 : now;
+            e->pending = 0;
+        }
+    if (grpan_direct && req->n)
+        XtAppAddTimeOut(app_context, 0, (XtTimerCallbackProc) grpan_refresh,
+                        (XtPointer) strdup(req->urls[0]));
+}
+
+static void grpan_input(XtPointer client_data, int *source, XtInputId *id)
+{
+    grpan_request *req = (grpan_request *) client_data;
+    int n;
+
+    if (req->len == req->size) {
+        req->size *= 2;
+        req->buf = (char *)realloc(req->buf, req->size + 1);
+    }
+    n = read(req->fd, req->buf + req->len, req->size - req->len);
+    if (n < 0 && errno == EINTR)
+        return;
+    if (n > 0) {
+        req->len += n;
+        return;
+    }
+
+    XtRemoveInput(req->id);
+    close(req->fd);
+    req->buf[req->len] = '\0';
+    grpan_answer(req);
+    for (n = 0; n < req->n; n++)
+        free(req->urls[n]);
+    free(req->urls);
+    free(req->buf);
+    free(req);
+}
+
+static void grpan_reaped(void *data, pid_t pid)
+{
+    /* The answer comes in through the pipe. */
+}
+
+/* Start a child asking the server about urls.  Returns -1 if it could
+   not be started. */
+static int grpan_start(char **urls, int n)
+{
+    char *access, *batch = NULL, **singles, *esc;
+    grpan_request *req;
+    sigset_t set, oset;
+    int fds[2], i, size;
+    pid_t pid;
+
+    if (grpan_direct)
+        return -1;
+    access = HTParse(get_pref_string(eANNOTATION_SERVER), "", PARSE_ACCESS);
+    i = strcmp(access, "http");
+    free(access);
+    if (i)
+        return -1;
+
+    singles = (char **)malloc(n * sizeof(char *));
+    for (i = 0, size = 64; i < n; i++) {
+        singles[i] = (char *)malloc(strlen(urls[i]) + 64);
+        sprintf(singles[i], "cmd=an_get&format=html&url=%s", urls[i]);
+        size += 3 * strlen(urls[i]) + 8;
+    }
+    if (n > 1 && !grpan_no_batch) {
+        batch = (char *)malloc(size);
+        strcpy(batch, "cmd=an_get_batch&format=html");
+        for (i = 0; i < n; i++) {
+            esc = mo_escape_part(urls[i]);
+            strcat(batch, "&url=");
+            strcat(batch, esc);
+            free(esc);
+        }
+    }
+
+    if (pipe(fds) < 0) {
+        pid = -1;
+        goto done;
+    }
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &set, &oset);
+    if ((pid = fork()) == 0) {
+        close(fds[0]);
+        signal(SIGALRM, SIG_DFL);
+        signal(SIGPIPE, SIG_IGN);
+        grpan_child(fds[1], batch, urls, singles, n);
+        _exit(0);
+    }
+    if (pid > 0)
+        AddChildProcessHandler(pid, grpan_reaped, NULL);
+    sigprocmask(SIG_SETMASK, &oset, NULL);
+    close(fds[1]);
+
+    if (pid < 0) {
+        close(fds[0]);
+        goto done;
+    }
+
+#ifndef DISABLE_TRACE
+    if (srcTrace)
+        fprintf(stderr, "grpan: child %d asking about %d document(s)\n", (int)pid, n);
+#endif
+
+    req = (grpan_request *) malloc(sizeof(grpan_request));
+    req->fd = fds[0];
+    req->generation = grpan_generation;
+    req->urls = (char **)malloc(n * sizeof(char *));
+    for (i = 0; i < n; i++)
+        req->urls[i] = strdup(urls[i]);
+    req->n = n;
+    req->size = 8192;
+    req->len = 0;
+    req->buf = (char *)malloc(req->size + 1);
+    req->id = XtAppAddInput(app_context, fds[0], (XtPointer) XtInputReadMask,
+                            (XtInputCallbackProc) grpan_input, (XtPointer) req);
+
+  done:
+    for (i = 0; i < n; i++)
+        free(singles[i]);
+    free(singles);
+    if (batch)
+        free(batch);
+    return pid < 0 ? -1 : 0;
+}
+
+/* Add url to the list to ask about, unless we know or are asking. */
+static void grpan_want(char *url, char **urls, int *n)
+{
+    grpan_entry *e;
+    int i;
+
+    if (*n >= GRPAN_BATCH_MAX)
+        return;
+    if ((e = grpan_lookup(url)) && (e->pending || grpan_fresh(e)))
+        return;
+    for (i = 0; i < *n; i++)
+        if (!strcmp(urls[i], url))
+            return;
+    urls[(*n)++] = strdup(url);
+}
+
+/* Add the history neighbours of every window's current document. */
+static void grpan_neighbours(char **urls, int *n)
+{
+    mo_window *win = NULL;
+    mo_node *nodes[3];
+    char *doc, *key;
+    int i;
+
+    while ((win = mo_next_window(win))) {
+        if (!win->current_node)
+            continue;
+        nodes[0] = win->current_node;
+        nodes[1] = win->current_node->previous;
+        nodes[2] = win->current_node->next;
+        for (i = 0; i < 3; i++) {
+            if (!nodes[i] || !nodes[i]->url)
+                continue;
+            doc = mo_url_to_unique_document(nodes[i]->url);
+            key = grpan_key(doc);
+            grpan_want(key, urls, n);
+            free(key);
+            free(doc);
+        }
+    }
+}
+
+/* The old way: ask and wait for the answer. */
+static char *grpan_fetch_now(char *url)
+{
+    char *ttxt, *ttxthead;
+    char *post_data, *status_ptr;
+
+    post_data = (char *)malloc(strlen(url) + 1024);
+    sprintf(post_data, "cmd=an_get&format=html&url=%s", url);
+    ttxt = mo_post_pull_er_over(get_pref_string(eANNOTATION_SERVER),
+                                "application/x-www-form-urlencoded", post_data, &ttxthead);
+    free(post_data);
+
+    /* check if status=200 was returned */
+    status_ptr = ttxt ? strstr(ttxt, "status=") : NULL;
+    if (!status_ptr || strncmp(status_ptr, "status=200", 10) != 0)
+        return NULL;
+    if (*ttxt == '\0')          /* No annotations */
+        return NULL;
+    return ttxt;
+}
+
 /****************************************************************************
  * name:    mo_fetch_grpan_links
  * purpose: Fetch the list of group annotations for this document.
@@ -147,58 +793,53 @@ static char *EscapeStuff(char *title)
  *   Right now the server constructs the list for us.  Later we will want 
  *   to construct it ourselves to be able to support local kill lists, 
  *   and the like.
+ *   If the answer is not in the cache, NULL is returned and the server
+ *   asked in the background; the document is redrawn when it answers.
  ****************************************************************************/
 char *mo_fetch_grpan_links(char *url)
 {
-    char *request;
-    char *ttxt, *ttxthead;
-    char *post_data, *status_ptr;
+    grpan_entry *e;
+    char *key, *rv = NULL;
+    char *urls[GRPAN_BATCH_MAX];
+    int i, n = 0;
 
-    if (!get_pref_string(eANNOTATION_SERVER)) { /* No annotation server */
+    if (!get_pref_string(eANNOTATION_SERVER))   /* No annotation server */
         return NULL;
-    } else {
-        /* Go get the anchor in the URL, if any. */
-        char *anch = mo_url_extract_anchor(url);
-
-        /* If there is one and it doesn't start with "hdfref",
-           then clip it off.  WHAT ABOUT PERSONAL ANNOTATIONS??? */
-        if (anch && strncmp(anch, "hdfref", 6))
-            url = mo_url_canonicalize(url, "");
-
-        /* Sanity check. */
-        if (!url)
-            return NULL;
-
-        /* the old Bina grpan request */
-/*      
-	request = (char *)malloc(strlen(url) + 256);
-	sprintf
-        (request, "grpan://%s/url=\"%s\";=", Rdata.annotation_server, url);
-	ttxt = grpan_doit("ANN_GET ", request, (char *)NULL, 0, &ttxthead);
-	free(request);
-	*/
 
-        /* amb */
-        post_data = (char *)malloc(strlen(url) + 1024);
-        sprintf(post_data, "cmd=an_get&format=html&url=%s", url);
-        ttxt = mo_post_pull_er_over(get_pref_string(eANNOTATION_SERVER),
-                                    "application/x-www-form-urlencoded", post_data, &ttxthead);
-        free(post_data);
+    /* Sanity check. */
+    if (!url || !(key = grpan_key(url)))
+        return NULL;
 
-        /* check if status=200 was returned */
-        status_ptr = strstr(ttxt, "status=");
-        /*check for null... SWP */
-        if (!status_ptr || (status_ptr && strncmp(status_ptr, "status=200", 10) != 0)) {
-            return (NULL);
-        }
-        /* /amb */
+    if ((e = grpan_lookup(key)) && (e->pending || grpan_fresh(e))) {
+        if (e->text)
+            rv = strdup(e->text);
+        free(key);
+        return rv;
+    }
 
-        if ((ttxt == NULL) || (*ttxt == '\0')) {    /* No annotations */
-            return (NULL);
-        } else {
-            return (ttxt);
+    grpan_want(key, urls, &n);
+    grpan_neighbours(urls, &n);
+
+    for (i = 0; i < n; i++)
+        if ((e = grpan_slot(urls[i])))
+            e->pending = 1;
+
+    if (grpan_start(urls, n) < 0) {
+        /* No child; do it the old way, for this one document only. */
+        for (i = 0; i < n; i++)
+            if ((e = grpan_lookup(urls[i])))
+                e->pending = 0;
+        rv = grpan_fetch_now(key);
+        if ((e = grpan_slot(key))) {
+            e->text = rv ? strdup(rv) : NULL;
+            e->fetched = time(NULL);
         }
     }
+
+    for (i = 0; i < n; i++)
+        free(urls[i]);
+    free(key);
+    return rv;
 }
 
 /****************************************************************************
@@ -291,6 +932,7 @@ mo_status mo_new_grpan(char *url, char *title, char *author, char *text)
         if (Euser != NULL) {
             free(Euser);
         }
+        grpan_flush();
         return mo_succeed;
     }
 }
@@ -344,6 +986,7 @@ mo_status mo_audio_grpan(char *url, char *title, char *author, char *data, int l
         if (Euser != NULL) {
             free(Euser);
         }
+        grpan_flush();
         return mo_succeed;
     }
 }
@@ -393,6 +1036,7 @@ mo_status mo_modify_grpan(char *url, char *title, char *author, char *text)
         if (Euser != NULL) {
             free(Euser);
         }
+        grpan_flush();
         return mo_succeed;
     }
 }
@@ -419,6 +1063,7 @@ mo_status mo_delete_grpan(char *url)
         sprintf(request, "grpan://%s/url=\"%s\";=", get_pref_string(eANNOTATION_SERVER), url);
         ttxt = grpan_doit("ANN_DELETE ", request, (char *)NULL, 0, &ttxthead);
         free(request);
+        grpan_flush();
         return (mo_succeed);
     }
 }
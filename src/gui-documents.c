@@ -60,6 +60,7 @@
 #include "annotate.h"
 #include "history.h"
 #include "libhtmlw/HTML.h"
+#include "libwww2/HTTimeline.h"
 #include "cci.h"
 #include "cciBindings.h"
 #include "compat.h"
@@ -292,6 +293,12 @@ static void mo_set_text(Widget w, char *txt, char *ans, int id, char *target_anc
     else
         HTMLSetText(w, txt, "\0", ans ? ans : "\0", id, target_anchor, cached_stuff);
     loading_inlined_images = 0;
+
+    /* Layout takes in the inlined images, which note their own times. */
+    HTTimelineSpan(HT_TL_PARSE, HTTimelineAt(&HTMLLastSetText.parse_start),
+                   HTTimelineAt(&HTMLLastSetText.parse_end), HTMLLastSetText.parse_bytes);
+    HTTimelineSpan(HT_TL_LAYOUT, HTTimelineAt(&HTMLLastSetText.format_start),
+                   HTTimelineAt(&HTMLLastSetText.format_end), -1);
     interrupted = 0;
     mo_gui_done_with_icon();
 }
@@ -635,6 +642,7 @@ mo_status mo_reload_window_text(mo_window *win, int reload_images_also)
         reloading = 1;
     }
 
+    HTTimelineBegin(win->current_node->url);
     win->current_node->text = mo_pull_er_over(win->current_node->url, &win->current_node->texthead);
 
     /* AF */
@@ -680,6 +688,8 @@ mo_status mo_reload_window_text(mo_window *win, int reload_images_also)
         mo_search_window(win, ">>>", 0, 1, 1);
     }
 
+    mo_timeline_end(win);
+
     return mo_succeed;
 }
 
@@ -715,6 +725,39 @@ mo_status mo_refresh_window_text(mo_window *win)
     return mo_succeed;
 }
 
+/****************************************************************************
+ * name:    mo_refresh_window_annotations
+ * purpose: Redraw the annotations of the current window's document.
+ * inputs:  
+ *   - mo_window *win: The current window.
+ * returns: 
+ *   mo_succeed, or mo_fail if there is no document.
+ * remarks: 
+ *   Only the annotation links are asked for again; the document text
+ *   and its forms are left as they are.
+ ****************************************************************************/
+mo_status mo_refresh_window_annotations(mo_window *win)
+{
+    char *ans;
+    int tmp;
+
+    if (!win->current_node || !win->current_node->url)
+        return mo_fail;
+
+    /* As in mo_do_window_text. */
+    tmp = binary_transfer;
+    binary_transfer = 0;
+    ans = mo_fetch_annotation_links(win->current_node->url, get_pref_boolean(eANNOTATIONS_ON_TOP));
+    binary_transfer = tmp;
+
+    if (get_pref_boolean(eANNOTATIONS_ON_TOP))
+        HTMLSetHeaderFooter(win->scrolled_win, ans ? ans : "\0", NULL);
+    else
+        HTMLSetHeaderFooter(win->scrolled_win, NULL, ans ? ans : "\0");
+
+    return mo_succeed;
+}
+
 /****************************************************************************
  * name:    mo_load_window_text
  * purpose: Given a window and a raw URL, load the window.  The window
@@ -799,6 +842,7 @@ mo_status mo_load_window_text(mo_window *win, char *url, char *ref)
     /********* Send Anchor history to CCI if CCI wants it */
             MoCCISendAnchorToCCI(url, 1);
     /*****************************************************/
+            HTTimelineBegin(canon);
             newtext = mo_pull_er_over(canon, &newtexthead);
 
             /* 
@@ -962,6 +1006,8 @@ mo_status mo_load_window_text(mo_window *win, char *url, char *ref)
         mo_search_window(win, ">>>", 0, 1, 1);
     }
 
+    mo_timeline_end(win);
+
     return return_stat;
 }
 
@@ -1006,8 +1052,10 @@ static mo_status mo_post_load_window_text(mo_window *win, char *url, char *conte
             char *canon = mo_url_canonicalize(url, "");
             interrupted = 0;
 
-            if (!MoCCIFormToClient(actionID, NULL, content_type, post_data, 0))
+            if (!MoCCIFormToClient(actionID, NULL, content_type, post_data, 0)) {
+                HTTimelineBegin(canon);
                 newtext = mo_post_pull_er_over(canon, content_type, post_data, &newtexthead);
+            }
             free(canon);
         }
 
@@ -1101,6 +1149,8 @@ static mo_status mo_post_load_window_text(mo_window *win, char *url, char *conte
   if (cci_event) MoCCISendEventOutput(LINK_LOADED);
 */
 
+    mo_timeline_end(win);
+
     return mo_succeed;
 }
 
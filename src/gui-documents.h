@@ -71,6 +71,7 @@ mo_status mo_forward_impossible (mo_window *win);
 mo_status mo_set_win_current_node (mo_window *, mo_node *);
 mo_status mo_reload_window_text (mo_window *, int);
 mo_status mo_refresh_window_text (mo_window *);
+mo_status mo_refresh_window_annotations (mo_window *);
 mo_status mo_load_window_text (mo_window *, char *, char *);
 mo_status mo_duplicate_window_text (mo_window *, mo_window *);
 mo_status mo_access_document (mo_window *, char *);
@@ -57,10 +57,12 @@
 #include "gui-extras.h"
 #include "mo-www.h"
 #include "libhtmlw/HTML.h"
+#include "libwww2/HTTimeline.h"
 #include <Xm/Xm.h>
 #include <Xm/ScrolledW.h>
 #include <Xm/List.h>
 #include <Xm/Label.h>
+#include <time.h>
 #include "compat.h"
 
 #include "libnut/system.h"
@@ -384,3 +386,203 @@ void System(char *cmd, char *title)
 
     return;
 }
+
+/****************************************************************************
+ * name:    mo_timeline_end
+ * purpose: Keep the timeline of the load just finished in a window.
+ * inputs:  
+ *   - mo_window *win: The window the load was for.
+ * returns: 
+ *   mo_succeed, or mo_fail if no load was being timed.
+ * remarks: 
+ *   The window keeps the last MO_TIMELINES; the oldest goes to make room.
+ ****************************************************************************/
+mo_status mo_timeline_end(mo_window *win)
+{
+    HTTimeline *tl = HTTimelineEnd();
+
+    if (!tl)
+        return mo_fail;
+    if (!win) {
+        HTTimelineFree(tl);
+        return mo_fail;
+    }
+
+    HTTimelineFree((HTTimeline *) win->timelines[win->timeline_next]);
+    win->timelines[win->timeline_next] = tl;
+    win->timeline_next = (win->timeline_next + 1) % MO_TIMELINES;
+
+    if (win->timeline_win && XtIsManaged(win->timeline_win))
+        mo_update_timeline_window(win);
+
+    return mo_succeed;
+}
+
+void mo_free_timelines(mo_window *win)
+{
+    int i;
+
+    for (i = 0; i < MO_TIMELINES; i++) {
+        HTTimelineFree((HTTimeline *) win->timelines[i]);
+        win->timelines[i] = NULL;
+    }
+    win->timeline_next = 0;
+}
+
+/****************************************************************************
+ * name:    mo_timeline_json
+ * purpose: Write out a window's load timelines, oldest first.
+ * inputs:  
+ *   - mo_window *win: The window.
+ * returns: 
+ *   A malloc'd JSON array of the timelines (see HTTimeline.h).
+ ****************************************************************************/
+char *mo_timeline_json(mo_window *win)
+{
+    HTChunk *ch = HTChunkCreate(1024);
+    char *json;
+    int i, n = 0;
+
+    HTChunkPutc(ch, '[');
+    for (i = 0; i < MO_TIMELINES; i++) {
+        HTTimeline *tl = (HTTimeline *) win->timelines[(win->timeline_next + i) % MO_TIMELINES];
+
+        if (!tl)
+            continue;
+        HTChunkPuts(ch, n++ ? ",\n" : "\n");
+        HTTimelineJSON(ch, tl);
+    }
+    HTChunkPuts(ch, "]\n");
+    HTChunkTerminate(ch);
+
+    json = ch->data;
+    free(ch);
+    return json;
+}
+
+static XmxCallback(timeline_win_cb)
+{
+    mo_window *win = mo_fetch_window_by_id(XmxExtractUniqid((int)client_data));
+
+    switch (XmxExtractToken((int)client_data)) {
+    case 0:                    /* CLEAR */
+        mo_free_timelines(win);
+        mo_update_timeline_window(win);
+        break;
+    case 1:                    /* DISMISS */
+        XtUnmanageChild(win->timeline_win);
+        break;
+    }
+
+    return;
+}
+
+mo_status mo_post_timeline_window(mo_window *win)
+{
+    Widget dialog_frame;
+    Widget dialog_sep, buttons_form;
+    Widget timeline_form;
+
+    if (!win->timeline_win) {
+        /* Create it for the first time. */
+        XmxSetUniqid(win->id);
+
+        win->timeline_win = XmxMakeFormDialog(win->base, "NCSA Mosaic: Load Timeline");
+        dialog_frame = XmxMakeFrame(win->timeline_win, XmxShadowOut);
+
+        /* Constraints for base. */
+        XmxSetConstraints
+            (dialog_frame, XmATTACH_FORM, XmATTACH_FORM, XmATTACH_FORM, XmATTACH_FORM, NULL, NULL, NULL, NULL);
+
+        /* Main form. */
+        timeline_form = XmxMakeForm(dialog_frame);
+
+        XmxSetArg(XmNscrolledWindowMarginWidth, 10);
+        XmxSetArg(XmNscrolledWindowMarginHeight, 10);
+        XmxSetArg(XmNcursorPositionVisible, False);
+        XmxSetArg(XmNeditable, False);
+        XmxSetArg(XmNeditMode, XmMULTI_LINE_EDIT);
+        XmxSetArg(XmNrows, 20);
+        XmxSetArg(XmNcolumns, 90);
+        win->timeline_text = XmxMakeScrolledText(timeline_form);
+
+        dialog_sep = XmxMakeHorizontalSeparator(timeline_form);
+
+        buttons_form = XmxMakeFormAndTwoButtonsSqueezed(timeline_form, timeline_win_cb, "Clear", "Dismiss", 0, 1);
+
+        XmxSetConstraints(XtParent(win->timeline_text),
+                          XmATTACH_FORM, XmATTACH_WIDGET, XmATTACH_FORM, XmATTACH_FORM, NULL, dialog_sep, NULL, NULL);
+        XmxSetArg(XmNtopOffset, 10);
+        XmxSetConstraints
+            (dialog_sep, XmATTACH_NONE, XmATTACH_WIDGET, XmATTACH_FORM, XmATTACH_FORM, NULL, buttons_form, NULL, NULL);
+        XmxSetConstraints
+            (buttons_form, XmATTACH_NONE, XmATTACH_FORM, XmATTACH_FORM, XmATTACH_FORM, NULL, NULL, NULL, NULL);
+    }
+
+    XmxManageRemanage(win->timeline_win);
+    mo_update_timeline_window(win);
+
+    return mo_succeed;
+}
+
+/* One load, newest first in the dialog.  Stages without a byte count
+   leave the column blank, and inline images are named at the end of
+   their lines. */
+static void timeline_describe(HTChunk *ch, HTTimeline *tl)
+{
+    char line[256], when[64];
+    HTTimelineEvent *ev;
+    time_t started = tl->begun.tv_sec;
+    int i;
+
+    HTChunkPuts(ch, tl->url);
+    strftime(when, sizeof(when), "%a %b %d %H:%M:%S %Y", localtime(&started));
+    sprintf(line, "\nStarted %s, %ld ms in all", when, tl->total);
+    HTChunkPuts(ch, line);
+    if (tl->dropped) {
+        sprintf(line, ", %d events not kept", tl->dropped);
+        HTChunkPuts(ch, line);
+    }
+    HTChunkPuts(ch, "\n\n     start       end      bytes  stage\n");
+
+    for (i = 0, ev = tl->events; i < tl->count; i++, ev++) {
+        sprintf(line, "%10ld%10ld", ev->start, ev->end);
+        HTChunkPuts(ch, line);
+        if (ev->bytes >= 0)
+            sprintf(line, " %10ld  %-13s", ev->bytes, HTTimelineStageName(ev->stage));
+        else
+            sprintf(line, " %10s  %-13s", "", HTTimelineStageName(ev->stage));
+        HTChunkPuts(ch, line);
+        if (ev->url)
+            HTChunkPuts(ch, ev->url);
+        HTChunkPutc(ch, '\n');
+    }
+}
+
+mo_status mo_update_timeline_window(mo_window *win)
+{
+    HTChunk *ch;
+    int i, n = 0;
+
+    if (!win->timeline_text)
+        return mo_fail;
+
+    ch = HTChunkCreate(1024);
+    for (i = 1; i <= MO_TIMELINES; i++) {
+        HTTimeline *tl = (HTTimeline *) win->timelines[(win->timeline_next + MO_TIMELINES - i) % MO_TIMELINES];
+
+        if (!tl)
+            continue;
+        if (n++)
+            HTChunkPuts(ch, "\n\n");
+        timeline_describe(ch, tl);
+    }
+    if (!n)
+        HTChunkPuts(ch, "No loads have been timed in this window yet.\n");
+    HTChunkTerminate(ch);
+
+    XmxTextSetString(win->timeline_text, ch->data);
+    HTChunkFree(ch);
+
+    return mo_succeed;
+}
@@ -67,6 +67,11 @@
 
 extern mo_status mo_post_links_window(mo_window *);
 extern mo_status mo_update_links_window(mo_window *);
+extern mo_status mo_post_timeline_window(mo_window *);
+extern mo_status mo_update_timeline_window(mo_window *);
+extern mo_status mo_timeline_end(mo_window *);
+extern void mo_free_timelines(mo_window *);
+extern char *mo_timeline_json(mo_window *);
 char *mo_special_urls(char *url);
 void System(char *cmd, char *title);
 
@@ -60,6 +60,7 @@
 #include "gui-ftp.h"
 #include "gui-popup.h"          /* for callback struct definition */
 #include "gui-dialogs.h"
+#include "gui-extras.h"
 #include "gui-news.h"
 #include "cci.h"
 #include "cciBindings.h"
@@ -1180,6 +1181,9 @@ XmxCallback(menubar_cb)
     case mo_links_window:
         mo_post_links_window(win);
         break;
+    case mo_timeline_window:
+        mo_post_timeline_window(win);
+        break;
 #ifdef HAVE_AUDIO_ANNOTATIONS
     case mo_audio_annotate:
         if (cci_event)
@@ -1607,13 +1611,14 @@ mo_status mo_init_menubar(void)
                        undr_menuspec) DEFINE_MENUBAR("Agent Spoofs", "g", NULL, 0, agent_menuspec)
         NULL_MENUBAR()
         /* Navigation Menu */
-        ALLOC_MENUBAR(navi_menuspec, 15)
+        ALLOC_MENUBAR(navi_menuspec, 16)
         DEFINE_MENUBAR("Back", "B", menubar_cb, mo_back, NULL)
         DEFINE_MENUBAR("Forward", "F", menubar_cb, mo_forward, NULL)
         SPACER()DEFINE_MENUBAR("Home Document", "D", menubar_cb,
                                mo_home_document,
                                NULL) DEFINE_MENUBAR("Window History...", "W", menubar_cb, mo_history_list, NULL)
-        DEFINE_MENUBAR("Document Links...", "L", menubar_cb, mo_links_window,
+        DEFINE_MENUBAR("Document Links...", "L", menubar_cb, mo_links_window, NULL)
+        DEFINE_MENUBAR("Load Timeline...", "T", menubar_cb, mo_timeline_window,
                        NULL) SPACER()DEFINE_MENUBAR("Hotlist...", "H", menubar_cb, mo_hotlist_postit, NULL)
         DEFINE_MENUBAR("Add Current To Hotlist", "A", menubar_cb,
                        mo_register_node_in_default_hotlist,
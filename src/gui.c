@@ -55,14 +55,19 @@
 #include "mosaic.h"
 #include "gui.h"
 #include "gui-documents.h"
+#include "gui-extras.h"
 #include "main.h"
 #include "mo-www.h"
+#include "globalhist.h"
 #include "gui-menubar.h"
 #include "proxy.h"
 #include "pan.h"
 #include "pixmaps.h"
 #include "libnut/system.h"
 #include "libwww2/HTAABrow.h"
+#include "libwww2/HTAlert.h"
+#include "libwww2/HTAnchor.h"
+#include "history.h"
 
 struct Proxy *noproxy_list = NULL, *proxy_list = NULL, *ReadProxies();
 
@@ -1101,9 +1106,9 @@ static XmxCallback(anchor_cb)
  * returns: 
  *   1 if href has been visited previously; 0 otherwise.
  * remarks: 
- *   All this does is canonicalize the URL and call
- *   mo_been_here_before_huh_dad() to figure out if we've been
- *   there before.
+ *   All this does is call mo_anchor_visited_huh(), which
+ *   canonicalizes the URL against the current document and
+ *   remembers the answer for the next anchor with the same href.
  ****************************************************************************/
 int anchor_visited_predicate(Widget w, char *href)
 {
@@ -1114,11 +1119,8 @@ int anchor_visited_predicate(Widget w, char *href)
 
     /* This doesn't do special things for data elements inside
        an HDF file, because it's faster this way. */
-    href = mo_url_canonicalize(href, cached_url);
+    rv = (mo_anchor_visited_huh(href, cached_url) == mo_succeed ? 1 : 0);
 
-    rv = (mo_been_here_before_huh_dad(href) == mo_succeed ? 1 : 0);
-
-    free(href);
     return rv;
 }
 
@@ -1454,13 +1456,23 @@ int mo_gui_check_icon(int twirl)
     mo_window *win = current_win;
     int ret;
     static int cnt = 0;
+    static struct timeval last_check;
 
-    if (twirl != (-1) && twirl > 0) {
-        if (!makeBusy) {
-            cursorAnimCnt = (-1);
-            makeBusy = 1;
-        }
+    if (twirl > 0 && !makeBusy) {
+        cursorAnimCnt = (-1);
+        makeBusy = 1;
+    }
 
+    /* Flushing the display is an X round trip, and the read loops call
+       us for every buffer.  Between checks just hand back whatever
+       interrupt has already been seen; twirl -1 always checks. */
+    if (twirl != (-1) && !HTFeedbackDue(&last_check)) {
+        ret = connect_interrupt;
+        connect_interrupt = 0;
+        return (ret);
+    }
+
+    if (twirl != (-1) && twirl > 0) {
         cnt++;
         if (cnt == 2) {
             animateCursor();
@@ -2930,6 +2942,7 @@ mo_status mo_delete_window(mo_window *win)
     POPDOWN(mailto_form_win);
     POPDOWN(news_win);
     POPDOWN(links_win);
+    POPDOWN(timeline_win);
 #ifdef HAVE_DTM
     POPDOWN(dtmout_win);
 #endif
@@ -2960,6 +2973,8 @@ mo_status mo_delete_window(mo_window *win)
     free(win->search_end);
     win->search_end = NULL;
 
+    mo_free_timelines(win);
+
     /* This will free the win structure (but none of its elements
        individually) and exit if this is the last window in the list. */
     mo_remove_window_from_list(win);
@@ -3120,6 +3135,9 @@ static mo_window *mo_open_window_internal(Widget base, mo_window *parent)
     win->post_data = 0;
     win->news_win = 0;
     win->links_win = 0;
+    win->timeline_win = win->timeline_text = 0;
+    memset(win->timelines, 0, sizeof(win->timelines));
+    win->timeline_next = 0;
     win->news_fsb_win = 0;
     win->mail_fsb_win = 0;
     win->annotate_win = 0;
@@ -4178,6 +4196,9 @@ void mo_do_gui(int argc, char **argv)
 
     twirl_increment = get_pref_int(eTWIRL_INCREMENT);
 
+    /* Keep the anchors of documents still in some window's history. */
+    HTAnchor_isReferenced = mo_url_in_history;
+
     /* Then make a copy of the hostname for shortmachine.
        Don't even ask. */
     shortmachine = strdup(machine);
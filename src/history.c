@@ -60,6 +60,7 @@
 #include <sys/types.h>
 #include "libhtmlw/HTML.h"
 #include "compat.h"
+#include "../libnut/str-tools.h"
 
 #define __SRC__
 #include "../libwww2/HTAAUtil.h"
@@ -186,6 +187,26 @@ mo_status mo_add_node_to_history(mo_window *win, mo_node *node)
     return mo_succeed;
 }
 
+/* -------------------------- mo_url_in_history -------------------------- */
+
+/* libwww2 asks this before it throws away the anchor it keeps for a
+   document (see HTAnchor_isReferenced); url has no #target, so match
+   any history entry that is url with or without one. */
+int mo_url_in_history(char *url)
+{
+    mo_window *win = NULL;
+    mo_node *node;
+    int len = strlen(url);
+
+    while ((win = mo_next_window(win)))
+        for (node = win->history; node != NULL; node = node->next)
+            if (node->url && !my_strncasecmp(node->url, url, len) &&
+                (node->url[len] == '\0' || node->url[len] == '#'))
+                return 1;
+
+    return 0;
+}
+
 /* ---------------------------- mo_grok_title ----------------------------- */
 
 /* Make up an appropriate title for a document that does not otherwise
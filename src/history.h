@@ -71,6 +71,7 @@ mo_status mo_kill_node (mo_window *, mo_node *);
 mo_status mo_kill_node_descendents (mo_window *, mo_node *);
 mo_status mo_add_node_to_history (mo_window *, mo_node *);
 char *mo_grok_title (mo_window *, char *, char *);
+int mo_url_in_history (char *);
 mo_status mo_record_visit (mo_window *, char *, char *, 
                                   char *, char *, char *, char *);
 mo_status mo_back_node (mo_window *);
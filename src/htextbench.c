@@ -0,0 +1,211 @@
+/****************************************************************************
+ * NCSA Mosaic for the X Window System                                      *
+ * Software Development Group                                               *
+ * National Center for Supercomputing Applications                          *
+ * University of Illinois at Urbana-Champaign                               *
+ * 605 E. Springfield, Champaign IL 61820                                   *
+ * mosaic@ncsa.uiuc.edu                                                     *
+ *                                                                          *
+ * Copyright (C) 1993, Board of Trustees of the University of Illinois      *
+ *                                                                          *
+ * NCSA Mosaic software, both binary and source (hereafter, Software) is    *
+ * copyrighted by The Board of Trustees of the University of Illinois       *
+ * (UI), and ownership remains with the UI.                                 *
+ *                                                                          *
+ * The UI grants you (hereafter, Licensee) a license to use the Software    *
+ * for academic, research and internal business purposes only, without a    *
+ * fee.  Licensee may distribute the binary and source code (if released)   *
+ * to third parties provided that the copyright notice and this statement   *
+ * appears on all copies and that no charge is associated with such         *
+ * copies.                                                                  *
+ *                                                                          *
+ * Licensee may make derivative works.  However, if Licensee distributes    *
+ * any derivative work based on or derived from the Software, then          *
+ * Licensee will (1) notify NCSA regarding its distribution of the          *
+ * derivative work, and (2) clearly notify users that such derivative       *
+ * work is a modified version and not the original NCSA Mosaic              *
+ * distributed by the UI.                                                   *
+ *                                                                          *
+ * Any Licensee wishing to make commercial use of the Software should       *
+ * contact the UI, c/o NCSA, to negotiate an appropriate license for such   *
+ * commercial use.  Commercial use includes (1) integration of all or       *
+ * part of the source code into a product for sale or license by or on      *
+ * behalf of Licensee to third parties, or (2) distribution of the binary   *
+ * code or source code to third parties that need it to utilize a           *
+ * commercial product sold or licensed by or on behalf of Licensee.         *
+ *                                                                          *
+ * UI MAKES NO REPRESENTATIONS ABOUT THE SUITABILITY OF THIS SOFTWARE FOR   *
+ * ANY PURPOSE.  IT IS PROVIDED "AS IS" WITHOUT EXPRESS OR IMPLIED          *
+ * WARRANTY.  THE UI SHALL NOT BE LIABLE FOR ANY DAMAGES SUFFERED BY THE    *
+ * USERS OF THIS SOFTWARE.                                                  *
+ *                                                                          *
+ * By using or copying this Software, Licensee agrees to abide by the       *
+ * copyright law and all other applicable laws of the U.S. including, but   *
+ * not limited to, export control laws, and the terms of this license.      *
+ * UI shall have the right to terminate this license immediately by         *
+ * written notice upon Licensee's breach of, or non-compliance with, any    *
+ * of its terms.  Licensee may be held legally responsible for any          *
+ * copyright infringement that is caused or encouraged by Licensee's        *
+ * failure to abide by the terms of this license.                           *
+ *                                                                          *
+ * Comments and questions are welcome and can be sent to                    *
+ * mosaic-x@ncsa.uiuc.edu.                                                  *
+ ****************************************************************************/
+/* htextbench -- time documents going into an HText.
+
+   Each file is pushed through the libwww HTML presenter (the stream
+   HTParseFile sets up for a local text/html file) in the same 64 KB
+   blocks HTFileCopy reads, once without and once with the size hint
+   HTParseFile now passes along, and the time per load is reported.
+
+   usage: htextbench [-n repeat] file ...
+
+   Build with "make htextbench" once libwww2 has been built. */
+
+#include "../config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "HTUtils.h"
+#include "HTFormat.h"
+#include "HTMosaicHTML.h"
+#include "HText.h"
+#include "mo-htext.h"
+#include "../libnut/system.h"
+
+#define BLOCK_SIZE 65536        /* INPUT_BUFFER_SIZE in HTFormat.c */
+
+struct _HTStream {
+    WWW_CONST HTStreamClass *isa;
+    /* ... */
+};
+
+/* Not in <string.h> under POSIX.2. */
+extern char *strdup();
+
+/* What the presenter needs from the rest of Mosaic. */
+int www2Trace = 0;
+int loading_length = -1;
+char *uncompress_program = "uncompress";
+char *gunzip_program = "gunzip";
+
+void HTProgress(char *msg)
+{
+}
+
+void application_user_feedback(char *str)
+{
+}
+
+void application_user_info_wait(char *str)
+{
+}
+
+char *mo_tmpnam(char *url)
+{
+    return strdup("/tmp/htextbench");
+}
+
+void HTFileCopyToText(FILE *fp, HText *text)
+{
+    fclose(fp);
+}
+
+/* Only reached when decompressing with an external program. */
+int my_system(char *cmd, char *retBuf, int bufsize)
+{
+    return SYS_NO_COMMAND;
+}
+
+int my_move(char *src, char *dest, char *retBuf, int bufsize, int overwrite)
+{
+    return SYS_NO_COMMAND;
+}
+
+static double now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* Push buf through a fresh presenter; returns the seconds it took. */
+static double load(char *buf, int len, int hint)
+{
+    HTStream *stream;
+    HText *text;
+    double start;
+    int off, n;
+
+    start = now();
+    loading_length = hint ? len : -1;
+    stream = HTMosaicHTMLPresent(NULL, NULL, NULL, NULL, 0);
+    loading_length = -1;
+    text = HTMainText;
+
+    for (off = 0; off < len; off += n) {
+        n = (len - off < BLOCK_SIZE) ? len - off : BLOCK_SIZE;
+        (*stream->isa->put_block) (stream, buf + off, n);
+    }
+    (*stream->isa->end_document) (stream);
+    (*stream->isa->free) (stream);
+
+    if (HText_getTextLength(text) != len + 1)
+        fprintf(stderr, "htextbench: got %d bytes, expected %d\n", HText_getTextLength(text) - 1, len);
+
+    /* Mosaic proper would take the text over here. */
+    free(text->htmlSrc);
+    text->htmlSrc = NULL;
+    return now() - start;
+}
+
+int main(int argc, char **argv)
+{
+    int repeat = 10, i, r, hint;
+    double secs[2];
+    struct stat st;
+    FILE *fp;
+    char *buf;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else
+            break;
+    }
+    if (i >= argc || repeat < 1) {
+        fprintf(stderr, "usage: %s [-n repeat] file ...\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-32s %10s %12s %12s\n", "file", "bytes", "ms/load", "hinted ms");
+    for (; i < argc; i++) {
+        if (stat(argv[i], &st) != 0 || !(fp = fopen(argv[i], "r"))) {
+            perror(argv[i]);
+            continue;
+        }
+        buf = (char *)malloc(st.st_size + 1);
+        if (!buf || fread(buf, 1, st.st_size, fp) != (size_t) st.st_size) {
+            fprintf(stderr, "htextbench: can't read %s\n", argv[i]);
+            fclose(fp);
+            free(buf);
+            continue;
+        }
+        fclose(fp);
+
+        for (hint = 0; hint < 2; hint++) {
+            secs[hint] = 0.0;
+            for (r = 0; r < repeat; r++)
+                secs[hint] += load(buf, (int)st.st_size, hint);
+        }
+        printf("%-32s %10ld %12.3f %12.3f\n", argv[i], (long)st.st_size,
+               secs[0] * 1000.0 / repeat, secs[1] * 1000.0 / repeat);
+        free(buf);
+    }
+    return 0;
+}
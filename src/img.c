@@ -59,8 +59,10 @@
 #include "globalhist.h"
 #include "picread.h"
 #include "libhtmlw/HTML.h"
+#include "libwww2/HTTimeline.h"
 #include "cci.h"
 #include "compat.h"
+#include <sys/stat.h>
 extern int cci_event;
 
 #ifndef DISABLE_TRACE
@@ -270,6 +272,8 @@ ImageInfo *ImageResolve(Widget w, char *src, int noload, char *wid, char *hei)
     int widthbyheight = 0;
     char *fnam;
     int rc;
+    long started;
+    struct stat st;
     int bg, bg_red, bg_green, bg_blue;
 #ifdef HAVE_HDF
     int ishdf = 0;
@@ -509,15 +513,19 @@ ImageInfo *ImageResolve(Widget w, char *src, int noload, char *wid, char *hei)
         if (w) {
 
             /* We have to load the image. */
-            fnam = mo_tmpnam(src);
+            fnam = mo_spoolnam(src);
 
             interrupted = 0;
+            HTTimelineSubject(src);
+            started = HTTimelineNow();
             rc = mo_pull_er_over_virgin(src, fnam);
             if (!rc) {
 #ifndef DISABLE_TRACE
                 if (srcTrace)
                     fprintf(stderr, "mo_pull_er_over_virgin returned %d; bonging\n", rc);
 #endif
+                HTTimelineSubject(NULL);
+                mo_spool_release(fnam);
                 free(fnam);
 
                 return NULL;
@@ -527,6 +535,7 @@ ImageInfo *ImageResolve(Widget w, char *src, int noload, char *wid, char *hei)
             if (srcTrace)
                 fprintf(stderr, "[ImageResolve] Got through mo_pull_er_over_virgin, rc %d\n", rc);
 #endif
+            HTTimelineAdd(HT_TL_IMAGE_FETCH, started, (stat(fnam, &st) ? -1L : (long)st.st_size));
 
 #if 0
             /* This causes problems. */
@@ -545,7 +554,11 @@ ImageInfo *ImageResolve(Widget w, char *src, int noload, char *wid, char *hei)
             MoCCISendBrowserViewFile(src, "unknown", fnam);
         }
 
+        started = HTTimelineNow();
         data = ReadBitmap(fnam, &width, &height, colrs, &bg);
+        if (data != NULL)
+            HTTimelineAdd(HT_TL_IMAGE_DECODE, started, (long)width * height);
+        HTTimelineSubject(NULL);
 
 #ifndef DISABLE_TRACE
         if (srcTrace)
@@ -577,7 +590,7 @@ ImageInfo *ImageResolve(Widget w, char *src, int noload, char *wid, char *hei)
         }
 
         /* Now delete the file. */
-        unlink(fnam);
+        mo_spool_release(fnam);
         {
             char *hfnam = (char *)malloc((strlen(fnam) + strlen(".html") + 5) * sizeof(char));
             sprintf(hfnam, "%s.html", fnam);
@@ -0,0 +1,819 @@
+/****************************************************************************
+ * NCSA Mosaic for the X Window System                                      *
+ * Software Development Group                                               *
+ * National Center for Supercomputing Applications                          *
+ * University of Illinois at Urbana-Champaign                               *
+ * 605 E. Springfield, Champaign IL 61820                                   *
+ * mosaic@ncsa.uiuc.edu                                                     *
+ *                                                                          *
+ * Copyright (C) 1993, Board of Trustees of the University of Illinois      *
+ *                                                                          *
+ * NCSA Mosaic software, both binary and source (hereafter, Software) is    *
+ * copyrighted by The Board of Trustees of the University of Illinois       *
+ * (UI), and ownership remains with the UI.                                 *
+ *                                                                          *
+ * The UI grants you (hereafter, Licensee) a license to use the Software    *
+ * for academic, research and internal business purposes only, without a    *
+ * fee.  Licensee may distribute the binary and source code (if released)   *
+ * to third parties provided that the copyright notice and this statement   *
+ * appears on all copies and that no charge is associated with such         *
+ * copies.                                                                  *
+ *                                                                          *
+ * Licensee may make derivative works.  However, if Licensee distributes    *
+ * any derivative work based on or derived from the Software, then          *
+ * Licensee will (1) notify NCSA regarding its distribution of the          *
+ * derivative work, and (2) clearly notify users that such derivative       *
+ * work is a modified version and not the original NCSA Mosaic              *
+ * distributed by the UI.                                                   *
+ *                                                                          *
+ * Any Licensee wishing to make commercial use of the Software should       *
+ * contact the UI, c/o NCSA, to negotiate an appropriate license for such   *
+ * commercial use.  Commercial use includes (1) integration of all or       *
+ * part of the source code into a product for sale or license by or on      *
+ * behalf of Licensee to third parties, or (2) distribution of the binary   *
+ * code or source code to third parties that need it to utilize a           *
+ * commercial product sold or licensed by or on behalf of Licensee.         *
+ *                                                                          *
+ * UI MAKES NO REPRESENTATIONS ABOUT THE SUITABILITY OF THIS SOFTWARE FOR   *
+ * ANY PURPOSE.  IT IS PROVIDED "AS IS" WITHOUT EXPRESS OR IMPLIED          *
+ * WARRANTY.  THE UI SHALL NOT BE LIABLE FOR ANY DAMAGES SUFFERED BY THE    *
+ * USERS OF THIS SOFTWARE.                                                  *
+ *                                                                          *
+ * By using or copying this Software, Licensee agrees to abide by the       *
+ * copyright law and all other applicable laws of the U.S. including, but   *
+ * not limited to, export control laws, and the terms of this license.      *
+ * UI shall have the right to terminate this license immediately by         *
+ * written notice upon Licensee's breach of, or non-compliance with, any    *
+ * of its terms.  Licensee may be held legally responsible for any          *
+ * copyright infringement that is caused or encouraged by Licensee's        *
+ * failure to abide by the terms of this license.                           *
+ *                                                                          *
+ * Comments and questions are welcome and can be sent to                    *
+ * mosaic-x@ncsa.uiuc.edu.                                                  *
+ ****************************************************************************/
+/* loadbench -- time pages through Mosaic's load pipeline, headless.
+
+   Each page is loaded the way Mosaic loads one: HTLoadAbsolute takes
+   it through HTMIME into an HText, HTMLParse turns the text into the
+   markup list the widget formats from, and every inline image is
+   pulled over into a spool and decoded as ImageResolve would, each
+   distinct SRC once per page as the image cache has it.  For each
+   stage the time, the number of allocations and the bytes moved are
+   reported per load:
+
+     load      bytes that landed in the HText
+     parse     bytes copied into the markup list
+     images    bytes written to spools, plus decoded pixels
+
+   Formatting is left out; FormatAll needs a realized HTML widget and
+   so a display.
+
+   The pages come from a corpus directory, either served over HTTP by
+   a small server forked for the run, listening on 127.0.0.1, or with
+   -f read through file: URLs.  With no pages named, every .html file
+   at the top of the corpus is loaded.  The exit status is 1 if any
+   page failed to load, so a run can gate a change.
+
+   usage: loadbench [-n repeat] [-f] corpus [page ...]
+
+   Allocations are counted only with the GNU C library.
+
+   Build with "make loadbench" once libwww2, libhtmlw and libnut have
+   been built.  loadbench-corpus has a few pages to start with: text,
+   tables, a form, and GIF, PNG and JPEG images, some used twice:
+
+     ./loadbench -n 20 loadbench-corpus */
+
+#include "../config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "HTUtils.h"
+#include "HTAccess.h"
+#include "HTParse.h"
+#include "HTSpool.h"
+#include "HText.h"
+#include "mo-htext.h"
+#include "libhtmlw/HTML.h"
+#include "gifread.h"
+#ifdef HAVE_PNG
+#include "readPNG.h"
+#endif
+#ifdef HAVE_JPEG
+#include "readJPEG.h"
+#endif
+
+/* Not in <string.h> under POSIX.2. */
+extern char *strdup();
+
+/* From libhtmlw. */
+extern struct mark_up *HTMLParse();
+extern char *ParseMarkTag();
+extern void FreeObjList();
+
+#define STAGE_LOAD 0
+#define STAGE_PARSE 1
+#define STAGE_IMAGES 2
+#define NSTAGES 3
+
+static char *stage_names[NSTAGES] = { "load", "parse", "images" };
+
+struct stage {
+    double secs;
+    long allocs;
+    long alloc_bytes;
+    long copied;
+};
+
+static long allocs = 0;
+static long alloc_bytes = 0;
+
+#ifdef __GLIBC__
+/* Count every allocation the pipeline makes; glibc lets a program
+   supply its own malloc and still reach the real one. */
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+
+void *malloc(size_t n)
+{
+    allocs++;
+    alloc_bytes += n;
+    return __libc_malloc(n);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    allocs++;
+    alloc_bytes += n * size;
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t n)
+{
+    allocs++;
+    alloc_bytes += n;
+    return __libc_realloc(p, n);
+}
+#endif
+
+/* What libwww, libhtmlw and the image readers need from the rest of
+   Mosaic.  The stand-in server is always reached directly, and there
+   is nobody to ask anything. */
+int htmlwTrace = 0;
+int srcTrace = 0;
+int tableSupportEnabled = 1;
+int loading_inlined_images = 0;
+int twirl_increment = 4096;
+int force_dump_to_file = 0;
+char *force_dump_filename = NULL;
+int binary_transfer = 0;
+char *HTReferer = NULL;
+char *machine_with_domain = "localhost";
+char *loadbench_agent[] = { "NCSA Mosaic loadbench", NULL };
+char **agent = loadbench_agent;
+int selectedAgent = 0;
+XtAppContext app_context = NULL;
+int use_default_type_map = 1;
+int use_default_extension_map = 1;
+char *global_type_map = "/dev/null";
+char *personal_type_map = "/dev/null";
+char *global_extension_map = "/dev/null";
+char *personal_extension_map = "/dev/null";
+char *global_xterm_str = "xterm";
+char *uncompress_program = "uncompress";
+char *gunzip_program = "gunzip";
+int have_hdf = 0;
+int tweak_gopher_types = 0;
+int ftp_timeout_val = 0;
+int ftpRedial = 0;
+int ftpRedialSleep = 0;
+int ftpFilenameLength = 26;
+int ftpEllipsisLength = 3;
+int ftpEllipsisMode = 0;
+int newsNoNewsRC = 1;
+char *userPath = NULL;
+
+static char no_proxy;
+
+void *GetNoProxy(char *access, char *host)
+{
+    return &no_proxy;
+}
+
+void *MatchProxy(char *access, char *host, int method, void *last)
+{
+    return NULL;
+}
+
+void ClearTempBongedProxies(void)
+{
+}
+
+int has_fallbacks(char *protocol)
+{
+    return 0;
+}
+
+int mo_busy(void)
+{
+    return 1;
+}
+
+int mo_not_busy(void)
+{
+    return 1;
+}
+
+int mo_gui_check_icon(int twirl)
+{
+    return 0;
+}
+
+void mo_gui_clear_icon(void)
+{
+}
+
+void mo_gui_done_with_icon(void)
+{
+}
+
+void mo_gui_notify_progress(char *msg)
+{
+}
+
+void mo_gui_update_meter(int level, char *text)
+{
+}
+
+void application_error(char *str, char *title)
+{
+    fprintf(stderr, "loadbench: %s\n", str);
+}
+
+void application_user_feedback(char *str)
+{
+}
+
+void application_user_info_wait(char *str)
+{
+}
+
+char *prompt_for_string(char *questionstr)
+{
+    return NULL;
+}
+
+char *prompt_for_password(char *questionstr)
+{
+    return NULL;
+}
+
+int prompt_for_yes_or_no(char *questionstr)
+{
+    return 0;
+}
+
+void rename_binary_file(char *fnam)
+{
+}
+
+/* Only reached by the internal image viewer. */
+ImageInfo *ImageResolve(Widget w, char *src, int noload, char *wid, char *hei)
+{
+    return NULL;
+}
+
+int GetMailtoKludgeInfo(char **url, char **subject)
+{
+    return 0;
+}
+
+void mo_post_mailto_win(char *to_address, char *subject)
+{
+}
+
+char *KCMS_Return_Format(void)
+{
+    return NULL;
+}
+
+/* The colors JPEGs are quantized to; nothing else asks. */
+int get_pref_int(long pref_id)
+{
+    return 50;
+}
+
+Boolean get_pref_boolean(long pref_id)
+{
+    return False;
+}
+
+void set_pref(long pref_id, void *incoming)
+{
+}
+
+XtIntervalId XtAppAddTimeOut(XtAppContext app, unsigned long interval, XtTimerCallbackProc proc, XtPointer closure)
+{
+    return 0;
+}
+
+void XtRemoveTimeOut(XtIntervalId timer)
+{
+}
+
+/* News and MD5 authentication, never reached here. */
+void newsrc_init(char *host)
+{
+}
+
+void *firstgroup(int mask)
+{
+    return NULL;
+}
+
+void *nextgroup(void *ng)
+{
+    return NULL;
+}
+
+void *findgroup(char *name)
+{
+    return NULL;
+}
+
+void *addgroup(char *name, long first, long last, int unused)
+{
+    return NULL;
+}
+
+int isread(void *ng, long art)
+{
+    return 0;
+}
+
+void markread(void *ng, long art)
+{
+}
+
+void markrangeread(void *ng, long start, long end)
+{
+}
+
+void setminmax(void *ng, long min, long max)
+{
+}
+
+void rereadseq(void *ng)
+{
+}
+
+void MD5Mem(unsigned char *data, int len, unsigned char *digest)
+{
+}
+
+char *MD5Convert_to_Hex(unsigned char *digest)
+{
+    return strdup("");
+}
+
+int NoBodyColors(Widget w)
+{
+    return 1;
+}
+
+int NoBodyImages(Widget w)
+{
+    return 1;
+}
+
+void hw_do_bg(Widget w, char *bgname)
+{
+}
+
+void hw_do_color(Widget w, char *att, char *cname)
+{
+}
+
+char *mo_tmpnam(char *url)
+{
+    static int n = 0;
+    char *tmp = (char *)malloc(64);
+
+    sprintf(tmp, "/tmp/loadbench.%ld.%d", (long)getpid(), n++);
+    return tmp;
+}
+
+static double now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static struct stage mark;
+
+static void begin_stage(void)
+{
+    mark.secs = now();
+    mark.allocs = allocs;
+    mark.alloc_bytes = alloc_bytes;
+}
+
+static void end_stage(struct stage *st, long copied)
+{
+    st->secs += now() - mark.secs;
+    st->allocs += allocs - mark.allocs;
+    st->alloc_bytes += alloc_bytes - mark.alloc_bytes;
+    st->copied += copied;
+}
+
+/* ------------------------------ the server ------------------------------ */
+
+static struct {
+    char *suffix;
+    char *type;
+} types[] = {
+    { ".html", "text/html" },
+    { ".htm", "text/html" },
+    { ".gif", "image/gif" },
+    { ".jpg", "image/jpeg" },
+    { ".jpeg", "image/jpeg" },
+    { ".png", "image/png" },
+    { ".xbm", "image/x-xbitmap" },
+    { NULL, "text/plain" }
+};
+
+/* Answer one request with a file from the corpus, HTTP/1.0 style. */
+static void answer(int soc, char *corpus)
+{
+    char req[4096], path[2048], buf[8192];
+    char *p, *type;
+    int len = 0, n, fd, i;
+    struct stat st;
+
+    while (len < (int)sizeof(req) - 1 && (n = read(soc, req + len, sizeof(req) - 1 - len)) > 0) {
+        len += n;
+        req[len] = '\0';
+        if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n"))
+            break;
+    }
+    req[len] = '\0';
+
+    if (strncmp(req, "GET /", 5) || !(p = strpbrk(req + 4, " ?#\r\n")) ||
+        strstr(req, "..") || (int)(strlen(corpus) + (p - req)) >= (int)sizeof(path)) {
+        fd = -1;
+    } else {
+        *p = '\0';
+        sprintf(path, "%s%s", corpus, req + 4);
+        fd = open(path, O_RDONLY);
+    }
+    if (fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        p = "HTTP/1.0 404 Not Found\r\nContent-Type: text/html\r\n\r\n<H1>Not Found</H1>\n";
+        write(soc, p, strlen(p));
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    for (i = 0; types[i].suffix; i++) {
+        n = strlen(path) - strlen(types[i].suffix);
+        if (n > 0 && !strcmp(path + n, types[i].suffix))
+            break;
+    }
+    type = types[i].type;
+    sprintf(buf, "HTTP/1.0 200 OK\r\nContent-Type: %s\r\nContent-Length: %ld\r\n\r\n", type, (long)st.st_size);
+    write(soc, buf, strlen(buf));
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        if (write(soc, buf, n) != n)
+            break;
+    close(fd);
+}
+
+/* Fork the server; returns its pid and sets *port, or returns -1. */
+static pid_t start_server(char *corpus, int *port)
+{
+    struct sockaddr_in sin;
+    socklen_t sinlen = sizeof(sin);
+    int soc, c;
+    pid_t pid;
+
+    if ((soc = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        perror("loadbench: socket");
+        return -1;
+    }
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sin.sin_port = 0;
+    if (bind(soc, (struct sockaddr *)&sin, sizeof(sin)) < 0 || listen(soc, 16) < 0 ||
+        getsockname(soc, (struct sockaddr *)&sin, &sinlen) < 0) {
+        perror("loadbench: bind");
+        close(soc);
+        return -1;
+    }
+    *port = ntohs(sin.sin_port);
+
+    fflush(stdout);
+    if ((pid = fork()) == 0) {
+        signal(SIGPIPE, SIG_IGN);
+        for (;;) {
+            if ((c = accept(soc, NULL, NULL)) < 0)
+                continue;
+            answer(c, corpus);
+            close(c);
+        }
+    }
+    close(soc);
+    if (pid < 0)
+        perror("loadbench: fork");
+    return pid;
+}
+
+/* ------------------------------ the pipeline ---------------------------- */
+
+/* Decode an image the way ReadBitmap does, less the formats that need
+   a display; returns the size of the decoded image, or 0. */
+static long decode(char *fnam)
+{
+    XColor colrs[256];
+    unsigned char *data = NULL;
+    int w = 0, h = 0, bg = -1;
+    FILE *fp;
+
+    if (!(fp = fopen(fnam, "r")))
+        return 0;
+    data = ReadGIF(fp, &w, &h, colrs, &bg);
+#ifdef HAVE_PNG
+    if (!data) {
+        rewind(fp);
+        data = ReadPNG(fp, &w, &h, colrs);
+    }
+#endif
+#ifdef HAVE_JPEG
+    /* ReadJPEG closes the file when it fails. */
+    if (!data) {
+        rewind(fp);
+        data = ReadJPEG(fp, &w, &h, colrs);
+        if (!data)
+            return 0;
+    }
+#endif
+    fclose(fp);
+    if (!data)
+        return 0;
+    free(data);
+    return (long)w * h;
+}
+
+/* Pull an inline image over into a spool, as mo_pull_er_over_virgin
+   does, and decode it; returns the bytes moved, or -1. */
+static long load_image(char *url)
+{
+    struct stat st;
+    char *fnam;
+    long bytes = -1;
+    int rv;
+
+    if (!(fnam = HTSpoolNew()))
+        fnam = mo_tmpnam(url);
+
+    force_dump_to_file = 1;
+    force_dump_filename = fnam;
+    loading_inlined_images = 1;
+    rv = HTLoadAbsolute(url);
+    loading_inlined_images = 0;
+    force_dump_to_file = 0;
+
+    if (rv == 1 && stat(fnam, &st) == 0)
+        bytes = (long)st.st_size + decode(fnam);
+
+    if (!HTSpoolRelease(fnam))
+        unlink(fnam);
+    free(fnam);
+    return bytes;
+}
+
+struct seen {
+    char *url;
+    struct seen *next;
+};
+
+/* Load one page; returns the number of images, or -1 on failure. */
+static int load_page(char *url, struct stage *st)
+{
+    struct mark_up *list, *m;
+    struct seen *seen = NULL, *s;
+    HText *text;
+    char *src, *iurl;
+    long copied, bytes;
+    int rv, nimages = 0;
+
+    begin_stage();
+    rv = HTLoadAbsolute(url);
+    text = HTMainText;
+    if (rv != 1 || !text || !text->htmlSrc) {
+        end_stage(&st[STAGE_LOAD], 0);
+        return -1;
+    }
+    end_stage(&st[STAGE_LOAD], (long)text->srclen);
+
+    begin_stage();
+    list = HTMLParse(NULL, text->htmlSrc, NULL);
+    copied = 0;
+    for (m = list; m; m = m->next) {
+        if (m->start)
+            copied += strlen(m->start);
+        if (m->text)
+            copied += strlen(m->text);
+    }
+    end_stage(&st[STAGE_PARSE], copied);
+
+    begin_stage();
+    copied = 0;
+    for (m = list; m; m = m->next) {
+        if (m->type != M_IMAGE || m->is_end || !m->start)
+            continue;
+        if (!(src = ParseMarkTag(m->start, MT_IMAGE, "SRC")))
+            continue;
+        iurl = HTParse(src, url, PARSE_ALL);
+        free(src);
+        for (s = seen; s && strcmp(s->url, iurl); s = s->next) ;
+        if (s) {
+            free(iurl);
+            continue;
+        }
+        s = (struct seen *)malloc(sizeof(struct seen));
+        s->url = iurl;
+        s->next = seen;
+        seen = s;
+
+        nimages++;
+        if ((bytes = load_image(iurl)) < 0)
+            fprintf(stderr, "loadbench: can't load image %s\n", iurl);
+        else
+            copied += bytes;
+    }
+    end_stage(&st[STAGE_IMAGES], copied);
+
+    while (seen) {
+        s = seen->next;
+        free(seen->url);
+        free(seen);
+        seen = s;
+    }
+    FreeObjList(list);
+
+    /* Mosaic proper would take the text over here. */
+    free(text->htmlSrc);
+    text->htmlSrc = NULL;
+    return nimages;
+}
+
+static int is_page(char *name)
+{
+    int n = strlen(name);
+
+    return (n > 5 && !strcmp(name + n - 5, ".html"));
+}
+
+int main(int argc, char **argv)
+{
+    struct stage st[NSTAGES], total[NSTAGES];
+    char **pages, *corpus, *base, *url, *path;
+    int repeat = 10, use_file = 0, npages = 0, failed = 0;
+    int port = 0, i, j, r, n, nimages;
+    pid_t server = -1;
+    DIR *dir;
+    struct dirent *de;
+    struct stat sb;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-f"))
+            use_file = 1;
+        else
+            break;
+    }
+    if (i >= argc || argv[i][0] == '-' || repeat < 1) {
+        fprintf(stderr, "usage: %s [-n repeat] [-f] corpus [page ...]\n", argv[0]);
+        return 2;
+    }
+
+    corpus = argv[i++];
+    if (corpus[0] != '/') {
+        char cwd[1024];
+
+        if (!getcwd(cwd, sizeof(cwd))) {
+            perror("loadbench: getcwd");
+            return 2;
+        }
+        base = (char *)malloc(strlen(cwd) + strlen(corpus) + 2);
+        sprintf(base, "%s/%s", cwd, corpus);
+        corpus = base;
+    }
+    while ((n = strlen(corpus)) > 1 && corpus[n - 1] == '/')
+        corpus[n - 1] = '\0';
+
+    pages = (char **)malloc((argc + 1) * sizeof(char *));
+    for (; i < argc; i++)
+        pages[npages++] = argv[i];
+    if (npages == 0) {
+        if (!(dir = opendir(corpus))) {
+            perror(corpus);
+            return 2;
+        }
+        while ((de = readdir(dir))) {
+            if (!is_page(de->d_name))
+                continue;
+            if (npages % 64 == 0)
+                pages = (char **)realloc(pages, (npages + 64) * sizeof(char *));
+            pages[npages++] = strdup(de->d_name);
+        }
+        closedir(dir);
+    }
+    if (npages == 0) {
+        fprintf(stderr, "loadbench: no pages in %s\n", corpus);
+        return 2;
+    }
+
+    if (use_file) {
+        base = (char *)malloc(strlen(corpus) + 16);
+        sprintf(base, "file://localhost%s/", corpus);
+    } else {
+        if ((server = start_server(corpus, &port)) < 0)
+            return 2;
+        base = (char *)malloc(64);
+        sprintf(base, "http://127.0.0.1:%d/", port);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(total, 0, sizeof(total));
+    printf("%-32s %-7s %6s %10s %10s %10s %10s\n",
+           "page", "stage", "images", "ms/load", "allocs", "alloc KB", "copied KB");
+    for (i = 0; i < npages; i++) {
+        url = (char *)malloc(strlen(base) + strlen(pages[i]) + 1);
+        path = (char *)malloc(strlen(corpus) + strlen(pages[i]) + 2);
+        sprintf(url, "%s%s", base, pages[i][0] == '/' ? pages[i] + 1 : pages[i]);
+
+        /* A page the server would answer 404 for still loads. */
+        sprintf(path, "%s/%s", corpus, pages[i]);
+        nimages = -1;
+        if (stat(path, &sb) == 0 && S_ISREG(sb.st_mode)) {
+            /* The first load sets up the format tables and so on. */
+            nimages = load_page(url, st);
+            memset(st, 0, sizeof(st));
+        }
+        for (r = 0; r < repeat && nimages >= 0; r++)
+            nimages = load_page(url, st);
+        if (nimages < 0) {
+            printf("%-32s %s\n", pages[i], "failed");
+            failed++;
+            free(url);
+            free(path);
+            continue;
+        }
+
+        for (j = 0; j < NSTAGES; j++) {
+            printf("%-32s %-7s %6d %10.3f %10ld %10.1f %10.1f\n",
+                   j ? "" : pages[i], stage_names[j], nimages,
+                   st[j].secs * 1000.0 / repeat, st[j].allocs / repeat,
+                   st[j].alloc_bytes / 1024.0 / repeat, st[j].copied / 1024.0 / repeat);
+            total[j].secs += st[j].secs / repeat;
+            total[j].allocs += st[j].allocs / repeat;
+            total[j].alloc_bytes += st[j].alloc_bytes / repeat;
+            total[j].copied += st[j].copied / repeat;
+        }
+        free(url);
+        free(path);
+    }
+
+    for (j = 0; j < NSTAGES; j++)
+        printf("%-32s %-7s %6s %10.3f %10ld %10.1f %10.1f\n",
+               j ? "" : "total", stage_names[j], "",
+               total[j].secs * 1000.0, total[j].allocs,
+               total[j].alloc_bytes / 1024.0, total[j].copied / 1024.0);
+#ifndef __GLIBC__
+    printf("(allocations are not counted on this system)\n");
+#endif
+
+    if (server > 0) {
+        kill(server, SIGTERM);
+        waitpid(server, NULL, 0);
+    }
+    return failed ? 1 : 0;
+}
@@ -55,6 +55,7 @@
 #include "mosaic.h"
 #include "mo-hdf.h"
 #include "mo-dtm.h"
+#include "mo-www.h"
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -91,9 +92,11 @@ static char *pull_guts_from_hdfref(char *target)
  ****************************************************************************/
 char *mo_hdf_fetch_local_filename(char *url)
 {
-    char *cache_url = mo_url_canonicalize(url, "");
+    char buf[MO_URL_BUF];
+    char *cache_url = mo_url_canonicalize_into(url, "", buf, MO_URL_BUF);
     char *rv = (char *)mo_fetch_cached_local_name(cache_url);
-    free(cache_url);
+    if (cache_url != buf)
+        free(cache_url);
     return rv;
 }
 
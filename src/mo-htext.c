@@ -0,0 +1,311 @@
+/****************************************************************************
+ * NCSA Mosaic for the X Window System                                      *
+ * Software Development Group                                               *
+ * National Center for Supercomputing Applications                          *
+ * University of Illinois at Urbana-Champaign                               *
+ * 605 E. Springfield, Champaign IL 61820                                   *
+ * mosaic@ncsa.uiuc.edu                                                     *
+ *                                                                          *
+ * Copyright (C) 1993, Board of Trustees of the University of Illinois      *
+ *                                                                          *
+ * NCSA Mosaic software, both binary and source (hereafter, Software) is    *
+ * copyrighted by The Board of Trustees of the University of Illinois       *
+ * (UI), and ownership remains with the UI.                                 *
+ *                                                                          *
+ * The UI grants you (hereafter, Licensee) a license to use the Software    *
+ * for academic, research and internal business purposes only, without a    *
+ * fee.  Licensee may distribute the binary and source code (if released)   *
+ * to third parties provided that the copyright notice and this statement   *
+ * appears on all copies and that no charge is associated with such         *
+ * copies.                                                                  *
+ *                                                                          *
+ * Licensee may make derivative works.  However, if Licensee distributes    *
+ * any derivative work based on or derived from the Software, then          *
+ * Licensee will (1) notify NCSA regarding its distribution of the          *
+ * derivative work, and (2) clearly notify users that such derivative       *
+ * work is a modified version and not the original NCSA Mosaic              *
+ * distributed by the UI.                                                   *
+ *                                                                          *
+ * Any Licensee wishing to make commercial use of the Software should       *
+ * contact the UI, c/o NCSA, to negotiate an appropriate license for such   *
+ * commercial use.  Commercial use includes (1) integration of all or       *
+ * part of the source code into a product for sale or license by or on      *
+ * behalf of Licensee to third parties, or (2) distribution of the binary   *
+ * code or source code to third parties that need it to utilize a           *
+ * commercial product sold or licensed by or on behalf of Licensee.         *
+ *                                                                          *
+ * UI MAKES NO REPRESENTATIONS ABOUT THE SUITABILITY OF THIS SOFTWARE FOR   *
+ * ANY PURPOSE.  IT IS PROVIDED "AS IS" WITHOUT EXPRESS OR IMPLIED          *
+ * WARRANTY.  THE UI SHALL NOT BE LIABLE FOR ANY DAMAGES SUFFERED BY THE    *
+ * USERS OF THIS SOFTWARE.                                                  *
+ *                                                                          *
+ * By using or copying this Software, Licensee agrees to abide by the       *
+ * copyright law and all other applicable laws of the U.S. including, but   *
+ * not limited to, export control laws, and the terms of this license.      *
+ * UI shall have the right to terminate this license immediately by         *
+ * written notice upon Licensee's breach of, or non-compliance with, any    *
+ * of its terms.  Licensee may be held legally responsible for any          *
+ * copyright infringement that is caused or encouraged by Licensee's        *
+ * failure to abide by the terms of this license.                           *
+ *                                                                          *
+ * Comments and questions are welcome and can be sent to                    *
+ * mosaic-x@ncsa.uiuc.edu.                                                  *
+ ****************************************************************************/
+#include "../config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "HTUtils.h"
+#include "HText.h"
+#include "mo-htext.h"
+
+/* The HText object: libwww hands Mosaic a document by appending it
+   here, and Mosaic proper takes htmlSrc from there.  Nothing in this
+   file touches the GUI, so it can be linked into tools as well. */
+
+#define MO_BUFFER_SIZE 8192
+
+HText *HTMainText = 0;          /* Equivalent of main window */
+
+HText *HText_new(void)
+{
+    HText *htObj = (HText *) malloc(sizeof(HText));
+
+    htObj->expandedAddress = NULL;
+    htObj->simpleAddress = NULL;
+    htObj->htmlSrc = NULL;
+    htObj->htmlSrcHead = NULL;
+    htObj->srcalloc = 0;
+    htObj->srclen = 0;
+
+    /* Free the struct but not the text, as it will be handled
+       by Mosaic proper -- apparently. */
+    if (HTMainText)
+        free(HTMainText);
+
+    HTMainText = htObj;
+
+    return htObj;
+}
+
+void HText_free(HText *self)
+{
+    if (self) {
+        if (self->htmlSrcHead)
+            free(self->htmlSrcHead);
+        free(self);
+    }
+    return;
+}
+
+void HText_beginAppend(HText *text)
+{
+    HTMainText = text;
+    return;
+}
+
+void HText_endAppend(HText *text)
+{
+    if (text) {
+        HText_appendCharacter(text, '\0');
+    }
+    HTMainText = text;
+    return;
+}
+
+void HText_doAbort(HText *self)
+{
+    /* Clean up -- we want to free htmlSrc here because htmlSrcHead
+       doesn't get assigned until hack_htmlsrc, and by the time we
+       reach that, this should never be called. */
+    if (self) {
+        if (self->htmlSrc)
+            free(self->htmlSrc);
+        self->htmlSrc = NULL;
+        self->htmlSrcHead = NULL;
+        self->srcalloc = 0;
+        self->srclen = 0;
+    }
+    return;
+}
+
+void HText_clearOutForNewContents(HText *self)
+{
+    if (self) {
+        if (self->htmlSrc)
+            free(self->htmlSrc);
+        self->htmlSrc = NULL;
+        self->htmlSrcHead = NULL;
+        self->srcalloc = 0;
+        self->srclen = 0;
+    }
+    return;
+}
+
+/* Make room for at least need more bytes.  The buffer doubles each
+   time so that a long document costs a handful of reallocs rather
+   than one per MO_BUFFER_SIZE. */
+static void new_chunk(HText *text, int need)
+{
+    int size;
+
+    size = text->srcalloc ? text->srcalloc : MO_BUFFER_SIZE;
+    while (size < text->srclen + need)
+        size = (size <= INT_MAX / 2) ? size * 2 : text->srclen + need;
+    if (size == text->srcalloc)
+        return;
+
+    if (text->srcalloc == 0) {
+        text->htmlSrc = (char *)malloc(size);
+        text->htmlSrc[0] = '\0';
+    } else {
+        text->htmlSrc = (char *)realloc(text->htmlSrc, size);
+    }
+
+    text->srcalloc = size;
+
+    return;
+}
+
+/* Size hint, e.g. from Content-Length: make room for len more bytes
+   and the trailing NUL in one go. */
+void HText_expectLength(HText *text, int len)
+{
+    char *buf;
+
+    if (!text || len <= 0 || len > INT_MAX - text->srclen - 1)
+        return;
+    if (text->srcalloc >= text->srclen + len + 1)
+        return;
+
+    /* Only a hint: if the space isn't there, grow as we go instead. */
+    if (text->srcalloc == 0) {
+        if (!(buf = (char *)malloc(len + 1)))
+            return;
+        buf[0] = '\0';
+    } else {
+        if (!(buf = (char *)realloc(text->htmlSrc, text->srclen + len + 1)))
+            return;
+    }
+
+    text->htmlSrc = buf;
+    text->srcalloc = text->srclen + len + 1;
+
+    return;
+}
+
+#if defined(__alpha) || defined(_IBMR2)
+void HText_appendCharacter(text, ch)
+HText *text;
+char ch;
+#else
+void HText_appendCharacter(HText *text, char ch)
+#endif
+{
+    if (text->srcalloc < text->srclen + 1)
+        new_chunk(text, 1);
+
+    text->htmlSrc[text->srclen++] = ch;
+
+    return;
+}
+
+void HText_appendText(HText *text, char *str)
+{
+    int len;
+
+    if (!str)
+        return;
+
+    len = strlen(str);
+
+    if (text->srcalloc < text->srclen + len + 1)
+        new_chunk(text, len + 1);
+
+/*  bcopy (str, (text->htmlSrc + text->srclen), len);*/
+    memcpy((text->htmlSrc + text->srclen), str, len);
+
+    text->srclen += len;
+    text->htmlSrc[text->srclen] = '\0';
+
+    return;
+}
+
+void HText_appendBlock(HText *text, char *data, int len)
+{
+    if (!data)
+        return;
+
+    if (text->srcalloc < text->srclen + len + 1)
+        new_chunk(text, len + 1);
+
+/*  bcopy (data, (text->htmlSrc + text->srclen), len);*/
+    memcpy((text->htmlSrc + text->srclen), data, len);
+
+    text->srclen += len;
+    text->htmlSrc[text->srclen] = '\0';
+
+    return;
+}
+
+void HText_appendParagraph(HText *text)
+{
+    /* Boy, talk about a misnamed function. */
+    char *str = " <p> \n";
+
+    HText_appendText(text, str);
+
+    return;
+}
+
+void HText_beginAnchor(HText *text, char *anc)
+{
+    HText_appendText(text, "<A HREF=\"");
+    HText_appendText(text, anc);
+    HText_appendText(text, "\">");
+    return;
+}
+
+void HText_endAnchor(HText *text)
+{
+    HText_appendText(text, "</A>");
+    return;
+}
+
+void HText_dump(HText *me)
+{
+    return;
+}
+
+char *HText_getText(HText *me)
+{
+    if (me)
+        return me->htmlSrc;
+    else
+        return NULL;
+}
+
+char **HText_getPtrToText(HText *me)
+{
+    if (me)
+        return &(me->htmlSrc);
+    else
+        return NULL;
+}
+
+int HText_getTextLength(HText *me)
+{
+    if (me)
+        return me->srclen;
+    else
+        return 0;
+}
+
+/*
+BOOL HText_select (HText *text)
+{
+  return ;
+}
+*/
@@ -107,29 +107,13 @@ char *saveFileName = NULL;
 #include "HText.h"
 #include "HTList.h"
 #include "HTInit.h"
+#include "HTSpool.h"
 #include "libnut/system.h"
 #include "libhtmlw/HTML.h"
-
-#define MO_BUFFER_SIZE 8192
-
-/* Bare minimum. */
-struct _HText {
-    char *expandedAddress;
-    char *simpleAddress;
-
-    /* This is what we should parse and display; it is *not*
-       safe to free. */
-    char *htmlSrc;
-    /* This is what we should free. */
-    char *htmlSrcHead;
-    int srcalloc;               /* amount of space allocated */
-    int srclen;                 /* amount of space used */
-};
+#include "mo-htext.h"
 
 /* Mosaic does NOT use either the anchor system or the style sheet
-   system of libwww. */
-
-HText *HTMainText = 0;          /* Equivalent of main window */
+   system of libwww; HText lives in mo-htext.c. */
 
 /* these are used in libwww */
 char *HTAppName = "NCSA_Mosaic";
@@ -148,7 +132,7 @@ extern int do_post;
 extern char *post_content_type;
 extern char *post_data;
 extern int do_put;
-extern int put_file_size;
+extern off_t put_file_size;
 extern FILE *put_fp;
 
 /* From HTMIME.c - AF */
@@ -513,211 +497,6 @@ mo_status mo_re_init_formats(void)
     return mo_succeed;
 }
 
-/* ------------------------------------------------------------------------ */
-
-HText *HText_new(void)
-{
-    HText *htObj = (HText *) malloc(sizeof(HText));
-
-    htObj->expandedAddress = NULL;
-    htObj->simpleAddress = NULL;
-    htObj->htmlSrc = NULL;
-    htObj->htmlSrcHead = NULL;
-    htObj->srcalloc = 0;
-    htObj->srclen = 0;
-
-    /* Free the struct but not the text, as it will be handled
-       by Mosaic proper -- apparently. */
-    if (HTMainText)
-        free(HTMainText);
-
-    HTMainText = htObj;
-
-    return htObj;
-}
-
-void HText_free(HText *self)
-{
-    if (self) {
-        if (self->htmlSrcHead)
-            free(self->htmlSrcHead);
-        free(self);
-    }
-    return;
-}
-
-void HText_beginAppend(HText *text)
-{
-    HTMainText = text;
-    return;
-}
-
-void HText_endAppend(HText *text)
-{
-    if (text) {
-        HText_appendCharacter(text, '\0');
-    }
-    HTMainText = text;
-    return;
-}
-
-void HText_doAbort(HText *self)
-{
-    /* Clean up -- we want to free htmlSrc here because htmlSrcHead
-       doesn't get assigned until hack_htmlsrc, and by the time we
-       reach that, this should never be called. */
-    if (self) {
-        if (self->htmlSrc)
-            free(self->htmlSrc);
-        self->htmlSrc = NULL;
-        self->htmlSrcHead = NULL;
-        self->srcalloc = 0;
-        self->srclen = 0;
-    }
-    return;
-}
-
-void HText_clearOutForNewContents(HText *self)
-{
-    if (self) {
-        if (self->htmlSrc)
-            free(self->htmlSrc);
-        self->htmlSrc = NULL;
-        self->htmlSrcHead = NULL;
-        self->srcalloc = 0;
-        self->srclen = 0;
-    }
-    return;
-}
-
-static void new_chunk(HText *text)
-{
-    if (text->srcalloc == 0) {
-        text->htmlSrc = (char *)malloc(MO_BUFFER_SIZE);
-        text->htmlSrc[0] = '\0';
-    } else {
-        text->htmlSrc = (char *)realloc(text->htmlSrc, text->srcalloc + MO_BUFFER_SIZE);
-    }
-
-    text->srcalloc += MO_BUFFER_SIZE;
-
-    return;
-}
-
-#if defined(__alpha) || defined(_IBMR2)
-void HText_appendCharacter(text, ch)
-HText *text;
-char ch;
-#else
-void HText_appendCharacter(HText *text, char ch)
-#endif
-{
-    if (text->srcalloc < text->srclen + 1)
-        new_chunk(text);
-
-    text->htmlSrc[text->srclen++] = ch;
-
-    return;
-}
-
-void HText_appendText(HText *text, char *str)
-{
-    int len;
-
-    if (!str)
-        return;
-
-    len = strlen(str);
-
-    while (text->srcalloc < text->srclen + len + 1)
-        new_chunk(text);
-
-/*  bcopy (str, (text->htmlSrc + text->srclen), len);*/
-    memcpy((text->htmlSrc + text->srclen), str, len);
-
-    text->srclen += len;
-    text->htmlSrc[text->srclen] = '\0';
-
-    return;
-}
-
-void HText_appendBlock(HText *text, char *data, int len)
-{
-    if (!data)
-        return;
-
-    while (text->srcalloc < text->srclen + len + 1)
-        new_chunk(text);
-
-/*  bcopy (data, (text->htmlSrc + text->srclen), len);*/
-    memcpy((text->htmlSrc + text->srclen), data, len);
-
-    text->srclen += len;
-    text->htmlSrc[text->srclen] = '\0';
-
-    return;
-}
-
-void HText_appendParagraph(HText *text)
-{
-    /* Boy, talk about a misnamed function. */
-    char *str = " <p> \n";
-
-    HText_appendText(text, str);
-
-    return;
-}
-
-void HText_beginAnchor(HText *text, char *anc)
-{
-    HText_appendText(text, "<A HREF=\"");
-    HText_appendText(text, anc);
-    HText_appendText(text, "\">");
-    return;
-}
-
-void HText_endAnchor(HText *text)
-{
-    HText_appendText(text, "</A>");
-    return;
-}
-
-void HText_dump(HText *me)
-{
-    return;
-}
-
-char *HText_getText(HText *me)
-{
-    if (me)
-        return me->htmlSrc;
-    else
-        return NULL;
-}
-
-char **HText_getPtrToText(HText *me)
-{
-    if (me)
-        return &(me->htmlSrc);
-    else
-        return NULL;
-}
-
-int HText_getTextLength(HText *me)
-{
-    if (me)
-        return me->srclen;
-    else
-        return 0;
-}
-
-/*
-BOOL HText_select (HText *text)
-{
-  return ;
-}
-*/
-
 /****************************************************************************
  * name:    fileOrServer
  * purpose: Given a string, checks to see if it can stat it. If so, it is
@@ -836,20 +615,49 @@ char *mo_url_canonicalize(char *url, char *oldurl)
  * returns: 
  *   The canonical representation of the URL.
  * remarks: 
- *   All we do is call HTParse.
+ *   oldurl is canonicalized on the stack first.
  ****************************************************************************/
 char *mo_url_canonicalize_keep_anchor(char *url, char *oldurl)
 {
+    char buf[MO_URL_BUF];
     char *rv;
     /* We KEEP anchor information already present in url,
        but NOT in oldurl. */
-    oldurl = HTParse(oldurl, "", PARSE_ACCESS | PARSE_HOST | PARSE_PATH | PARSE_PUNCTUATION);
+    oldurl = mo_url_canonicalize_into(oldurl, "", buf, MO_URL_BUF);
     rv = HTParse(url, oldurl, PARSE_ACCESS | PARSE_HOST | PARSE_PATH | PARSE_PUNCTUATION | PARSE_ANCHOR);
-    /* We made a new copy of oldurl, so free the new copy. */
-    free(oldurl);
+    /* A long oldurl gets a new copy, so free it. */
+    if (oldurl != buf)
+        free(oldurl);
     return rv;
 }
 
+/****************************************************************************
+ * name:    mo_url_canonicalize_into
+ * purpose: Turn a URL into its canonical form, as mo_url_canonicalize,
+ *          but in the caller's buffer.
+ * inputs:  
+ *   - char    *url: URL to canonicalize.
+ *   - char *oldurl: The previous URL in this context.
+ *   - char    *buf: Where to put the result.
+ *   - int     size: The size of buf, normally MO_URL_BUF.
+ * returns: 
+ *   buf, or if the result might not fit there, a malloc'd copy
+ *   which the caller frees.
+ * remarks: 
+ *   For callers that look the URL up and throw it away; nothing is
+ *   allocated unless url and oldurl between them are very long.
+ ****************************************************************************/
+char *mo_url_canonicalize_into(char *url, char *oldurl, char *buf, int size)
+{
+    HTURLParts given, related;
+
+    HTParseParts(url, &given);
+    HTParseParts(oldurl, &related);
+    if (HTParseInto(&given, &related, PARSE_ACCESS | PARSE_HOST | PARSE_PATH | PARSE_PUNCTUATION, buf, size) < 0)
+        return mo_url_canonicalize(url, oldurl);
+    return buf;
+}
+
 /****************************************************************************
  * name:    mo_url_to_unique_document
  * purpose: Given a URL that may or may not contain an internal anchor,
@@ -1000,6 +808,49 @@ char *mo_tmpnam(char *url)
     }
 }
 
+/****************************************************************************
+ * name:    mo_spoolnam
+ * purpose: Name somewhere to put a document that will be read back
+ *          and thrown away straight after, e.g. an inline image.
+ * inputs:  
+ *   - char *url: The URL being loaded, or NULL.
+ * returns: 
+ *   The new name; give it back with mo_spool_release.
+ * remarks: 
+ *   A spool in memory if we can have one (see libwww2/HTSpool.h),
+ *   otherwise a temporary file from mo_tmpnam.
+ ****************************************************************************/
+char *mo_spoolnam(char *url)
+{
+    extern void MoCCIAddFileURLToList(char *, char *);
+    char *name = HTSpoolNew();
+
+    if (!name)
+        return mo_tmpnam(url);
+    if (url)
+        MoCCIAddFileURLToList(name, url);
+    return name;
+}
+
+/****************************************************************************
+ * name:    mo_spool_release
+ * purpose: Get rid of a document named by mo_spoolnam or mo_tmpnam.
+ * inputs:  
+ *   - char *fnam: Its name; not freed.
+ * returns: 
+ *   nothing
+ * remarks: 
+ *   Spool names are reused, so the file-to-URL entry goes too.
+ ****************************************************************************/
+void mo_spool_release(char *fnam)
+{
+    extern void MoCCIRemoveFileURLFromList(char *);
+
+    MoCCIRemoveFileURLFromList(fnam);
+    if (!HTSpoolRelease(fnam))
+        unlink(fnam);
+}
+
 /* ------------------------------ dumb stuff ------------------------------ */
 
 /* Grumble grumble... */
@@ -1425,8 +1276,12 @@ int upload(mo_window *win, FILE *fp, char *fname)
     free(put_url);
     put_url = xurl;
 
-    fseek(fp, 0, SEEK_END);
-    put_file_size = ftell(fp);
+    /* fstat rather than ftell, which is a long and stops at 2GB */
+    {
+        struct stat st;
+
+        put_file_size = (fstat(fileno(fp), &st) == 0) ? st.st_size : 0;
+    }
     rewind(fp);
     put_fp = fp;
 
@@ -65,12 +65,16 @@
 #ifndef __MOWWW_H__
 #define __MOWWW_H__ 
 
+#define MO_URL_BUF 1024     /* Room for most URLs, for mo_url_canonicalize_into */
+
 char *mo_pull_er_over (char *, char **);
 char *mo_post_pull_er_over (char *url, char *content_type, char *data, 
                             char **texthead);
 mo_status mo_pull_er_over_virgin (char *, char *);
 mo_status mo_re_init_formats (void);
 char *mo_tmpnam (char *);
+char *mo_spoolnam (char *);
+void mo_spool_release (char *);
 char *mo_get_html_return (char **);
 char *mo_convert_newlines_to_spaces (char *);
 mo_status mo_re_init_formats (void);
@@ -78,6 +82,7 @@ mo_status mo_re_init_formats (void);
 char *mo_url_prepend_protocol(char *);
 char *mo_url_canonicalize (char *, char *);
 char *mo_url_canonicalize_keep_anchor (char *, char *);
+char *mo_url_canonicalize_into (char *, char *, char *, int);
 char *mo_url_canonicalize_local (char *);
 char *mo_url_to_unique_document (char *);
 char *mo_url_extract_anchor (char *);
@@ -288,6 +288,8 @@ extern char *strdup ();
 #define moMODE_NEWS   0x0004
 #define moMODE_ALL    0x0007
 
+#define MO_TIMELINES  8   /* Load timelines kept per window */
+
 
 /* mo_window contains everything related to a single Document View
    window, including subwindow details. */
@@ -329,6 +331,10 @@ typedef struct mo_window
     Widget links_list; /* widget holding the list itself */
     XmString *links_items;
     int links_count;
+    Widget timeline_win;  /* Load Timeline dialog */
+    Widget timeline_text;
+    void *timelines[MO_TIMELINES]; /* HTTimelines of the last loads, */
+    int timeline_next;             /* a ring; next one goes here */
 
   Widget ftpput_win, ftpremove_win, ftpremove_text, ftpmkdir_win, ftpmkdir_text;
   char *ftp_site;
@@ -650,6 +656,8 @@ typedef enum
   mo_no_underlines, mo_binary_transfer,
 /* links window */
   mo_links_window, 
+/* load timeline window */
+  mo_timeline_window,
 /* News Menu & Stuff */
   mo_news_prev, mo_news_next, mo_news_prevt, mo_news_nextt,
   mo_news_post, mo_news_cancel, mo_news_reply, mo_news_follow,
@@ -57,6 +57,10 @@
 #include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utime.h>
 #include "libhtmlw/HTML.h"
 #include "compat.h"
 
@@ -69,6 +73,8 @@
 #define S_IXUSR 100
 #endif
 
+extern int truncate();           /* Not in POSIX.2 <unistd.h> */
+
 #ifndef DISABLE_TRACE
 extern int srcTrace;
 #endif
@@ -119,15 +125,45 @@ extern int srcTrace;
 /* --------------------------- GLOBAL PAN LIST ---------------------------- */
 /* ------------------------------------------------------------------------ */
 
+/*
+  Every annotation is also kept in a file called STORE in the same
+  directory, so that showing a document never has to open one file per
+  annotation.  The STORE is only ever appended to:
+
+  ncsa-mosaic-personal-annotation-store-format-1   [cookie]
+  pan id length url                                [annotation id for url,
+  [length bytes of the annotation, as above]        superseding any earlier
+                                                    record for id]
+  del id 0 -                                       [annotation id deleted]
+  ...
+
+  with a newline after each record's bytes.  The STORE is mapped
+  when it is read, and an in-memory index from url to the place of
+  each annotation's bytes is built from it at startup (from LOG and
+  the PAN-#.html files the first time).  When more than half of it is
+  superseded records, it is rewritten on exit with each url's
+  annotations next to each other.  LOG and the PAN-#.html files are
+  still written: the links to annotations are file: URLs, and older
+  versions of Mosaic read LOG.
+
+  Older versions write LOG too, and know nothing of the STORE.  So
+  that their changes are not lost, the STORE is touched whenever LOG
+  is written, and at startup a LOG newer than the STORE means the
+  STORE is built again from LOG and the PAN-#.html files.
+  */
+
 #define NCSA_PAN_LOG_FORMAT_COOKIE_ONE \
   "ncsa-mosaic-personal-annotation-log-format-1"
+#define NCSA_PAN_STORE_FORMAT_COOKIE_ONE \
+  "ncsa-mosaic-personal-annotation-store-format-1"
 #define PAN_LOG_FILENAME "LOG"
+#define PAN_STORE_FILENAME "STORE"
 #define PAN_ANNOTATION_PREFIX "PAN-"
 
 #define NCSA_ANNOTATION_FORMAT_ONE \
   "<ncsa-annotation-format-1>"
 
-#define HASHSIZE 100
+#define HASHSIZE 1021
 #define MAX_PANS_PER_HREF 20
 
 /* Cached string for home directory. */
@@ -137,6 +173,8 @@ typedef struct entry {
     char *href;
     int num_pans;
     int an[MAX_PANS_PER_HREF];
+    long off[MAX_PANS_PER_HREF];        /* where each one is in the STORE */
+    int len[MAX_PANS_PER_HREF];
     struct entry *next;
 } entry;
 
@@ -151,6 +189,18 @@ static int max_pan_id = 0;
 
 static bucket hash_table[HASHSIZE];
 
+/* The entry each annotation id belongs to, indexed by id. */
+static entry **id_table = NULL;
+static int id_table_size = 0;
+
+static char *cached_global_pan_fname = NULL;
+static char *cached_pan_store_fname = NULL;
+
+static char *store_map = NULL;          /* the STORE, mapped */
+static long store_mapped = 0;
+static long store_size = 0;             /* bytes in the STORE */
+static long store_dead = 0;             /* of which superseded */
+
 static int locate_id(int id, entry ** lptr);
 static void ensure_pan_directory_exists(void);
 static int hash_url(char *url);
@@ -159,22 +209,27 @@ static entry *new_entry(int buck, char *href);
 static entry *fetch_entry(char *href);
 static void add_an_to_entry(entry * l, int an);
 static void remove_an_from_entry(entry * l, int an);
+static void set_id_entry(int id, entry * l);
 static void mo_read_pan_file(char *filename);
 static mo_status mo_init_pan(void);
-static mo_status mo_write_pan(int id, char *title, char *author, char *text);
+static mo_status mo_write_pan(entry * l, int id, char *title, char *author, char *text);
 static char *smart_append(char *s1, char *s2);
 static char *extract_meat(char *s, int offset);
+static char *pan_text(entry * l, int i);
+static void store_unmap(void);
+static long store_append(char *op, int id, char *url, char *text, int len);
+static int store_read(char *filename);
+static void store_convert(void);
+static void store_compact(void);
 
 static int hash_url(char *url)
 {
-    int len, i, val;
+    unsigned int val = 0;
 
     if (!url)
         return 0;
-    len = strlen(url);
-    val = 0;
-    for (i = 0; i < 10; i++)
-        val += url[(i * val + 7) % len];
+    while (*url)
+        val = val * 31 + (unsigned char)*url++;
 
     return val % HASHSIZE;
 }
@@ -203,7 +258,7 @@ static entry *new_entry(int buck, char *href)
     l->href = strdup(href);
     l->num_pans = 0;
 /*  bzero ((void *)(l->an), MAX_PANS_PER_HREF * 4);*/
-    memset((void *)(l->an), 0, MAX_PANS_PER_HREF * 4);
+    memset((void *)(l->an), 0, sizeof(l->an));
     l->next = NULL;
 
     if (bkt->head == NULL)
@@ -234,6 +289,23 @@ static entry *fetch_entry(char *href)
     return NULL;
 }
 
+/* Remember which entry id belongs to. */
+static void set_id_entry(int id, entry *l)
+{
+    if (id <= 0)
+        return;
+    if (id >= id_table_size) {
+        int size = id_table_size ? id_table_size : 256;
+
+        while (size <= id)
+            size *= 2;
+        id_table = (entry **) realloc(id_table, size * sizeof(entry *));
+        memset(id_table + id_table_size, 0, (size - id_table_size) * sizeof(entry *));
+        id_table_size = size;
+    }
+    id_table[id] = l;
+}
+
 /* Given an entry and an annotation id, do the right thing
    to the entry. */
 static void add_an_to_entry(entry *l, int an)
@@ -242,6 +314,9 @@ static void add_an_to_entry(entry *l, int an)
         return;
 
     l->an[l->num_pans] = an;
+    l->off[l->num_pans] = -1;
+    l->len[l->num_pans] = 0;
+    set_id_entry(an, l);
 
     l->num_pans++;
 }
@@ -264,10 +339,14 @@ static void remove_an_from_entry(entry *l, int an)
   ok:
     /* Found an in the list of annotations. */
     l->an[place] = 0;
+    set_id_entry(an, NULL);
     /* If place is 3 and num_pans is 6,
        then i goes from 4 to 5; 3 gets 4's value and then 4 gets 5's. */
-    for (i = place + 1; i < l->num_pans; i++)
+    for (i = place + 1; i < l->num_pans; i++) {
         l->an[i - 1] = l->an[i];
+        l->off[i - 1] = l->off[i];
+        l->len[i - 1] = l->len[i];
+    }
     l->num_pans--;
 
     /* Don't have to remove an empty entry, since an empty entry won't
@@ -276,24 +355,20 @@ static void remove_an_from_entry(entry *l, int an)
     return;
 }
 
-/* For a given ID, look through the hash table, find the corresponding
-   entry, and return both it and the position of the id in it. */
+/* For a given ID, find the corresponding entry, and return both it
+   and the position of the id in it. */
 int locate_id(int id, entry **lptr)
 {
     entry *l;
-    int i, j;
+    int j;
 
-    for (i = 0; i < HASHSIZE; i++) {
-        if (hash_table[i].count)
-            for (l = hash_table[i].head; l != NULL; l = l->next) {
-                for (j = 0; j < l->num_pans; j++) {
-                    if (l->an[j] == id) {
-                        *lptr = l;
-                        return j;
-                    }
-                }
+    if (id > 0 && id < id_table_size && (l = id_table[id]))
+        for (j = 0; j < l->num_pans; j++) {
+            if (l->an[j] == id) {
+                *lptr = l;
+                return j;
             }
-    }
+        }
 
     *lptr = NULL;
     return -1;
@@ -367,7 +442,263 @@ static void mo_read_pan_file(char *filename)
     return;
 }
 
-static char *cached_global_pan_fname = NULL;
+/* ------------------------------ the STORE ------------------------------- */
+
+static void store_unmap(void)
+{
+    if (store_map)
+        munmap(store_map, store_mapped);
+    store_map = NULL;
+    store_mapped = 0;
+}
+
+/* The bytes of the i'th annotation of l, in the mapped STORE, or NULL. */
+static char *pan_text(entry *l, int i)
+{
+    if (l->off[i] < 0)
+        return NULL;
+
+    if (!store_map && store_size > 0) {
+        int fd = open(cached_pan_store_fname, O_RDONLY);
+        char *p;
+
+        if (fd < 0)
+            return NULL;
+        p = (char *)mmap(NULL, store_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (p == (char *)MAP_FAILED)
+            return NULL;
+        store_map = p;
+        store_mapped = store_size;
+    }
+
+    if (!store_map || l->off[i] + l->len[i] > store_mapped)
+        return NULL;
+    return store_map + l->off[i];
+}
+
+/* Add a record to the end of the STORE.  Returns the offset of its
+   text, or -1 if it could not be written. */
+static long store_append(char *op, int id, char *url, char *text, int len)
+{
+    char *rec;
+    int fd, hlen, n;
+    long off;
+
+    ensure_pan_directory_exists();
+
+    fd = open(cached_pan_store_fname, O_WRONLY | O_APPEND | O_CREAT, 0600);
+    if (fd < 0)
+        return -1;
+
+    rec = (char *)malloc(strlen(NCSA_PAN_STORE_FORMAT_COOKIE_ONE) + strlen(url) + len + 64);
+    hlen = 0;
+    if (store_size == 0)
+        hlen = sprintf(rec, "%s\n", NCSA_PAN_STORE_FORMAT_COOKIE_ONE);
+    hlen += sprintf(rec + hlen, "%s %d %d %s\n", op, id, len, url);
+    memcpy(rec + hlen, text, len);
+    rec[hlen + len] = '\n';
+
+    n = write(fd, rec, hlen + len + 1);
+    free(rec);
+    close(fd);
+    if (n != hlen + len + 1) {
+        /* Leave the next load to cut off what did get written. */
+        return -1;
+    }
+
+    off = store_size + hlen;
+    store_size += hlen + len + 1;
+    store_unmap();
+
+    return off;
+}
+
+/* Build the index from the STORE.  Returns 0 if there is no STORE. */
+static int store_read(char *filename)
+{
+    struct stat st;
+    char *p, *end, *nl, op[4], *url;
+    char line[MO_LINE_LENGTH + 1];
+    int fd, id, len, len_url, j;
+    long good;
+    entry *l;
+
+    if ((fd = open(filename, O_RDONLY)) < 0)
+        return 0;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    p = (char *)mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == (char *)MAP_FAILED)
+        return 0;
+    store_map = p;
+    store_mapped = store_size = st.st_size;
+    end = p + st.st_size;
+
+    if (st.st_size <= strlen(NCSA_PAN_STORE_FORMAT_COOKIE_ONE) ||
+        strncmp(p, NCSA_PAN_STORE_FORMAT_COOKIE_ONE, strlen(NCSA_PAN_STORE_FORMAT_COOKIE_ONE)) ||
+        !(nl = memchr(p, '\n', end - p))) {
+        store_unmap();
+        store_size = 0;
+        return 0;
+    }
+    p = nl + 1;
+    good = p - store_map;
+
+    while (p < end && (nl = memchr(p, '\n', end - p))) {
+        /* The map has no NUL at the end: scan a copy of the line, or
+           sscanf would look for the end of the whole file each time. */
+        if (nl - p > MO_LINE_LENGTH)
+            break;
+        memcpy(line, p, nl - p);
+        line[nl - p] = '\0';
+        if (sscanf(line, "%3s %d %d", op, &id, &len) != 3 ||
+            len < 0 || len > end - nl - 2 || !(url = memchr(p, ' ', nl - p)) ||
+            !(url = memchr(url + 1, ' ', nl - url - 1)) || !(url = memchr(url + 1, ' ', nl - url - 1)))
+            break;
+        len_url = nl - url - 1;
+        url = strncpy((char *)malloc(len_url + 1), url + 1, len_url);
+        url[len_url] = '\0';
+
+        /* A later record for an id replaces the earlier one. */
+        if ((j = locate_id(id, &l)) >= 0) {
+            store_dead += l->len[j] + strlen(l->href) + 24;
+            remove_an_from_entry(l, id);
+        }
+        if (!strcmp(op, "pan")) {
+            if (!(l = fetch_entry(url)))
+                l = new_entry(hash_url(url), url);
+            add_an_to_entry(l, id);
+            if (l->an[l->num_pans - 1] == id) {
+                l->off[l->num_pans - 1] = nl + 1 - store_map;
+                l->len[l->num_pans - 1] = len;
+            }
+            if (id > max_pan_id)
+                max_pan_id = id;
+        } else
+            store_dead += nl + 2 - p;
+        free(url);
+
+        p = nl + 1 + len + 1;
+        good = p - store_map;
+    }
+
+    /* Cut off a record left half written. */
+    if (good < store_size) {
+#ifndef DISABLE_TRACE
+        if (srcTrace)
+            fprintf(stderr, "pan: dropping %ld bytes at the end of %s\n", store_size - good, filename);
+#endif
+        store_unmap();
+        truncate(filename, good);
+        store_size = good;
+    }
+
+    return 1;
+}
+
+/* Fill the STORE from LOG and the PAN-#.html files.  The records go
+   to a new file, which takes the place of any old STORE once it is
+   complete. */
+static void store_convert(void)
+{
+    char *default_directory = get_pref_string(ePRIVATE_ANNOTATION_DIRECTORY);
+    char *store = cached_pan_store_fname;
+    char filename[500];
+    struct stat st;
+    entry *l;
+    char *text;
+    FILE *fp;
+    int i, j, len;
+
+    cached_pan_store_fname = (char *)malloc(strlen(store) + 8);
+    sprintf(cached_pan_store_fname, "%s.new", store);
+    unlink(cached_pan_store_fname);
+    store_size = store_dead = 0;
+
+    for (i = 0; i < HASHSIZE; i++)
+        for (l = hash_table[i].head; l != NULL; l = l->next)
+            for (j = 0; j < l->num_pans; j++) {
+                sprintf(filename, "%s/%s/%s%d.html", home, default_directory, PAN_ANNOTATION_PREFIX, l->an[j]);
+                if (!(fp = fopen(filename, "r")))
+                    continue;
+                if (fstat(fileno(fp), &st) == 0) {
+                    text = (char *)malloc(st.st_size + 1);
+                    len = fread(text, 1, st.st_size, fp);
+                    l->off[j] = store_append("pan", l->an[j], l->href, text, len);
+                    l->len[j] = len;
+                    free(text);
+                }
+                fclose(fp);
+            }
+
+    if (store_size == 0 || rename(cached_pan_store_fname, store) < 0) {
+        unlink(cached_pan_store_fname);
+        if (store_size == 0)
+            unlink(store);
+        for (i = 0; i < HASHSIZE; i++)
+            for (l = hash_table[i].head; l != NULL; l = l->next)
+                for (j = 0; j < l->num_pans; j++)
+                    l->off[j] = -1;
+        store_size = 0;
+    }
+    free(cached_pan_store_fname);
+    cached_pan_store_fname = store;
+}
+
+/* Rewrite the STORE with just the live records, each url's together. */
+static void store_compact(void)
+{
+    char *tmpname;
+    long size, *offs;
+    entry *l;
+    char *text;
+    FILE *fp;
+    int i, j, n;
+
+    tmpname = (char *)malloc(strlen(cached_pan_store_fname) + 8);
+    sprintf(tmpname, "%s.new", cached_pan_store_fname);
+    if (!(fp = fopen(tmpname, "w"))) {
+        free(tmpname);
+        return;
+    }
+
+    for (i = n = 0; i < HASHSIZE; i++)
+        for (l = hash_table[i].head; l != NULL; l = l->next)
+            n += l->num_pans;
+    offs = (long *)malloc((n + 1) * sizeof(long));
+
+    size = fprintf(fp, "%s\n", NCSA_PAN_STORE_FORMAT_COOKIE_ONE);
+    for (i = n = 0; i < HASHSIZE; i++)
+        for (l = hash_table[i].head; l != NULL; l = l->next)
+            for (j = 0; j < l->num_pans; j++, n++) {
+                if (!(text = pan_text(l, j))) {
+                    offs[n] = -1;
+                    continue;
+                }
+                size += fprintf(fp, "pan %d %d %s\n", l->an[j], l->len[j], l->href);
+                offs[n] = size;
+                size += fwrite(text, 1, l->len[j], fp);
+                putc('\n', fp);
+                size++;
+            }
+
+    if (fclose(fp) == 0 && rename(tmpname, cached_pan_store_fname) == 0) {
+        for (i = n = 0; i < HASHSIZE; i++)
+            for (l = hash_table[i].head; l != NULL; l = l->next)
+                for (j = 0; j < l->num_pans; j++, n++)
+                    l->off[j] = offs[n];
+        store_unmap();
+        store_size = size;
+        store_dead = 0;
+    } else
+        unlink(tmpname);
+    free(offs);
+    free(tmpname);
+}
 
 static mo_status mo_init_pan(void)
 {
@@ -420,14 +751,16 @@ mo_status mo_is_editable_pan(char *text)
 
 /* First, call mo_init_pan() to set up internal hash table.
    Then, snarf a value for home.
-   Then, snarf a value for the log file.
-   Then, read the log file and load up the hash table
-     by calling mo_read_pan_file. */
+   Then, snarf values for the log file and the store.
+   Then, load up the hash table from the store, or if there isn't
+     one yet, from the log file by calling mo_read_pan_file and
+     fill the store from the annotation files. */
 mo_status mo_setup_pan_list(void)
 {
     char *default_directory = get_pref_string(ePRIVATE_ANNOTATION_DIRECTORY);
     char *default_filename = PAN_LOG_FILENAME;
     char *filename;
+    struct stat log, store;
 
     mo_init_pan();
 
@@ -441,12 +774,29 @@ mo_status mo_setup_pan_list(void)
     sprintf(filename, "%s/%s/%s", home, default_directory, default_filename);
     cached_global_pan_fname = filename;
 
-    mo_read_pan_file(filename);
+    filename = (char *)malloc((strlen(home) + strlen(default_directory) + strlen(PAN_STORE_FILENAME) + 8) * sizeof(char));
+    sprintf(filename, "%s/%s/%s", home, default_directory, PAN_STORE_FILENAME);
+    cached_pan_store_fname = filename;
+
+    /* An older Mosaic has written LOG since we last did. */
+    if (stat(cached_global_pan_fname, &log) == 0 && stat(cached_pan_store_fname, &store) == 0 &&
+        log.st_mtime > store.st_mtime) {
+#ifndef DISABLE_TRACE
+        if (srcTrace)
+            fprintf(stderr, "pan: %s is newer than %s; reading it again\n",
+                    cached_global_pan_fname, cached_pan_store_fname);
+#endif
+        mo_read_pan_file(cached_global_pan_fname);
+        store_convert();
+    } else if (!store_read(cached_pan_store_fname)) {
+        mo_read_pan_file(cached_global_pan_fname);
+        store_convert();
+    }
 
     return mo_succeed;
 }
 
-/* Write out the log file. */
+/* Write out the log file, and tidy up the store if it needs it. */
 mo_status mo_write_pan_list(void)
 {
     FILE *fp;
@@ -455,6 +805,9 @@ mo_status mo_write_pan_list(void)
 
     ensure_pan_directory_exists();
 
+    if (store_dead > store_size / 2)
+        store_compact();
+
     fp = fopen(cached_global_pan_fname, "w");
     if (!fp)
         return mo_fail;
@@ -473,39 +826,55 @@ mo_status mo_write_pan_list(void)
 
     fclose(fp);
 
+    /* So that LOG is not taken for an older Mosaic's next time */
+    utime(cached_pan_store_fname, NULL);
+
     return mo_succeed;
 }
 
-static mo_status mo_write_pan(int id, char *title, char *author, char *text)
+/* Write annotation id, which belongs to entry l, to the store and
+   to its own file. */
+static mo_status mo_write_pan(entry *l, int id, char *title, char *author, char *text)
 {
     char *default_directory = get_pref_string(ePRIVATE_ANNOTATION_DIRECTORY);
     char filename[500];
     FILE *fp;
     time_t foo = time(NULL);
     char *ts = ctime(&foo);
+    char *an_anno;
+    int len, place;
+    long off;
 
     ts[strlen(ts) - 1] = '\0';
 
     ensure_pan_directory_exists();
 
+    an_anno = (char *)malloc(strlen(NCSA_ANNOTATION_FORMAT_ONE) + 2 * strlen(title) + strlen(author) +
+                             strlen(ts) + strlen(text) + 128);
+    len = sprintf(an_anno, "%s\n<title>%s</title>\n<h1>%s</h1>\n<address>%s</address>\n"
+                  "<address>%s</address>\n______________________________________\n<pre>\n%s",
+                  NCSA_ANNOTATION_FORMAT_ONE, title, title, author, ts, text);
+
+    off = store_append("pan", id, l->href, an_anno, len);
+    for (place = 0; place < l->num_pans; place++)
+        if (l->an[place] == id) {
+            if (l->off[place] >= 0)
+                store_dead += l->len[place] + strlen(l->href) + 24;
+            l->off[place] = off;
+            l->len[place] = len;
+        }
+
     /* Write the new annotation to its appropriate file. */
     sprintf(filename, "%s/%s/%s%d.html", home, default_directory, PAN_ANNOTATION_PREFIX, id);
 
     fp = fopen(filename, "w");
-    if (!fp)
+    if (!fp) {
+        free(an_anno);
         return mo_fail;
-
-    fprintf(fp, "%s\n", NCSA_ANNOTATION_FORMAT_ONE);
-    fprintf(fp, "<title>%s</title>\n", title);
-    fprintf(fp, "<h1>%s</h1>\n", title);
-    fprintf(fp, "<address>%s</address>\n", author);
-    foo = time(NULL);
-    fprintf(fp, "<address>%s</address>\n", ts);
-    fprintf(fp, "______________________________________\n");
-    fprintf(fp, "<pre>\n");
-    fprintf(fp, "%s", text);
-
+    }
+    fwrite(an_anno, 1, len, fp);
     fclose(fp);
+    free(an_anno);
 
     return mo_succeed;
 }
@@ -529,7 +898,7 @@ mo_status mo_new_pan(char *url, char *title, char *author, char *text)
     /* Register the new annotation id with the entry. */
     add_an_to_entry(l, id);
 
-    mo_write_pan(id, title, author, text);
+    mo_write_pan(l, id, title, author, text);
 
     return mo_succeed;
 }
@@ -547,7 +916,11 @@ mo_status mo_delete_pan(int id)
     if (!l)
         /* Weird -- no URL associated with the edited annotation. */
         return mo_fail;
+    if (l->off[place] >= 0)
+        store_dead += l->len[place] + strlen(l->href) + 24;
     remove_an_from_entry(l, id);
+    if (store_append("del", id, "-", "", 0) >= 0)
+        store_dead += 16;
 
     /* Remove the annotation itself. */
     sprintf(filename, "%s/%s/%s%d.html", home, default_directory, PAN_ANNOTATION_PREFIX, id);
@@ -587,17 +960,24 @@ mo_status mo_delete_pan(int id)
     return mo_succeed;
 }
 
+
 /* We're modifying an existing pan.  Pass in the id,
    the title, author, and text.
    Check for null text -- NOT AT THE MOMENT */
 mo_status mo_modify_pan(int id, char *title, char *author, char *text)
 {
+    entry *l;
+
     if (!title || !*title)
         title = strdup("Annotation with no title");
     if (!author || !*author)
         author = strdup("No author name");
 
-    mo_write_pan(id, title, author, text);
+    locate_id(id, &l);
+    if (!l)
+        return mo_fail;
+
+    mo_write_pan(l, id, title, author, text);
     return mo_succeed;
 }
 
@@ -638,49 +1018,55 @@ static char *extract_meat(char *s, int offset)
     return ptr;
 }
 
+/* Find line n (from 0) of an annotation's len bytes, and return a
+   pointer to it offset characters in, with the length up to the next
+   '<' or end of line in *meat; NULL if it is not there. */
+static char *pan_line_meat(char *text, int len, int n, int offset, int *meat)
+{
+    char *end = text + len, *nl;
+
+    while (n-- > 0) {
+        if (!(nl = memchr(text, '\n', end - text)))
+            return NULL;
+        text = nl + 1;
+    }
+    if (end - text < offset)
+        return NULL;
+    text += offset;
+    for (*meat = 0; text + *meat < end && text[*meat] != '<' && text[*meat] != '\n'; (*meat)++)
+        ;
+    return text;
+}
+
 char *mo_fetch_personal_annotations(char *url)
 {
     entry *l = fetch_entry(url);
-    char *msg = NULL;
-    char line[MO_LINE_LENGTH];
-    char *default_directory = get_pref_string(ePRIVATE_ANNOTATION_DIRECTORY);
-    int i, count = 0;
+    char *msg, *p, *text;
+    int i, size;
 
     if (!l || !l->num_pans) {
         return NULL;
     }
 
     /* OK, now we've got the entry.  Basically, we step through
-       and append all anotations for the given url together
+       and append all anotations for the given url together,
+       into one buffer sized for them all up front.
      */
-    sprintf(line, "Private-Annotation: %d\r\n", l->num_pans);
-    msg = smart_append(msg, line);
+    size = 64;
+    for (i = 0; i < l->num_pans; i++)
+        size += l->len[i] + 64;
+    p = msg = (char *)malloc(size);
 
-    for (i = 0; i < l->num_pans; i++) {
-        /* What's the annotation called? */
-        char filename[500];
-        FILE *fp;
-
-        /* Do we have to assume we're opening a file with
-           suffix .html??? */
-        sprintf(filename, "%s/%s/%s%d.html", home, default_directory, PAN_ANNOTATION_PREFIX, l->an[i]);
-
-        /* This whole routine assumes there are no NULLs in the file. */
-        fp = fopen(filename, "r");
-        if (fp) {
-            char *an_anno = NULL;
-            while (fgets(line, MO_LINE_LENGTH, fp)) {
-                an_anno = smart_append(an_anno, line);
-            }
-            sprintf(line, "Content-Length: %d\r\n", strlen(an_anno));
-            msg = smart_append(msg, line);
-            msg = smart_append(msg, an_anno);
-            if (an_anno)
-                free(an_anno);
-        }
+    p += sprintf(p, "Private-Annotation: %d\r\n", l->num_pans);
 
-        fclose(fp);
+    for (i = 0; i < l->num_pans; i++) {
+        if (!(text = pan_text(l, i)))
+            continue;
+        p += sprintf(p, "Content-Length: %d\r\n", l->len[i]);
+        memcpy(p, text, l->len[i]);
+        p += l->len[i];
     }
+    *p = '\0';
 
     return msg;
 }
@@ -690,11 +1076,9 @@ char *mo_fetch_personal_annotations(char *url)
 char *mo_fetch_pan_links(char *url, int on_top)
 {
     entry *l = fetch_entry(url);
-    char *msg = NULL;
-    char line[MO_LINE_LENGTH];
-    char *status;
+    char *msg, *p, *text, *title, *date;
     char *default_directory = get_pref_string(ePRIVATE_ANNOTATION_DIRECTORY);
-    int i, count = 0;
+    int i, size, count = 0, tlen, dlen;
 
     if (!l) {
         return NULL;
@@ -713,51 +1097,31 @@ char *mo_fetch_pan_links(char *url, int on_top)
        </ul>
      */
 
-    msg = smart_append(msg, "<h2>Personal Annotations</h2>\n<ul>\n");
-
-    for (i = 0; i < l->num_pans; i++) {
-        /* What's the annotation called? */
-        char filename[500];
-        FILE *fp;
+    size = 64;
+    for (i = 0; i < l->num_pans; i++)
+        size += l->len[i] + strlen(home) + strlen(default_directory) + 64;
+    p = msg = (char *)malloc(size);
 
-        /* Do we have to assume we're opening a file with
-           suffix .html??? */
-        sprintf(filename, "%s/%s/%s%d.html", home, default_directory, PAN_ANNOTATION_PREFIX, l->an[i]);
-
-        fp = fopen(filename, "r");
-        if (fp) {
-            status = fgets(line, MO_LINE_LENGTH, fp);
-            if (status && *line) {
-                /* See if it's our format. */
-                if (!strncmp(line, NCSA_ANNOTATION_FORMAT_ONE, strlen(NCSA_ANNOTATION_FORMAT_ONE))) {
-                    char chunk[500];
-
-                    count++;
-
-                    /* Second line is the title. */
-                    status = fgets(line, MO_LINE_LENGTH, fp);
+    p += sprintf(p, "<h2>Personal Annotations</h2>\n<ul>\n");
 
-                    sprintf(chunk,
-                            "<li> <a href=\"file://%s%s\">%s</a>  ", "localhost", filename, extract_meat(line, 7));
-                    msg = smart_append(msg, chunk);
-
-                    /* Third line is skipped. */
-                    status = fgets(line, MO_LINE_LENGTH, fp);
+    for (i = 0; i < l->num_pans; i++) {
+        text = pan_text(l, i);
 
-                    /* Fourth line is the author; skipped. */
-                    status = fgets(line, MO_LINE_LENGTH, fp);
+        /* See if it's our format. */
+        if (!text || l->len[i] < strlen(NCSA_ANNOTATION_FORMAT_ONE) ||
+            strncmp(text, NCSA_ANNOTATION_FORMAT_ONE, strlen(NCSA_ANNOTATION_FORMAT_ONE)))
+            continue;
 
-                    /* Fifth line is the date. */
-                    status = fgets(line, MO_LINE_LENGTH, fp);
-                    sprintf(chunk, "(%s)\n", extract_meat(line, 9));
-                    msg = smart_append(msg, chunk);
+        /* Second line is the title, fifth is the date. */
+        if (!(title = pan_line_meat(text, l->len[i], 1, 7, &tlen)) ||
+            !(date = pan_line_meat(text, l->len[i], 4, 9, &dlen)))
+            continue;
 
-                    /* That's it. */
-                }
-            }
+        count++;
 
-            fclose(fp);
-        }
+        p += sprintf(p, "<li> <a href=\"file://%s%s/%s/%s%d.html\">%.*s</a>  (%.*s)\n",
+                     "localhost", home, default_directory, PAN_ANNOTATION_PREFIX, l->an[i],
+                     tlen, title, dlen, date);
     }
 
     /* If we made it all this way and it turns out we don't actually
@@ -767,7 +1131,7 @@ char *mo_fetch_pan_links(char *url, int on_top)
         return NULL;
     }
 
-    msg = smart_append(msg, "</ul>\n");
+    strcpy(p, "</ul>\n");
 
     return msg;
 }
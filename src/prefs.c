@@ -414,6 +414,7 @@ static Boolean write_preferences_file(prefsStructP inPrefsStruct)
     write_pref_string(fp, eNOPROXY_SPECFILE, "NOPROXY_SPECFILE");
     write_pref_int(fp, eCCIPORT, "CCIPORT");
     write_pref_int(fp, eMAX_NUM_OF_CCI_CONNECTIONS, "MAX_NUM_OF_CCI_CONNECTIONS");
+    write_pref_int(fp, eMAX_CCI_REQUESTS_IN_FLIGHT, "MAX_CCI_REQUESTS_IN_FLIGHT");
     write_pref_int(fp, eMAX_WAIS_RESPONSES, "MAX_WAIS_RESPONSES");
     write_pref_boolean(fp, eKIOSK, "KIOSK");
     write_pref_boolean(fp, eKIOSKNOEXIT, "KIOSKNOEXIT");
@@ -710,6 +711,9 @@ void *get_pref(long pref_id)
     case eMAX_NUM_OF_CCI_CONNECTIONS:
         return (void *)&(thePrefsStructP->RdataP->max_num_of_cci_connections);
         break;
+    case eMAX_CCI_REQUESTS_IN_FLIGHT:
+        return (void *)&(thePrefsStructP->RdataP->max_cci_requests_in_flight);
+        break;
     case eMAX_WAIS_RESPONSES:
         return (void *)&(thePrefsStructP->RdataP->max_wais_responses);
         break;
@@ -1265,6 +1269,9 @@ void set_pref(long pref_id, void *incoming)
     case eMAX_NUM_OF_CCI_CONNECTIONS:
         thePrefsStructP->RdataP->max_num_of_cci_connections = *((int *)incoming);
         break;
+    case eMAX_CCI_REQUESTS_IN_FLIGHT:
+        thePrefsStructP->RdataP->max_cci_requests_in_flight = *((int *)incoming);
+        break;
     case eMAX_WAIS_RESPONSES:
         thePrefsStructP->RdataP->max_wais_responses = *((int *)incoming);
         break;
@@ -176,6 +176,7 @@ typedef struct
     
     int cciPort;
     int max_num_of_cci_connections;
+    int max_cci_requests_in_flight;
     int max_wais_responses;
     Boolean kiosk;
     Boolean kioskPrint;
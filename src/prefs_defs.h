@@ -119,6 +119,7 @@ enum pref_item {
     eNOPROXY_SPECFILE, 
     eCCIPORT, 
     eMAX_NUM_OF_CCI_CONNECTIONS, 
+    eMAX_CCI_REQUESTS_IN_FLIGHT,
     eMAX_WAIS_RESPONSES, 
     eKIOSK, 
     eKIOSKPRINT,
@@ -1143,40 +1143,7 @@ void AddProxyToList(struct EditInfo *pEditInfo, struct Proxy *proxy)
 
 struct Proxy *GetNoProxy(char *access, char *site)
 {
-    struct Proxy *p = noproxy_list;
-    char *port = NULL;
-    int portnum = -1;
-
-    if ((access == NULL) || (site == NULL))
-        return NULL;
-
-    if ((port = strchr(site, ':')) != NULL) {
-        *port++ = 0;
-        portnum = atoi(port);
-    } else {
-        if (!strcmp(access, "http"))
-            portnum = 80;
-        else if (!strcmp(access, "gopher"))
-            portnum = 70;
-        else if (!strcmp(access, "ftp"))
-            portnum = 21;
-        else if (!strcmp(access, "wais"))
-            portnum = 210;
-    }
-
-    while (p != NULL) {
-        if (strstr(site, p->address)) {
-            if (p->port == NULL) {
-                break;
-            } else {
-                int match_port = atoi(p->port);
-                if (match_port == portnum)
-                    break;
-            }
-        }
-        p = p->next;
-    }
-    return p;
+    return MatchNoProxy(access, site);
 }
 
 void ClearTempBongedProxies()
@@ -1196,57 +1163,7 @@ void ClearTempBongedProxies()
 
 struct Proxy *GetProxy(char *proxy, char *access, int fMatchEnd)
 {
-    struct Proxy *p = proxy_list;
-    struct ProxyDomain *pd;
-
-    if ((access == NULL) || (proxy == NULL))
-        return NULL;
-
-    while (p != NULL) {
-
-        if (strcmp(p->scheme, proxy) != 0 || p->alive) {
-            p = p->next;
-            continue;
-        }
-
-        /* found a matching proxy */
-
-        /*
-         ** If the access list is empty, that's a match on
-         ** everything.  Bale out here.
-         */
-        if (p->list == NULL)
-            return p;
-
-        pd = p->list;
-
-        while (pd != NULL) {
-            char *ptr;
-
-            ptr = strstr(access, pd->domain);
-
-            if (ptr) {
-                if (fMatchEnd) {
-                    /* at the end? */
-                    if (strlen(ptr) == strlen(pd->domain))
-                        break;
-                } else {
-                    /* at beginning? */
-                    if (ptr == access)
-                        break;
-                }
-            }
-            pd = pd->next;
-        }
-
-        if (pd == NULL) {
-            p = p->next;
-            continue;           /* We didn't match... look for another */
-        }
-
-        return p;               /* we found a match on access and proxy */
-    }
-    return NULL;
+    return MatchProxy(proxy, access, fMatchEnd, NULL);
 }
 
 struct Proxy *FindProxyEntry(struct EditInfo *pEditInfo, char *txt)
@@ -1498,6 +1415,7 @@ XtPointer call;
         pEditInfo->editing->list = pdList;
         pdList = NULL;
     }
+    ProxyRulesChanged();
     ShowProxyList(pEditInfo);
 
     if (pEditInfo->fProxy)
@@ -1556,6 +1474,7 @@ void CommitProxyDomainInfo(Widget w, XtPointer client, XtPointer call)
         strcpy(p->editingDomain->domain, domain);
     }
 
+    ProxyRulesChanged();
     ShowProxyDomainList(p);
     XtPopdown(EditProxyDomainDialog);
     return;
@@ -1612,6 +1531,7 @@ void RemoveProxyInfo(Widget w, XtPointer client, XtPointer call, int type)
         struct Proxy *pEditing = FindProxyEntry(pEditInfo, selected_text);
 
         DeleteProxy(pEditInfo, pEditing);
+        ProxyRulesChanged();
         ShowProxyList(pEditInfo);
     } else {                    /* PROXY_DOMAIN */
         struct ProxyDomain *pdEntry;
@@ -1629,6 +1549,7 @@ void RemoveProxyInfo(Widget w, XtPointer client, XtPointer call, int type)
                 pEditInfo->editing->list = pdEntry->next;
         }
         DeleteProxyDomain(pdEntry);
+        ProxyRulesChanged();
         ShowProxyDomainList(pEditInfo);
     }
 
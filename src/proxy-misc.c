@@ -53,6 +53,7 @@
  ****************************************************************************/
 #include "../config.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "proxy.h"
 
@@ -321,3 +322,357 @@ int has_fallbacks(char *protocol)
 
     return (0);
 }
+
+/*
+ * Compiled proxy rules.
+ *
+ * Every document and every inline image asks which proxy, if any, to
+ * go through.  Rather than walk the proxy and no-proxy lists with
+ * strstr each time, the proxy list is compiled on first use into a
+ * table per scheme: the proxies that apply to every host, and a trie
+ * of the domains the others are limited to, keyed on the domain read
+ * backwards, so that one walk down it from the end of a host finds
+ * every domain the host ends in.  The answer for each host is then
+ * remembered, along with "transport://address:port/" for each proxy,
+ * so a repeat lookup is a hash probe and no allocation.  Whether a
+ * proxy is alive is checked on every lookup, since that changes as
+ * proxies fail; anything else changing calls ProxyRulesChanged().
+ */
+
+#define PROXY_MEMO_SIZE 256             /* hosts remembered per list */
+
+struct ProxyTrie {
+    int c;
+    struct ProxyTrie *child, *sibling;
+    int *match;                         /* proxies whose domain ends here */
+    int nmatch;
+};
+
+struct ProxyScheme {
+    char *scheme;
+    int *any;                           /* proxies with no domain list */
+    int nany;
+    struct ProxyTrie *trie;
+    struct ProxyScheme *next;
+};
+
+struct ProxyMemo {
+    char *key;                          /* "scheme host" or "scheme site" */
+    int fMatchEnd;
+    int *match;                         /* proxies, in list order, -1 ends */
+    struct Proxy *noproxy;
+};
+
+static struct Proxy **proxy_order = NULL;   /* proxy_list as an array */
+static char **proxy_urls = NULL;
+static int proxy_count = 0;
+static struct ProxyScheme *proxy_schemes = NULL;
+static int proxy_compiled = 0;
+static struct ProxyMemo proxy_memo[PROXY_MEMO_SIZE];
+static struct ProxyMemo noproxy_memo[PROXY_MEMO_SIZE];
+
+extern struct Proxy *noproxy_list;
+
+static void add_match(int **match, int *n, int i)
+{
+    *match = (int *)realloc(*match, (*n + 1) * sizeof(int));
+    (*match)[(*n)++] = i;
+}
+
+static void free_trie(struct ProxyTrie *t)
+{
+    struct ProxyTrie *next;
+
+    for (; t; t = next) {
+        next = t->sibling;
+        free_trie(t->child);
+        if (t->match)
+            free(t->match);
+        free(t);
+    }
+}
+
+static void free_memo(struct ProxyMemo *memo)
+{
+    int i;
+
+    for (i = 0; i < PROXY_MEMO_SIZE; i++) {
+        if (memo[i].key)
+            free(memo[i].key);
+        if (memo[i].match)
+            free(memo[i].match);
+        memo[i].key = NULL;
+        memo[i].match = NULL;
+    }
+}
+
+/* Forget the compiled rules and every remembered answer. */
+void ProxyRulesChanged(void)
+{
+    struct ProxyScheme *s, *next;
+    int i;
+
+    for (s = proxy_schemes; s; s = next) {
+        next = s->next;
+        free_trie(s->trie);
+        if (s->any)
+            free(s->any);
+        free(s);
+    }
+    proxy_schemes = NULL;
+
+    for (i = 0; i < proxy_count; i++)
+        free(proxy_urls[i]);
+    if (proxy_order)
+        free(proxy_order);
+    if (proxy_urls)
+        free(proxy_urls);
+    proxy_order = NULL;
+    proxy_urls = NULL;
+    proxy_count = 0;
+
+    free_memo(proxy_memo);
+    free_memo(noproxy_memo);
+    proxy_compiled = 0;
+}
+
+static struct ProxyScheme *find_scheme(char *scheme, int create)
+{
+    struct ProxyScheme *s;
+
+    for (s = proxy_schemes; s; s = s->next)
+        if (!strcmp(s->scheme, scheme))
+            return s;
+    if (!create)
+        return NULL;
+
+    s = (struct ProxyScheme *)calloc(1, sizeof(struct ProxyScheme));
+    s->scheme = scheme;
+    s->next = proxy_schemes;
+    proxy_schemes = s;
+    return s;
+}
+
+static void compile_proxies(void)
+{
+    struct Proxy *p;
+    struct ProxyDomain *pd;
+    struct ProxyScheme *s;
+    struct ProxyTrie **tp, *t;
+    char *c;
+    int i;
+
+    for (p = proxy_list; p; p = p->next)
+        proxy_count++;
+    proxy_order = (struct Proxy **)malloc((proxy_count + 1) * sizeof(struct Proxy *));
+    proxy_urls = (char **)malloc((proxy_count + 1) * sizeof(char *));
+
+    for (i = 0, p = proxy_list; p; p = p->next, i++) {
+        proxy_order[i] = p;
+        proxy_urls[i] = (char *)malloc(strlen(p->transport) + strlen(p->address) + strlen(p->port) + 8);
+        sprintf(proxy_urls[i], "%s://%s:%s/", p->transport, p->address, p->port);
+        if (!p->scheme)
+            continue;
+
+        s = find_scheme(p->scheme, 1);
+        if (p->list == NULL) {
+            add_match(&s->any, &s->nany, i);
+            continue;
+        }
+        for (pd = p->list; pd; pd = pd->next) {
+            if (!pd->domain || !*pd->domain)
+                continue;
+            /* Insert the domain backwards. */
+            tp = &s->trie;
+            t = NULL;
+            for (c = pd->domain + strlen(pd->domain) - 1; c >= pd->domain; c--) {
+                for (t = *tp; t && t->c != *c; t = t->sibling)
+                    ;
+                if (!t) {
+                    t = (struct ProxyTrie *)calloc(1, sizeof(struct ProxyTrie));
+                    t->c = *c;
+                    t->sibling = *tp;
+                    *tp = t;
+                }
+                tp = &t->child;
+            }
+            if (!t->nmatch || t->match[t->nmatch - 1] != i)
+                add_match(&t->match, &t->nmatch, i);
+        }
+    }
+    proxy_compiled = 1;
+}
+
+static int compare_int(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+/* Every proxy for scheme that could serve host, in list order. */
+static int *match_proxies(char *scheme, char *host, int fMatchEnd)
+{
+    struct ProxyScheme *s = find_scheme(scheme, 0);
+    struct ProxyTrie *t;
+    struct ProxyDomain *pd;
+    int *match = NULL, n = 0, i, j;
+    char *c;
+
+    if (s) {
+        for (i = 0; i < s->nany; i++)
+            add_match(&match, &n, s->any[i]);
+
+        if (fMatchEnd) {
+            t = s->trie;
+            for (c = host + strlen(host) - 1; c >= host && t; c--) {
+                for (; t && t->c != *c; t = t->sibling)
+                    ;
+                if (!t)
+                    break;
+                for (i = 0; i < t->nmatch; i++)
+                    add_match(&match, &n, t->match[i]);
+                t = t->child;
+            }
+        } else {
+            /* Anything that is not a host is matched at the start. */
+            for (i = 0; i < proxy_count; i++) {
+                if (!proxy_order[i]->scheme || strcmp(proxy_order[i]->scheme, scheme))
+                    continue;
+                for (pd = proxy_order[i]->list; pd; pd = pd->next)
+                    if (!strncmp(host, pd->domain, strlen(pd->domain)))
+                        break;
+                if (pd)
+                    add_match(&match, &n, i);
+            }
+        }
+    }
+
+    qsort(match, n, sizeof(int), compare_int);
+    for (i = j = 0; i < n; i++)
+        if (j == 0 || match[j - 1] != match[i])
+            match[j++] = match[i];
+    add_match(&match, &j, -1);
+    return match;
+}
+
+static unsigned int memo_hash(char *scheme, char *host, int fMatchEnd)
+{
+    unsigned int h = fMatchEnd;
+
+    while (*scheme)
+        h = h * 31 + (unsigned char)*scheme++;
+    h = h * 31 + ' ';
+    while (*host)
+        h = h * 31 + (unsigned char)*host++;
+    return h % PROXY_MEMO_SIZE;
+}
+
+/* Does memo entry m hold the answer for scheme and host? */
+static int memo_is(struct ProxyMemo *m, char *scheme, char *host, int fMatchEnd)
+{
+    int len = strlen(scheme);
+
+    return m->key && m->fMatchEnd == fMatchEnd && !strncmp(m->key, scheme, len) &&
+        m->key[len] == ' ' && !strcmp(m->key + len + 1, host);
+}
+
+static void memo_fill(struct ProxyMemo *m, char *scheme, char *host, int fMatchEnd)
+{
+    if (m->key)
+        free(m->key);
+    if (m->match)
+        free(m->match);
+    m->key = (char *)malloc(strlen(scheme) + strlen(host) + 2);
+    sprintf(m->key, "%s %s", scheme, host);
+    m->fMatchEnd = fMatchEnd;
+    m->match = NULL;
+    m->noproxy = NULL;
+}
+
+/*
+ * The first live proxy for scheme that serves access (a host, or
+ * else what follows the scheme, when fMatchEnd is 0), or NULL.  If
+ * url is not NULL it is set to "transport://address:port/" for the
+ * proxy; the string belongs to the compiled rules.
+ */
+struct Proxy *MatchProxy(char *scheme, char *access, int fMatchEnd, char **url)
+{
+    struct ProxyMemo *m;
+    int *i;
+
+    if (url)
+        *url = NULL;
+    if ((access == NULL) || (scheme == NULL) || !proxy_list)
+        return NULL;
+    if (!proxy_compiled)
+        compile_proxies();
+
+    m = &proxy_memo[memo_hash(scheme, access, fMatchEnd)];
+    if (!memo_is(m, scheme, access, fMatchEnd)) {
+        memo_fill(m, scheme, access, fMatchEnd);
+        m->match = match_proxies(scheme, access, fMatchEnd);
+    }
+
+    for (i = m->match; *i >= 0; i++)
+        if (!proxy_order[*i]->alive) {
+            if (url)
+                *url = proxy_urls[*i];
+            return proxy_order[*i];
+        }
+    return NULL;
+}
+
+/*
+ * The no-proxy entry matching site, which may end in ":port", for
+ * the given access scheme, or NULL.  As ever, a ":port" on site is
+ * cut off.
+ */
+struct Proxy *MatchNoProxy(char *access, char *site)
+{
+    struct ProxyMemo *m;
+    struct Proxy *p;
+    char *port = NULL;
+    int portnum = -1;
+
+    if ((access == NULL) || (site == NULL))
+        return NULL;
+
+    if ((port = strchr(site, ':')) != NULL) {
+        *port++ = 0;
+        portnum = atoi(port);
+    } else {
+        if (!strcmp(access, "http"))
+            portnum = 80;
+        else if (!strcmp(access, "gopher"))
+            portnum = 70;
+        else if (!strcmp(access, "ftp"))
+            portnum = 21;
+        else if (!strcmp(access, "wais"))
+            portnum = 210;
+    }
+    if (!noproxy_list)
+        return NULL;
+
+    /* The memo is keyed on the port number and site. */
+    m = &noproxy_memo[memo_hash(access, site, portnum)];
+    if (memo_is(m, access, site, portnum))
+        return m->noproxy;
+
+    /* Not in the proxy trie: a no-proxy address matches anywhere in
+       the site, not just at the end, so a suffix trie cannot answer
+       it.  The memo means each site is only looked for once. */
+    for (p = noproxy_list; p != NULL; p = p->next) {
+        if (strstr(site, p->address)) {
+            if (p->port == NULL) {
+                break;
+            } else {
+                int match_port = atoi(p->port);
+                if (match_port == portnum)
+                    break;
+            }
+        }
+    }
+
+    memo_fill(m, access, site, portnum);
+    m->noproxy = p;
+    return p;
+}
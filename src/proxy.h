@@ -95,3 +95,9 @@ struct Proxy *ReadNoProxies(char *filename);
 struct ProxyDomain *AddProxyDomain(char *sbDomain, struct ProxyDomain **pdList);
 
 void DeleteProxyDomain(struct ProxyDomain *p);
+
+struct Proxy *MatchProxy(char *scheme, char *access, int fMatchEnd, char **url);
+
+struct Proxy *MatchNoProxy(char *access, char *site);
+
+void ProxyRulesChanged(void);
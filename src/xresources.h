@@ -112,6 +112,8 @@ static XtResource resources[] = {
       offset (cciPort), XtRString, "0" },
   { "maxNumCCIConnect","MaxNumCCIConnect",XtRInt,sizeof (int),
       offset (max_num_of_cci_connections), XtRString, "0" },
+  { "maxCCIRequestsInFlight","MaxCCIRequestsInFlight",XtRInt,sizeof (int),
+      offset (max_cci_requests_in_flight), XtRString, "8" },
   { "loadLocalFile","LoadLocalFile",XtRInt,sizeof(int),
       offset (load_local_file), XtRString, "1"},
   { "editCommand", "EditCommand", XtRString, sizeof (char *),
@@ -593,6 +595,7 @@ static XrmOptionDescRec options[] = {
   {"-kioskNoExit",  "*kioskNoExit",   XrmoptionNoArg,  "True"},
   {"-cciPort",  "*cciPort",   	      XrmoptionSepArg,  "0"},
   {"-maxNumCCIConnect",  "*maxNumCCIConnect",  XrmoptionSepArg,  "0"},
+  {"-maxCCIRequestsInFlight",  "*maxCCIRequestsInFlight",  XrmoptionSepArg,  "8"},
   {"-install",  "*nothingUseful",     XrmoptionNoArg,  "True"},
 };
 